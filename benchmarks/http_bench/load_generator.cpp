@@ -0,0 +1,554 @@
+#include "load_generator.h"
+
+#include <httpserver/unix_socket.h>
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <openssl/err.h>
+#include <openssl/ssl.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace HttpBench {
+
+namespace {
+
+constexpr uint64_t kNsPerSec = 1000000000ULL;
+constexpr uint64_t kReconnectBackoffNs = 10000000ULL;
+constexpr uint64_t kMaxWaitNs = 10000000ULL;
+constexpr size_t kReadChunk = 16384;
+
+uint64_t nowNs() {
+    timespec ts{};
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * kNsPerSec + static_cast<uint64_t>(ts.tv_nsec);
+}
+
+bool iequalsPrefix(std::string_view text, std::string_view prefix) {
+    if (text.size() < prefix.size()) return false;
+    for (size_t i = 0; i < prefix.size(); i++) {
+        if (std::tolower(static_cast<unsigned char>(text[i])) != std::tolower(static_cast<unsigned char>(prefix[i])))
+            return false;
+    }
+    return true;
+}
+
+struct ParsedResponse {
+    int status = 0;
+    size_t length = 0; // headers + body
+    bool close = false;
+};
+
+// Returns true when 'buffer' starts with a complete response.
+bool parseResponse(std::string_view buffer, ParsedResponse& out) {
+    const size_t headerEnd = buffer.find("\r\n\r\n");
+    if (headerEnd == std::string_view::npos) return false;
+
+    std::string_view head = buffer.substr(0, headerEnd);
+    size_t lineEnd = head.find("\r\n");
+    std::string_view statusLine = head.substr(0, lineEnd);
+
+    size_t space = statusLine.find(' ');
+    out.status = space == std::string_view::npos ? 0 : std::atoi(std::string(statusLine.substr(space + 1, 3)).c_str());
+    out.close = statusLine.starts_with("HTTP/1.0");
+
+    size_t contentLength = 0;
+    while (lineEnd != std::string_view::npos) {
+        size_t start = lineEnd + 2;
+        lineEnd = head.find("\r\n", start);
+        std::string_view line = head.substr(start, lineEnd == std::string_view::npos ? head.npos : lineEnd - start);
+
+        if (iequalsPrefix(line, "content-length:")) {
+            contentLength = std::strtoull(std::string(line.substr(15)).c_str(), nullptr, 10);
+        } else if (iequalsPrefix(line, "connection:")) {
+            std::string_view value = line.substr(11);
+            while (!value.empty() && value.front() == ' ') value.remove_prefix(1);
+            out.close = iequalsPrefix(value, "close");
+        }
+    }
+
+    out.length = headerEnd + 4 + contentLength;
+    return buffer.size() >= out.length;
+}
+
+struct InFlight {
+    uint64_t intendedNs;
+    uint64_t sentNs;
+};
+
+struct Connection {
+    enum class State { Idle, Connecting, Handshaking, Ready };
+
+    State state = State::Idle;
+    int fd = -1;
+    SSL* ssl = nullptr;
+    std::string out;
+    size_t outOffset = 0;
+    std::string in;
+    std::deque<InFlight> inflight;
+    uint64_t nextSendNs = 0;
+    uint64_t lastProgressNs = 0;
+    uint64_t retryAtNs = 0;
+    uint32_t generation = 0; // distinguishes stale epoll events of a previous socket
+};
+
+class Worker {
+  public:
+    Worker(const BenchOptions& options, int connections, const sockaddr_storage& addr, socklen_t addrLen,
+           SSL_CTX* ctx, uint64_t seed)
+        : d_options(options), d_addr(addr), d_addrLen(addrLen), d_ctx(ctx), d_rng(seed | 1),
+          d_connections(connections) {
+        for (const auto& request : options.requests) {
+            d_payloads.push_back(request.method + " " + request.path + " HTTP/1.1\r\nHost: " + options.host + ":" +
+                                 std::to_string(options.port) + "\r\nUser-Agent: http_bench\r\nConnection: " +
+                                 (options.keepAlive ? "keep-alive" : "close") + "\r\n\r\n");
+            d_totalWeight += request.weight;
+            d_cumulativeWeights.push_back(d_totalWeight);
+        }
+
+        if (options.rate > 0) {
+            const double perConnection = options.rate / static_cast<double>(options.connections);
+            d_intervalNs = static_cast<uint64_t>(static_cast<double>(kNsPerSec) / perConnection);
+        }
+    }
+
+    ~Worker() {
+        for (auto& conn : d_connections) {
+            closeConnection(conn);
+        }
+        if (d_epoll >= 0) ::close(d_epoll);
+    }
+
+    void run(uint64_t startNs, uint64_t measureFromNs, uint64_t endNs) {
+        d_epoll = epoll_create1(EPOLL_CLOEXEC);
+        d_measureFromNs = measureFromNs;
+
+        for (size_t i = 0; i < d_connections.size(); i++) {
+            // Spread scheduled sends so connections don't fire in lockstep.
+            d_connections[i].nextSendNs =
+                startNs + (d_intervalNs ? d_intervalNs * i / std::max<size_t>(1, d_connections.size()) : 0);
+            startConnect(d_connections[i], i);
+        }
+
+        std::vector<epoll_event> events(d_connections.size() + 1);
+        while (true) {
+            const uint64_t now = nowNs();
+            if (now >= endNs) break;
+
+            uint64_t wakeAt = endNs;
+            for (size_t i = 0; i < d_connections.size(); i++) {
+                wakeAt = std::min(wakeAt, service(d_connections[i], i, now));
+            }
+
+            const uint64_t waitNs = std::min<uint64_t>(wakeAt > now ? wakeAt - now : 0, kMaxWaitNs);
+            const int n = waitForEvents(events, waitNs);
+
+            for (int e = 0; e < n; e++) {
+                const size_t i = events[e].data.u64 & 0xffffffffULL;
+                const auto generation = static_cast<uint32_t>(events[e].data.u64 >> 32);
+                if (d_connections[i].generation != generation || d_connections[i].fd < 0) continue;
+                onEvent(d_connections[i], i, events[e].events);
+            }
+        }
+
+        d_result.elapsedSec = static_cast<double>(endNs - measureFromNs) / static_cast<double>(kNsPerSec);
+    }
+
+    const BenchResult& result() const { return d_result; }
+
+  private:
+    const std::string& nextPayload() {
+        if (d_payloads.size() == 1) return d_payloads.front();
+
+        d_rng ^= d_rng << 13;
+        d_rng ^= d_rng >> 7;
+        d_rng ^= d_rng << 17;
+        const uint64_t pick = d_rng % d_totalWeight;
+        auto it = std::upper_bound(d_cumulativeWeights.begin(), d_cumulativeWeights.end(), pick);
+        return d_payloads[static_cast<size_t>(it - d_cumulativeWeights.begin())];
+    }
+
+    bool measuring(uint64_t now) const { return now >= d_measureFromNs; }
+
+    // Open loop sends need sub-millisecond wake ups, so prefer the
+    // nanosecond resolution epoll_pwait2 and fall back to epoll_wait (rounding
+    // down, i.e. polling the remainder) on kernels without it.
+    int waitForEvents(std::vector<epoll_event>& events, uint64_t waitNs) {
+        const int capacity = static_cast<int>(events.size());
+#ifdef __GLIBC_PREREQ
+#if __GLIBC_PREREQ(2, 35)
+        if (d_hasPwait2) {
+            timespec timeout{static_cast<time_t>(waitNs / kNsPerSec), static_cast<long>(waitNs % kNsPerSec)};
+            int n = epoll_pwait2(d_epoll, events.data(), capacity, &timeout, nullptr);
+            if (n >= 0 || errno != ENOSYS) return n;
+            d_hasPwait2 = false;
+        }
+#endif
+#endif
+        return epoll_wait(d_epoll, events.data(), capacity, static_cast<int>(waitNs / 1000000));
+    }
+
+    void startConnect(Connection& conn, size_t index) {
+        conn.fd = socket(d_addr.ss_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (conn.fd < 0) {
+            failConnect(conn, nowNs());
+            return;
+        }
+
+        int one = 1;
+        setsockopt(conn.fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        if (d_options.fastOpen) setsockopt(conn.fd, IPPROTO_TCP, TCP_FASTOPEN_CONNECT, &one, sizeof(one));
+
+        if (connect(conn.fd, reinterpret_cast<const sockaddr*>(&d_addr), d_addrLen) < 0 && errno != EINPROGRESS) {
+            failConnect(conn, nowNs());
+            return;
+        }
+
+        epoll_event ev{};
+        ev.events = EPOLLIN | EPOLLOUT | EPOLLET | EPOLLRDHUP;
+        conn.generation++;
+        ev.data.u64 = (static_cast<uint64_t>(conn.generation) << 32) | index;
+        epoll_ctl(d_epoll, EPOLL_CTL_ADD, conn.fd, &ev);
+
+        conn.state = Connection::State::Connecting;
+        conn.lastProgressNs = nowNs();
+    }
+
+    void failConnect(Connection& conn, uint64_t now) {
+        if (measuring(now)) d_result.connectErrors++;
+        closeConnection(conn);
+        conn.retryAtNs = now + kReconnectBackoffNs;
+    }
+
+    void closeConnection(Connection& conn) {
+        if (conn.ssl) {
+            SSL_free(conn.ssl);
+            conn.ssl = nullptr;
+        }
+        if (conn.fd >= 0) {
+            ::close(conn.fd);
+            conn.fd = -1;
+        }
+        conn.state = Connection::State::Idle;
+        conn.out.clear();
+        conn.outOffset = 0;
+        conn.in.clear();
+    }
+
+    // Requests that were in flight on a dropped connection are re-issued on
+    // the next one with their original intended send time.
+    void reconnect(Connection& conn, size_t index, uint64_t now) {
+        for (auto& pending : conn.inflight) {
+            conn.nextSendNs = std::min(conn.nextSendNs, pending.intendedNs);
+        }
+        conn.inflight.clear();
+        closeConnection(conn);
+        conn.retryAtNs = now;
+        startConnect(conn, index);
+    }
+
+    // Issues due requests and returns the next time this connection needs
+    // attention without an I/O event.
+    uint64_t service(Connection& conn, size_t index, uint64_t now) {
+        if (conn.state == Connection::State::Idle) {
+            if (now < conn.retryAtNs) return conn.retryAtNs;
+            startConnect(conn, index);
+            return now + kReconnectBackoffNs;
+        }
+
+        if (!conn.inflight.empty() || conn.state != Connection::State::Ready) {
+            const uint64_t deadline = conn.lastProgressNs + static_cast<uint64_t>(d_options.timeoutMs) * 1000000ULL;
+            if (now >= deadline) {
+                if (measuring(now)) d_result.timeouts += std::max<size_t>(1, conn.inflight.size());
+                reconnect(conn, index, now);
+                return now;
+            }
+            if (conn.state != Connection::State::Ready) return deadline;
+        }
+
+        const size_t depth = d_options.keepAlive ? static_cast<size_t>(d_options.pipeline) : 1;
+        bool queued = false;
+        while (conn.inflight.size() < depth && (d_intervalNs == 0 || conn.nextSendNs <= now)) {
+            const uint64_t intended = d_intervalNs ? conn.nextSendNs : now;
+            conn.inflight.push_back({intended, now});
+            conn.out.append(nextPayload());
+            if (d_intervalNs) conn.nextSendNs += d_intervalNs;
+            queued = true;
+        }
+
+        if (queued) {
+            if (conn.inflight.size() == 1) conn.lastProgressNs = now;
+            flush(conn, index);
+        }
+
+        if (d_intervalNs && conn.inflight.size() < depth) return conn.nextSendNs;
+        return now + static_cast<uint64_t>(d_options.timeoutMs) * 1000000ULL;
+    }
+
+    void onEvent(Connection& conn, size_t index, uint32_t events) {
+        const uint64_t now = nowNs();
+
+        if (conn.state == Connection::State::Connecting) {
+            int err = 0;
+            socklen_t len = sizeof(err);
+            getsockopt(conn.fd, SOL_SOCKET, SO_ERROR, &err, &len);
+            if (err != 0 || (events & EPOLLERR)) {
+                failConnect(conn, now);
+                return;
+            }
+            if (!(events & EPOLLOUT)) return;
+
+            if (measuring(now)) d_result.connects++;
+            if (d_ctx) {
+                conn.ssl = SSL_new(d_ctx);
+                SSL_set_fd(conn.ssl, conn.fd);
+                SSL_set_tlsext_host_name(conn.ssl, d_options.host.c_str());
+                conn.state = Connection::State::Handshaking;
+            } else {
+                conn.state = Connection::State::Ready;
+            }
+            conn.lastProgressNs = now;
+        }
+
+        if (conn.state == Connection::State::Handshaking) {
+            int rc = SSL_connect(conn.ssl);
+            if (rc <= 0) {
+                int err = SSL_get_error(conn.ssl, rc);
+                if (err != SSL_ERROR_WANT_READ && err != SSL_ERROR_WANT_WRITE) failConnect(conn, now);
+                return;
+            }
+            conn.state = Connection::State::Ready;
+            conn.lastProgressNs = now;
+            service(conn, index, now);
+            return;
+        }
+
+        if (conn.state != Connection::State::Ready) return;
+
+        if (events & EPOLLOUT) flush(conn, index);
+        if (events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) readResponses(conn, index, now);
+    }
+
+    void flush(Connection& conn, size_t index) {
+        while (conn.outOffset < conn.out.size()) {
+            const char* data = conn.out.data() + conn.outOffset;
+            const size_t size = conn.out.size() - conn.outOffset;
+
+            ssize_t written;
+            if (conn.ssl) {
+                written = SSL_write(conn.ssl, data, static_cast<int>(size));
+                if (written <= 0) {
+                    int err = SSL_get_error(conn.ssl, static_cast<int>(written));
+                    if (err == SSL_ERROR_WANT_WRITE || err == SSL_ERROR_WANT_READ) return;
+                }
+            } else {
+                written = send(conn.fd, data, size, MSG_NOSIGNAL);
+                if (written < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return;
+            }
+
+            if (written <= 0) {
+                if (measuring(nowNs())) d_result.ioErrors++;
+                reconnect(conn, index, nowNs());
+                return;
+            }
+            conn.outOffset += static_cast<size_t>(written);
+        }
+        conn.out.clear();
+        conn.outOffset = 0;
+    }
+
+    void readResponses(Connection& conn, size_t index, uint64_t now) {
+        char chunk[kReadChunk];
+        bool peerClosed = false;
+
+        while (true) {
+            ssize_t n;
+            if (conn.ssl) {
+                n = SSL_read(conn.ssl, chunk, sizeof(chunk));
+                if (n <= 0) {
+                    int err = SSL_get_error(conn.ssl, static_cast<int>(n));
+                    if (err == SSL_ERROR_WANT_READ || err == SSL_ERROR_WANT_WRITE) break;
+                    peerClosed = true;
+                    break;
+                }
+            } else {
+                n = recv(conn.fd, chunk, sizeof(chunk), 0);
+                if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+                if (n <= 0) {
+                    peerClosed = true;
+                    break;
+                }
+            }
+            conn.in.append(chunk, static_cast<size_t>(n));
+            if (measuring(now)) d_result.bytesRead += static_cast<uint64_t>(n);
+        }
+
+        const uint64_t completedAt = nowNs();
+        size_t consumed = 0;
+        bool mustClose = false;
+        ParsedResponse response;
+        while (!conn.inflight.empty() &&
+               parseResponse(std::string_view(conn.in).substr(consumed), response)) {
+            const InFlight request = conn.inflight.front();
+            conn.inflight.pop_front();
+            consumed += response.length;
+            conn.lastProgressNs = completedAt;
+
+            if (measuring(completedAt)) {
+                d_result.completed++;
+                d_result.statusCounts[response.status]++;
+                d_result.latency.record(completedAt - request.intendedNs);
+                d_result.serviceTime.record(completedAt - request.sentNs);
+            }
+
+            if (response.close || !d_options.keepAlive) {
+                mustClose = true;
+                break;
+            }
+        }
+        conn.in.erase(0, consumed);
+
+        if (mustClose || peerClosed) {
+            if (peerClosed && !mustClose && !conn.inflight.empty() && measuring(completedAt)) d_result.ioErrors++;
+            reconnect(conn, index, completedAt);
+            return;
+        }
+
+        service(conn, index, completedAt);
+    }
+
+    const BenchOptions& d_options;
+    sockaddr_storage d_addr;
+    socklen_t d_addrLen;
+    SSL_CTX* d_ctx;
+    uint64_t d_rng;
+    std::vector<Connection> d_connections;
+    std::vector<std::string> d_payloads;
+    std::vector<uint64_t> d_cumulativeWeights;
+    uint64_t d_totalWeight = 0;
+    uint64_t d_intervalNs = 0;
+    uint64_t d_measureFromNs = 0;
+    int d_epoll = -1;
+    bool d_hasPwait2 = true;
+    BenchResult d_result;
+};
+
+bool resolve(const std::string& host, int port, sockaddr_storage& addr, socklen_t& len) {
+    addrinfo hints{};
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* result = nullptr;
+    if (getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &result) != 0 || !result) return false;
+
+    std::memcpy(&addr, result->ai_addr, result->ai_addrlen);
+    len = result->ai_addrlen;
+    freeaddrinfo(result);
+    return true;
+}
+
+} // namespace
+
+void BenchResult::merge(const BenchResult& other) {
+    elapsedSec = std::max(elapsedSec, other.elapsedSec);
+    completed += other.completed;
+    bytesRead += other.bytesRead;
+    connects += other.connects;
+    connectErrors += other.connectErrors;
+    ioErrors += other.ioErrors;
+    timeouts += other.timeouts;
+    for (const auto& [status, count] : other.statusCounts) {
+        statusCounts[status] += count;
+    }
+    latency.merge(other.latency);
+    serviceTime.merge(other.serviceTime);
+}
+
+uint64_t BenchResult::non2xx() const {
+    uint64_t total = 0;
+    for (const auto& [status, count] : statusCounts) {
+        if (status < 200 || status >= 300) total += count;
+    }
+    return total;
+}
+
+HTTPServer::HistogramSnapshot correctForCoordinatedOmission(const HTTPServer::HistogramSnapshot& raw,
+                                                            uint64_t expectedIntervalNs) {
+    HTTPServer::HistogramSnapshot corrected = raw;
+    if (expectedIntervalNs == 0) return corrected;
+
+    for (size_t i = 0; i < raw.buckets.size(); i++) {
+        const uint64_t count = raw.buckets[i];
+        if (count == 0) continue;
+
+        const uint64_t value =
+            (HTTPServer::HistogramBuckets::lowerBound(i) + HTTPServer::HistogramBuckets::upperBound(i)) / 2;
+        for (uint64_t missing = value > expectedIntervalNs ? value - expectedIntervalNs : 0;
+             missing >= expectedIntervalNs; missing -= expectedIntervalNs) {
+            corrected.buckets[HTTPServer::HistogramBuckets::indexFor(missing)] += count;
+            corrected.count += count;
+            corrected.sum += missing * count;
+        }
+    }
+    return corrected;
+}
+
+BenchResult runBenchmark(const BenchOptions& options) {
+    BenchResult total;
+
+    sockaddr_storage addr{};
+    socklen_t addrLen = 0;
+    const bool resolved =
+        options.unixPath.empty()
+            ? resolve(options.host, options.port, addr, addrLen)
+            : HTTPServer::UnixSocket::makeAddress(options.unixPath, reinterpret_cast<sockaddr_un&>(addr), addrLen);
+    if (!resolved) {
+        total.connectErrors = 1;
+        return total;
+    }
+
+    std::unique_ptr<SSL_CTX, decltype(&SSL_CTX_free)> ctx(nullptr, SSL_CTX_free);
+    if (options.tls) {
+        ctx.reset(SSL_CTX_new(TLS_client_method()));
+        SSL_CTX_set_verify(ctx.get(), SSL_VERIFY_NONE, nullptr);
+        SSL_CTX_set_mode(ctx.get(), SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER | SSL_MODE_ENABLE_PARTIAL_WRITE);
+    }
+
+    const int threads = std::max(1, std::min(options.threads, options.connections));
+    std::vector<std::unique_ptr<Worker>> workers;
+    for (int t = 0; t < threads; t++) {
+        const int connections = options.connections / threads + (t < options.connections % threads ? 1 : 0);
+        workers.push_back(std::make_unique<Worker>(options, connections, addr, addrLen, ctx.get(),
+                                                   0x9e3779b97f4a7c15ULL * static_cast<uint64_t>(t + 1)));
+    }
+
+    const uint64_t start = nowNs();
+    const uint64_t measureFrom = start + static_cast<uint64_t>(options.warmupSec * static_cast<double>(kNsPerSec));
+    const uint64_t end = measureFrom + static_cast<uint64_t>(options.durationSec * static_cast<double>(kNsPerSec));
+
+    std::vector<std::thread> running;
+    for (auto& worker : workers) {
+        running.emplace_back([&worker, start, measureFrom, end]() { worker->run(start, measureFrom, end); });
+    }
+    for (auto& thread : running) thread.join();
+
+    for (const auto& worker : workers) {
+        total.merge(worker->result());
+    }
+    return total;
+}
+
+} // namespace HttpBench
@@ -0,0 +1,66 @@
+#ifndef HTTP_BENCH_LOAD_GENERATOR_H
+#define HTTP_BENCH_LOAD_GENERATOR_H
+
+#include <httpserver/metrics.h>
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace HttpBench {
+
+struct RequestTemplate {
+    std::string method = "GET";
+    std::string path = "/";
+    unsigned weight = 1;
+};
+
+struct BenchOptions {
+    std::string host = "127.0.0.1";
+    int port = 8080;
+    std::string unixPath; // connect here instead of host:port when set
+    bool tls = false;
+    bool fastOpen = false; // TCP_FASTOPEN_CONNECT: send the request in the SYN once a cookie is held
+    int connections = 16;
+    int threads = 2;
+    double durationSec = 10.0;
+    double warmupSec = 1.0;
+    bool keepAlive = true;
+    int pipeline = 1;
+    double rate = 0.0; // total requests/second, 0 = closed loop (as fast as possible)
+    int timeoutMs = 2000;
+    std::vector<RequestTemplate> requests;
+};
+
+struct BenchResult {
+    double elapsedSec = 0.0;
+    uint64_t completed = 0;
+    uint64_t bytesRead = 0;
+    uint64_t connects = 0;
+    uint64_t connectErrors = 0;
+    uint64_t ioErrors = 0;
+    uint64_t timeouts = 0;
+    std::map<int, uint64_t> statusCounts;
+
+    // Nanoseconds. 'latency' is measured from the time the request was
+    // scheduled to be sent (open loop) and so includes queueing caused by a
+    // stalled server; 'serviceTime' is measured from the actual send.
+    HTTPServer::HistogramSnapshot latency;
+    HTTPServer::HistogramSnapshot serviceTime;
+
+    void merge(const BenchResult&);
+    uint64_t non2xx() const;
+};
+
+BenchResult runBenchmark(const BenchOptions&);
+
+// Post-hoc coordinated omission correction for closed loop runs (as done by
+// HdrHistogram): every sample larger than the expected interval implies the
+// samples a non-stalled client would have taken while it was waiting.
+HTTPServer::HistogramSnapshot correctForCoordinatedOmission(const HTTPServer::HistogramSnapshot&,
+                                                            uint64_t expectedIntervalNs);
+
+} // namespace HttpBench
+
+#endif
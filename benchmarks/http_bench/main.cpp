@@ -0,0 +1,183 @@
+#include "load_generator.h"
+
+#include <httpserver/metrics.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+using namespace HttpBench;
+
+namespace {
+
+constexpr double kPercentiles[] = {50.0, 75.0, 90.0, 99.0, 99.9, 99.99, 100.0};
+
+void usage(const char* argv0) {
+    std::cerr
+        << "Usage: " << argv0 << " [options]\n"
+        << "  -h, --host HOST         Target host (default 127.0.0.1)\n"
+        << "  -p, --port PORT         Target port (default 8080)\n"
+        << "  -u, --unix PATH         Connect to a Unix domain socket instead ('@' for abstract)\n"
+        << "  -c, --connections N     Concurrent connections (default 16)\n"
+        << "  -t, --threads N         Client threads (default 2)\n"
+        << "  -d, --duration SEC      Measured duration (default 10)\n"
+        << "  -w, --warmup SEC        Warm-up before measuring (default 1)\n"
+        << "  -r, --rate RPS          Total request rate; enables open-loop, coordinated\n"
+        << "                          omission free latency (default: closed loop)\n"
+        << "  -P, --pipeline N        Requests in flight per connection (default 1)\n"
+        << "      --no-keep-alive     One request per connection\n"
+        << "      --tls               Use HTTPS (certificates are not verified)\n"
+        << "      --fast-open         Use TCP Fast Open once the server has issued a cookie\n"
+        << "      --path PATH[=W]     Request path with optional weight, repeatable (default /)\n"
+        << "      --timeout MS        Per-request timeout (default 2000)\n"
+        << "      --json              Print the report as JSON\n";
+}
+
+std::string formatNs(uint64_t ns) {
+    char buf[32];
+    if (ns >= 1000000000ULL) {
+        std::snprintf(buf, sizeof(buf), "%.2fs", static_cast<double>(ns) / 1e9);
+    } else if (ns >= 1000000ULL) {
+        std::snprintf(buf, sizeof(buf), "%.2fms", static_cast<double>(ns) / 1e6);
+    } else {
+        std::snprintf(buf, sizeof(buf), "%.2fus", static_cast<double>(ns) / 1e3);
+    }
+    return buf;
+}
+
+void printPercentiles(const char* title, const HTTPServer::HistogramSnapshot& histogram) {
+    std::printf("  %s\n", title);
+    for (double p : kPercentiles) {
+        std::printf("    p%-7g %s\n", p, formatNs(histogram.percentile(p)).c_str());
+    }
+}
+
+void printJsonPercentiles(const char* name, const HTTPServer::HistogramSnapshot& histogram, bool last) {
+    std::printf("  \"%s\": {", name);
+    bool first = true;
+    for (double p : kPercentiles) {
+        std::printf("%s\"p%g\": %llu", first ? "" : ", ", p, static_cast<unsigned long long>(histogram.percentile(p)));
+        first = false;
+    }
+    std::printf("}%s\n", last ? "" : ",");
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    BenchOptions options;
+    bool json = false;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        auto value = [&]() -> std::string {
+            if (i + 1 >= argc) {
+                usage(argv[0]);
+                std::exit(2);
+            }
+            return argv[++i];
+        };
+
+        if (arg == "-h" || arg == "--host") {
+            options.host = value();
+        } else if (arg == "-p" || arg == "--port") {
+            options.port = std::stoi(value());
+        } else if (arg == "-u" || arg == "--unix") {
+            options.unixPath = value();
+        } else if (arg == "-c" || arg == "--connections") {
+            options.connections = std::stoi(value());
+        } else if (arg == "-t" || arg == "--threads") {
+            options.threads = std::stoi(value());
+        } else if (arg == "-d" || arg == "--duration") {
+            options.durationSec = std::stod(value());
+        } else if (arg == "-w" || arg == "--warmup") {
+            options.warmupSec = std::stod(value());
+        } else if (arg == "-r" || arg == "--rate") {
+            options.rate = std::stod(value());
+        } else if (arg == "-P" || arg == "--pipeline") {
+            options.pipeline = std::stoi(value());
+        } else if (arg == "--no-keep-alive") {
+            options.keepAlive = false;
+        } else if (arg == "--tls") {
+            options.tls = true;
+        } else if (arg == "--fast-open") {
+            options.fastOpen = true;
+        } else if (arg == "--timeout") {
+            options.timeoutMs = std::stoi(value());
+        } else if (arg == "--path") {
+            std::string spec = value();
+            RequestTemplate request;
+            auto eq = spec.rfind('=');
+            if (eq != std::string::npos && spec.find('?') == std::string::npos) {
+                request.weight = static_cast<unsigned>(std::stoul(spec.substr(eq + 1)));
+                spec = spec.substr(0, eq);
+            }
+            request.path = spec;
+            options.requests.push_back(request);
+        } else if (arg == "--json") {
+            json = true;
+        } else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+
+    if (options.requests.empty()) options.requests.push_back(RequestTemplate{});
+    if (options.connections <= 0 || options.pipeline <= 0 || options.durationSec <= 0) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    BenchResult result = runBenchmark(options);
+
+    // In closed loop mode each connection would ideally issue a request
+    // every mean-service-time, which is the interval used for correction.
+    HTTPServer::HistogramSnapshot corrected = result.latency;
+    if (options.rate <= 0 && result.serviceTime.count > 0) {
+        const uint64_t expected = result.serviceTime.sum / result.serviceTime.count;
+        corrected = correctForCoordinatedOmission(result.serviceTime, expected);
+    }
+
+    const double rps = result.elapsedSec > 0 ? static_cast<double>(result.completed) / result.elapsedSec : 0.0;
+    const double mbps = result.elapsedSec > 0 ? static_cast<double>(result.bytesRead) / result.elapsedSec / 1e6 : 0.0;
+
+    if (json) {
+        std::printf("{\n");
+        std::printf("  \"target\": \"%s:%d\",\n  \"tls\": %s,\n  \"connections\": %d,\n  \"pipeline\": %d,\n",
+                    options.host.c_str(), options.port, options.tls ? "true" : "false", options.connections,
+                    options.pipeline);
+        std::printf("  \"keep_alive\": %s,\n  \"target_rate\": %g,\n  \"duration_s\": %.3f,\n",
+                    options.keepAlive ? "true" : "false", options.rate, result.elapsedSec);
+        std::printf("  \"requests\": %llu,\n  \"rps\": %.1f,\n  \"read_mb_per_s\": %.3f,\n",
+                    static_cast<unsigned long long>(result.completed), rps, mbps);
+        std::printf("  \"errors\": {\"connect\": %llu, \"io\": %llu, \"timeout\": %llu, \"non_2xx\": %llu},\n",
+                    static_cast<unsigned long long>(result.connectErrors),
+                    static_cast<unsigned long long>(result.ioErrors), static_cast<unsigned long long>(result.timeouts),
+                    static_cast<unsigned long long>(result.non2xx()));
+        printJsonPercentiles("latency_ns", corrected, false);
+        printJsonPercentiles("service_time_ns", result.serviceTime, true);
+        std::printf("}\n");
+    } else {
+        std::printf("Target %s://%s:%d, %d connections, %d threads, pipeline %d, %s\n", options.tls ? "https" : "http",
+                    options.host.c_str(), options.port, options.connections, options.threads, options.pipeline,
+                    options.keepAlive ? "keep-alive" : "no keep-alive");
+        if (options.rate > 0) {
+            std::printf("Open loop at %g req/s\n", options.rate);
+        } else {
+            std::printf("Closed loop (latency corrected post-hoc for coordinated omission)\n");
+        }
+        std::printf("\n  %llu requests in %.2fs, %.2f MB read\n", static_cast<unsigned long long>(result.completed),
+                    result.elapsedSec, static_cast<double>(result.bytesRead) / 1e6);
+        std::printf("  Requests/sec: %.1f\n  Transfer/sec: %.2f MB\n", rps, mbps);
+        std::printf("  Errors: connect %llu, io %llu, timeout %llu, non-2xx %llu\n\n",
+                    static_cast<unsigned long long>(result.connectErrors),
+                    static_cast<unsigned long long>(result.ioErrors), static_cast<unsigned long long>(result.timeouts),
+                    static_cast<unsigned long long>(result.non2xx()));
+        printPercentiles("Latency (coordinated omission corrected)", corrected);
+        printPercentiles("Service time (uncorrected)", result.serviceTime);
+    }
+
+    return result.completed > 0 ? 0 : 1;
+}
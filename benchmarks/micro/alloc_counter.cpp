@@ -0,0 +1,55 @@
+#include "alloc_counter.h"
+
+#include <cstdlib>
+#include <new>
+
+namespace {
+
+thread_local uint64_t t_allocations = 0;
+thread_local uint64_t t_bytes = 0;
+
+void* countedAlloc(std::size_t size) {
+    t_allocations++;
+    t_bytes += size;
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void* countedAlignedAlloc(std::size_t size, std::align_val_t alignment) {
+    t_allocations++;
+    t_bytes += size;
+    const auto align = static_cast<std::size_t>(alignment);
+    if (void* p = std::aligned_alloc(align, (size + align - 1) / align * align)) return p;
+    throw std::bad_alloc();
+}
+
+} // namespace
+
+void* operator new(std::size_t size) { return countedAlloc(size); }
+void* operator new[](std::size_t size) { return countedAlloc(size); }
+void* operator new(std::size_t size, std::align_val_t alignment) { return countedAlignedAlloc(size, alignment); }
+void* operator new[](std::size_t size, std::align_val_t alignment) { return countedAlignedAlloc(size, alignment); }
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+void operator delete(void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+
+namespace MicroBench {
+
+AllocStats threadAllocStats() { return {t_allocations, t_bytes}; }
+
+AllocScope::~AllocScope() {
+    const AllocStats end = threadAllocStats();
+    const auto iterations = static_cast<double>(d_state.iterations());
+    if (iterations == 0) return;
+
+    d_state.counters["allocs"] = static_cast<double>(end.allocations - d_start.allocations) / iterations;
+    d_state.counters["alloc_bytes"] = static_cast<double>(end.bytes - d_start.bytes) / iterations;
+}
+
+} // namespace MicroBench
@@ -0,0 +1,33 @@
+#ifndef MICRO_ALLOC_COUNTER_H
+#define MICRO_ALLOC_COUNTER_H
+
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+
+namespace MicroBench {
+
+// Heap activity of the calling thread, counted by the global operator
+// new/delete replacements in alloc_counter.cpp.
+struct AllocStats {
+    uint64_t allocations = 0;
+    uint64_t bytes = 0;
+};
+
+AllocStats threadAllocStats();
+
+// Measures allocations made by the benchmark loop and reports them as
+// per-iteration counters ("allocs", "alloc_bytes") in the benchmark output.
+class AllocScope {
+  public:
+    explicit AllocScope(benchmark::State& state) : d_state(state), d_start(threadAllocStats()) {}
+    ~AllocScope();
+
+  private:
+    benchmark::State& d_state;
+    AllocStats d_start;
+};
+
+} // namespace MicroBench
+
+#endif
@@ -0,0 +1,55 @@
+#include "alloc_counter.h"
+
+#include <benchmark/benchmark.h>
+#include <httpserver/http_object.h>
+#include <httpserver/http_response_builder.h>
+
+#include <string>
+
+using namespace HTTPServer;
+
+namespace {
+
+HttpRequest makeRequest() {
+    HttpRequest request;
+    request.method = "GET";
+    request.path = "/index.html";
+    request.version = "HTTP/1.1";
+    request.headers["Host"] = "localhost";
+    return request;
+}
+
+void BM_HttpResponse_SerializeSmall(benchmark::State& state) {
+    HttpResponse response = Responses::ok(makeRequest(), "Hello, world!");
+    MicroBench::AllocScope allocs(state);
+    for (auto _ : state) {
+        auto payload = response.serialize();
+        benchmark::DoNotOptimize(payload);
+    }
+}
+
+void BM_HttpResponse_SerializeBody(benchmark::State& state) {
+    HttpResponse response = Responses::ok(makeRequest(), std::string(static_cast<size_t>(state.range(0)), 'x'),
+                                          "text/html");
+    MicroBench::AllocScope allocs(state);
+    for (auto _ : state) {
+        auto payload = response.serialize();
+        benchmark::DoNotOptimize(payload);
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * state.range(0)));
+}
+
+void BM_Responses_Ok(benchmark::State& state) {
+    const HttpRequest request = makeRequest();
+    MicroBench::AllocScope allocs(state);
+    for (auto _ : state) {
+        HttpResponse response = Responses::ok(request, "Hello, world!");
+        benchmark::DoNotOptimize(response);
+    }
+}
+
+} // namespace
+
+BENCHMARK(BM_HttpResponse_SerializeSmall);
+BENCHMARK(BM_HttpResponse_SerializeBody)->Arg(1 << 10)->Arg(64 << 10)->Arg(1 << 20);
+BENCHMARK(BM_Responses_Ok);
@@ -0,0 +1,77 @@
+#include "alloc_counter.h"
+
+#include <benchmark/benchmark.h>
+#include <httpserver/http_object.h>
+#include <httpserver/http_response_builder.h>
+#include <httpserver/router.h>
+
+#include <string>
+
+using namespace HTTPServer;
+
+namespace {
+
+constexpr int kStaticRoutes = 300;
+constexpr int kDynamicRoutes = 100;
+constexpr int kWildcardRoutes = 20;
+
+// Router is a process wide singleton, so the route table is built once for
+// all router benchmarks.
+void registerRoutes() {
+    static bool registered = false;
+    if (registered) return;
+    registered = true;
+
+    auto handler = [](const HttpRequest& req) { return Responses::ok(req, "ok"); };
+    for (int i = 0; i < kStaticRoutes; i++) {
+        Router::instance().addRoute("GET", "/api/v1/resource" + std::to_string(i), handler);
+    }
+    for (int i = 0; i < kDynamicRoutes; i++) {
+        Router::instance().addRoute("GET", "/api/v2/collection" + std::to_string(i) + "/{id}/items/{item}", handler);
+    }
+    for (int i = 0; i < kWildcardRoutes; i++) {
+        Router::instance().addRoute("GET", "/assets/bundle" + std::to_string(i) + "/*", handler);
+    }
+}
+
+void routePath(benchmark::State& state, const std::string& path) {
+    registerRoutes();
+    MicroBench::AllocScope allocs(state);
+    for (auto _ : state) {
+        HttpRequest request;
+        request.method = "GET";
+        request.path = path;
+        request.version = "HTTP/1.1";
+        benchmark::DoNotOptimize(Router::instance().match(request));
+    }
+}
+
+void BM_Router_Static(benchmark::State& state) { routePath(state, "/api/v1/resource150"); }
+void BM_Router_DynamicFirst(benchmark::State& state) { routePath(state, "/api/v2/collection0/42/items/7"); }
+void BM_Router_DynamicLast(benchmark::State& state) {
+    routePath(state, "/api/v2/collection" + std::to_string(kDynamicRoutes - 1) + "/42/items/7");
+}
+void BM_Router_Wildcard(benchmark::State& state) { routePath(state, "/assets/bundle7/js/app.min.js"); }
+void BM_Router_NotFound(benchmark::State& state) { routePath(state, "/does/not/exist"); }
+
+void BM_Router_RouteAndHandle(benchmark::State& state) {
+    registerRoutes();
+    MicroBench::AllocScope allocs(state);
+    for (auto _ : state) {
+        HttpRequest request;
+        request.method = "GET";
+        request.path = "/api/v1/resource150";
+        request.version = "HTTP/1.1";
+        HttpResponse response = Router::instance().route(request);
+        benchmark::DoNotOptimize(response);
+    }
+}
+
+} // namespace
+
+BENCHMARK(BM_Router_Static);
+BENCHMARK(BM_Router_DynamicFirst);
+BENCHMARK(BM_Router_DynamicLast);
+BENCHMARK(BM_Router_Wildcard);
+BENCHMARK(BM_Router_NotFound);
+BENCHMARK(BM_Router_RouteAndHandle);
@@ -0,0 +1,49 @@
+#include "alloc_counter.h"
+
+#include <benchmark/benchmark.h>
+#include <httpserver/http_object.h>
+#include <httpserver/utils.h>
+
+#include <string>
+#include <vector>
+
+using namespace HTTPServer;
+
+namespace {
+
+void BM_Mime_FromExtension(benchmark::State& state) {
+    const std::vector<std::string> paths = {"public/index.html", "public/css/style.css", "public/js/main.js",
+                                            "public/img/rory.jpeg", "public/data.json", "public/archive.tar.gz",
+                                            "public/README"};
+    MicroBench::AllocScope allocs(state);
+    size_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(Mime::fromExtension(paths[i++ % paths.size()]));
+    }
+}
+
+void BM_RequestWantsKeepAlive_Header(benchmark::State& state) {
+    HttpRequest request;
+    request.version = "HTTP/1.1";
+    request.headers["Connection"] = "Keep-Alive";
+    MicroBench::AllocScope allocs(state);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(requestWantsKeepAlive(request));
+    }
+}
+
+void BM_RequestWantsKeepAlive_Default(benchmark::State& state) {
+    HttpRequest request;
+    request.version = "HTTP/1.1";
+    request.headers["Host"] = "localhost";
+    MicroBench::AllocScope allocs(state);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(requestWantsKeepAlive(request));
+    }
+}
+
+} // namespace
+
+BENCHMARK(BM_Mime_FromExtension);
+BENCHMARK(BM_RequestWantsKeepAlive_Header);
+BENCHMARK(BM_RequestWantsKeepAlive_Default);
@@ -0,0 +1,99 @@
+#ifndef ACCESS_LOG_H
+#define ACCESS_LOG_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+
+#include "httpserver/client_address.h"
+#include "httpserver/phase_timing.h"
+
+namespace HTTPServer {
+
+// On-disk layout of a single access log entry. Records are fixed size so the
+// log can be used as a ring: slot = sequence % capacity. A record is only
+// valid when its 'sequence' field equals the sequence number it was claimed
+// with plus one, which is written last by the producer.
+struct AccessLogRecord {
+    static constexpr size_t kMaxMethodLength = 8;
+    static constexpr size_t kMaxPathLength = 110;
+    static constexpr uint8_t kFlagTLS = 0x01;
+    static constexpr uint8_t kFlagPhases = 0x02;
+    static constexpr uint8_t kFlagUnixSocket = 0x04; // client address unset
+
+    uint64_t sequence;
+    uint64_t timestampNs;
+    uint64_t bytesSent;
+    uint32_t latencyUs;
+    uint16_t status;
+    uint16_t clientPort;
+    uint8_t clientAddr[16];
+    uint32_t phaseUs[kPhaseCount]; // valid when kFlagPhases is set
+    uint8_t flags;
+    uint8_t pathLength;
+    char method[kMaxMethodLength];
+    char path[kMaxPathLength];
+};
+
+static_assert(sizeof(AccessLogRecord) == 192, "AccessLogRecord must stay 192 bytes");
+
+struct AccessLogFileHeader {
+    static constexpr char kMagic[8] = {'H', 'S', 'A', 'L', 'O', 'G', '0', '1'};
+    static constexpr uint32_t kVersion = 2;
+
+    char magic[8];
+    uint32_t version;
+    uint32_t recordSize;
+    uint64_t capacity;
+    uint64_t head;
+    uint8_t reserved[32];
+};
+
+static_assert(sizeof(AccessLogFileHeader) == 64, "AccessLogFileHeader must stay 64 bytes");
+
+struct AccessLogEntry {
+    ClientAddress client;
+    std::string_view method;
+    std::string_view path;
+    int status = 0;
+    uint64_t bytesSent = 0;
+    uint32_t latencyUs = 0;
+    bool tls = false;
+    const std::array<uint64_t, kPhaseCount>* phasesNs = nullptr;
+};
+
+// Binary access log backed by a memory mapped, fixed size ring file. Any
+// number of threads may call append() concurrently: a slot is claimed with a
+// single atomic increment of the shared head and the record is published by
+// writing its sequence number last, so no locks are taken.
+class AccessLog {
+  public:
+    AccessLog() = default;
+    ~AccessLog();
+    AccessLog(const AccessLog&) = delete;
+    AccessLog& operator=(const AccessLog&) = delete;
+
+    bool open(const std::string& path, size_t capacity);
+    void close();
+    bool isOpen() const;
+    size_t capacity() const;
+
+    void append(const AccessLogEntry&);
+
+    // Visits every committed record in the file at 'path' from oldest to
+    // newest. Returns false if the file is missing or is not an access log.
+    static bool forEachRecord(const std::string& path, const std::function<void(const AccessLogRecord&)>&);
+
+  private:
+    AccessLogFileHeader* d_header{nullptr};
+    AccessLogRecord* d_records{nullptr};
+    size_t d_capacity{0};
+    size_t d_mappedSize{0};
+};
+
+} // namespace HTTPServer
+
+#endif
@@ -0,0 +1,84 @@
+#ifndef ADMISSION_H
+#define ADMISSION_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+namespace HTTPServer {
+
+// What a listener does with a connection it has no room for.
+enum class OverloadAction {
+    // Stop calling accept() until a slot frees up; new connections wait in
+    // the kernel's listen backlog, and SYNs are dropped once that is full.
+    PauseAccept,
+    // Accept, answer with a pre-serialized 503 and Retry-After, and close.
+    // TLS listeners close without answering, as a handshake would be exactly
+    // the work being shed.
+    Reject,
+};
+
+struct ConnectionLimits {
+    size_t maxConnections = 0;         // main listener, 0 = unlimited
+    size_t maxRedirectConnections = 0; // HTTP -> HTTPS redirect listener
+    size_t maxTotalConnections = 0;    // all listeners together
+    OverloadAction onOverload = OverloadAction::Reject;
+    std::chrono::seconds retryAfter{1};
+};
+
+// Count of open connections with an optional cap, shared lock-free between
+// the accepting thread and the connection threads releasing their slots.
+class ConnectionLimiter {
+  public:
+    explicit ConnectionLimiter(size_t limit = 0) : d_limit(limit) {}
+    ConnectionLimiter(const ConnectionLimiter&) = delete;
+    ConnectionLimiter& operator=(const ConnectionLimiter&) = delete;
+
+    void setLimit(size_t limit) { d_limit.store(limit, std::memory_order_relaxed); }
+    size_t limit() const { return d_limit.load(std::memory_order_relaxed); }
+    size_t active() const { return d_active.load(std::memory_order_relaxed); }
+    bool hasCapacity() const;
+
+    bool tryAcquire();
+    void release();
+
+  private:
+    std::atomic<size_t> d_limit;
+    std::atomic<size_t> d_active{0};
+};
+
+// Admission for one listener: a connection needs a slot on the listener's
+// own limiter and on the optional limiter shared by all listeners.
+class ListenerAdmission {
+  public:
+    explicit ListenerAdmission(ConnectionLimiter* shared = nullptr);
+    ListenerAdmission(const ListenerAdmission&) = delete;
+    ListenerAdmission& operator=(const ListenerAdmission&) = delete;
+
+    void configure(size_t limit, OverloadAction, std::chrono::seconds retryAfter);
+    OverloadAction action() const { return d_action; }
+
+    bool hasCapacity() const;
+    // Takes a slot on both limiters or on neither.
+    bool tryAdmit();
+    void release();
+    size_t active() const { return d_limiter.active(); }
+
+    // Blocks while the listener is full; false once 'running' is cleared.
+    bool waitForCapacity(const std::atomic<bool>& running) const;
+    // Turns away a connection that was accepted without a slot. Never blocks.
+    void reject(int fd, bool sendResponse) const;
+    std::string_view rejection() const { return d_rejection; }
+
+  private:
+    ConnectionLimiter d_limiter;
+    ConnectionLimiter* const d_shared;
+    OverloadAction d_action = OverloadAction::Reject;
+    std::string d_rejection;
+};
+
+} // namespace HTTPServer
+
+#endif
@@ -0,0 +1,97 @@
+#ifndef BUFFER_POOL_H
+#define BUFFER_POOL_H
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace HTTPServer {
+
+class BufferPool;
+
+// Buffer borrowed from the BufferPool, returned when the handle is reset or
+// destroyed. Move-only.
+class PooledBuffer {
+  public:
+    PooledBuffer() = default;
+    PooledBuffer(PooledBuffer&&) noexcept;
+    PooledBuffer& operator=(PooledBuffer&&) noexcept;
+    PooledBuffer(const PooledBuffer&) = delete;
+    PooledBuffer& operator=(const PooledBuffer&) = delete;
+    ~PooledBuffer() { reset(); }
+
+    char* data() const { return d_data; }
+    size_t capacity() const { return d_capacity; }
+    explicit operator bool() const { return d_data != nullptr; }
+    void reset();
+
+  private:
+    friend class BufferPool;
+    PooledBuffer(char* data, size_t capacity, uint8_t sizeClass)
+        : d_data(data), d_capacity(capacity), d_sizeClass(sizeClass) {}
+
+    char* d_data = nullptr;
+    size_t d_capacity = 0;
+    uint8_t d_sizeClass = 0;
+};
+
+// Process wide pool of I/O buffers in power-of-four size classes from 4 KiB
+// to 4 MiB. Small classes are carved out of 256 KiB slabs; larger ones are
+// allocated individually. Each thread keeps a small cache per class so
+// back-to-back acquire/release pairs avoid the shared lists; a thread that is
+// about to block calls trimThreadCache() so buffers are never parked on an
+// idle thread. Requests above the largest class are served unpooled.
+class BufferPool {
+  public:
+    static constexpr size_t kSizeClassCount = 6;
+    static constexpr size_t kMinBufferSize = 4 * 1024;
+    static constexpr size_t kMaxBufferSize = kMinBufferSize << (2 * (kSizeClassCount - 1));
+    static constexpr size_t kSlabSize = 256 * 1024;
+
+    struct Stats {
+        uint64_t reservedBytes = 0; // slabs and individually allocated buffers
+        uint64_t inUseBytes = 0;    // currently borrowed, excluding unpooled
+        std::array<uint64_t, kSizeClassCount> freeBuffers{};
+    };
+
+    static BufferPool& instance();
+    BufferPool(const BufferPool&) = delete;
+    BufferPool& operator=(const BufferPool&) = delete;
+
+    static size_t sizeClassFor(size_t);
+    static size_t classSize(size_t sizeClass) { return kMinBufferSize << (2 * sizeClass); }
+
+    PooledBuffer acquire(size_t minSize);
+    void trimThreadCache();
+    Stats stats() const;
+
+  private:
+    friend class PooledBuffer;
+    struct ThreadCache;
+    struct SizeClass {
+        mutable std::mutex mtx;
+        std::vector<char*> free;
+    };
+
+    static constexpr uint8_t kUnpooled = kSizeClassCount;
+    static constexpr size_t kThreadCacheDepth = 4;
+    static constexpr size_t kMaxSharedLargeBuffers = 8;
+
+    BufferPool() = default;
+    ThreadCache& threadCache();
+    char* refill(size_t sizeClass);
+    void release(char*, uint8_t sizeClass);
+    void releaseShared(char*, size_t sizeClass);
+    void flush(ThreadCache&);
+
+    std::array<SizeClass, kSizeClassCount> d_classes;
+    std::atomic<uint64_t> d_reservedBytes{0};
+    std::atomic<uint64_t> d_inUseBytes{0};
+};
+
+} // namespace HTTPServer
+
+#endif
@@ -0,0 +1,29 @@
+#ifndef CLIENT_ADDRESS_H
+#define CLIENT_ADDRESS_H
+
+#include <sys/socket.h>
+
+#include <array>
+#include <cstdint>
+#include <string>
+
+namespace HTTPServer {
+
+// Remote peer of an accepted connection. IPv4 peers are stored as
+// IPv4-mapped IPv6 addresses (::ffff:a.b.c.d) so every address has the same
+// 16 byte representation. Peers on a Unix domain socket have no address.
+struct ClientAddress {
+    std::array<uint8_t, 16> bytes{};
+    uint16_t port = 0;
+    bool unixSocket = false;
+
+    static ClientAddress fromSockaddr(const sockaddr_storage&);
+
+    bool isIPv4() const;
+    std::string ip() const;
+    std::string toString() const;
+};
+
+} // namespace HTTPServer
+
+#endif
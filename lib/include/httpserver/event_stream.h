@@ -0,0 +1,151 @@
+#ifndef EVENT_STREAM_H
+#define EVENT_STREAM_H
+
+#include <sys/types.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "httpserver/http_object.h"
+
+namespace HTTPServer {
+
+// Server-Sent Events wire format (the text/event-stream of the HTML
+// living standard).
+namespace EventStream {
+
+// Appends one event. Each line of 'data' becomes its own "data:" field;
+// 'event' and 'id' are left out when empty.
+void writeEvent(std::string& out, std::string_view data, std::string_view event = {}, std::string_view id = {});
+// The head that opens a stream: 200, text/event-stream, no caching and no
+// length, as the body lasts as long as the connection. Requests over
+// anything but HTTP/1.x are answered 400, as the stream needs the
+// connection to itself.
+HttpResponse accept(const HttpRequest&);
+
+} // namespace EventStream
+
+struct EventStreamOptions {
+    // Backlog a subscriber may have queued, in events and in bytes. One that
+    // falls further behind is evicted: its queue is dropped and the
+    // connection closed, and the client reconnects with Last-Event-ID.
+    size_t maxQueuedEvents = 256;
+    size_t maxQueuedBytes = 1 << 20;
+    // A comment line is sent after this long without events, which keeps
+    // intermediaries from timing the stream out and finds dead clients.
+    std::chrono::milliseconds heartbeatInterval{15000};
+    // Reconnection delay sent to the client when the stream opens; zero
+    // leaves the client's default.
+    std::chrono::milliseconds retry{0};
+    // Polled between writes; once it returns true the stream ends, and the
+    // client reconnects to whichever process takes over.
+    std::function<bool()> draining;
+};
+
+// Byte stream the subscriber writes to, with the conventions of
+// Http2Transport. Reads only detect the client going away.
+struct EventStreamTransport {
+    std::function<ssize_t(char*, size_t)> read;
+    std::function<ssize_t(const char*, size_t)> write;
+    std::function<bool(std::chrono::milliseconds, int wakeFd)> waitReadable;
+};
+
+// One open event stream, run on the thread that served its request. Events
+// are queued by shared pointer from whichever thread publishes them, and
+// written by the subscriber's own thread, coalesced into as few writes as
+// the backlog allows.
+class EventStreamSubscriber {
+  public:
+    EventStreamSubscriber(EventStreamTransport, const EventStreamOptions& = {});
+    ~EventStreamSubscriber();
+    EventStreamSubscriber(const EventStreamSubscriber&) = delete;
+    EventStreamSubscriber& operator=(const EventStreamSubscriber&) = delete;
+
+    // Writes queued events until the client goes away, the subscriber is
+    // evicted or closed, or the server drains.
+    void run();
+
+    // Thread-safe. Queues an event encoded with EventStream::writeEvent.
+    // Returns false once closed, and when this event would take the backlog
+    // over its limits, evicting the subscriber.
+    bool push(std::shared_ptr<const std::string> event);
+    void close();
+
+    bool isOpen() const { return d_open.load(std::memory_order_relaxed); }
+    bool evicted() const { return d_evicted.load(std::memory_order_relaxed); }
+    size_t queuedEvents() const;
+
+  private:
+    using Clock = std::chrono::steady_clock;
+
+    static constexpr size_t kReadSize = 512;
+
+    bool flush();
+    bool writeAll(std::string_view data);
+    void wake();
+
+    EventStreamTransport d_transport;
+    const EventStreamOptions d_options;
+    int d_wakeFd = -1;
+    std::atomic<bool> d_open{true};
+    std::atomic<bool> d_evicted{false};
+    // Subscriber thread only.
+    std::string d_writeBuffer;
+    Clock::time_point d_lastWrite;
+
+    mutable std::mutex d_mtx;
+    std::deque<std::shared_ptr<const std::string>> d_queue;
+    size_t d_queuedBytes = 0;
+    bool d_woken = false;
+};
+
+using EventStreamSubscriberPtr = std::shared_ptr<EventStreamSubscriber>;
+
+// A topic events are published to. Each event is encoded once into a
+// shared buffer that every subscriber's queue points at, so a subscriber
+// costs a queue of pointers rather than a copy of every event.
+//
+// With a history, the last events published with an id are kept, and a
+// client reconnecting with Last-Event-ID is sent the ones it missed.
+class EventStreamHub {
+  public:
+    explicit EventStreamHub(size_t history = 0) : d_historySize(history) {}
+
+    // Returns how many subscribers the event was queued for.
+    size_t publish(std::string_view data, std::string_view event = {}, std::string_view id = {});
+    void subscribe(EventStreamSubscriberPtr, std::string_view lastEventId = {});
+    void unsubscribe(const EventStreamSubscriber*);
+
+    size_t subscribers() const;
+    // Subscribers evicted for falling behind, since the hub was created.
+    size_t evicted() const { return d_evicted.load(std::memory_order_relaxed); }
+
+  private:
+    const size_t d_historySize;
+    std::atomic<size_t> d_evicted{0};
+
+    mutable std::mutex d_mtx;
+    std::vector<EventStreamSubscriberPtr> d_subscribers;
+    std::deque<std::pair<std::string, std::shared_ptr<const std::string>>> d_history;
+};
+
+// Picks the hub a request subscribes to, or nullptr to answer 404.
+using EventStreamSelector = std::function<EventStreamHub*(const HttpRequest&)>;
+
+struct EventStreamRoute {
+    EventStreamSelector select;
+    EventStreamOptions options;
+};
+
+} // namespace HTTPServer
+
+#endif
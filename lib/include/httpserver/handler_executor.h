@@ -0,0 +1,68 @@
+#ifndef HANDLER_EXECUTOR_H
+#define HANDLER_EXECUTOR_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace HTTPServer {
+
+struct HandlerExecutorOptions {
+    size_t threads = 0; // 0 = hardware threads
+    // Offloaded requests allowed to wait for a thread; beyond that they are
+    // answered 503 at once rather than queueing behind minutes of work.
+    size_t maxQueued = 1024;
+    std::chrono::seconds retryAfter{1};
+};
+
+// Where routes registered with HandlerExecution::Offloaded run: a fixed set
+// of threads of their own with a bounded queue in front. Slow, CPU heavy or
+// blocking handlers then compete with each other for these threads only,
+// while the connection threads, the handler slots of the LoadShedder and
+// the IoScheduler stay free for the inline routes.
+//
+// The threads start with the first job, so a prefork supervisor never runs
+// them.
+class HandlerExecutor {
+  public:
+    static HandlerExecutor& instance();
+    ~HandlerExecutor();
+    HandlerExecutor(const HandlerExecutor&) = delete;
+    HandlerExecutor& operator=(const HandlerExecutor&) = delete;
+
+    // Not thread-safe; call before the first job is submitted.
+    void configure(const HandlerExecutorOptions&);
+    const HandlerExecutorOptions& options() const { return d_options; }
+
+    // Queues 'job' for one of the executor's threads. Returns false, without
+    // running it, when the queue is full.
+    bool submit(std::function<void()> job);
+
+    size_t queued() const { return d_queued.load(std::memory_order_relaxed); }
+    size_t active() const { return d_active.load(std::memory_order_relaxed); }
+
+  private:
+    HandlerExecutor() = default;
+
+    void run();
+
+    HandlerExecutorOptions d_options;
+    std::atomic<size_t> d_queued{0};
+    std::atomic<size_t> d_active{0};
+
+    std::mutex d_mtx;
+    std::condition_variable d_cv;
+    std::deque<std::function<void()>> d_jobs;
+    std::vector<std::thread> d_threads;
+    bool d_stopping = false;
+};
+
+} // namespace HTTPServer
+
+#endif
@@ -0,0 +1,114 @@
+#ifndef HPACK_H
+#define HPACK_H
+
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <string>
+#include <string_view>
+
+namespace HTTPServer {
+
+// HTTP/2 header compression (RFC 7541).
+namespace Hpack {
+
+constexpr size_t kDefaultTableSize = 4096;
+// Per entry overhead counted against the table size, RFC 7541 section 4.1.
+constexpr size_t kEntryOverhead = 32;
+constexpr size_t kStaticTableSize = 61;
+
+// Canonical Huffman code of RFC 7541 Appendix B. decode fails on invalid
+// padding or an encoded EOS symbol.
+size_t huffmanEncodedSize(std::string_view);
+void huffmanEncode(std::string_view, std::string& out);
+bool huffmanDecode(std::string_view, std::string& out);
+
+} // namespace Hpack
+
+struct HeaderField {
+    std::string name;
+    std::string value;
+};
+
+// Static table followed by the dynamic table, addressed by the 1-based HPACK
+// index. New entries go to the front of the dynamic table and the oldest are
+// evicted once the table outgrows its maximum size.
+class HpackTable {
+  public:
+    explicit HpackTable(size_t maxSize = Hpack::kDefaultTableSize);
+
+    size_t size() const { return d_size; }
+    size_t maxSize() const { return d_maxSize; }
+    size_t entryCount() const { return d_entries.size(); }
+
+    void setMaxSize(size_t);
+    void insert(std::string_view name, std::string_view value);
+    bool lookup(size_t index, std::string_view& name, std::string_view& value) const;
+    // Index of an entry matching name and value, else of one matching the name
+    // only (valueMatched false), else 0.
+    size_t find(std::string_view name, std::string_view value, bool& valueMatched) const;
+
+  private:
+    void evict(size_t limit);
+
+    std::deque<HeaderField> d_entries; // newest first
+    size_t d_size = 0;
+    size_t d_maxSize;
+};
+
+class HpackDecoder {
+  public:
+    using FieldHandler = std::function<void(std::string_view name, std::string_view value)>;
+
+    // 'maxTableSize' is the SETTINGS_HEADER_TABLE_SIZE advertised to the
+    // peer; dynamic table size updates above it are rejected.
+    explicit HpackDecoder(size_t maxTableSize = Hpack::kDefaultTableSize);
+
+    // Decodes one complete header block, passing each field to 'onField' in
+    // order. The views are only valid during the call. Returns false on a
+    // compression error, after which the decoder state is undefined and the
+    // connection must be torn down.
+    bool decode(std::string_view block, const FieldHandler& onField);
+
+    const HpackTable& table() const { return d_table; }
+
+  private:
+    bool readString(std::string_view& in, std::string& scratch, std::string_view& out);
+
+    HpackTable d_table;
+    size_t d_maxTableSize;
+    std::string d_name;
+    std::string d_value;
+};
+
+class HpackEncoder {
+  public:
+    enum class Indexing { Incremental, None, Never };
+
+    explicit HpackEncoder(size_t maxTableSize = Hpack::kDefaultTableSize);
+
+    // Applies the peer's SETTINGS_HEADER_TABLE_SIZE. The encoder never grows
+    // its table past the size it was constructed with; any change is
+    // announced at the start of the next block.
+    void setMaxTableSize(size_t);
+
+    // Starts a header block, emitting pending table size updates.
+    void beginBlock(std::string& out);
+    // 'name' must already be lower case.
+    void encode(std::string_view name, std::string_view value, std::string& out,
+                Indexing = Indexing::Incremental);
+
+    const HpackTable& table() const { return d_table; }
+
+  private:
+    static void writeString(std::string_view, std::string& out);
+
+    HpackTable d_table;
+    const size_t d_limit;
+    size_t d_smallestUpdate;
+    bool d_updatePending = false;
+};
+
+} // namespace HTTPServer
+
+#endif
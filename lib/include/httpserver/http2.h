@@ -0,0 +1,233 @@
+#ifndef HTTP2_H
+#define HTTP2_H
+
+#include <sys/types.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "httpserver/buffer_pool.h"
+#include "httpserver/hpack.h"
+#include "httpserver/http_object.h"
+
+namespace HTTPServer {
+
+// HTTP/2 wire format (RFC 9113).
+namespace Http2 {
+
+constexpr std::string_view kClientPreface = "PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n";
+constexpr std::string_view kAlpnProtocol = "h2";
+constexpr size_t kFrameHeaderSize = 9;
+constexpr uint32_t kDefaultWindowSize = 65535;
+constexpr uint32_t kMaxWindowSize = 0x7fffffff;
+constexpr uint32_t kDefaultMaxFrameSize = 16384;
+constexpr uint32_t kMaxFrameSizeLimit = (1 << 24) - 1;
+
+enum class FrameType : uint8_t {
+    Data = 0x0,
+    Headers = 0x1,
+    Priority = 0x2,
+    RstStream = 0x3,
+    Settings = 0x4,
+    PushPromise = 0x5,
+    Ping = 0x6,
+    GoAway = 0x7,
+    WindowUpdate = 0x8,
+    Continuation = 0x9,
+};
+
+namespace Flags {
+constexpr uint8_t EndStream = 0x1;
+constexpr uint8_t Ack = 0x1;
+constexpr uint8_t EndHeaders = 0x4;
+constexpr uint8_t Padded = 0x8;
+constexpr uint8_t Priority = 0x20;
+} // namespace Flags
+
+enum class Setting : uint16_t {
+    HeaderTableSize = 0x1,
+    EnablePush = 0x2,
+    MaxConcurrentStreams = 0x3,
+    InitialWindowSize = 0x4,
+    MaxFrameSize = 0x5,
+    MaxHeaderListSize = 0x6,
+};
+
+enum class ErrorCode : uint32_t {
+    NoError = 0x0,
+    ProtocolError = 0x1,
+    InternalError = 0x2,
+    FlowControlError = 0x3,
+    SettingsTimeout = 0x4,
+    StreamClosed = 0x5,
+    FrameSizeError = 0x6,
+    RefusedStream = 0x7,
+    Cancel = 0x8,
+    CompressionError = 0x9,
+    ConnectError = 0xa,
+    EnhanceYourCalm = 0xb,
+    InadequateSecurity = 0xc,
+    Http11Required = 0xd,
+};
+
+struct FrameHeader {
+    uint32_t length = 0;
+    FrameType type = FrameType::Data;
+    uint8_t flags = 0;
+    uint32_t streamId = 0;
+};
+
+// 'in' must hold kFrameHeaderSize bytes.
+FrameHeader readFrameHeader(const char* in);
+void writeFrameHeader(std::string& out, size_t length, FrameType, uint8_t flags, uint32_t streamId);
+void writeSetting(std::string& out, Setting, uint32_t value);
+uint32_t readUint32(const char* in);
+void writeUint32(std::string& out, uint32_t value);
+
+} // namespace Http2
+
+struct Http2Options {
+    uint32_t maxConcurrentStreams = 100;
+    // Receive window advertised for every stream and for the connection.
+    uint32_t initialWindowSize = 1 << 20;
+    size_t maxHeaderListSize = 64 * 1024;
+    size_t maxRequestBodySize = BufferPool::kMaxBufferSize;
+    std::chrono::milliseconds idleTimeout{5000};
+    // Polled between frames; once it returns true the connection sends
+    // GOAWAY, finishes the streams already open and refuses new ones.
+    std::function<bool()> draining;
+};
+
+// Byte stream the connection runs over. read and write follow recv/SSL_read
+// conventions (bytes transferred, 0 on close, negative on error);
+// waitReadable returns false once the timeout expires, or the wake
+// descriptor it is given becomes readable, with nothing to read. A negative
+// timeout waits indefinitely.
+struct Http2Transport {
+    std::function<ssize_t(char*, size_t)> read;
+    std::function<ssize_t(const char*, size_t)> write;
+    std::function<bool(std::chrono::milliseconds, int wakeFd)> waitReadable;
+};
+
+// Server side of one HTTP/2 connection, run on the connection's thread.
+//
+// Requests are turned into the same HttpRequest / HttpResponse objects the
+// HTTP/1.1 path uses, each stream allocating from its own pooled arena.
+// Responses are queued per stream and their DATA frames interleaved round
+// robin within the flow control windows, so a large download does not hold
+// up the small responses multiplexed next to it. Handlers are started as
+// soon as a request is complete; a synchronous one runs inline, while an
+// asynchronous one may answer later from another thread, and the connection
+// goes on serving its other streams in the meantime.
+class Http2Connection {
+  public:
+    using Dispatch = std::function<HttpResponse(HttpRequest&)>;
+    // Called exactly once per dispatched stream, from any thread.
+    using Respond = std::function<void(HttpResponse)>;
+    using AsyncDispatch = std::function<void(HttpRequest&, Respond)>;
+    // Called once per stream after the last byte of its response was queued
+    // for sending.
+    using Completion = std::function<void(const HttpRequest&, const HttpResponse&, size_t bytesSent,
+                                          std::chrono::nanoseconds latency)>;
+
+    Http2Connection(Http2Transport, Dispatch, Completion = {}, const Http2Options& = {});
+    Http2Connection(Http2Transport, AsyncDispatch, Completion = {}, const Http2Options& = {});
+    ~Http2Connection();
+    Http2Connection(const Http2Connection&) = delete;
+    Http2Connection& operator=(const Http2Connection&) = delete;
+
+    // Serves streams until the peer goes away, the connection fails, it
+    // stays idle for the idle timeout or it has drained. The client preface is expected to be
+    // the first bytes read. Returns once every dispatched handler has
+    // responded, as their requests live in the connection's streams.
+    void run();
+
+    size_t streamsServed() const { return d_streamsServed; }
+
+  private:
+    struct Stream;
+
+    void serve();
+    bool readInput();
+    bool processFrame(const Http2::FrameHeader&, std::string_view payload);
+    bool onData(const Http2::FrameHeader&, std::string_view payload);
+    bool onHeaders(const Http2::FrameHeader&, std::string_view payload);
+    bool onContinuation(const Http2::FrameHeader&, std::string_view payload);
+    bool onSettings(const Http2::FrameHeader&, std::string_view payload);
+    bool onWindowUpdate(const Http2::FrameHeader&, std::string_view payload);
+    bool finishHeaderBlock();
+    void dispatch(Stream&);
+    void respond(uint32_t streamId, HttpResponse&&);
+    void takeResponses();
+    void closeStream(uint32_t streamId);
+    bool hasSendableData() const;
+    void sendData();
+    void completeStream(uint32_t streamId);
+    void resetStream(uint32_t streamId, Http2::ErrorCode);
+    bool connectionError(Http2::ErrorCode);
+    void sendGoAway(Http2::ErrorCode);
+    bool flush();
+
+    Http2Transport d_transport;
+    AsyncDispatch d_dispatch;
+    Completion d_completion;
+    const Http2Options d_options;
+
+    HpackDecoder d_decoder;
+    HpackEncoder d_encoder;
+
+    PooledBuffer d_in;
+    size_t d_inBuffered = 0;
+    bool d_prefaceReceived = false;
+    std::string d_out;
+
+    std::unordered_map<uint32_t, std::unique_ptr<Stream>> d_streams;
+    std::deque<uint32_t> d_sendQueue; // streams with DATA left to send
+    uint32_t d_lastStreamId = 0;
+    size_t d_streamsServed = 0;
+
+    // Header block being assembled from HEADERS and CONTINUATION frames.
+    uint32_t d_headerStream = 0;
+    bool d_headerEndStream = false;
+    std::string d_headerBlock;
+    // Scratch space for encoding response header blocks.
+    std::string d_encoded;
+    std::string d_name;
+
+    int64_t d_sendWindow = Http2::kDefaultWindowSize;
+    int64_t d_recvWindow = Http2::kDefaultWindowSize;
+    uint32_t d_peerInitialWindow = Http2::kDefaultWindowSize;
+    uint32_t d_peerMaxFrameSize = Http2::kDefaultMaxFrameSize;
+
+    bool d_peerGoAway = false;
+    bool d_goingAway = false;
+    bool d_closed = false;
+    size_t d_handling = 0; // dispatched streams still without a response
+
+    // Responses of asynchronous handlers, handed over from whichever thread
+    // they finish on; the first one queued wakes waitReadable. Declared after
+    // d_streams, as they allocate from their streams' arenas.
+    int d_wakeFd = -1;
+    std::thread::id d_thread; // the one running run()
+    std::mutex d_responsesMtx;
+    std::condition_variable d_responded;
+    std::vector<std::pair<uint32_t, HttpResponse>> d_responses;
+    size_t d_unanswered = 0;
+    bool d_woken = false;
+};
+
+} // namespace HTTPServer
+
+#endif
@@ -1,42 +1,139 @@
 #ifndef HTTP_OBJECT_H
 #define HTTP_OBJECT_H
 
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
 #include <string>
+#include <string_view>
 #include <unordered_map>
 
 namespace HTTPServer {
 
+// Named codes are the ones the server produces itself; a proxied response
+// may carry any other code, which is serialized with a generic reason.
 enum class StatusCode {
+    SwitchingProtocols = 101,
     OK = 200,
+    Created = 201,
+    Accepted = 202,
+    NoContent = 204,
     MovedPermanently = 301,
+    Found = 302,
+    SeeOther = 303,
+    NotModified = 304,
+    TemporaryRedirect = 307,
+    PermanentRedirect = 308,
     BadRequest = 400,
+    Unauthorized = 401,
+    Forbidden = 403,
     NotFound = 404,
+    MethodNotAllowed = 405,
+    Conflict = 409,
+    PayloadTooLarge = 413,
+    TooManyRequests = 429,
     InternalServerError = 500,
+    BadGateway = 502,
+    ServiceUnavailable = 503,
+    GatewayTimeout = 504,
 };
 
+// Hash and equality that accept any string type, so maps can be probed with a
+// std::string, std::string_view or literal without building a temporary key.
+struct StringHash {
+    using is_transparent = void;
+    size_t operator()(std::string_view s) const noexcept { return std::hash<std::string_view>{}(s); }
+};
+
+struct StringEqual {
+    using is_transparent = void;
+    bool operator()(std::string_view a, std::string_view b) const noexcept { return a == b; }
+};
+
+using HeaderMap = std::pmr::unordered_map<std::pmr::string, std::pmr::string, StringHash, StringEqual>;
+
+// Request and response are allocator aware: everything they own (strings,
+// header and parameter nodes) comes from the memory resource they were
+// constructed with. The server gives each connection an arena that is reset
+// between keep-alive requests; default construction uses the global heap.
 struct HttpRequest {
-    std::string method;
-    std::string path;
-    std::string version;
-    std::unordered_map<std::string, std::string> headers;
-    std::string body;
-    std::unordered_map<std::string, std::string> params;
+    using allocator_type = std::pmr::polymorphic_allocator<std::byte>;
+
+    std::pmr::string method;
+    std::pmr::string path;
+    // Query string as received, without the '?'; decoded into 'params'.
+    std::pmr::string query;
+    std::pmr::string version;
+    HeaderMap headers;
+    std::pmr::string body;
+    HeaderMap params;
+
+    // Pattern of the route that handled the request, set by Router::route.
+    // Views storage owned by the Router; empty when no route matched.
+    std::string_view route;
+
+    HttpRequest() : HttpRequest(allocator_type{}) {}
+    explicit HttpRequest(const allocator_type&);
+    HttpRequest(const HttpRequest&, const allocator_type& = {});
+    HttpRequest(HttpRequest&&) = default;
+    HttpRequest& operator=(const HttpRequest&) = default;
+    HttpRequest& operator=(HttpRequest&&) = default;
+
+    allocator_type get_allocator() const { return method.get_allocator(); }
+};
+
+// Open file sent after the response head in place of an in-memory body, so
+// the server can hand it to sendfile(2) or SSL_sendfile. Owns the descriptor.
+class FileBody {
+  public:
+    FileBody(int fd, size_t size) : d_fd(fd), d_size(size) {}
+    ~FileBody();
+    FileBody(const FileBody&) = delete;
+    FileBody& operator=(const FileBody&) = delete;
+
+    int fd() const { return d_fd; }
+    size_t size() const { return d_size; }
+
+  private:
+    int d_fd;
+    size_t d_size;
 };
 
 struct HttpResponse {
+    using allocator_type = std::pmr::polymorphic_allocator<std::byte>;
+
     StatusCode code = StatusCode::InternalServerError;
-    std::string version = "HTTP/1.1";
-    std::unordered_map<std::string, std::string> headers;
-    std::string body;
+    std::pmr::string version;
+    HeaderMap headers;
+    std::pmr::string body;
+    // Set instead of 'body' for large file responses, see Responses::file.
+    std::shared_ptr<const FileBody> file;
+
+    HttpResponse() : HttpResponse(allocator_type{}) {}
+    explicit HttpResponse(const allocator_type&);
+    HttpResponse(const HttpResponse&, const allocator_type& = {});
+    HttpResponse(HttpResponse&&) = default;
+    HttpResponse& operator=(const HttpResponse&) = default;
+    HttpResponse& operator=(HttpResponse&&) = default;
+
+    allocator_type get_allocator() const { return version.get_allocator(); }
 
     HttpResponse& setStatus(StatusCode);
-    HttpResponse& addHeader(const std::string&, const std::string&);
-    HttpResponse& setBody(const std::string&);
+    HttpResponse& addHeader(std::string_view, std::string_view);
+    HttpResponse& setBody(std::string_view);
     HttpResponse& applyRequestDefaults(const HttpRequest&);
 
-    std::string serialize() const;
+    // Serialized bytes are allocated from the response's own resource. A file
+    // body is read in, so writers that can stream it should use
+    // serializeHead instead.
+    std::pmr::string serialize() const;
+    // Status line and headers including the terminating blank line, for
+    // writers that send the body separately. serializeHead writes exactly
+    // headSize() bytes to 'out' and returns the end pointer.
+    size_t headSize() const;
+    char* serializeHead(char* out) const;
 };
 
 } // namespace HTTPServer
 
-#endif
\ No newline at end of file
+#endif
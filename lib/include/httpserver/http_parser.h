@@ -2,6 +2,7 @@
 #define HTTP_PARSER_H
 
 #include <string>
+#include <string_view>
 
 #include "http_object.h"
 
@@ -15,21 +16,42 @@ enum class ParseError {
     INVALID_VERSION,
     INVALID_HEADER_FORMAT,
     INVALID_HEADER_NAME,
+    REQUEST_TOO_LARGE,
 };
 
+// Extent of the request at the front of a receive buffer, see
+// HttpParser::frame.
+struct RequestFrame {
+    bool headersComplete = false;
+    size_t headerBytes = 0; // request line, headers and the blank line
+    size_t contentLength = 0;
+
+    size_t totalBytes() const { return headerBytes + contentLength; }
+};
+
+// Parses without intermediate copies: the raw bytes are scanned in place and
+// every string stored in the request is allocated from the request's own
+// memory resource.
 class HttpParser {
   public:
-    static ParseError parse(const std::string &, HttpRequest &);
+    static ParseError parse(std::string_view, HttpRequest &);
+    // Finds where the header block of the request at the front of 'raw' ends
+    // and how many body bytes follow (Content-Length). headersComplete is
+    // false until the blank line has been received.
+    static RequestFrame frame(std::string_view raw);
+    // Splits a request target into path and decoded query parameters.
+    static void parseTarget(std::string_view target, HttpRequest &);
 
   private:
-    static void trim(std::string &);
-    static bool isValidMethod(const std::string &);
-    static bool isValidVersion(const std::string &);
-    static bool isValidHeaderName(const std::string &);
-    static std::string urlDecode(const std::string &);
-    static void parseQueryParams(const std::string&, std::unordered_map<std::string, std::string>&);
+    static bool nextLine(std::string_view &, std::string_view &);
+    static std::string_view trim(std::string_view);
+    static bool isValidMethod(std::string_view);
+    static bool isValidVersion(std::string_view);
+    static bool isValidHeaderName(std::string_view);
+    static void urlDecode(std::string_view, std::pmr::string &);
+    static void parseQueryParams(std::string_view, HeaderMap &);
 };
 
 } // namespace HTTPServer
 
-#endif
\ No newline at end of file
+#endif
@@ -1,18 +1,32 @@
 #ifndef HTTP_RESPONSE_BUILDER_H
 #define HTTP_RESPONSE_BUILDER_H
 
+#include <chrono>
+#include <cstddef>
 #include <string>
+#include <string_view>
 
 #include "http_object.h"
 #include "httpserver/port.h"
 
 namespace HTTPServer {
 
+// Responses built for a request allocate from the same memory resource as
+// the request, so they live in the connection's arena.
 namespace Responses {
 
-HttpResponse ok(const HttpRequest&, const std::string&, const std::string& = "text/plain");
+// Files above this size are streamed from the descriptor instead of being
+// read into the response body.
+constexpr size_t kMaxInlineFileSize = 64 * 1024;
+
+HttpResponse ok(const HttpRequest&, std::string_view, std::string_view = "text/plain");
 HttpResponse notFound(const HttpRequest&);
-HttpResponse badRequest();
+HttpResponse badRequest(const HttpResponse::allocator_type& = {});
+HttpResponse tooManyRequests(const HttpRequest&, std::chrono::seconds retryAfter);
+HttpResponse serviceUnavailable(const HttpRequest&, std::chrono::seconds retryAfter);
+HttpResponse internalServerError(const HttpRequest&);
+HttpResponse badGateway(const HttpRequest&);
+HttpResponse gatewayTimeout(const HttpRequest&);
 HttpResponse redirection(const HttpRequest&, const Port&);
 HttpResponse file(const HttpRequest&, const std::string&);
 
@@ -20,4 +34,4 @@ HttpResponse file(const HttpRequest&, const std::string&);
 
 } // namespace HTTPServer
 
-#endif
\ No newline at end of file
+#endif
@@ -5,4 +5,26 @@
 #include "http_parser.h"
 #include "router.h"
 #include "http_object.h"
-#include "http_response_builder.h"
\ No newline at end of file
+#include "http_response_builder.h"
+#include "access_log.h"
+#include "metrics.h"
+#include "phase_timing.h"
+#include "buffer_pool.h"
+#include "tls_session.h"
+#include "hpack.h"
+#include "http2.h"
+#include "redirect_listener.h"
+#include "timer_wheel.h"
+#include "admission.h"
+#include "load_shedder.h"
+#include "rate_limiter.h"
+#include "listener_handoff.h"
+#include "prefork.h"
+#include "task.h"
+#include "io_scheduler.h"
+#include "handler_executor.h"
+#include "reverse_proxy.h"
+#include "websocket.h"
+#include "event_stream.h"
+#include "unix_socket.h"
+#include "socket_options.h"
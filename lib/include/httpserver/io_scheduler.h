@@ -0,0 +1,147 @@
+#ifndef IO_SCHEDULER_H
+#define IO_SCHEDULER_H
+
+#include <sys/epoll.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <coroutine>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "httpserver/timer_wheel.h"
+
+namespace HTTPServer {
+
+// Event loop that resumes suspended coroutines once what they wait for is
+// ready, so a handler waiting on a socket, a timer or a file costs a
+// coroutine frame instead of a thread. One thread multiplexes every socket
+// wait through epoll with the timeouts on a TimerWheel; file reads, which
+// epoll cannot wait on, are done by a second thread. Whatever the awaitable,
+// the coroutine is resumed on the loop thread, so code between two awaits
+// should be short: anything long running holds up every other waiter.
+//
+// Started by the first call to instance(), so a process only runs the
+// threads once a handler uses them (after fork, for prefork workers).
+// Operations still pending at exit are abandoned.
+class IoScheduler {
+  public:
+    using Clock = TimerWheel::Clock;
+    static constexpr std::chrono::milliseconds kResolution{10};
+
+    static IoScheduler& instance();
+    ~IoScheduler();
+    IoScheduler(const IoScheduler&) = delete;
+    IoScheduler& operator=(const IoScheduler&) = delete;
+
+    class Operation : TimerWheel::Timer {
+      public:
+        bool await_ready() const noexcept { return false; }
+        void await_suspend(std::coroutine_handle<> handle);
+
+      protected:
+        friend class IoScheduler;
+        Operation(IoScheduler& scheduler, int fd, uint32_t events, std::chrono::milliseconds timeout)
+            : d_scheduler(scheduler), d_fd(fd), d_events(events), d_timeout(timeout) {}
+
+        IoScheduler& d_scheduler;
+        std::coroutine_handle<> d_handle;
+        const int d_fd;
+        const uint32_t d_events;
+        const std::chrono::milliseconds d_timeout;
+        bool d_ready = false;
+    };
+
+    // co_await yields true once 'fd' is readable (or writable), false when
+    // 'timeout' runs out first; a negative timeout waits indefinitely. Only
+    // one operation may wait on a descriptor at a time.
+    class Readiness : public Operation {
+      public:
+        bool await_resume() const noexcept { return d_ready; }
+
+      private:
+        friend class IoScheduler;
+        using Operation::Operation;
+    };
+
+    // co_await returns once 'duration' has passed, to within kResolution.
+    class Sleep : public Operation {
+      public:
+        void await_resume() const noexcept {}
+
+      private:
+        friend class IoScheduler;
+        using Operation::Operation;
+    };
+
+    // co_await yields the file's contents, or nothing if it cannot be read.
+    class FileRead {
+      public:
+        bool await_ready() const noexcept { return false; }
+        void await_suspend(std::coroutine_handle<> handle);
+        std::optional<std::string> await_resume() { return std::move(d_contents); }
+
+      private:
+        friend class IoScheduler;
+        FileRead(IoScheduler& scheduler, std::string path) : d_scheduler(scheduler), d_path(std::move(path)) {}
+
+        IoScheduler& d_scheduler;
+        std::coroutine_handle<> d_handle;
+        const std::string d_path;
+        std::optional<std::string> d_contents;
+    };
+
+    Readiness readable(int fd, std::chrono::milliseconds timeout = std::chrono::milliseconds(-1)) {
+        return Readiness(*this, fd, EPOLLIN | EPOLLRDHUP, timeout);
+    }
+    Readiness writable(int fd, std::chrono::milliseconds timeout = std::chrono::milliseconds(-1)) {
+        return Readiness(*this, fd, EPOLLOUT, timeout);
+    }
+    Sleep sleepFor(std::chrono::milliseconds duration) { return Sleep(*this, -1, 0, duration); }
+    FileRead readFile(std::string path) { return FileRead(*this, std::move(path)); }
+
+    // Coroutines currently suspended on one of the awaitables.
+    size_t pending() const { return d_pending.load(std::memory_order_relaxed); }
+
+  private:
+    static constexpr int kMaxEvents = 64;
+
+    IoScheduler();
+
+    void submit(Operation&);
+    void submit(FileRead&);
+    void resume(std::coroutine_handle<>);
+    void wake();
+    void run();
+    void runFileReads();
+    void arm(Operation&);
+    void complete(Operation&, bool ready);
+
+    int d_epollFd = -1;
+    int d_wakeFd = -1;
+    std::atomic<size_t> d_pending{0};
+
+    std::mutex d_mtx;
+    bool d_stopping = false;
+    bool d_woken = false;
+    std::vector<Operation*> d_submitted;
+    std::vector<std::coroutine_handle<>> d_resumable;
+    TimerWheel d_timers{kResolution}; // loop thread only
+    std::thread d_loop;
+
+    std::mutex d_fileMtx;
+    std::condition_variable d_fileCv;
+    bool d_fileStopping = false;
+    std::deque<FileRead*> d_fileReads;
+    std::thread d_fileThread;
+};
+
+} // namespace HTTPServer
+
+#endif
@@ -0,0 +1,47 @@
+#ifndef LISTENER_HANDOFF_H
+#define LISTENER_HANDOFF_H
+
+#include <sys/types.h>
+
+#include <string>
+#include <vector>
+
+#include "httpserver/port.h"
+
+namespace HTTPServer {
+
+// Listening sockets passed from a running server to its replacement, so a
+// deploy never has a moment with nobody listening.
+//
+// The old process re-executes its binary with the listening sockets left
+// open across exec and their numbers in HTTPSERVER_LISTEN_FDS. The new
+// process takes them over instead of binding its own, and once it is
+// accepting tells the old process to drain with SIGTERM. Both processes
+// accept from the same kernel queue in the meantime, so a connection is
+// never refused: it is served by whichever process accepts it.
+class ListenerHandoff {
+  public:
+    static constexpr const char* kFdsEnv = "HTTPSERVER_LISTEN_FDS";
+    static constexpr const char* kParentEnv = "HTTPSERVER_UPGRADE_PARENT";
+
+    // An inherited socket listening on 'port', or -1 when there is none.
+    // The socket belongs to the caller from here on.
+    static int take(const Port& port);
+    // An inherited socket bound to the Unix domain socket 'path', as
+    // UnixSocket::boundPath reports it, or -1.
+    static int take(const std::string& path);
+    // Closes inherited sockets nobody took, so connections do not queue
+    // where nobody accepts them, and signals the process that handed them
+    // over to drain. Call once every listener is in place.
+    static void complete();
+
+    // Starts the binary at the path this process was run from (the newly
+    // deployed one when it has been replaced), with the same arguments and
+    // environment plus 'fds'. No other descriptor is inherited. Returns the
+    // child's pid, or -1.
+    static pid_t spawn(const std::vector<int>& fds);
+};
+
+} // namespace HTTPServer
+
+#endif
@@ -0,0 +1,110 @@
+#ifndef LOAD_SHEDDER_H
+#define LOAD_SHEDDER_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+
+namespace HTTPServer {
+
+struct LoadSheddingOptions {
+    // Handlers allowed to run at once; requests beyond that queue for a slot.
+    size_t maxConcurrentHandlers = 0; // 0 = hardware threads
+    // CoDel parameters: the queue is overloaded once the smallest queueing
+    // delay seen over a whole interval stays above the target.
+    std::chrono::milliseconds target{5};
+    std::chrono::milliseconds interval{100};
+    // While overloaded, serve the newest waiter first: it is the one whose
+    // client is most likely still waiting, and the oldest are shed instead.
+    bool lifoWhenOverloaded = true;
+    std::chrono::seconds retryAfter{1};
+};
+
+// Admission to request handlers with CoDel style shedding (Nichols &
+// Jacobson, as adapted for server queues by Facebook's Wangle). Up to
+// maxConcurrentHandlers requests run at once, the rest wait for a slot.
+// Every wait is measured; when even the shortest wait of an interval exceeds
+// the target the queue is standing rather than absorbing a burst, and
+// waiters older than twice the target are turned away so the slots go to
+// requests that can still finish in time.
+//
+// Admission takes no lock while slots are free and nobody is waiting.
+class LoadShedder {
+  public:
+    // A handler slot, returned when the permit is destroyed. An empty permit
+    // means the request was shed.
+    class Permit {
+      public:
+        Permit() = default;
+        Permit(Permit&& other) noexcept : d_owner(other.d_owner), d_admitted(other.d_admitted) {
+            other.d_owner = nullptr;
+        }
+        Permit& operator=(Permit&&) = delete;
+        Permit(const Permit&) = delete;
+        ~Permit() {
+            if (d_owner) d_owner->release();
+        }
+
+        explicit operator bool() const { return d_admitted; }
+
+      private:
+        friend class LoadShedder;
+        Permit(LoadShedder* owner, bool admitted) : d_owner(owner), d_admitted(admitted) {}
+
+        LoadShedder* d_owner = nullptr;
+        bool d_admitted = false;
+    };
+
+    LoadShedder() = default;
+    LoadShedder(const LoadShedder&) = delete;
+    LoadShedder& operator=(const LoadShedder&) = delete;
+
+    // Not thread-safe; call before any request is admitted.
+    void configure(const LoadSheddingOptions&);
+    bool enabled() const { return d_limit != 0; }
+    const LoadSheddingOptions& options() const { return d_options; }
+
+    // Blocks until a handler slot is free or the request is shed. Always
+    // admits when shedding is not enabled.
+    Permit admit();
+
+    bool overloaded() const { return d_overloadedFlag.load(std::memory_order_relaxed); }
+    size_t active() const { return d_active.load(std::memory_order_relaxed); }
+    size_t queued() const { return d_waiting.load(std::memory_order_relaxed); }
+
+  private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Waiter {
+        std::condition_variable cv;
+        Clock::time_point enqueued;
+        bool granted = false;
+    };
+
+    bool tryAcquire();
+    void release();
+    void grantWaiters();
+    void recordDelay(Clock::duration delay, Clock::time_point now);
+    void removeWaiter(Waiter&);
+
+    LoadSheddingOptions d_options;
+    size_t d_limit = 0;
+    std::atomic<size_t> d_active{0};
+    std::atomic<size_t> d_waiting{0};
+    std::atomic<bool> d_fastAdmits{false};
+    std::atomic<bool> d_overloadedFlag{false};
+
+    std::mutex d_mtx;
+    std::deque<Waiter*> d_queue;
+    bool d_overloaded = false;
+    Clock::duration d_minDelay{0};
+    Clock::time_point d_intervalEnd;
+};
+
+} // namespace HTTPServer
+
+#endif
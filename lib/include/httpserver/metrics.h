@@ -0,0 +1,170 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+#include "httpserver/phase_timing.h"
+#include "httpserver/timer_wheel.h"
+
+namespace HTTPServer {
+
+// Log-linear (HDR style) bucketing of nanosecond latencies: values below 16ns
+// get exact buckets, every power of two above that is split into 16 linear
+// sub-buckets, bounding the relative error to 1/16.
+namespace HistogramBuckets {
+
+constexpr unsigned kSubBucketBits = 4;
+constexpr uint64_t kSubBucketCount = uint64_t{1} << kSubBucketBits;
+constexpr unsigned kMaxValueBits = 40; // ~18 minutes in nanoseconds
+constexpr size_t kBucketCount = (kMaxValueBits - kSubBucketBits + 1) * kSubBucketCount;
+
+size_t indexFor(uint64_t value);
+uint64_t lowerBound(size_t index);
+uint64_t upperBound(size_t index);
+
+} // namespace HistogramBuckets
+
+// Plain, non-atomic histogram used for aggregation and reporting.
+struct HistogramSnapshot {
+    std::array<uint64_t, HistogramBuckets::kBucketCount> buckets{};
+    uint64_t count = 0;
+    uint64_t sum = 0;
+
+    void record(uint64_t value);
+    void merge(const HistogramSnapshot&);
+    uint64_t percentile(double) const; // 0 - 100
+    uint64_t countAtOrBelow(uint64_t) const;
+};
+
+// Histogram written by exactly one thread and read concurrently by scrapers.
+// The owning thread updates with relaxed load/store pairs, which avoids any
+// locked read-modify-write instruction on the hot path.
+class LatencyHistogram {
+  public:
+    void record(uint64_t value);
+    void addTo(HistogramSnapshot&) const;
+
+  private:
+    std::array<std::atomic<uint64_t>, HistogramBuckets::kBucketCount> d_buckets{};
+    std::atomic<uint64_t> d_count{0};
+    std::atomic<uint64_t> d_sum{0};
+};
+
+// Monotonic counter with a single writer, see LatencyHistogram.
+class LocalCounter {
+  public:
+    void add(uint64_t n = 1) { d_value.store(d_value.load(std::memory_order_relaxed) + n, std::memory_order_relaxed); }
+    uint64_t value() const { return d_value.load(std::memory_order_relaxed); }
+
+  private:
+    std::atomic<uint64_t> d_value{0};
+};
+
+using RequestSeriesKey = std::tuple<std::string, std::string, int>; // method, route, status
+
+struct RequestSeriesSnapshot {
+    HistogramSnapshot latency;
+    uint64_t bytesSent = 0;
+};
+
+struct MetricsSnapshot {
+    uint64_t connectionsOpened = 0;
+    uint64_t connectionsClosed = 0;
+    uint64_t connectionsRejected = 0;
+    uint64_t requestsShed = 0;
+    uint64_t connectionsRateLimited = 0;
+    uint64_t requestsRateLimited = 0;
+    uint64_t parseErrors = 0;
+    uint64_t tlsHandshakeFailures = 0;
+    uint64_t tlsFullHandshakes = 0;
+    uint64_t tlsResumedHandshakes = 0;
+    uint64_t ktlsSendConnections = 0;
+    uint64_t ktlsFallbackConnections = 0;
+    uint64_t http2Connections = 0;
+    std::array<uint64_t, kTimeoutKindCount> connectionTimeouts{};
+    std::map<RequestSeriesKey, RequestSeriesSnapshot> requests;
+    std::array<HistogramSnapshot, kPhaseCount> phases;
+
+    uint64_t activeConnections() const;
+    void merge(const MetricsSnapshot&);
+
+    // Compact binary form for passing a snapshot to another process running
+    // the same binary. decode() returns false on malformed input.
+    std::string encode() const;
+    static bool decode(std::string_view, MetricsSnapshot&);
+};
+
+// Process wide request metrics. Every thread records into its own shard, so
+// recording never contends with other request threads; shards are summed
+// only when a snapshot is taken. Shards of exited threads are folded into a
+// retired total so short lived connection threads lose nothing.
+class Metrics {
+  public:
+    // Method label for requests whose method is not a standard one, or that
+    // could not be parsed at all.
+    static constexpr std::string_view kOtherMethod = "OTHER";
+
+    static Metrics& instance();
+    Metrics(const Metrics&) = delete;
+    Metrics& operator=(const Metrics&) = delete;
+
+    void setEnabled(bool);
+    bool enabled() const { return d_enabled.load(std::memory_order_relaxed); }
+
+    void connectionOpened();
+    void connectionClosed();
+    void connectionRejected();
+    void requestShed();
+    void connectionRateLimited();
+    void requestRateLimited();
+    void parseError();
+    void tlsHandshakeFailed();
+    void tlsHandshakeCompleted(bool resumed);
+    void ktlsSendNegotiated(bool offloaded);
+    void http2Negotiated();
+    // Called from the deadline reaper thread, which has a shard of its own.
+    void connectionTimedOut(TimeoutKind);
+    void recordRequest(std::string_view method, std::string_view route, int status, uint64_t latencyNs,
+                       uint64_t bytesSent);
+    void recordPhases(const std::array<uint64_t, kPhaseCount>& nanoseconds, bool includesAccept);
+
+    // Folded into every snapshot, for metrics recorded by other processes
+    // such as prefork workers. Set before serving.
+    void setPeers(std::function<MetricsSnapshot()> peers);
+
+    // This process only.
+    MetricsSnapshot localSnapshot() const;
+    // This process and its peers.
+    MetricsSnapshot snapshot() const;
+    std::string renderPrometheus() const;
+
+  private:
+    struct Shard;
+    struct ShardHandle;
+
+    Metrics() = default;
+    Shard& localShard();
+    void retire(Shard*);
+
+    std::atomic<bool> d_enabled{true};
+    mutable std::mutex d_mtx;
+    std::vector<Shard*> d_shards;
+    MetricsSnapshot d_retired;
+    std::function<MetricsSnapshot()> d_peers;
+};
+
+} // namespace HTTPServer
+
+#endif
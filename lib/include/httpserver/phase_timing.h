@@ -0,0 +1,93 @@
+#ifndef PHASE_TIMING_H
+#define PHASE_TIMING_H
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace HTTPServer {
+
+enum class Phase : uint8_t {
+    Accept,  // accept() returned -> connection ready to read (incl. TLS handshake)
+    Recv,    // bytes available -> request bytes read
+    Parse,   // HttpParser::parse
+    Route,   // Router::match
+    Handler, // application handler
+    Send,    // serialize + write
+};
+
+constexpr size_t kPhaseCount = 6;
+
+const char* phaseName(Phase);
+
+enum class TimingClock {
+    Monotonic,       // CLOCK_MONOTONIC, ~20ns per read, ns resolution
+    MonotonicCoarse, // CLOCK_MONOTONIC_COARSE, cheapest syscall-free read, tick resolution
+    Tsc,             // rdtsc, calibrated against CLOCK_MONOTONIC (x86 only)
+};
+
+// Runtime switch for per-request phase timing. When disabled the request
+// path pays a single relaxed atomic load per request.
+class PhaseTiming {
+  public:
+    static PhaseTiming& instance();
+    PhaseTiming(const PhaseTiming&) = delete;
+    PhaseTiming& operator=(const PhaseTiming&) = delete;
+
+    void enable(TimingClock = TimingClock::Monotonic);
+    void disable();
+    bool enabled() const { return d_enabled.load(std::memory_order_relaxed); }
+    TimingClock clock() const { return d_clock.load(std::memory_order_relaxed); }
+
+    void setServerTimingHeader(bool);
+    bool serverTimingHeader() const { return d_serverTimingHeader.load(std::memory_order_relaxed); }
+
+    static uint64_t now(TimingClock);
+    double nanosecondsPerTick(TimingClock) const;
+
+  private:
+    PhaseTiming() = default;
+    void calibrateTsc();
+
+    std::atomic<bool> d_enabled{false};
+    std::atomic<TimingClock> d_clock{TimingClock::Monotonic};
+    std::atomic<bool> d_serverTimingHeader{false};
+    std::atomic<double> d_tscNsPerTick{0.0};
+};
+
+// Stack object accumulating the phases of one request. Every call is a no-op
+// when the recorder was constructed inactive.
+class PhaseRecorder {
+  public:
+    explicit PhaseRecorder(bool active);
+
+    bool active() const { return d_active; }
+    uint64_t now() const { return d_active ? PhaseTiming::now(d_clock) : 0; }
+    void start() { d_last = now(); }
+    void mark(Phase phase) {
+        if (!d_active) return;
+        const uint64_t t = PhaseTiming::now(d_clock);
+        d_ticks[static_cast<size_t>(phase)] += t - d_last;
+        d_last = t;
+    }
+    void set(Phase phase, uint64_t ticks) {
+        if (d_active) d_ticks[static_cast<size_t>(phase)] = ticks;
+    }
+
+    uint64_t nanoseconds(Phase) const;
+    std::array<uint64_t, kPhaseCount> nanoseconds() const;
+    std::string serverTimingHeader() const;
+
+  private:
+    bool d_active;
+    TimingClock d_clock{TimingClock::Monotonic};
+    double d_nsPerTick{1.0};
+    uint64_t d_last{0};
+    std::array<uint64_t, kPhaseCount> d_ticks{};
+};
+
+} // namespace HTTPServer
+
+#endif
@@ -0,0 +1,86 @@
+#ifndef PREFORK_H
+#define PREFORK_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <thread>
+
+#include "httpserver/metrics.h"
+
+namespace HTTPServer {
+
+struct PreforkOptions {
+    size_t workers = 0; // 0 = one per hardware thread
+    // Gives every worker a SO_REUSEPORT socket of its own, so the kernel
+    // spreads connections across workers instead of them taking turns on
+    // one accept queue.
+    bool reusePort = false;
+    // Wait before restarting a worker that died, so a worker crashing on
+    // startup does not spin.
+    std::chrono::milliseconds restartDelay{100};
+    // How often each worker publishes its metrics for the others to report.
+    std::chrono::milliseconds statsInterval{1000};
+};
+
+// Metrics of every prefork worker, kept in a shared anonymous mapping the
+// supervisor creates before forking. Each worker owns one slot and publishes
+// an encoded snapshot of its own metrics into it every statsInterval; a
+// scrape served by any worker adds the other slots to its own live metrics.
+// Recording stays entirely process and thread local: the only cross-process
+// traffic is one copy per interval, under a sequence lock readers retry on.
+//
+// When a worker exits, the supervisor folds its last snapshot into a retired
+// slot, so counters never go backwards when the worker is replaced.
+class SharedMetrics {
+  public:
+    static constexpr size_t kSlotBytes = 256 * 1024;
+
+    SharedMetrics() = default;
+    ~SharedMetrics();
+    SharedMetrics(const SharedMetrics&) = delete;
+    SharedMetrics& operator=(const SharedMetrics&) = delete;
+
+    // In the supervisor, before forking.
+    bool create(size_t workers);
+    size_t workers() const { return d_workers; }
+
+    // In a worker: publishes into 'worker's slot from a thread of its own,
+    // and adds the other slots to every Metrics snapshot.
+    void attach(size_t worker, std::chrono::milliseconds interval);
+    // Stops publishing after a final, up to date snapshot.
+    void detach();
+
+    // In the supervisor, once 'worker' has exited. Its connections are gone,
+    // so they are counted as closed.
+    void retire(size_t worker);
+
+    // Every slot but 'exclude'.
+    MetricsSnapshot collect(size_t exclude) const;
+
+  private:
+    static constexpr int kReadAttempts = 1000;
+
+    struct Slot;
+
+    Slot* slot(size_t index) const;
+    void publish(size_t index, const MetricsSnapshot&);
+    bool read(size_t index, MetricsSnapshot&) const;
+
+    void* d_mapping = nullptr;
+    size_t d_mappedSize = 0;
+    size_t d_workers = 0;
+    size_t d_self = 0;
+
+    std::thread d_publisher;
+    std::mutex d_mtx;
+    std::condition_variable d_cv;
+    bool d_stopping = false;
+    std::atomic<bool> d_trimmed{false};
+};
+
+} // namespace HTTPServer
+
+#endif
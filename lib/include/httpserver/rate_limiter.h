@@ -0,0 +1,97 @@
+#ifndef RATE_LIMITER_H
+#define RATE_LIMITER_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+
+#include "httpserver/client_address.h"
+
+namespace HTTPServer {
+
+// A token bucket: 'perSecond' tokens are added every second up to 'burst'.
+struct RateLimit {
+    double perSecond = 0; // 0 = unlimited
+    double burst = 1;
+};
+
+struct RateLimits {
+    RateLimit connections; // new connections per client IP, checked at accept
+    RateLimit requests;    // requests per client IP across its connections
+    // Clients tracked at once; the least recently seen are forgotten first.
+    size_t maxClients = 64 * 1024;
+    std::chrono::seconds retryAfter{1};
+};
+
+// Per client IP token buckets kept in a fixed size table that is allocated
+// once and never locked.
+//
+// The table is split into sets of kWays entries, and an address only ever
+// touches the set its hash selects, so clients in different sets never
+// share a cache line. Within a set a new client takes a free entry or the
+// one seen longest ago. Eviction is approximate: with 8 ways a flood of new
+// addresses pushes out the quietest clients in each set, whose buckets have
+// usually refilled anyway.
+//
+// Buckets are kept as a theoretical arrival time (GCRA): a check is one
+// compare-and-swap, with no separate token count and refill timestamp.
+// Addresses are keyed by a 64 bit hash seeded per process, so two clients
+// share a bucket only on a full hash collision, and nobody can pick
+// addresses that crowd into one set.
+class RateLimiter {
+  public:
+    static constexpr size_t kWays = 8;
+
+    RateLimiter() = default;
+    RateLimiter(const RateLimiter&) = delete;
+    RateLimiter& operator=(const RateLimiter&) = delete;
+
+    // Not thread-safe; call before any check.
+    void configure(const RateLimits&);
+    bool enabled() const { return d_sets != 0; }
+    const RateLimits& limits() const { return d_limits; }
+    size_t capacity() const { return d_sets * kWays; }
+
+    // Each takes a token from the client's bucket; false when it is empty.
+    // Clients on a Unix domain socket have no IP and are never limited.
+    bool allowConnection(const ClientAddress&);
+    bool allowRequest(const ClientAddress&);
+
+    // Closes a connection refused at accept, after a pre-serialized 429 when
+    // 'sendResponse' is set. Never blocks.
+    void reject(int fd, bool sendResponse) const;
+    std::string_view rejection() const { return d_rejection; }
+
+  private:
+    struct alignas(32) Entry {
+        std::atomic<uint64_t> key{0}; // 0 = free
+        std::atomic<uint64_t> lastSeen{0};
+        std::atomic<uint64_t> connectionsTat{0};
+        std::atomic<uint64_t> requestsTat{0};
+    };
+
+    struct Bucket {
+        uint64_t interval = 0;  // ns per token, 0 = unlimited
+        uint64_t tolerance = 0; // ns the arrival time may run ahead of now
+    };
+
+    static Bucket toBucket(const RateLimit&);
+    static bool take(std::atomic<uint64_t>& tat, const Bucket&, uint64_t now);
+    Entry& find(const ClientAddress&, uint64_t now);
+
+    RateLimits d_limits;
+    Bucket d_connections;
+    Bucket d_requests;
+    std::unique_ptr<Entry[]> d_entries;
+    size_t d_sets = 0;
+    uint64_t d_seed = 0;
+    std::string d_rejection;
+};
+
+} // namespace HTTPServer
+
+#endif
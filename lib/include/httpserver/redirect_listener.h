@@ -0,0 +1,87 @@
+#ifndef REDIRECT_LISTENER_H
+#define REDIRECT_LISTENER_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#include "httpserver/admission.h"
+#include "httpserver/buffer_pool.h"
+#include "httpserver/port.h"
+#include "httpserver/timer_wheel.h"
+
+namespace HTTPServer {
+
+// Plain HTTP listener that answers every request with a 301 to the same host
+// and path over HTTPS. One thread multiplexes all clients through epoll on
+// non-blocking sockets, so an idle or slow client never delays the others,
+// and connections are kept alive between requests. Each connection's idle
+// deadline lives in a TimerWheel, so idle clients are closed without scanning
+// every connection.
+//
+// The response is assembled from pre-serialized pieces: everything up to the
+// Location value is fixed, only the host and request target are spliced in
+// with a single writev.
+class RedirectListener {
+  public:
+    // 'admission', if given, must outlive the listener.
+    RedirectListener(const Port& httpsPort, std::chrono::milliseconds idleTimeout,
+                     ListenerAdmission* admission = nullptr);
+    ~RedirectListener();
+    RedirectListener(const RedirectListener&) = delete;
+    RedirectListener& operator=(const RedirectListener&) = delete;
+
+    // Serves 'listenFd', which must already be listening, until stop(). The
+    // listener takes ownership of the socket and closes it on return.
+    void run(int listenFd);
+    // Safe to call from any thread or a signal handler.
+    void stop();
+
+    size_t connectionCount() const { return d_connectionCount.load(std::memory_order_relaxed); }
+
+  private:
+    static constexpr size_t kMaxRequestHead = 8 * 1024;
+
+    struct Connection : TimerWheel::Timer {
+        int fd = -1;
+        PooledBuffer in;
+        size_t buffered = 0;
+        std::string out; // unsent tail of a response the socket would not take
+        size_t outOffset = 0;
+        bool closeAfterWrite = false;
+    };
+
+    void acceptClients();
+    void setAcceptPaused(bool paused);
+    void onReadable(Connection&);
+    void onWritable(Connection&);
+    bool processRequests(Connection&);
+    void respond(Connection&, std::string_view head, bool forceClose);
+    void send(Connection&, std::string_view host, std::string_view target, bool keepAlive);
+    void sendBadRequest(Connection&);
+    void touch(Connection&);
+    void closeConnection(int fd);
+
+    const std::string d_keepAlivePrefix;
+    const std::string d_closePrefix;
+    const std::string d_portSuffix;
+    const std::chrono::milliseconds d_idleTimeout;
+    ListenerAdmission* const d_admission;
+
+    int d_epollFd = -1;
+    int d_listenFd = -1;
+    bool d_acceptPaused = false;
+    int d_wakeFd = -1;
+    std::atomic<bool> d_stopping{false};
+    std::unordered_map<int, std::unique_ptr<Connection>> d_connections;
+    TimerWheel d_idleTimers;
+    std::atomic<size_t> d_connectionCount{0};
+};
+
+} // namespace HTTPServer
+
+#endif
@@ -0,0 +1,109 @@
+#ifndef REVERSE_PROXY_H
+#define REVERSE_PROXY_H
+
+#include <sys/socket.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "httpserver/http_object.h"
+#include "httpserver/task.h"
+
+namespace HTTPServer {
+
+enum class LoadBalancing {
+    RoundRobin,
+    LeastConnections, // fewest requests in flight, round robin among ties
+};
+
+struct ProxyOptions {
+    // "host:port", "[v6 address]:port" or "unix:/path/to/socket".
+    std::vector<std::string> upstreams;
+    LoadBalancing balancing = LoadBalancing::RoundRobin;
+    // Idle keep-alive connections kept open per upstream.
+    size_t maxIdlePerUpstream = 32;
+    std::chrono::milliseconds connectTimeout{1000};
+    // Longest the upstream may take to accept more of the request or to
+    // send more of the response.
+    std::chrono::milliseconds ioTimeout{30000};
+    size_t maxResponseBodySize = 64 * 1024 * 1024;
+    // Passive health checking: an upstream that fails this many requests in
+    // a row (connection refused, reset, timed out or unparsable response) is
+    // skipped for ejectFor. Only when every upstream is ejected are they
+    // tried regardless.
+    size_t maxFails = 3;
+    std::chrono::milliseconds ejectFor{10000};
+};
+
+// Forwards requests over HTTP/1.1 to a set of upstream servers, reusing
+// keep-alive connections from a pool per upstream so a proxied request
+// costs no handshake once the pool is warm.
+//
+// forward() is a coroutine: connecting, sending and waiting for the
+// response are all awaited on the IoScheduler, so requests waiting on slow
+// upstreams hold no thread. Hop-by-hop headers are dropped in both
+// directions and the client's Host header is passed on. Bodies are relayed
+// whole: the request body is already read by the time a handler runs, and
+// the response body is read into the response before it is returned.
+//
+// Upstream failures answer 502 (504 when the upstream timed out). A
+// request on a pooled connection the upstream had already closed is
+// retried once on a fresh one if its method is idempotent.
+class ReverseProxy {
+  public:
+    explicit ReverseProxy(const ProxyOptions&);
+    ~ReverseProxy();
+    ReverseProxy(const ReverseProxy&) = delete;
+    ReverseProxy& operator=(const ReverseProxy&) = delete;
+
+    Task<HttpResponse> forward(const HttpRequest&);
+
+    // Upstreams the options named that could be resolved.
+    size_t upstreams() const { return d_upstreams.size(); }
+    size_t idleConnections() const;
+
+  private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Upstream {
+        std::string name;
+        std::string authority; // Host header for requests that have none
+        sockaddr_storage address{};
+        socklen_t addressLength = 0;
+        std::atomic<size_t> active{0};
+        std::atomic<size_t> failures{0};
+        std::atomic<Clock::rep> ejectedUntil{0};
+        mutable std::mutex mtx;
+        std::vector<int> idle;
+    };
+
+    enum class Result { Ok, Stale, Failed, TimedOut };
+
+    static bool resolve(std::string_view spec, Upstream&);
+
+    Upstream* pick();
+    int takeIdle(Upstream&);
+    void putIdle(Upstream&, int fd);
+    void succeeded(Upstream&);
+    void failed(Upstream&);
+
+    Task<int> connect(const Upstream&);
+    Task<Result> exchange(int fd, bool reused, std::string_view head, const HttpRequest&, HttpResponse&,
+                          bool& reusable);
+    Task<bool> sendAll(int fd, std::string_view data, bool& timedOut);
+    Task<ssize_t> receive(int fd, std::string& in, bool& timedOut);
+
+    const ProxyOptions d_options;
+    std::vector<std::unique_ptr<Upstream>> d_upstreams;
+    std::atomic<size_t> d_next{0};
+};
+
+} // namespace HTTPServer
+
+#endif
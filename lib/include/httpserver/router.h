@@ -2,18 +2,82 @@
 #define ROUTER_H
 
 #include <functional>
+#include <memory>
 #include <unordered_map>
 #include <string>
+#include <string_view>
+#include <vector>
 
 #include "http_object.h"
+#include "httpserver/event_stream.h"
+#include "httpserver/reverse_proxy.h"
+#include "httpserver/task.h"
+#include "httpserver/websocket.h"
 
 namespace HTTPServer {
 
 using RequestHandler = std::function<HttpResponse(const HttpRequest&)>;
+// Suspends on the awaitables of IoScheduler (or anything else) instead of
+// blocking, so a waiting request holds a coroutine frame but no thread.
+using AsyncRequestHandler = std::function<Task<HttpResponse>(const HttpRequest&)>;
+
+// Where a route's handler runs. Inline handlers run on the thread that read
+// the request, which suits anything quick. Offloaded handlers run on the
+// HandlerExecutor, for handlers that are slow, CPU heavy or block, so they
+// cannot hold up the quick ones; the response is handed back to the
+// connection to be written.
+enum class HandlerExecution {
+    Inline,
+    Offloaded,
+};
+
+// The handler registered for a route, in either form.
+class RouteHandler {
+    public:
+        using Done = std::function<void(HttpResponse)>;
+
+        RouteHandler(RequestHandler handler, HandlerExecution execution = HandlerExecution::Inline)
+            : d_handler(std::move(handler)), d_execution(execution) {}
+        RouteHandler(AsyncRequestHandler handler, HandlerExecution execution = HandlerExecution::Inline)
+            : d_asyncHandler(std::move(handler)), d_execution(execution) {}
+        // Answers the upgrade handshake; the server then hands the connection
+        // to a WebSocketConnection running 'route'.
+        explicit RouteHandler(std::shared_ptr<const WebSocketRoute> route)
+            : d_handler(WebSocket::handshake), d_execution(HandlerExecution::Inline),
+              d_webSocket(std::move(route)) {}
+        // Opens the stream; the server then keeps the connection to write
+        // the events of the hub 'route' selects.
+        explicit RouteHandler(std::shared_ptr<const EventStreamRoute> route);
+
+        bool isAsync() const { return static_cast<bool>(d_asyncHandler); }
+        bool isOffloaded() const { return d_execution == HandlerExecution::Offloaded; }
+        const WebSocketRoute* webSocket() const { return d_webSocket.get(); }
+        const EventStreamRoute* eventStream() const { return d_eventStream.get(); }
+
+        // Produces the response on the calling thread, blocking it while an
+        // asynchronous handler is suspended.
+        HttpResponse operator()(const HttpRequest&) const;
+        // Calls 'done' with the response: before returning for a synchronous
+        // handler, from whichever thread an asynchronous one finishes on
+        // otherwise, and from an executor thread when offloaded. 'request'
+        // must stay alive until then. An exception escaping an asynchronous
+        // handler becomes a 500, and an offloaded request the executor has
+        // no room for a 503.
+        void start(const HttpRequest& request, Done done) const;
+
+    private:
+        void startHere(const HttpRequest& request, Done done) const;
+
+        RequestHandler d_handler;
+        AsyncRequestHandler d_asyncHandler;
+        HandlerExecution d_execution;
+        std::shared_ptr<const WebSocketRoute> d_webSocket;
+        std::shared_ptr<const EventStreamRoute> d_eventStream;
+};
 
 struct DynamicRoute {
     std::string d_pattern;
-    RequestHandler d_handler;
+    RouteHandler d_handler;
 };
 
 class Router {
@@ -24,15 +88,38 @@ class Router {
         Router(Router&&) = delete;
         Router& operator=(Router&&) = delete;
 
-        void addRoute(const std::string&, const std::string&, RequestHandler);
+        void addRoute(const std::string&, const std::string&, RequestHandler,
+                      HandlerExecution = HandlerExecution::Inline);
+        void addRoute(const std::string&, const std::string&, AsyncRequestHandler,
+                      HandlerExecution = HandlerExecution::Inline);
         void addStaticDirectoryRoute(const std::string&, const std::string&);
+        void addMetricsRoute(const std::string& = "/metrics");
+        // Forwards every request under 'urlBase' (path and query unchanged)
+        // to the upstreams in 'options', see ReverseProxy.
+        void addProxyRoute(const std::string& urlBase, const ProxyOptions& options);
+        // Accepts WebSocket upgrades on GET 'path' (HTTP/1.1 only) and runs
+        // 'handler' for the connection, see WebSocketConnection.
+        void addWebSocketRoute(const std::string& path, WebSocketHandler handler,
+                               const WebSocketOptions& options = {});
+        // Serves Server-Sent Events on GET 'path' (HTTP/1.1 only): each
+        // request holds its connection open as a subscriber of 'hub', or of
+        // the hub 'select' picks for it.
+        void addEventStreamRoute(const std::string& path, EventStreamHub& hub,
+                                 const EventStreamOptions& options = {});
+        void addEventStreamRoute(const std::string& path, EventStreamSelector select,
+                                 const EventStreamOptions& options = {});
+        const RouteHandler* match(HttpRequest&) const;
         HttpResponse route(HttpRequest&) const;
 
     private:
         Router() = default;
-        bool matchDynamic(const std::string&, const std::string&, HttpRequest&) const;
-        std::unordered_map<std::string, std::unordered_map<std::string, RequestHandler>> d_routes;
-        std::unordered_map<std::string, std::vector<DynamicRoute>> d_dynamicRoutes;
+        template <typename Value>
+        using StringMap = std::unordered_map<std::string, Value, StringHash, StringEqual>;
+
+        void addRoute(const std::string&, const std::string&, RouteHandler);
+        bool matchDynamic(std::string_view, std::string_view, HttpRequest&) const;
+        StringMap<StringMap<RouteHandler>> d_routes;
+        StringMap<std::vector<DynamicRoute>> d_dynamicRoutes;
 };
 
 } // namespace HTTPServer
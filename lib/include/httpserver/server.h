@@ -2,23 +2,70 @@
 #define SERVER_H
 
 #include <openssl/ssl.h>
+#include <poll.h>
 #include <unistd.h>
 
+#include <array>
 #include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstring>
+#include <functional>
+#include <list>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <string_view>
 #include <thread>
 #include <vector>
 
+#include "httpserver/access_log.h"
+#include "httpserver/admission.h"
+#include "httpserver/buffer_pool.h"
+#include "httpserver/event_stream.h"
+#include "httpserver/client_address.h"
+#include "httpserver/handler_executor.h"
+#include "httpserver/http2.h"
 #include "httpserver/http_object.h"
 #include "httpserver/http_parser.h"
 #include "httpserver/http_response_builder.h"
+#include "httpserver/listener_handoff.h"
+#include "httpserver/load_shedder.h"
 #include "httpserver/logger.h"
+#include "httpserver/metrics.h"
+#include "httpserver/phase_timing.h"
 #include "httpserver/port.h"
+#include "httpserver/prefork.h"
+#include "httpserver/rate_limiter.h"
+#include "httpserver/redirect_listener.h"
 #include "httpserver/router.h"
+#include "httpserver/socket_options.h"
+#include "httpserver/timer_wheel.h"
+#include "httpserver/tls_session.h"
+#include "httpserver/unix_socket.h"
 #include "httpserver/utils.h"
+#include "httpserver/websocket.h"
 
 
 namespace HTTPServer {
 
+struct AcceptedClient {
+  int fd{-1};
+  ClientAddress address;
+  // PhaseTiming ticks at accept(), zero when phase timing was disabled.
+  uint64_t acceptTicks{0};
+  TimingClock acceptClock{TimingClock::Monotonic};
+};
+
+// Where a drain stands; connections are those of the main listener.
+struct DrainProgress {
+  bool draining{false};
+  size_t connectionsAtStart{0};
+  size_t remaining{0};
+  size_t idleClosed{0};  // waiting for a next request, closed at once
+  size_t forced{0};      // still open at the drain deadline
+};
+
 class Server {
  public:
   explicit Server(Port port = Port(443));
@@ -28,96 +75,561 @@ class Server {
   const Port& port() const;
   void start();
   void installSignalHandlers();
+  // Drains and stops: stops accepting, closes idle keep-alive connections,
+  // answers in-flight requests with Connection: close (HTTP/2 connections
+  // get GOAWAY and finish their open streams), and shuts down whatever is
+  // still open once the drain timeout passes.
   void stop();
+  // Zero downtime upgrade, also on SIGUSR2: starts the binary again with the
+  // listening sockets handed over (see ListenerHandoff), and drains once the
+  // new process is accepting. If it never gets that far this process simply
+  // keeps serving.
+  bool upgrade();
+  void setDrainTimeout(std::chrono::milliseconds timeout);
+  DrainProgress drainProgress() const;
   void enableHttps(const std::string& certFile, const std::string& keyFile);
   void enableHttpRedirection(Port redirection_port = Port(80));
+  // Adds Strict-Transport-Security to HTTPS responses so browsers go
+  // straight to HTTPS instead of through the redirect listener.
+  void enableHsts(std::chrono::seconds maxAge = std::chrono::seconds(31536000),
+                  bool includeSubDomains = false);
+  void setTlsSessionOptions(const TlsSessionOptions& options);
+  void enableKernelTls(bool enabled = true);
+  // Offers "h2" over ALPN; clients that do not ask for it keep HTTP/1.1.
+  void enableHttp2(bool enabled = true);
+  void enableAccessLog(const std::string& path,
+                       size_t capacity = kDefaultAccessLogCapacity);
+  // Deadlines for keep-alive idle, reading a request head and body, and
+  // write stalls; a connection missing one is shut down.
+  void setConnectionTimeouts(const ConnectionTimeouts& timeouts);
+  // Caps on concurrent connections and what to do with the ones over them.
+  void setConnectionLimits(const ConnectionLimits& limits);
+  // Per client IP token buckets for new connections and for requests;
+  // clients over either are answered 429.
+  void setRateLimits(const RateLimits& limits);
+  // Bounds how many handlers run at once and sheds requests with 503 once
+  // their queueing delay shows the server is persistently overloaded.
+  void enableLoadShedding(const LoadSheddingOptions& options = {});
+  // Threads and queue depth for routes added with HandlerExecution::Offloaded.
+  void setHandlerExecutor(const HandlerExecutorOptions& options);
+  // Runs as a supervisor that forks worker processes to serve, restarts
+  // any that die, and reports metrics summed over all of them.
+  void enablePrefork(const PreforkOptions& options = {});
+  // Also accepts on the Unix domain socket 'path' ("@name" for the abstract
+  // namespace), with the same connection handling as the TCP port. May be
+  // called for any number of paths.
+  void addUnixListener(const std::string& path,
+                       const UnixListenerOptions& options = {});
+  // Serves the Unix listeners alone, without binding the TCP port.
+  void disableTcpListener();
+  // Options for every listening socket and accepted connection.
+  void setSocketOptions(const SocketOptions& options);
 
  private:
-  static constexpr int kClientRecvTimeoutSec = 5;
+  static constexpr size_t kDefaultAccessLogCapacity = 1 << 20;
   static constexpr int kDefaultHttpRedirectPort = 8080;
-  static constexpr size_t kRecvBufferSize = 4096;
+  static constexpr size_t kRecvBufferSize = BufferPool::kMinBufferSize;
+  static constexpr size_t kRequestArenaSize = 16 * 1024;
+  static constexpr size_t kMaxHeaderBytes = 64 * 1024;
+  static constexpr size_t kMaxRequestBytes = BufferPool::kMaxBufferSize;
+  static constexpr size_t kMaxCoalescedBody = 4096;
   static constexpr int kMaxKeepAliveRequests = 100;
+  static constexpr auto kDefaultDrainTimeout = std::chrono::seconds(10);
+
+  struct UnixListener {
+    std::string path;
+    UnixListenerOptions options;
+    int fd{-1};
+  };
 
   const Port d_port;
   Port d_redirection_port;
   int server_fd{-1};
   int redirection_server_fd{-1};
   std::atomic<bool> d_running{false};
-  std::vector<std::thread> client_threads;
+  pid_t d_upgradePid{-1};
+  // Written by the signal handlers and polled by the main accept loop, or
+  // the supervisor, which then stops or upgrades. Left open for as long as
+  // the handlers may run.
+  int d_signalFd{-1};
+  // Every listening socket on d_port; one per worker with SO_REUSEPORT.
+  std::vector<int> d_listenFds;
+  bool tcp_enabled{true};
+  std::vector<UnixListener> d_unixListeners;
+  std::vector<std::thread> d_acceptThreads;
+  SocketOptions d_socketOptions;
+  bool prefork_enabled{false};
+  PreforkOptions d_prefork;
+  int d_workerIndex{-1};  // -1 in the supervisor or without prefork
+  std::vector<std::atomic<pid_t>> d_workerPids;  // 0 while not running
+  SharedMetrics d_sharedMetrics;
+  // Appended to by every accept thread, so guarded by client_threads_mtx.
+  // A thread adds itself to finished_client_threads as it exits, and is
+  // joined and removed on the next dispatch, so finished connections do not
+  // keep their threads and stacks until stop(). The finished list has its
+  // own mutex so exiting threads never wait on a thread being created.
+  std::mutex client_threads_mtx;
+  std::list<std::thread> client_threads;
+  std::mutex finished_client_threads_mtx;
+  std::vector<std::list<std::thread>::iterator> finished_client_threads;
   bool https_enabled{false};
   bool http_redirection_enabled{false};
+  bool ktls_enabled{false};
+  bool http2_enabled{false};
   std::string cert_path;
   std::string key_path;
   SSL_CTX* ssl_ctx{nullptr};
+  TlsSessionOptions d_tlsSessionOptions;
+  std::unique_ptr<TicketKeyRing> d_ticketKeys;
+  std::string hsts_header;
+  std::unique_ptr<RedirectListener> d_redirectListener;
+  std::string access_log_path;
+  size_t access_log_capacity{kDefaultAccessLogCapacity};
+  AccessLog d_accessLog;
+  ConnectionTimeouts d_timeouts;
+  DeadlineReaper d_deadlines;
+  ConnectionLimits d_limits;
+  ConnectionLimiter d_totalConnections;
+  ListenerAdmission d_admission{&d_totalConnections};
+  ListenerAdmission d_redirectAdmission{&d_totalConnections};
+  RateLimiter d_rateLimiter;
+  LoadShedder d_loadShedder;
+  std::chrono::milliseconds d_drainTimeout{kDefaultDrainTimeout};
+  // Readable from the moment a drain starts; polled next to every idle
+  // connection so none of them waits out its idle deadline.
+  int d_drainFd{-1};
+  std::atomic<bool> d_draining{false};
+  std::atomic<size_t> d_drainAtStart{0};
+  std::atomic<size_t> d_drainIdleClosed{0};
+  std::atomic<size_t> d_drainForced{0};
 
-  template <typename Reader, typename Writer>
-  void init_request_processor(int client_fd, Reader readFunc, Writer writeFunc,
+  template <typename Reader, typename Writer, typename FileSender>
+  void init_request_processor(const AcceptedClient& accepted, Reader readFunc,
+                              Writer writeFunc, FileSender sendFileFunc,
                               bool isTLS = false, SSL* ssl = nullptr);
+  HttpResponse run_handler(const RouteHandler& handler,
+                           const HttpRequest& request);
+  void start_handler(const RouteHandler& handler, const HttpRequest& request,
+                     RouteHandler::Done done);
+  enum class ReadStatus { Complete, Closed, Error, TooLarge };
+
+  template <typename Reader>
+  ReadStatus read_request(Reader& readFunc, PooledBuffer& buffer,
+                          size_t& buffered, RequestFrame& frame,
+                          ConnectionDeadline& deadline) const;
+  template <typename Writer>
+  static bool write_all(Writer& writeFunc, const char* data, size_t size,
+                        bool more, size_t& written,
+                        ConnectionDeadline& deadline);
+  std::function<bool(std::chrono::milliseconds, int)> session_wait(
+      int client_fd, SSL* ssl, ConnectionDeadline& deadline);
+  template <typename Reader, typename Writer>
+  void run_event_stream(const EventStreamRoute& route,
+                        const HttpRequest& request, Reader& readFunc,
+                        Writer& writeFunc, int client_fd, SSL* ssl,
+                        ConnectionDeadline& deadline);
+  template <typename Reader, typename Writer>
+  void run_websocket(const WebSocketRoute& route, const HttpRequest& upgrade,
+                     Reader& readFunc, Writer& writeFunc, int client_fd,
+                     SSL* ssl, std::string_view pending,
+                     ConnectionDeadline& deadline);
+  bool wait_for_request(int client_fd, SSL* ssl, bool drainable);
   bool init_ssl_context();
   void cleanup_ssl_context();
-  void dispatch_client(int client_fd);
-  void handle_client(SSL* ssl);
-  void handle_client(int client_fd);
+  void accept_connections(int listen_fd, bool tls, int wake_fd,
+                          int signal_fd = -1);
+  void handle_signals();
+  void dispatch_client(const AcceptedClient& accepted, bool tls);
+  bool start_client_thread(std::function<void()> run);
+  bool tls_handshake(SSL* ssl, int client_fd);
+  void handle_client(SSL* ssl, const AcceptedClient& accepted);
+  void handle_client(const AcceptedClient& accepted);
+  void handle_http2_client(SSL* ssl, const AcceptedClient& accepted);
   void start_http_redirect(const Port& redirection_port);
+  int open_listener(const Port& port, bool reusePort);
+  bool open_listeners();
+  bool open_unix_listeners();
+  void close_unix_listeners();
+  void serve();
+  size_t worker_count() const;
+  void run_supervisor();
+  void spawn_worker(size_t index);
+  [[noreturn]] void run_worker(size_t index);
+  void drain();
 };
 
-template <typename Reader, typename Writer>
-void Server::init_request_processor(int client_fd, Reader readFunc,
-                                    Writer writeFunc, bool isTLS, SSL* ssl) {
+template <typename Reader, typename Writer, typename FileSender>
+void Server::init_request_processor(const AcceptedClient& accepted,
+                                    Reader readFunc, Writer writeFunc,
+                                    FileSender sendFileFunc, bool isTLS,
+                                    SSL* ssl) {
+  const int client_fd = accepted.fd;
+  const ClientAddress& client = accepted.address;
+  const uint64_t acceptTicks =
+      accepted.acceptTicks
+          ? PhaseTiming::now(accepted.acceptClock) - accepted.acceptTicks
+          : 0;
+
   LOG_INFO("Client [" + std::to_string(client_fd) + "] connected" +
            (isTLS ? " via secure TLS" : ""));
+  Metrics::instance().connectionOpened();
+
+  // Connections borrow pooled buffers only while a request is in flight:
+  // recvBuffer is held across iterations only when a pipelined request is
+  // already buffered, and the arena (parsed request, response, serialized
+  // head) lives for a single request.
+  PooledBuffer recvBuffer;
+  size_t buffered = 0;
+  ConnectionDeadline deadline(d_deadlines, client_fd);
 
   bool keepAlive = true;
   int requests_handled = 0;
   while (keepAlive && requests_handled < kMaxKeepAliveRequests) {
-    char buffer[kRecvBufferSize];
-    int bytes = readFunc(buffer, sizeof(buffer));
-    if (bytes <= 0) {
-      if (bytes == 0)
-        LOG_INFO("Client [" + std::to_string(client_fd) +
-                 "] closed connection");
-      else if (errno == EAGAIN || errno == EWOULDBLOCK)
-        LOG_INFO("Client [" + std::to_string(client_fd) +
-                 "] idle timeout reached, closing");
-      else
-        LOG_ERROR("Fatal: Client [" + std::to_string(client_fd) +
-                  "] recv error");
+    PhaseRecorder phases(PhaseTiming::instance().enabled());
+    if (buffered == 0) {
+      BufferPool::instance().trimThreadCache();
+      deadline.arm(TimeoutKind::Idle, d_timeouts.idle);
+      // A client that has only just connected is about to send its first
+      // request, so only connections that have been served count as idle.
+      if (!wait_for_request(client_fd, ssl, requests_handled > 0) ||
+          deadline.expired())
+        break;
+    }
+    // The head deadline covers the whole head however slowly it trickles in,
+    // unlike a receive timeout which restarts with every byte.
+    deadline.arm(TimeoutKind::Header, d_timeouts.header);
+    phases.start();
+
+    RequestFrame frame;
+    const ReadStatus status =
+        read_request(readFunc, recvBuffer, buffered, frame, deadline);
+    if (deadline.expired()) break;
+    if (status == ReadStatus::Closed) {
+      LOG_INFO("Client [" + std::to_string(client_fd) +
+               "] closed connection");
+      break;
+    }
+    if (status == ReadStatus::Error) {
+      LOG_ERROR("Fatal: Client [" + std::to_string(client_fd) +
+                "] recv error");
       break;
     }
 
-    std::string raw(buffer, bytes);
-    HttpRequest request;
-    ParseError err = HttpParser::parse(raw, request);
-    HttpResponse response;
+    const auto requestStart = std::chrono::steady_clock::now();
+    const bool timesAccept = requests_handled == 0 && acceptTicks != 0 &&
+                             accepted.acceptClock == PhaseTiming::instance().clock();
+    if (timesAccept) phases.set(Phase::Accept, acceptTicks);
+    phases.mark(Phase::Recv);
+
+    // Everything the request allocates comes from this arena and is dropped
+    // wholesale at the end of the iteration; larger requests spill to the
+    // heap and are freed along with it.
+    PooledBuffer arenaBuffer = BufferPool::instance().acquire(kRequestArenaSize);
+    std::pmr::monotonic_buffer_resource arena(arenaBuffer.data(),
+                                              arenaBuffer.capacity());
+
+    HttpRequest request(&arena);
+    ParseError err = ParseError::REQUEST_TOO_LARGE;
+    if (status == ReadStatus::Complete) {
+      err = HttpParser::parse(
+          std::string_view(recvBuffer.data(), frame.totalBytes()), request);
+
+      // The request now owns copies of everything it needs; keep only the
+      // bytes of any pipelined request that followed it.
+      buffered -= frame.totalBytes();
+      if (buffered > 0) {
+        std::memmove(recvBuffer.data(),
+                     recvBuffer.data() + frame.totalBytes(), buffered);
+      } else {
+        recvBuffer.reset();
+      }
+    }
+    phases.mark(Phase::Parse);
+    HttpResponse response(&arena);
+    // Set when the response hands the connection over to a WebSocket or an
+    // event stream, which then runs on this thread until it closes.
+    const RouteHandler* session = nullptr;
     if (err != ParseError::NONE) {
       LOG_ERROR("Bad HTTP request from client [" + std::to_string(client_fd) +
-                "]: " + request.method + " " + request.path);
-      response = Responses::badRequest();
+                "]: " + std::string(request.method) + " " +
+                std::string(request.path));
+      Metrics::instance().parseError();
+      response = Responses::badRequest(&arena);
       keepAlive = false;
+    } else if (!d_rateLimiter.allowRequest(client)) {
+      response = Responses::tooManyRequests(request,
+                                            d_rateLimiter.limits().retryAfter);
+      keepAlive = requestWantsKeepAlive(request);
     } else {
       LOG_INFO("Parsed request from client [" + std::to_string(client_fd) +
-               "]: " + request.method + " " + request.path);
-      response = Router::instance().route(request);
+               "]: " + std::string(request.method) + " " +
+               std::string(request.path));
+      const RouteHandler* handler = Router::instance().match(request);
+      phases.mark(Phase::Route);
+      response = handler ? run_handler(*handler, request)
+                         : Responses::notFound(request);
+      phases.mark(Phase::Handler);
       keepAlive = requestWantsKeepAlive(request);
+      if (handler &&
+          ((handler->webSocket() &&
+            response.code == StatusCode::SwitchingProtocols) ||
+           (handler->eventStream() && response.code == StatusCode::OK)))
+        session = handler;
+    }
+
+    if (d_draining.load(std::memory_order_relaxed)) {
+      // No new sessions once draining; the client may retry on whichever
+      // process takes over.
+      if (session) {
+        response = Responses::serviceUnavailable(request,
+                                                 std::chrono::seconds(1));
+        session = nullptr;
+      }
+      response.addHeader("Connection", "close");
+      keepAlive = false;
+    }
+    if (isTLS && !hsts_header.empty()) {
+      response.addHeader("Strict-Transport-Security", hsts_header);
+    }
+    if (phases.active() && PhaseTiming::instance().serverTimingHeader()) {
+      response.addHeader("Server-Timing", phases.serverTimingHeader());
+    }
+
+    // Small bodies go out in the same write as the head; larger ones are
+    // written straight from the response without another copy, and file
+    // bodies are handed to the connection's sendfile path.
+    const std::string_view body = response.body;
+    const FileBody* file = response.file.get();
+    const size_t headSize = response.headSize();
+    const size_t inlineBody = body.size() <= kMaxCoalescedBody ? body.size() : 0;
+    const bool separateBody = inlineBody != body.size();
+    char* head = static_cast<char*>(arena.allocate(headSize + inlineBody, 1));
+    body.copy(response.serializeHead(head), inlineBody);
+
+    // Only what reached the socket is logged and counted, so a failed or
+    // timed out send shows how far it got.
+    deadline.arm(TimeoutKind::Write, d_timeouts.writeStall);
+    size_t bytesSent = 0;
+    const bool sent =
+        write_all(writeFunc, head, headSize + inlineBody,
+                  separateBody || file, bytesSent, deadline) &&
+        (!separateBody || write_all(writeFunc, body.data(), body.size(),
+                                    file != nullptr, bytesSent, deadline)) &&
+        (!file ||
+         sendFileFunc(file->fd(), file->size(), bytesSent, deadline));
+    phases.mark(Phase::Send);
+    if (!sent) {
+      if (!deadline.expired())
+        LOG_ERROR("Client [" + std::to_string(client_fd) + "] send error");
+      keepAlive = false;
     }
 
-    std::string payload = response.serialize();
-    writeFunc(payload.c_str(), payload.size());
+    const auto latency = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - requestStart);
+    // Nothing parsed from a bad request is trusted as a label; unmatched
+    // routes already share the empty route.
+    const bool parsed = err == ParseError::NONE;
+    Metrics::instance().recordRequest(
+        parsed ? std::string_view(request.method) : Metrics::kOtherMethod,
+        parsed ? request.route : std::string_view(),
+        static_cast<int>(response.code), latency.count(), bytesSent);
+
+    std::array<uint64_t, kPhaseCount> phaseNs{};
+    if (phases.active()) {
+      phaseNs = phases.nanoseconds();
+      Metrics::instance().recordPhases(phaseNs, timesAccept);
+    }
+
+    if (d_accessLog.isOpen()) {
+      d_accessLog.append({client, request.method, request.path,
+                          static_cast<int>(response.code), bytesSent,
+                          static_cast<uint32_t>(latency.count() / 1000),
+                          isTLS, phases.active() ? &phaseNs : nullptr});
+    }
 
     requests_handled++;
+    if (session && sent) {
+      if (session->webSocket()) {
+        run_websocket(*session->webSocket(), request, readFunc, writeFunc,
+                      client_fd, ssl,
+                      buffered ? std::string_view(recvBuffer.data(), buffered)
+                               : std::string_view(),
+                      deadline);
+      } else {
+        run_event_stream(*session->eventStream(), request, readFunc,
+                         writeFunc, client_fd, ssl, deadline);
+      }
+      break;
+    }
     if (!keepAlive) break;
   }
 
   if (isTLS && ssl) {
+    deadline.arm(TimeoutKind::Write, d_timeouts.writeStall);
     SSL_shutdown(ssl);
     SSL_free(ssl);
   }
 
+  // No deadline may fire once the descriptor can be reused.
+  deadline.disarm();
   close(client_fd);
+  Metrics::instance().connectionClosed();
   LOG_INFO("Client [" + std::to_string(client_fd) + "] disconnected" +
            (isTLS ? " (Secure TLS)" : ""));
 }
 
+// Reads until the request at the front of 'buffer' is complete. The buffer
+// starts at the smallest pool class and is swapped for a larger one at most
+// twice: while the header block outgrows it, and once the Content-Length is
+// known, so bodies are read in place rather than regrown in steps. Once the
+// head is in, the rest of the body gets its own deadline.
+template <typename Reader>
+Server::ReadStatus Server::read_request(Reader& readFunc, PooledBuffer& buffer,
+                                        size_t& buffered, RequestFrame& frame,
+                                        ConnectionDeadline& deadline) const {
+  if (!buffer) buffer = BufferPool::instance().acquire(kRecvBufferSize);
+
+  bool readingBody = false;
+  while (true) {
+    frame = HttpParser::frame(std::string_view(buffer.data(), buffered));
+
+    size_t required = 0;
+    if (frame.headersComplete) {
+      if (frame.contentLength > kMaxRequestBytes - frame.headerBytes)
+        return ReadStatus::TooLarge;
+      if (buffered >= frame.totalBytes()) return ReadStatus::Complete;
+      required = frame.totalBytes();
+      if (!readingBody) {
+        deadline.arm(TimeoutKind::Body, d_timeouts.body);
+        readingBody = true;
+      }
+    } else if (buffered == buffer.capacity()) {
+      if (buffered >= kMaxHeaderBytes) return ReadStatus::TooLarge;
+      required = buffered + 1;
+    }
+
+    if (required > buffer.capacity()) {
+      PooledBuffer larger = BufferPool::instance().acquire(required);
+      std::memcpy(larger.data(), buffer.data(), buffered);
+      buffer = std::move(larger);
+    }
+
+    int bytes = readFunc(buffer.data() + buffered, buffer.capacity() - buffered);
+    if (bytes <= 0) {
+      return bytes == 0 ? ReadStatus::Closed : ReadStatus::Error;
+    }
+    buffered += bytes;
+  }
+}
+
+// The write deadline bounds stalls rather than the whole response, so it is
+// pushed out whenever a partial write makes progress.
+template <typename Writer>
+bool Server::write_all(Writer& writeFunc, const char* data, size_t size,
+                       bool more, size_t& written,
+                       ConnectionDeadline& deadline) {
+  while (size > 0) {
+    auto bytes = writeFunc(data, size, more);
+    if (bytes <= 0) {
+      if (bytes < 0 && errno == EINTR) continue;
+      return false;
+    }
+    data += bytes;
+    size -= bytes;
+    written += bytes;
+    if (size > 0) deadline.extend();
+  }
+  return true;
+}
+
+// Waits for a WebSocket or event stream session: returns early, once, when a
+// drain starts, and is woken by the session's eventfd. The session times its
+// own pings or heartbeats, so the deadline is set past the wait and only a
+// drain expiring every deadline fires it.
+inline std::function<bool(std::chrono::milliseconds, int)>
+Server::session_wait(int client_fd, SSL* ssl, ConnectionDeadline& deadline) {
+  return [this, ssl, client_fd, &deadline, drainSeen = false](
+             std::chrono::milliseconds timeout, int wakeFd) mutable {
+    if (ssl && SSL_pending(ssl) > 0) return true;
+    pollfd pfds[3] = {{client_fd, POLLIN, 0},
+                      {drainSeen ? -1 : d_drainFd, POLLIN, 0},
+                      {wakeFd, POLLIN, 0}};
+    if (timeout.count() > 0)
+      deadline.arm(TimeoutKind::Idle, timeout + d_timeouts.idle);
+    const int ready = poll(pfds, 3, static_cast<int>(timeout.count()));
+    if (timeout.count() > 0) deadline.disarm();
+    if (ready > 0 && pfds[1].revents) drainSeen = true;
+    return ready > 0 && pfds[0].revents != 0;
+  };
+}
+
+// The subscriber writes events with a write deadline and waits for them
+// like a WebSocket session, the heartbeat standing in for its pings.
+template <typename Reader, typename Writer>
+void Server::run_event_stream(const EventStreamRoute& route,
+                              const HttpRequest& request, Reader& readFunc,
+                              Writer& writeFunc, int client_fd, SSL* ssl,
+                              ConnectionDeadline& deadline) {
+  EventStreamHub* hub = route.select(request);
+  if (!hub) return;
+  EventStreamTransport transport{
+      [&readFunc](char* buf, size_t size) -> ssize_t {
+        return readFunc(buf, size);
+      },
+      [this, &writeFunc, &deadline](const char* data, size_t size) -> ssize_t {
+        deadline.arm(TimeoutKind::Write, d_timeouts.writeStall);
+        const auto bytes = writeFunc(data, size, false);
+        deadline.disarm();
+        return bytes;
+      },
+      session_wait(client_fd, ssl, deadline)};
+
+  EventStreamOptions options = route.options;
+  options.draining = [this]() {
+    return d_draining.load(std::memory_order_relaxed);
+  };
+  auto subscriber =
+      std::make_shared<EventStreamSubscriber>(std::move(transport), options);
+  hub->subscribe(subscriber, findHeader(request.headers, "Last-Event-ID"));
+  subscriber->run();
+  hub->unsubscribe(subscriber.get());
+}
+
+// The connection keeps its thread for the life of the WebSocket session,
+// with the same deadlines as an HTTP/2 connection: reads and writes are
+// bounded, and waiting for the next frame counts as idle so a drain that
+// runs out of time can still close it.
+template <typename Reader, typename Writer>
+void Server::run_websocket(const WebSocketRoute& route,
+                           const HttpRequest& upgrade, Reader& readFunc,
+                           Writer& writeFunc, int client_fd, SSL* ssl,
+                           std::string_view pending,
+                           ConnectionDeadline& deadline) {
+  LOG_INFO("Client [" + std::to_string(client_fd) + "] upgraded to WebSocket");
+  WebSocketTransport transport{
+      [this, &readFunc, &deadline](char* buf, size_t size) -> ssize_t {
+        deadline.arm(TimeoutKind::Header, d_timeouts.header);
+        const auto bytes = readFunc(buf, size);
+        deadline.disarm();
+        return bytes;
+      },
+      [this, &writeFunc, &deadline](const char* data, size_t size) -> ssize_t {
+        deadline.arm(TimeoutKind::Write, d_timeouts.writeStall);
+        const auto bytes = writeFunc(data, size, false);
+        deadline.disarm();
+        return bytes;
+      },
+      session_wait(client_fd, ssl, deadline)};
+
+  WebSocketOptions options = route.options;
+  options.draining = [this]() {
+    return d_draining.load(std::memory_order_relaxed);
+  };
+  auto connection = std::make_shared<WebSocketConnection>(
+      std::move(transport), route.handler, options);
+  connection->run(upgrade, pending);
+}
+
 }  // namespace HTTPServer
 
 #endif
\ No newline at end of file
@@ -0,0 +1,48 @@
+#ifndef SOCKET_OPTIONS_H
+#define SOCKET_OPTIONS_H
+
+#include <sys/socket.h>
+
+#include <chrono>
+
+namespace HTTPServer {
+
+// Tuning for the listening sockets and the connections accepted on them.
+// Zero leaves the kernel's default; TCP options are skipped on Unix domain
+// sockets.
+struct SocketOptions {
+    // Sends each write at once instead of holding a small one back until
+    // the previous one is acknowledged (Nagle). Responses written in pieces
+    // are still coalesced, with MSG_MORE.
+    bool noDelay = true;
+    // accept() only returns a connection once its first data has arrived,
+    // or this long after the handshake, so no thread is spawned for clients
+    // that connect and send nothing.
+    std::chrono::seconds deferAccept{0};
+    // TCP Fast Open: clients holding a cookie send their request in the SYN
+    // and save a round trip. Connections not yet accepted that may have done
+    // so; needs the server bit of net.ipv4.tcp_fastopen.
+    int fastOpenQueue = 0;
+    // SO_SNDBUF / SO_RCVBUF in bytes, which also turn off the kernel's
+    // autotuning of that buffer.
+    int sendBuffer = 0;
+    int receiveBuffer = 0;
+    // Connections that completed the handshake and wait to be accepted,
+    // capped by net.core.somaxconn.
+    int backlog = SOMAXCONN;
+    // SO_BUSY_POLL: a read that finds nothing spins on the device queue this
+    // long before sleeping, trading CPU for latency on supporting NICs.
+    // Raising it above net.core.busy_read needs CAP_NET_ADMIN.
+    std::chrono::microseconds busyPoll{0};
+};
+
+// Best called before listen(), so the buffers are in place for the first
+// connections. Failures are logged and leave that option at its default.
+void configureListeningSocket(int fd, const SocketOptions&, bool tcp);
+// For each accepted connection; quiet, as the listener already reported
+// anything the kernel refuses.
+void configureAcceptedSocket(int fd, const SocketOptions&, bool tcp);
+
+} // namespace HTTPServer
+
+#endif
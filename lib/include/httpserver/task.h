@@ -0,0 +1,149 @@
+#ifndef TASK_H
+#define TASK_H
+
+#include <coroutine>
+#include <exception>
+#include <functional>
+#include <optional>
+#include <utility>
+
+namespace HTTPServer {
+
+template <typename T = void>
+class Task;
+
+namespace detail {
+
+struct TaskPromiseBase {
+    std::coroutine_handle<> continuation;
+    std::exception_ptr error;
+
+    // A finished task resumes whoever awaited it straight away, by symmetric
+    // transfer, so chains of awaited tasks never grow the stack.
+    struct FinalAwaiter {
+        bool await_ready() noexcept { return false; }
+        template <typename Promise>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept {
+            std::coroutine_handle<> next = handle.promise().continuation;
+            return next ? next : std::noop_coroutine();
+        }
+        void await_resume() noexcept {}
+    };
+
+    std::suspend_always initial_suspend() noexcept { return {}; }
+    FinalAwaiter final_suspend() noexcept { return {}; }
+    void unhandled_exception() noexcept { error = std::current_exception(); }
+};
+
+template <typename T>
+struct TaskPromise : TaskPromiseBase {
+    std::optional<T> value;
+
+    Task<T> get_return_object() noexcept;
+    template <typename U>
+    void return_value(U&& result) {
+        value.emplace(std::forward<U>(result));
+    }
+    T take() {
+        if (error) std::rethrow_exception(error);
+        return std::move(*value);
+    }
+};
+
+template <>
+struct TaskPromise<void> : TaskPromiseBase {
+    Task<void> get_return_object() noexcept;
+    void return_void() noexcept {}
+    void take() {
+        if (error) std::rethrow_exception(error);
+    }
+};
+
+// Owns nothing: runs on its own from creation and frees its frame when done.
+struct Detached {
+    struct promise_type {
+        Detached get_return_object() noexcept { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() noexcept {}
+        void unhandled_exception() noexcept { std::terminate(); }
+    };
+};
+
+} // namespace detail
+
+// Lazily started coroutine producing a T. Nothing runs until the task is
+// co_awaited, or handed to detach(); it then runs on the awaiting thread
+// until its first suspension, and resumes on whichever thread completes what
+// it waits for (for the awaitables of IoScheduler, the scheduler's thread).
+// Exceptions propagate to the awaiter.
+template <typename T>
+class [[nodiscard]] Task {
+  public:
+    using promise_type = detail::TaskPromise<T>;
+    using Handle = std::coroutine_handle<promise_type>;
+
+    Task() = default;
+    explicit Task(Handle handle) : d_handle(handle) {}
+    Task(Task&& other) noexcept : d_handle(std::exchange(other.d_handle, {})) {}
+    Task& operator=(Task&& other) noexcept {
+        if (this != &other) {
+            if (d_handle) d_handle.destroy();
+            d_handle = std::exchange(other.d_handle, {});
+        }
+        return *this;
+    }
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+    ~Task() {
+        if (d_handle) d_handle.destroy();
+    }
+
+    bool valid() const { return static_cast<bool>(d_handle); }
+
+    bool await_ready() const noexcept { return false; }
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiter) noexcept {
+        d_handle.promise().continuation = awaiter;
+        return d_handle;
+    }
+    T await_resume() { return d_handle.promise().take(); }
+
+  private:
+    Handle d_handle;
+};
+
+namespace detail {
+
+template <typename T>
+Task<T> TaskPromise<T>::get_return_object() noexcept {
+    return Task<T>(std::coroutine_handle<TaskPromise<T>>::from_promise(*this));
+}
+
+inline Task<void> TaskPromise<void>::get_return_object() noexcept {
+    return Task<void>(std::coroutine_handle<TaskPromise<void>>::from_promise(*this));
+}
+
+template <typename T, typename Done>
+Detached runDetached(Task<T> task, Done done) {
+    if constexpr (std::is_void_v<T>) {
+        co_await std::move(task);
+        done();
+    } else {
+        done(co_await std::move(task));
+    }
+}
+
+} // namespace detail
+
+// Starts 'task' with nobody awaiting it. It runs on the calling thread until
+// it first suspends; 'done' is called with its result on whichever thread
+// it finishes, which is the calling thread if it never suspends. An
+// exception escaping the task terminates, as it would on a thread.
+template <typename T, typename Done>
+void detach(Task<T> task, Done done) {
+    detail::runDetached(std::move(task), std::move(done));
+}
+
+} // namespace HTTPServer
+
+#endif
@@ -0,0 +1,234 @@
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string_view>
+#include <thread>
+
+namespace HTTPServer {
+
+// Hierarchical timing wheel (Varghese & Lauck). Timers are intrusive list
+// nodes hashed into 64 slots on each of four levels, so scheduling,
+// rescheduling and cancelling are O(1) regardless of how many timers exist.
+// A timer too far out for the lowest level sits on a coarser one and
+// cascades down as time reaches its slot. With the default 100ms tick the
+// wheel spans 64^4 ticks, about 19 days; later deadlines are clamped to the
+// top level and re-examined each time they cascade.
+//
+// Not thread-safe; see DeadlineReaper for the shared, locked wrapper.
+class TimerWheel {
+  public:
+    using Clock = std::chrono::steady_clock;
+
+    // Derive from Timer to make an object schedulable. A timer must be
+    // cancelled (or have fired) before it is destroyed.
+    class Timer {
+      public:
+        Timer() = default;
+        Timer(const Timer&) = delete;
+        Timer& operator=(const Timer&) = delete;
+
+        bool scheduled() const { return d_wheel != nullptr; }
+
+      private:
+        friend class TimerWheel;
+        TimerWheel* d_wheel = nullptr;
+        Timer* d_prev = nullptr;
+        Timer* d_next = nullptr;
+        Timer** d_slot = nullptr;
+        uint64_t d_expiry = 0;
+        size_t d_level = 0;
+    };
+
+    static constexpr unsigned kSlotBits = 6;
+    static constexpr size_t kSlots = size_t{1} << kSlotBits;
+    static constexpr size_t kLevels = 4;
+
+    explicit TimerWheel(std::chrono::milliseconds resolution = std::chrono::milliseconds(100),
+                        Clock::time_point origin = Clock::now());
+    ~TimerWheel();
+    TimerWheel(const TimerWheel&) = delete;
+    TimerWheel& operator=(const TimerWheel&) = delete;
+
+    // (Re)schedules 'timer' to fire at the first tick at or after 'deadline'.
+    // A deadline in the past fires on the next advance().
+    void schedule(Timer&, Clock::time_point deadline);
+    void cancel(Timer&);
+
+    // Fires, in deadline order by tick, every timer due at or before 'now'.
+    // 'onExpire(Timer&)' runs after the timer has been unlinked, so it may
+    // reschedule or destroy it. Returns the number of timers fired.
+    template <typename OnExpire>
+    size_t advance(Clock::time_point now, OnExpire onExpire);
+    // Fires every timer regardless of its deadline. 'onExpire' must not
+    // schedule timers back onto the wheel.
+    template <typename OnExpire>
+    size_t expireAll(OnExpire onExpire);
+
+    size_t size() const { return d_size; }
+    bool empty() const { return d_size == 0; }
+    std::chrono::milliseconds resolution() const { return d_resolution; }
+
+  private:
+    uint64_t tickFor(Clock::time_point) const;
+    void link(Timer&);
+    void unlink(Timer&);
+    void cascade(size_t level);
+
+    const std::chrono::milliseconds d_resolution;
+    const Clock::time_point d_origin;
+    uint64_t d_now = 0;
+    size_t d_size = 0;
+    std::array<size_t, kLevels> d_levelSizes{};
+    std::array<std::array<Timer*, kSlots>, kLevels> d_slots{};
+};
+
+template <typename OnExpire>
+size_t TimerWheel::advance(Clock::time_point now, OnExpire onExpire) {
+    const uint64_t target = tickFor(now);
+    size_t fired = 0;
+    while (d_now < target) {
+        if (d_size == 0) {
+            // Nothing can cascade into an empty wheel; skip the idle ticks.
+            d_now = target;
+            break;
+        }
+        if (d_levelSizes[0] == 0) {
+            // Nothing can fire before level 0 wraps and the next cascade.
+            d_now = std::min(target, d_now | (kSlots - 1));
+            if (d_now == target) break;
+        }
+        d_now++;
+        // Whenever a level wraps, the next slot of the level above is
+        // redistributed into the levels below it.
+        for (size_t level = 1; level < kLevels; level++) {
+            if ((d_now & ((uint64_t{1} << (kSlotBits * level)) - 1)) != 0) break;
+            cascade(level);
+        }
+        Timer*& slot = d_slots[0][d_now & (kSlots - 1)];
+        while (Timer* timer = slot) {
+            unlink(*timer);
+            fired++;
+            onExpire(*timer);
+        }
+    }
+    return fired;
+}
+
+template <typename OnExpire>
+size_t TimerWheel::expireAll(OnExpire onExpire) {
+    size_t fired = 0;
+    for (auto& level : d_slots) {
+        for (Timer*& slot : level) {
+            while (Timer* timer = slot) {
+                unlink(*timer);
+                fired++;
+                onExpire(*timer);
+            }
+        }
+    }
+    return fired;
+}
+
+// Per-connection deadline kinds, in the order a request goes through them.
+enum class TimeoutKind : uint8_t {
+    Idle,   // keep-alive wait for the first byte of the next request
+    Header, // TLS handshake and the whole request head
+    Body,   // the rest of the request once its head is in
+    Write,  // no progress writing the response
+};
+constexpr size_t kTimeoutKindCount = 4;
+
+std::string_view timeoutKindName(TimeoutKind);
+
+struct ConnectionTimeouts {
+    std::chrono::milliseconds idle{std::chrono::seconds(5)};
+    std::chrono::milliseconds header{std::chrono::seconds(10)};
+    std::chrono::milliseconds body{std::chrono::seconds(30)};
+    std::chrono::milliseconds writeStall{std::chrono::seconds(10)};
+};
+
+// One TimerWheel shared by every connection thread, ticked by a background
+// thread. An expired deadline shuts the socket down, which wakes whatever
+// recv, send, poll or SSL call the connection thread is blocked in; the
+// thread then sees which deadline fired through ConnectionDeadline.
+class DeadlineReaper {
+  public:
+    explicit DeadlineReaper(std::chrono::milliseconds resolution = std::chrono::milliseconds(100));
+    ~DeadlineReaper();
+    DeadlineReaper(const DeadlineReaper&) = delete;
+    DeadlineReaper& operator=(const DeadlineReaper&) = delete;
+
+    void start();
+    void stop();
+
+    size_t pending() const;
+    std::chrono::milliseconds resolution() const { return d_wheel.resolution(); }
+
+    // Fires every armed deadline now, and any deadline armed afterwards as
+    // soon as it is armed, until the next start(). Used to close whatever is
+    // left once a drain runs out of time. Returns the deadlines fired now.
+    size_t expireAll();
+
+  private:
+    friend class ConnectionDeadline;
+
+    void run();
+
+    mutable std::mutex d_mtx;
+    std::condition_variable d_cv;
+    TimerWheel d_wheel;
+    bool d_stopping = false;
+    bool d_expiringAll = false;
+    std::thread d_thread;
+};
+
+// A connection's single active deadline. Arming replaces whatever was armed
+// before, so a connection costs one wheel entry however many phases it goes
+// through. Once a deadline has fired the socket is shut down and further
+// arming is ignored.
+class ConnectionDeadline {
+  public:
+    ConnectionDeadline(DeadlineReaper&, int fd);
+    ~ConnectionDeadline();
+    ConnectionDeadline(const ConnectionDeadline&) = delete;
+    ConnectionDeadline& operator=(const ConnectionDeadline&) = delete;
+
+    void arm(TimeoutKind, std::chrono::milliseconds timeout);
+    // Pushes the armed deadline out by its full timeout again, for progress
+    // based deadlines such as a write stall.
+    void extend();
+    void disarm();
+
+    bool expired() const { return d_expired.load(std::memory_order_acquire); }
+    // Only meaningful once expired().
+    TimeoutKind expiredKind() const { return d_entry.kind; }
+
+  private:
+    friend class DeadlineReaper;
+
+    struct Entry : TimerWheel::Timer {
+        ConnectionDeadline* owner = nullptr;
+        TimeoutKind kind = TimeoutKind::Idle;
+        std::chrono::milliseconds timeout{0};
+    };
+
+    // 'forced' when closed by expireAll() rather than by its own deadline.
+    void fire(bool forced = false);
+
+    DeadlineReaper& d_reaper;
+    const int d_fd;
+    Entry d_entry;
+    std::atomic<bool> d_expired{false};
+};
+
+} // namespace HTTPServer
+
+#endif
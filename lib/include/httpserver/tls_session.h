@@ -0,0 +1,71 @@
+#ifndef TLS_SESSION_H
+#define TLS_SESSION_H
+
+#include <openssl/ssl.h>
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+
+namespace HTTPServer {
+
+struct TlsSessionOptions {
+    // Server side cache of full sessions, used for session ID resumption and
+    // for TLS 1.3 stateful tickets when stateless tickets are disabled.
+    bool sessionCache = true;
+    size_t sessionCacheSize = 20 * 1024;
+    std::chrono::seconds sessionLifetime{300};
+
+    // Stateless tickets sealed with in-process keys that rotate every
+    // ticketKeyRotation; no server state is kept per session.
+    bool sessionTickets = true;
+    std::chrono::seconds ticketKeyRotation{3600};
+};
+
+// Keys for stateless session tickets. New tickets are sealed with the newest
+// key, which is replaced once it is older than the rotation interval. Retired
+// keys keep decrypting for one session lifetime, and tickets they open are
+// re-issued under the current key.
+class TicketKeyRing {
+  public:
+    TicketKeyRing(std::chrono::seconds rotationInterval, std::chrono::seconds sessionLifetime);
+    TicketKeyRing(const TicketKeyRing&) = delete;
+    TicketKeyRing& operator=(const TicketKeyRing&) = delete;
+
+    // Registers the ticket callback on 'ctx'. The ring must outlive it.
+    bool install(SSL_CTX* ctx);
+    void rotate();
+    size_t keyCount() const;
+
+  private:
+    static constexpr size_t kNameLength = 16;
+    static constexpr size_t kSecretLength = 32;
+
+    struct Key {
+        std::array<unsigned char, kNameLength> name;
+        std::array<unsigned char, kSecretLength> aesKey;
+        std::array<unsigned char, kSecretLength> hmacKey;
+        std::chrono::steady_clock::time_point created;
+    };
+
+    static int ticketCallback(SSL*, unsigned char* keyName, unsigned char* iv, EVP_CIPHER_CTX*, EVP_MAC_CTX*,
+                              int encrypt);
+    int seal(unsigned char* keyName, unsigned char* iv, EVP_CIPHER_CTX*, EVP_MAC_CTX*);
+    int open(const unsigned char* keyName, const unsigned char* iv, EVP_CIPHER_CTX*, EVP_MAC_CTX*);
+    void rotateLocked(std::chrono::steady_clock::time_point now);
+
+    const std::chrono::seconds d_rotationInterval;
+    const std::chrono::seconds d_sessionLifetime;
+    mutable std::mutex d_mtx;
+    std::deque<Key> d_keys; // newest first
+};
+
+// Applies the cache and ticket settings to 'ctx'. 'ticketKeys' may be null
+// when tickets are disabled.
+void configureTlsSessions(SSL_CTX* ctx, const TlsSessionOptions&, TicketKeyRing* ticketKeys);
+
+} // namespace HTTPServer
+
+#endif
@@ -0,0 +1,44 @@
+#ifndef UNIX_SOCKET_H
+#define UNIX_SOCKET_H
+
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/un.h>
+
+#include <string>
+#include <string_view>
+
+#include "httpserver/socket_options.h"
+
+namespace HTTPServer {
+
+struct UnixListenerOptions {
+    // Permissions of the socket file, which decide who may connect. Abstract
+    // sockets have no file: anyone in the network namespace may connect.
+    mode_t mode = 0660;
+    // Serve TLS on this socket too when HTTPS is enabled. Off by default, as
+    // the connection never leaves the host.
+    bool tls = false;
+};
+
+// Unix domain socket addresses. A path starting with '@' names a socket in
+// Linux's abstract namespace, which has no file and disappears with the
+// last descriptor; any other path is a socket file.
+namespace UnixSocket {
+
+constexpr char kAbstractPrefix = '@';
+
+// False when 'path' is empty or too long for sockaddr_un.
+bool makeAddress(std::string_view path, sockaddr_un&, socklen_t&);
+// The path a socket is bound to, in the form makeAddress takes; empty when
+// it is not a bound Unix domain socket.
+std::string boundPath(int fd);
+// A listening socket on 'path', or -1. A socket file left behind by a
+// process that has gone is replaced; one something still listens on is not.
+int listen(const std::string& path, mode_t mode, const SocketOptions& = {});
+
+} // namespace UnixSocket
+
+} // namespace HTTPServer
+
+#endif
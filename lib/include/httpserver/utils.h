@@ -3,19 +3,25 @@
 
 #include "http_object.h"
 
-#include <string>
+#include <string_view>
 
 namespace HTTPServer {
 
-std::string statusCodeToString(StatusCode);
+std::string_view statusCodeToString(StatusCode);
 bool requestWantsKeepAlive(const HttpRequest&);
+// Header names are stored as received, so lookups by name that must not
+// depend on the peer's spelling go through these.
+bool equalsIgnoreCase(std::string_view, std::string_view);
+std::string_view findHeader(const HeaderMap&, std::string_view name);
+// True if the comma separated header value lists 'token', in any case.
+bool hasToken(std::string_view value, std::string_view token);
 
 namespace Mime {
 
-std::string fromExtension(const std::string&);
+std::string_view fromExtension(std::string_view);
 
 } // namespace Mime
 
 } // namespace HTTPServer
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,218 @@
+#ifndef WEBSOCKET_H
+#define WEBSOCKET_H
+
+#include <sys/types.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "httpserver/http_object.h"
+
+namespace HTTPServer {
+
+// WebSocket wire format (RFC 6455).
+namespace WebSocket {
+
+constexpr std::string_view kAcceptGuid = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+constexpr size_t kMaxFrameHeaderSize = 14;
+constexpr size_t kMaxControlPayload = 125;
+
+enum class Opcode : uint8_t {
+    Continuation = 0x0,
+    Text = 0x1,
+    Binary = 0x2,
+    Close = 0x8,
+    Ping = 0x9,
+    Pong = 0xa,
+};
+
+enum class CloseCode : uint16_t {
+    Normal = 1000,
+    GoingAway = 1001,
+    ProtocolError = 1002,
+    UnsupportedData = 1003,
+    NoStatus = 1005, // never sent: the peer's Close frame carried no code
+    Abnormal = 1006, // never sent: the connection ended without a Close frame
+    InvalidPayload = 1007,
+    PolicyViolation = 1008,
+    MessageTooBig = 1009,
+    InternalError = 1011,
+};
+
+struct FrameHeader {
+    bool fin = false;
+    uint8_t reserved = 0; // RSV1-3, no extension is negotiated so always 0
+    Opcode opcode = Opcode::Continuation;
+    bool masked = false;
+    uint32_t maskKey = 0; // in wire byte order
+    uint64_t length = 0;
+    size_t size = 0; // bytes the header itself takes
+};
+
+// Parses the frame header at the front of 'in'; false while it is incomplete.
+bool readFrameHeader(std::string_view in, FrameHeader&);
+// Appends a frame as the server sends it, unmasked.
+void writeFrame(std::string& out, Opcode, std::string_view payload, bool fin = true);
+// XORs 'data' with the repeating four byte 'key' (in wire byte order), a
+// vector register at a time where SSE2 or NEON is available and eight bytes
+// at a time otherwise.
+void unmask(char* data, size_t size, uint32_t key);
+bool isValidUtf8(std::string_view);
+// Sec-WebSocket-Accept for the client's Sec-WebSocket-Key.
+std::string acceptKey(std::string_view clientKey);
+// Answers an upgrade request: 101 with the accept key if it is a valid
+// version 13 handshake over HTTP/1.1, 400 otherwise.
+HttpResponse handshake(const HttpRequest&);
+
+} // namespace WebSocket
+
+struct WebSocketOptions {
+    // Largest message accepted, reassembled across its fragments; a bigger
+    // one closes the connection with 1009.
+    size_t maxMessageSize = 1 << 20;
+    // A ping is sent once the peer has been silent this long, and the
+    // connection dropped when it stays silent as long again. Zero disables.
+    std::chrono::milliseconds pingInterval{30000};
+    // Outgoing bytes a connection may have queued. A peer reading slower
+    // than messages are sent to it has its queue dropped and is closed with
+    // 1008 rather than holding ever more memory.
+    size_t maxQueuedBytes = 4 << 20;
+    // Polled between reads; once it returns true the connection is closed
+    // with 1001.
+    std::function<bool()> draining;
+};
+
+class WebSocketConnection;
+using WebSocketPtr = std::shared_ptr<WebSocketConnection>;
+
+// Callbacks of a WebSocket route, all run on the connection's thread. Any
+// may be empty.
+struct WebSocketHandler {
+    std::function<void(const WebSocketPtr&, const HttpRequest& upgrade)> onOpen;
+    // 'message' is only valid for the duration of the call.
+    std::function<void(const WebSocketPtr&, std::string_view message, bool binary)> onMessage;
+    std::function<void(const WebSocketPtr&, WebSocket::CloseCode)> onClose;
+};
+
+struct WebSocketRoute {
+    WebSocketHandler handler;
+    WebSocketOptions options;
+};
+
+// Byte stream the connection runs over, with the conventions of
+// Http2Transport.
+struct WebSocketTransport {
+    std::function<ssize_t(char*, size_t)> read;
+    std::function<ssize_t(const char*, size_t)> write;
+    std::function<bool(std::chrono::milliseconds, int wakeFd)> waitReadable;
+};
+
+// Server side of one WebSocket connection after the 101, run on the thread
+// that served the upgrade request.
+//
+// Only that thread touches the transport: messages sent from anywhere else
+// are queued as encoded frames and the thread woken to write them, which
+// keeps TLS connections (whose SSL object may not be used from two threads
+// at once) safe. Frames are queued by shared pointer, so a broadcast
+// encodes its frame once however many connections it goes to. Fragmented
+// messages are reassembled, pings answered and text checked to be UTF-8
+// before the handler sees them.
+class WebSocketConnection : public std::enable_shared_from_this<WebSocketConnection> {
+  public:
+    WebSocketConnection(WebSocketTransport, WebSocketHandler, const WebSocketOptions& = {});
+    ~WebSocketConnection();
+    WebSocketConnection(const WebSocketConnection&) = delete;
+    WebSocketConnection& operator=(const WebSocketConnection&) = delete;
+
+    // Serves the connection until it closes. 'pending' holds any bytes read
+    // past the upgrade request. Must be owned by a shared_ptr.
+    void run(const HttpRequest& upgrade, std::string_view pending = {});
+
+    // Thread-safe. Return false, sending nothing, once the connection is
+    // closing or its queue is over maxQueuedBytes.
+    bool send(std::string_view text);
+    bool sendBinary(std::string_view data);
+    // Queues a frame encoded with WebSocket::writeFrame.
+    bool sendFrame(std::shared_ptr<const std::string> frame);
+    // Thread-safe. Sends what is already queued, then a Close frame.
+    void close(WebSocket::CloseCode = WebSocket::CloseCode::Normal, std::string_view reason = {});
+
+    bool isOpen() const { return d_state.load(std::memory_order_relaxed) == State::Open; }
+    size_t queuedBytes() const;
+
+  private:
+    enum class State { Open, Closing, Closed };
+    using Clock = std::chrono::steady_clock;
+
+    static constexpr size_t kReadSize = 16 * 1024;
+    static constexpr std::chrono::milliseconds kCloseTimeout{1000};
+
+    void processInput();
+    void processFrame(const WebSocket::FrameHeader&, std::string_view payload);
+    void deliver(std::string_view message, bool binary);
+    bool flush();
+    bool writeAll(std::string_view data);
+    void sendClose(WebSocket::CloseCode, std::string_view reason);
+    void fail(WebSocket::CloseCode);
+    void wake();
+    std::chrono::milliseconds nextTimeout(Clock::time_point now) const;
+
+    WebSocketTransport d_transport;
+    WebSocketHandler d_handler;
+    const WebSocketOptions d_options;
+    int d_wakeFd = -1;
+    std::atomic<State> d_state{State::Open};
+    WebSocket::CloseCode d_closeCode = WebSocket::CloseCode::Abnormal;
+
+    // Connection thread only.
+    std::string d_input;
+    std::string d_message; // fragments of the message being reassembled
+    bool d_inMessage = false;
+    bool d_messageBinary = false;
+    std::string d_control; // pongs and the close frame, written first
+    Clock::time_point d_lastHeard;
+    Clock::time_point d_closeSent;
+    bool d_pingSent = false;
+
+    mutable std::mutex d_mtx;
+    std::deque<std::shared_ptr<const std::string>> d_outbox;
+    size_t d_queuedBytes = 0;
+    bool d_woken = false;
+    bool d_closeRequested = false;
+    WebSocket::CloseCode d_requestedCode = WebSocket::CloseCode::Normal;
+    std::string d_requestedReason;
+};
+
+// A set of connections that messages are broadcast to, such as the
+// subscribers of one channel. Connections are usually added in onOpen and
+// removed in onClose; closed ones are also dropped by the next broadcast.
+class WebSocketHub {
+  public:
+    void add(WebSocketPtr);
+    void remove(const WebSocketConnection*);
+    size_t size() const;
+
+    // Encodes the message once and queues it on every open connection.
+    // Returns how many connections accepted it.
+    size_t broadcast(std::string_view text);
+    size_t broadcastBinary(std::string_view data);
+
+  private:
+    size_t broadcastFrame(const std::shared_ptr<const std::string>& frame);
+
+    mutable std::mutex d_mtx;
+    std::vector<WebSocketPtr> d_connections;
+};
+
+} // namespace HTTPServer
+
+#endif
@@ -0,0 +1,187 @@
+#include "httpserver/access_log.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <string>
+
+#include "httpserver/logger.h"
+
+namespace HTTPServer {
+
+namespace {
+
+size_t fileSizeFor(size_t capacity) { return sizeof(AccessLogFileHeader) + capacity * sizeof(AccessLogRecord); }
+
+bool headerMatches(const AccessLogFileHeader& header, size_t capacity) {
+    return std::memcmp(header.magic, AccessLogFileHeader::kMagic, sizeof(header.magic)) == 0 &&
+           header.version == AccessLogFileHeader::kVersion && header.recordSize == sizeof(AccessLogRecord) &&
+           (capacity == 0 || header.capacity == capacity);
+}
+
+uint64_t nowNs() {
+    auto now = std::chrono::system_clock::now().time_since_epoch();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(now).count();
+}
+
+} // namespace
+
+AccessLog::~AccessLog() { close(); }
+
+bool AccessLog::open(const std::string& path, size_t capacity) {
+    close();
+    if (capacity == 0) {
+        LOG_ERROR("Access log: capacity must be greater than zero");
+        return false;
+    }
+
+    int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        LOG_ERROR_ERRNO("Access log: Failed to open " + path);
+        return false;
+    }
+
+    const size_t size = fileSizeFor(capacity);
+    bool reuse = false;
+
+    struct stat st{};
+    if (fstat(fd, &st) == 0 && static_cast<size_t>(st.st_size) == size) {
+        AccessLogFileHeader existing{};
+        if (pread(fd, &existing, sizeof(existing), 0) == sizeof(existing)) {
+            reuse = headerMatches(existing, capacity);
+        }
+    }
+
+    // A file with a different layout is truncated first so every slot
+    // starts zeroed (and therefore uncommitted).
+    if (!reuse && (ftruncate(fd, 0) < 0 || ftruncate(fd, static_cast<off_t>(size)) < 0)) {
+        LOG_ERROR_ERRNO("Access log: Failed to size " + path);
+        ::close(fd);
+        return false;
+    }
+
+    void* mapping = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED) {
+        LOG_ERROR_ERRNO("Access log: Failed to map " + path);
+        return false;
+    }
+
+    d_header = static_cast<AccessLogFileHeader*>(mapping);
+    d_records = reinterpret_cast<AccessLogRecord*>(static_cast<char*>(mapping) + sizeof(AccessLogFileHeader));
+    d_capacity = capacity;
+    d_mappedSize = size;
+
+    if (!reuse) {
+        std::memcpy(d_header->magic, AccessLogFileHeader::kMagic, sizeof(d_header->magic));
+        d_header->version = AccessLogFileHeader::kVersion;
+        d_header->recordSize = sizeof(AccessLogRecord);
+        d_header->capacity = capacity;
+        d_header->head = 0;
+    }
+
+    return true;
+}
+
+void AccessLog::close() {
+    if (!d_header) return;
+
+    msync(d_header, d_mappedSize, MS_ASYNC);
+    munmap(d_header, d_mappedSize);
+    d_header = nullptr;
+    d_records = nullptr;
+    d_capacity = 0;
+    d_mappedSize = 0;
+}
+
+bool AccessLog::isOpen() const { return d_header != nullptr; }
+
+size_t AccessLog::capacity() const { return d_capacity; }
+
+void AccessLog::append(const AccessLogEntry& entry) {
+    if (!d_header) return;
+
+    const uint64_t sequence = std::atomic_ref<uint64_t>(d_header->head).fetch_add(1, std::memory_order_relaxed);
+    AccessLogRecord& record = d_records[sequence % d_capacity];
+
+    // Mark the slot as in-progress before overwriting it so a concurrent
+    // reader never accepts a half written record.
+    std::atomic_ref<uint64_t> marker(record.sequence);
+    marker.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    record.timestampNs = nowNs();
+    record.bytesSent = entry.bytesSent;
+    record.latencyUs = entry.latencyUs;
+    record.status = static_cast<uint16_t>(entry.status);
+    record.clientPort = entry.client.port;
+    std::memcpy(record.clientAddr, entry.client.bytes.data(), sizeof(record.clientAddr));
+    record.flags = entry.tls ? AccessLogRecord::kFlagTLS : 0;
+    if (entry.client.unixSocket) record.flags |= AccessLogRecord::kFlagUnixSocket;
+
+    if (entry.phasesNs) {
+        for (size_t i = 0; i < kPhaseCount; i++) {
+            record.phaseUs[i] = static_cast<uint32_t>((*entry.phasesNs)[i] / 1000);
+        }
+        record.flags |= AccessLogRecord::kFlagPhases;
+    } else {
+        std::memset(record.phaseUs, 0, sizeof(record.phaseUs));
+    }
+
+    std::memset(record.method, 0, sizeof(record.method));
+    std::memcpy(record.method, entry.method.data(), std::min(entry.method.size(), sizeof(record.method)));
+
+    const size_t pathLength = std::min(entry.path.size(), sizeof(record.path));
+    std::memcpy(record.path, entry.path.data(), pathLength);
+    record.pathLength = static_cast<uint8_t>(pathLength);
+
+    marker.store(sequence + 1, std::memory_order_release);
+}
+
+bool AccessLog::forEachRecord(const std::string& path, const std::function<void(const AccessLogRecord&)>& visitor) {
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return false;
+
+    struct stat st{};
+    AccessLogFileHeader header{};
+    if (fstat(fd, &st) < 0 || pread(fd, &header, sizeof(header), 0) != sizeof(header) || !headerMatches(header, 0) ||
+        static_cast<size_t>(st.st_size) != fileSizeFor(header.capacity) || header.capacity == 0) {
+        ::close(fd);
+        return false;
+    }
+
+    const size_t size = fileSizeFor(header.capacity);
+    void* mapping = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED) return false;
+
+    const auto* mappedHeader = static_cast<const AccessLogFileHeader*>(mapping);
+    const auto* records =
+        reinterpret_cast<const AccessLogRecord*>(static_cast<const char*>(mapping) + sizeof(AccessLogFileHeader));
+
+    const uint64_t head = __atomic_load_n(&mappedHeader->head, __ATOMIC_ACQUIRE);
+    const uint64_t first = head > header.capacity ? head - header.capacity : 0;
+
+    for (uint64_t sequence = first; sequence < head; sequence++) {
+        const AccessLogRecord& slot = records[sequence % header.capacity];
+        if (__atomic_load_n(&slot.sequence, __ATOMIC_ACQUIRE) != sequence + 1) continue;
+
+        AccessLogRecord copy;
+        std::memcpy(&copy, &slot, sizeof(copy));
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (__atomic_load_n(&slot.sequence, __ATOMIC_RELAXED) != sequence + 1) continue;
+
+        visitor(copy);
+    }
+
+    munmap(mapping, size);
+    return true;
+}
+
+} // namespace HTTPServer
@@ -0,0 +1,102 @@
+#include "httpserver/admission.h"
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <thread>
+
+#include "httpserver/metrics.h"
+
+namespace HTTPServer {
+
+namespace {
+
+constexpr std::string_view kRejectionBody = "503 Service Unavailable";
+constexpr auto kCapacityPollInterval = std::chrono::milliseconds(1);
+
+std::string rejectionResponse(std::chrono::seconds retryAfter) {
+    return "HTTP/1.1 503 Service Unavailable\r\n"
+           "Content-Type: text/plain\r\n"
+           "Content-Length: " +
+           std::to_string(kRejectionBody.size()) +
+           "\r\n"
+           "Retry-After: " +
+           std::to_string(retryAfter.count()) +
+           "\r\n"
+           "Connection: close\r\n"
+           "\r\n" +
+           std::string(kRejectionBody);
+}
+
+} // namespace
+
+bool ConnectionLimiter::hasCapacity() const {
+    const size_t cap = limit();
+    return cap == 0 || active() < cap;
+}
+
+bool ConnectionLimiter::tryAcquire() {
+    const size_t cap = limit();
+    if (cap == 0) {
+        d_active.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+    size_t current = d_active.load(std::memory_order_relaxed);
+    do {
+        if (current >= cap) return false;
+    } while (!d_active.compare_exchange_weak(current, current + 1, std::memory_order_relaxed));
+    return true;
+}
+
+void ConnectionLimiter::release() { d_active.fetch_sub(1, std::memory_order_relaxed); }
+
+ListenerAdmission::ListenerAdmission(ConnectionLimiter* shared)
+    : d_shared(shared), d_rejection(rejectionResponse(std::chrono::seconds(1))) {}
+
+void ListenerAdmission::configure(size_t limit, OverloadAction action, std::chrono::seconds retryAfter) {
+    d_limiter.setLimit(limit);
+    d_action = action;
+    d_rejection = rejectionResponse(retryAfter);
+}
+
+bool ListenerAdmission::hasCapacity() const {
+    return d_limiter.hasCapacity() && (!d_shared || d_shared->hasCapacity());
+}
+
+bool ListenerAdmission::tryAdmit() {
+    if (!d_limiter.tryAcquire()) return false;
+    if (d_shared && !d_shared->tryAcquire()) {
+        d_limiter.release();
+        return false;
+    }
+    return true;
+}
+
+void ListenerAdmission::release() {
+    d_limiter.release();
+    if (d_shared) d_shared->release();
+}
+
+// Slots are released by connection threads without any notification, so a
+// paused listener polls; while paused the server is saturated anyway and one
+// wakeup per millisecond costs nothing next to the connections it serves.
+bool ListenerAdmission::waitForCapacity(const std::atomic<bool>& running) const {
+    while (!hasCapacity()) {
+        if (!running) return false;
+        std::this_thread::sleep_for(kCapacityPollInterval);
+    }
+    return running;
+}
+
+void ListenerAdmission::reject(int fd, bool sendResponse) const {
+    if (sendResponse) {
+        // The socket buffer of a fresh connection always has room for this.
+        [[maybe_unused]] ssize_t sent =
+            send(fd, d_rejection.data(), d_rejection.size(), MSG_DONTWAIT | MSG_NOSIGNAL);
+        shutdown(fd, SHUT_WR);
+    }
+    close(fd);
+    Metrics::instance().connectionRejected();
+}
+
+} // namespace HTTPServer
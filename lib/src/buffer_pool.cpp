@@ -0,0 +1,164 @@
+#include "httpserver/buffer_pool.h"
+
+#include <bit>
+#include <new>
+#include <utility>
+
+namespace HTTPServer {
+
+namespace {
+
+constexpr std::align_val_t kBufferAlignment{64};
+
+char* allocateBlock(size_t size) { return static_cast<char*>(::operator new(size, kBufferAlignment)); }
+
+void freeBlock(char* block) { ::operator delete(block, kBufferAlignment); }
+
+} // namespace
+
+PooledBuffer::PooledBuffer(PooledBuffer&& other) noexcept
+    : d_data(std::exchange(other.d_data, nullptr)),
+      d_capacity(std::exchange(other.d_capacity, 0)),
+      d_sizeClass(other.d_sizeClass) {}
+
+PooledBuffer& PooledBuffer::operator=(PooledBuffer&& other) noexcept {
+    if (this != &other) {
+        reset();
+        d_data = std::exchange(other.d_data, nullptr);
+        d_capacity = std::exchange(other.d_capacity, 0);
+        d_sizeClass = other.d_sizeClass;
+    }
+    return *this;
+}
+
+void PooledBuffer::reset() {
+    if (!d_data) return;
+    if (d_sizeClass == BufferPool::kUnpooled) {
+        freeBlock(d_data);
+    } else {
+        BufferPool::instance().release(d_data, d_sizeClass);
+    }
+    d_data = nullptr;
+    d_capacity = 0;
+}
+
+struct BufferPool::ThreadCache {
+    std::array<std::array<char*, kThreadCacheDepth>, kSizeClassCount> buffers{};
+    std::array<size_t, kSizeClassCount> counts{};
+
+    ~ThreadCache() { BufferPool::instance().flush(*this); }
+};
+
+BufferPool& BufferPool::instance() {
+    static BufferPool pool;
+    return pool;
+}
+
+size_t BufferPool::sizeClassFor(size_t size) {
+    if (size <= kMinBufferSize) return 0;
+    const unsigned bits = std::bit_width((size - 1) / kMinBufferSize);
+    return (bits + 1) / 2;
+}
+
+BufferPool::ThreadCache& BufferPool::threadCache() {
+    thread_local ThreadCache cache;
+    return cache;
+}
+
+PooledBuffer BufferPool::acquire(size_t minSize) {
+    const size_t sizeClass = sizeClassFor(minSize);
+    if (sizeClass >= kSizeClassCount) {
+        return PooledBuffer(allocateBlock(minSize), minSize, kUnpooled);
+    }
+
+    const size_t size = classSize(sizeClass);
+    d_inUseBytes.fetch_add(size, std::memory_order_relaxed);
+
+    ThreadCache& cache = threadCache();
+    if (cache.counts[sizeClass] > 0) {
+        char* data = cache.buffers[sizeClass][--cache.counts[sizeClass]];
+        return PooledBuffer(data, size, static_cast<uint8_t>(sizeClass));
+    }
+    return PooledBuffer(refill(sizeClass), size, static_cast<uint8_t>(sizeClass));
+}
+
+// Takes a buffer from the shared list, growing the pool when it is empty.
+char* BufferPool::refill(size_t sizeClass) {
+    SizeClass& shared = d_classes[sizeClass];
+    const size_t size = classSize(sizeClass);
+    {
+        std::lock_guard<std::mutex> lock(shared.mtx);
+        if (!shared.free.empty()) {
+            char* data = shared.free.back();
+            shared.free.pop_back();
+            return data;
+        }
+    }
+
+    if (size >= kSlabSize) {
+        d_reservedBytes.fetch_add(size, std::memory_order_relaxed);
+        return allocateBlock(size);
+    }
+
+    // Slabs are never returned: the pool keeps its high-water mark of small
+    // buffers, which is bounded and avoids fragmenting the heap.
+    char* slab = allocateBlock(kSlabSize);
+    d_reservedBytes.fetch_add(kSlabSize, std::memory_order_relaxed);
+
+    std::lock_guard<std::mutex> lock(shared.mtx);
+    for (size_t offset = size; offset < kSlabSize; offset += size) {
+        shared.free.push_back(slab + offset);
+    }
+    return slab;
+}
+
+void BufferPool::release(char* data, uint8_t sizeClass) {
+    d_inUseBytes.fetch_sub(classSize(sizeClass), std::memory_order_relaxed);
+
+    ThreadCache& cache = threadCache();
+    if (cache.counts[sizeClass] < kThreadCacheDepth) {
+        cache.buffers[sizeClass][cache.counts[sizeClass]++] = data;
+        return;
+    }
+    releaseShared(data, sizeClass);
+}
+
+void BufferPool::releaseShared(char* data, size_t sizeClass) {
+    SizeClass& shared = d_classes[sizeClass];
+    const size_t size = classSize(sizeClass);
+    {
+        std::lock_guard<std::mutex> lock(shared.mtx);
+        if (size < kSlabSize || shared.free.size() < kMaxSharedLargeBuffers) {
+            shared.free.push_back(data);
+            return;
+        }
+    }
+
+    // Large buffers are individually allocated, so surplus ones are freed
+    // instead of pinning memory after a burst of big requests.
+    d_reservedBytes.fetch_sub(size, std::memory_order_relaxed);
+    freeBlock(data);
+}
+
+void BufferPool::trimThreadCache() { flush(threadCache()); }
+
+void BufferPool::flush(ThreadCache& cache) {
+    for (size_t sizeClass = 0; sizeClass < kSizeClassCount; sizeClass++) {
+        while (cache.counts[sizeClass] > 0) {
+            releaseShared(cache.buffers[sizeClass][--cache.counts[sizeClass]], sizeClass);
+        }
+    }
+}
+
+BufferPool::Stats BufferPool::stats() const {
+    Stats stats;
+    stats.reservedBytes = d_reservedBytes.load(std::memory_order_relaxed);
+    stats.inUseBytes = d_inUseBytes.load(std::memory_order_relaxed);
+    for (size_t sizeClass = 0; sizeClass < kSizeClassCount; sizeClass++) {
+        std::lock_guard<std::mutex> lock(d_classes[sizeClass].mtx);
+        stats.freeBuffers[sizeClass] = d_classes[sizeClass].free.size();
+    }
+    return stats;
+}
+
+} // namespace HTTPServer
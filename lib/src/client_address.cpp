@@ -0,0 +1,58 @@
+#include "httpserver/client_address.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+
+#include <cstring>
+#include <string>
+
+namespace HTTPServer {
+
+ClientAddress ClientAddress::fromSockaddr(const sockaddr_storage& storage) {
+    ClientAddress address;
+
+    if (storage.ss_family == AF_INET6) {
+        const auto* in6 = reinterpret_cast<const sockaddr_in6*>(&storage);
+        std::memcpy(address.bytes.data(), &in6->sin6_addr, address.bytes.size());
+        address.port = ntohs(in6->sin6_port);
+    } else if (storage.ss_family == AF_INET) {
+        const auto* in4 = reinterpret_cast<const sockaddr_in*>(&storage);
+        address.bytes[10] = 0xff;
+        address.bytes[11] = 0xff;
+        std::memcpy(address.bytes.data() + 12, &in4->sin_addr, 4);
+        address.port = ntohs(in4->sin_port);
+    } else if (storage.ss_family == AF_UNIX) {
+        address.unixSocket = true;
+    }
+
+    return address;
+}
+
+bool ClientAddress::isIPv4() const {
+    for (size_t i = 0; i < 10; i++) {
+        if (bytes[i] != 0) return false;
+    }
+    return bytes[10] == 0xff && bytes[11] == 0xff;
+}
+
+std::string ClientAddress::ip() const {
+    if (unixSocket) return "unix";
+    char buffer[INET6_ADDRSTRLEN];
+
+    if (isIPv4()) {
+        inet_ntop(AF_INET, bytes.data() + 12, buffer, sizeof(buffer));
+    } else {
+        inet_ntop(AF_INET6, bytes.data(), buffer, sizeof(buffer));
+    }
+    return buffer;
+}
+
+std::string ClientAddress::toString() const {
+    if (unixSocket) return ip();
+    if (isIPv4()) {
+        return ip() + ":" + std::to_string(port);
+    }
+    return "[" + ip() + "]:" + std::to_string(port);
+}
+
+} // namespace HTTPServer
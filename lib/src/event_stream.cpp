@@ -0,0 +1,213 @@
+#include "httpserver/event_stream.h"
+
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+
+#include "httpserver/http_response_builder.h"
+#include "httpserver/logger.h"
+
+namespace HTTPServer {
+
+namespace EventStream {
+
+void writeEvent(std::string& out, std::string_view data, std::string_view event, std::string_view id) {
+    if (!id.empty()) out.append("id: ").append(id).append("\n");
+    if (!event.empty()) out.append("event: ").append(event).append("\n");
+    while (true) {
+        const size_t newline = data.find('\n');
+        std::string_view line = data.substr(0, newline);
+        if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+        out.append("data: ").append(line).append("\n");
+        if (newline == std::string_view::npos) break;
+        data.remove_prefix(newline + 1);
+    }
+    out.append("\n");
+}
+
+HttpResponse accept(const HttpRequest& req) {
+    if (!req.version.starts_with("HTTP/1.")) return Responses::badRequest(req.get_allocator());
+    HttpResponse res(req.get_allocator());
+    res.setStatus(StatusCode::OK)
+        .applyRequestDefaults(req)
+        .addHeader("Content-Type", "text/event-stream")
+        .addHeader("Cache-Control", "no-cache")
+        .addHeader("Connection", "close");
+    return res;
+}
+
+} // namespace EventStream
+
+EventStreamSubscriber::EventStreamSubscriber(EventStreamTransport transport, const EventStreamOptions& options)
+    : d_transport(std::move(transport)), d_options(options), d_wakeFd(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) {
+    if (d_wakeFd < 0) LOG_ERROR_ERRNO("EventStream: Failed to create wake eventfd");
+}
+
+EventStreamSubscriber::~EventStreamSubscriber() {
+    if (d_wakeFd >= 0) ::close(d_wakeFd);
+}
+
+void EventStreamSubscriber::run() {
+    if (d_options.retry.count() > 0) d_writeBuffer = "retry: " + std::to_string(d_options.retry.count()) + "\n\n";
+    d_lastWrite = Clock::now();
+
+    while (true) {
+        if (!flush()) break;
+        if (!isOpen() || (d_options.draining && d_options.draining())) break;
+
+        std::chrono::milliseconds timeout(-1);
+        if (d_options.heartbeatInterval.count() > 0) {
+            const auto now = Clock::now();
+            if (now >= d_lastWrite + d_options.heartbeatInterval) {
+                d_writeBuffer = ":\n\n";
+                continue;
+            }
+            timeout = std::chrono::ceil<std::chrono::milliseconds>(d_lastWrite + d_options.heartbeatInterval - now);
+        }
+
+        const bool readable = d_transport.waitReadable(timeout, d_wakeFd);
+        uint64_t wakes;
+        if (::read(d_wakeFd, &wakes, sizeof(wakes)) > 0) {
+            std::lock_guard<std::mutex> lock(d_mtx);
+            d_woken = false;
+        }
+        // The client has nothing to say on an event stream; anything it does
+        // send is ignored, and the end of its input ends the stream.
+        char ignored[kReadSize];
+        if (readable && d_transport.read(ignored, sizeof(ignored)) <= 0) break;
+    }
+
+    d_open.store(false, std::memory_order_relaxed);
+    std::lock_guard<std::mutex> lock(d_mtx);
+    d_queue.clear();
+    d_queuedBytes = 0;
+}
+
+// Takes the whole backlog at once and sends it in one write, so a
+// subscriber that fell behind catches up in as few system calls as
+// possible.
+bool EventStreamSubscriber::flush() {
+    std::deque<std::shared_ptr<const std::string>> events;
+    {
+        std::lock_guard<std::mutex> lock(d_mtx);
+        events.swap(d_queue);
+        d_queuedBytes = 0;
+    }
+    if (!isOpen() || (events.empty() && d_writeBuffer.empty())) return true;
+
+    bool written;
+    if (events.size() == 1 && d_writeBuffer.empty()) {
+        written = writeAll(*events.front());
+    } else {
+        for (const auto& event : events) d_writeBuffer.append(*event);
+        written = writeAll(d_writeBuffer);
+        d_writeBuffer.clear();
+    }
+    d_lastWrite = Clock::now();
+    return written;
+}
+
+bool EventStreamSubscriber::writeAll(std::string_view data) {
+    while (!data.empty()) {
+        const ssize_t written = d_transport.write(data.data(), data.size());
+        if (written <= 0) {
+            if (written < 0 && errno == EINTR) continue;
+            return false;
+        }
+        data.remove_prefix(static_cast<size_t>(written));
+    }
+    return true;
+}
+
+bool EventStreamSubscriber::push(std::shared_ptr<const std::string> event) {
+    bool accepted = true;
+    {
+        std::lock_guard<std::mutex> lock(d_mtx);
+        if (!isOpen()) return false;
+        if (d_queue.size() >= d_options.maxQueuedEvents ||
+            d_queuedBytes + event->size() > d_options.maxQueuedBytes) {
+            d_queue.clear();
+            d_queuedBytes = 0;
+            d_evicted.store(true, std::memory_order_relaxed);
+            d_open.store(false, std::memory_order_relaxed);
+            accepted = false;
+        } else {
+            d_queuedBytes += event->size();
+            d_queue.push_back(std::move(event));
+        }
+        if (d_woken) return accepted;
+        d_woken = true;
+    }
+    wake();
+    return accepted;
+}
+
+void EventStreamSubscriber::close() {
+    {
+        std::lock_guard<std::mutex> lock(d_mtx);
+        d_open.store(false, std::memory_order_relaxed);
+        if (d_woken) return;
+        d_woken = true;
+    }
+    wake();
+}
+
+size_t EventStreamSubscriber::queuedEvents() const {
+    std::lock_guard<std::mutex> lock(d_mtx);
+    return d_queue.size();
+}
+
+void EventStreamSubscriber::wake() {
+    const uint64_t one = 1;
+    if (::write(d_wakeFd, &one, sizeof(one)) < 0 && errno != EAGAIN)
+        LOG_ERROR_ERRNO("EventStream: Failed to wake subscriber");
+}
+
+size_t EventStreamHub::publish(std::string_view data, std::string_view event, std::string_view id) {
+    auto encoded = std::make_shared<std::string>();
+    EventStream::writeEvent(*encoded, data, event, id);
+    const std::shared_ptr<const std::string> frame = std::move(encoded);
+
+    std::lock_guard<std::mutex> lock(d_mtx);
+    if (!id.empty() && d_historySize > 0) {
+        d_history.emplace_back(std::string(id), frame);
+        if (d_history.size() > d_historySize) d_history.pop_front();
+    }
+
+    size_t queued = 0;
+    std::erase_if(d_subscribers, [&](const EventStreamSubscriberPtr& subscriber) {
+        if (subscriber->push(frame)) {
+            queued++;
+            return false;
+        }
+        if (subscriber->evicted()) d_evicted.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    });
+    return queued;
+}
+
+void EventStreamHub::subscribe(EventStreamSubscriberPtr subscriber, std::string_view lastEventId) {
+    std::lock_guard<std::mutex> lock(d_mtx);
+    if (!lastEventId.empty()) {
+        auto it = std::find_if(d_history.begin(), d_history.end(),
+                               [lastEventId](const auto& entry) { return entry.first == lastEventId; });
+        if (it != d_history.end()) {
+            for (++it; it != d_history.end(); ++it) subscriber->push(it->second);
+        }
+    }
+    d_subscribers.push_back(std::move(subscriber));
+}
+
+void EventStreamHub::unsubscribe(const EventStreamSubscriber* subscriber) {
+    std::lock_guard<std::mutex> lock(d_mtx);
+    std::erase_if(d_subscribers, [subscriber](const EventStreamSubscriberPtr& s) { return s.get() == subscriber; });
+}
+
+size_t EventStreamHub::subscribers() const {
+    std::lock_guard<std::mutex> lock(d_mtx);
+    return d_subscribers.size();
+}
+
+} // namespace HTTPServer
@@ -0,0 +1,57 @@
+#include "httpserver/handler_executor.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace HTTPServer {
+
+HandlerExecutor& HandlerExecutor::instance() {
+    static HandlerExecutor executor;
+    return executor;
+}
+
+HandlerExecutor::~HandlerExecutor() {
+    {
+        std::lock_guard<std::mutex> lock(d_mtx);
+        d_stopping = true;
+    }
+    d_cv.notify_all();
+    for (std::thread& thread : d_threads) thread.join();
+}
+
+void HandlerExecutor::configure(const HandlerExecutorOptions& options) { d_options = options; }
+
+bool HandlerExecutor::submit(std::function<void()> job) {
+    {
+        std::lock_guard<std::mutex> lock(d_mtx);
+        if (d_stopping || d_jobs.size() >= d_options.maxQueued) return false;
+        if (d_threads.empty()) {
+            const size_t threads =
+                d_options.threads ? d_options.threads : std::max(1u, std::thread::hardware_concurrency());
+            for (size_t i = 0; i < threads; i++) d_threads.emplace_back([this]() { run(); });
+        }
+        d_jobs.push_back(std::move(job));
+        d_queued.store(d_jobs.size(), std::memory_order_relaxed);
+    }
+    d_cv.notify_one();
+    return true;
+}
+
+void HandlerExecutor::run() {
+    std::unique_lock<std::mutex> lock(d_mtx);
+    while (true) {
+        d_cv.wait(lock, [this]() { return d_stopping || !d_jobs.empty(); });
+        if (d_stopping) return;
+        std::function<void()> job = std::move(d_jobs.front());
+        d_jobs.pop_front();
+        d_queued.store(d_jobs.size(), std::memory_order_relaxed);
+
+        lock.unlock();
+        d_active.fetch_add(1, std::memory_order_relaxed);
+        job();
+        d_active.fetch_sub(1, std::memory_order_relaxed);
+        lock.lock();
+    }
+}
+
+} // namespace HTTPServer
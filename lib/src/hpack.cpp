@@ -0,0 +1,482 @@
+#include "httpserver/hpack.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+
+namespace HTTPServer {
+
+namespace {
+
+struct StaticEntry {
+    std::string_view name;
+    std::string_view value;
+};
+
+constexpr std::array<StaticEntry, Hpack::kStaticTableSize> kStaticTable = {{
+    {":authority", ""},
+    {":method", "GET"},
+    {":method", "POST"},
+    {":path", "/"},
+    {":path", "/index.html"},
+    {":scheme", "http"},
+    {":scheme", "https"},
+    {":status", "200"},
+    {":status", "204"},
+    {":status", "206"},
+    {":status", "304"},
+    {":status", "400"},
+    {":status", "404"},
+    {":status", "500"},
+    {"accept-charset", ""},
+    {"accept-encoding", "gzip, deflate"},
+    {"accept-language", ""},
+    {"accept-ranges", ""},
+    {"accept", ""},
+    {"access-control-allow-origin", ""},
+    {"age", ""},
+    {"allow", ""},
+    {"authorization", ""},
+    {"cache-control", ""},
+    {"content-disposition", ""},
+    {"content-encoding", ""},
+    {"content-language", ""},
+    {"content-length", ""},
+    {"content-location", ""},
+    {"content-range", ""},
+    {"content-type", ""},
+    {"cookie", ""},
+    {"date", ""},
+    {"etag", ""},
+    {"expect", ""},
+    {"expires", ""},
+    {"from", ""},
+    {"host", ""},
+    {"if-match", ""},
+    {"if-modified-since", ""},
+    {"if-none-match", ""},
+    {"if-range", ""},
+    {"if-unmodified-since", ""},
+    {"last-modified", ""},
+    {"link", ""},
+    {"location", ""},
+    {"max-forwards", ""},
+    {"proxy-authenticate", ""},
+    {"proxy-authorization", ""},
+    {"range", ""},
+    {"referer", ""},
+    {"refresh", ""},
+    {"retry-after", ""},
+    {"server", ""},
+    {"set-cookie", ""},
+    {"strict-transport-security", ""},
+    {"transfer-encoding", ""},
+    {"user-agent", ""},
+    {"vary", ""},
+    {"via", ""},
+    {"www-authenticate", ""},
+}};
+
+struct HuffmanCode {
+    uint32_t bits;
+    uint8_t length;
+};
+
+constexpr uint16_t kEos = 256;
+
+// Indexed by symbol, EOS last.
+constexpr std::array<HuffmanCode, 257> kHuffmanCodes = {{
+    {0x1ff8, 13}, {0x7fffd8, 23}, {0xfffffe2, 28}, {0xfffffe3, 28},
+    {0xfffffe4, 28}, {0xfffffe5, 28}, {0xfffffe6, 28}, {0xfffffe7, 28},
+    {0xfffffe8, 28}, {0xffffea, 24}, {0x3ffffffc, 30}, {0xfffffe9, 28},
+    {0xfffffea, 28}, {0x3ffffffd, 30}, {0xfffffeb, 28}, {0xfffffec, 28},
+    {0xfffffed, 28}, {0xfffffee, 28}, {0xfffffef, 28}, {0xffffff0, 28},
+    {0xffffff1, 28}, {0xffffff2, 28}, {0x3ffffffe, 30}, {0xffffff3, 28},
+    {0xffffff4, 28}, {0xffffff5, 28}, {0xffffff6, 28}, {0xffffff7, 28},
+    {0xffffff8, 28}, {0xffffff9, 28}, {0xffffffa, 28}, {0xffffffb, 28},
+    {0x14, 6}, {0x3f8, 10}, {0x3f9, 10}, {0xffa, 12},
+    {0x1ff9, 13}, {0x15, 6}, {0xf8, 8}, {0x7fa, 11},
+    {0x3fa, 10}, {0x3fb, 10}, {0xf9, 8}, {0x7fb, 11},
+    {0xfa, 8}, {0x16, 6}, {0x17, 6}, {0x18, 6},
+    {0x0, 5}, {0x1, 5}, {0x2, 5}, {0x19, 6},
+    {0x1a, 6}, {0x1b, 6}, {0x1c, 6}, {0x1d, 6},
+    {0x1e, 6}, {0x1f, 6}, {0x5c, 7}, {0xfb, 8},
+    {0x7ffc, 15}, {0x20, 6}, {0xffb, 12}, {0x3fc, 10},
+    {0x1ffa, 13}, {0x21, 6}, {0x5d, 7}, {0x5e, 7},
+    {0x5f, 7}, {0x60, 7}, {0x61, 7}, {0x62, 7},
+    {0x63, 7}, {0x64, 7}, {0x65, 7}, {0x66, 7},
+    {0x67, 7}, {0x68, 7}, {0x69, 7}, {0x6a, 7},
+    {0x6b, 7}, {0x6c, 7}, {0x6d, 7}, {0x6e, 7},
+    {0x6f, 7}, {0x70, 7}, {0x71, 7}, {0x72, 7},
+    {0xfc, 8}, {0x73, 7}, {0xfd, 8}, {0x1ffb, 13},
+    {0x7fff0, 19}, {0x1ffc, 13}, {0x3ffc, 14}, {0x22, 6},
+    {0x7ffd, 15}, {0x3, 5}, {0x23, 6}, {0x4, 5},
+    {0x24, 6}, {0x5, 5}, {0x25, 6}, {0x26, 6},
+    {0x27, 6}, {0x6, 5}, {0x74, 7}, {0x75, 7},
+    {0x28, 6}, {0x29, 6}, {0x2a, 6}, {0x7, 5},
+    {0x2b, 6}, {0x76, 7}, {0x2c, 6}, {0x8, 5},
+    {0x9, 5}, {0x2d, 6}, {0x77, 7}, {0x78, 7},
+    {0x79, 7}, {0x7a, 7}, {0x7b, 7}, {0x7ffe, 15},
+    {0x7fc, 11}, {0x3ffd, 14}, {0x1ffd, 13}, {0xffffffc, 28},
+    {0xfffe6, 20}, {0x3fffd2, 22}, {0xfffe7, 20}, {0xfffe8, 20},
+    {0x3fffd3, 22}, {0x3fffd4, 22}, {0x3fffd5, 22}, {0x7fffd9, 23},
+    {0x3fffd6, 22}, {0x7fffda, 23}, {0x7fffdb, 23}, {0x7fffdc, 23},
+    {0x7fffdd, 23}, {0x7fffde, 23}, {0xffffeb, 24}, {0x7fffdf, 23},
+    {0xffffec, 24}, {0xffffed, 24}, {0x3fffd7, 22}, {0x7fffe0, 23},
+    {0xffffee, 24}, {0x7fffe1, 23}, {0x7fffe2, 23}, {0x7fffe3, 23},
+    {0x7fffe4, 23}, {0x1fffdc, 21}, {0x3fffd8, 22}, {0x7fffe5, 23},
+    {0x3fffd9, 22}, {0x7fffe6, 23}, {0x7fffe7, 23}, {0xffffef, 24},
+    {0x3fffda, 22}, {0x1fffdd, 21}, {0xfffe9, 20}, {0x3fffdb, 22},
+    {0x3fffdc, 22}, {0x7fffe8, 23}, {0x7fffe9, 23}, {0x1fffde, 21},
+    {0x7fffea, 23}, {0x3fffdd, 22}, {0x3fffde, 22}, {0xfffff0, 24},
+    {0x1fffdf, 21}, {0x3fffdf, 22}, {0x7fffeb, 23}, {0x7fffec, 23},
+    {0x1fffe0, 21}, {0x1fffe1, 21}, {0x3fffe0, 22}, {0x1fffe2, 21},
+    {0x7fffed, 23}, {0x3fffe1, 22}, {0x7fffee, 23}, {0x7fffef, 23},
+    {0xfffea, 20}, {0x3fffe2, 22}, {0x3fffe3, 22}, {0x3fffe4, 22},
+    {0x7ffff0, 23}, {0x3fffe5, 22}, {0x3fffe6, 22}, {0x7ffff1, 23},
+    {0x3ffffe0, 26}, {0x3ffffe1, 26}, {0xfffeb, 20}, {0x7fff1, 19},
+    {0x3fffe7, 22}, {0x7ffff2, 23}, {0x3fffe8, 22}, {0x1ffffec, 25},
+    {0x3ffffe2, 26}, {0x3ffffe3, 26}, {0x3ffffe4, 26}, {0x7ffffde, 27},
+    {0x7ffffdf, 27}, {0x3ffffe5, 26}, {0xfffff1, 24}, {0x1ffffed, 25},
+    {0x7fff2, 19}, {0x1fffe3, 21}, {0x3ffffe6, 26}, {0x7ffffe0, 27},
+    {0x7ffffe1, 27}, {0x3ffffe7, 26}, {0x7ffffe2, 27}, {0xfffff2, 24},
+    {0x1fffe4, 21}, {0x1fffe5, 21}, {0x3ffffe8, 26}, {0x3ffffe9, 26},
+    {0xffffffd, 28}, {0x7ffffe3, 27}, {0x7ffffe4, 27}, {0x7ffffe5, 27},
+    {0xfffec, 20}, {0xfffff3, 24}, {0xfffed, 20}, {0x1fffe6, 21},
+    {0x3fffe9, 22}, {0x1fffe7, 21}, {0x1fffe8, 21}, {0x7ffff3, 23},
+    {0x3fffea, 22}, {0x3fffeb, 22}, {0x1ffffee, 25}, {0x1ffffef, 25},
+    {0xfffff4, 24}, {0xfffff5, 24}, {0x3ffffea, 26}, {0x7ffff4, 23},
+    {0x3ffffeb, 26}, {0x7ffffe6, 27}, {0x3ffffec, 26}, {0x3ffffed, 26},
+    {0x7ffffe7, 27}, {0x7ffffe8, 27}, {0x7ffffe9, 27}, {0x7ffffea, 27},
+    {0x7ffffeb, 27}, {0xffffffe, 28}, {0x7ffffec, 27}, {0x7ffffed, 27},
+    {0x7ffffee, 27}, {0x7ffffef, 27}, {0x7fffff0, 27}, {0x3ffffee, 26},
+    {0x3fffffff, 30},
+}};
+
+// Binary trie over kHuffmanCodes, walked one bit at a time when decoding.
+struct HuffmanNode {
+    int16_t child[2] = {-1, -1};
+    int16_t symbol = -1;
+};
+
+const std::vector<HuffmanNode>& huffmanTrie() {
+    static const std::vector<HuffmanNode> trie = [] {
+        std::vector<HuffmanNode> nodes(1);
+        for (size_t symbol = 0; symbol < kHuffmanCodes.size(); symbol++) {
+            const HuffmanCode code = kHuffmanCodes[symbol];
+            size_t node = 0;
+            for (int bit = code.length - 1; bit >= 0; bit--) {
+                const int branch = (code.bits >> bit) & 1;
+                if (nodes[node].child[branch] < 0) {
+                    nodes[node].child[branch] = static_cast<int16_t>(nodes.size());
+                    nodes.emplace_back();
+                }
+                node = static_cast<size_t>(nodes[node].child[branch]);
+            }
+            nodes[node].symbol = static_cast<int16_t>(symbol);
+        }
+        return nodes;
+    }();
+    return trie;
+}
+
+// Integer with an N-bit prefix, RFC 7541 section 5.1. 'flags' holds the bits
+// of the first byte above the prefix.
+void writeInteger(std::string& out, uint8_t flags, unsigned prefixBits, size_t value) {
+    const size_t max = (size_t{1} << prefixBits) - 1;
+    if (value < max) {
+        out.push_back(static_cast<char>(flags | value));
+        return;
+    }
+    out.push_back(static_cast<char>(flags | max));
+    value -= max;
+    while (value >= 0x80) {
+        out.push_back(static_cast<char>((value & 0x7f) | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<char>(value));
+}
+
+bool readInteger(std::string_view& in, unsigned prefixBits, size_t& value) {
+    if (in.empty()) return false;
+    const size_t max = (size_t{1} << prefixBits) - 1;
+    value = static_cast<uint8_t>(in[0]) & max;
+    in.remove_prefix(1);
+    if (value < max) return true;
+
+    // Anything needing more than four continuation bytes is far beyond any
+    // length or index a peer can legitimately send.
+    for (unsigned shift = 0; shift <= 28; shift += 7) {
+        if (in.empty()) return false;
+        const uint8_t byte = static_cast<uint8_t>(in[0]);
+        in.remove_prefix(1);
+        value += static_cast<size_t>(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) return true;
+    }
+    return false;
+}
+
+} // namespace
+
+namespace Hpack {
+
+size_t huffmanEncodedSize(std::string_view s) {
+    size_t bits = 0;
+    for (char c : s) {
+        bits += kHuffmanCodes[static_cast<uint8_t>(c)].length;
+    }
+    return (bits + 7) / 8;
+}
+
+void huffmanEncode(std::string_view s, std::string& out) {
+    uint64_t pending = 0;
+    unsigned count = 0;
+    for (char c : s) {
+        const HuffmanCode code = kHuffmanCodes[static_cast<uint8_t>(c)];
+        pending = (pending << code.length) | code.bits;
+        count += code.length;
+        while (count >= 8) {
+            count -= 8;
+            out.push_back(static_cast<char>(pending >> count));
+        }
+        pending &= (uint64_t{1} << count) - 1;
+    }
+    // Pad with the most significant bits of EOS, which are all ones.
+    if (count > 0) {
+        out.push_back(static_cast<char>((pending << (8 - count)) | (0xff >> count)));
+    }
+}
+
+bool huffmanDecode(std::string_view s, std::string& out) {
+    const std::vector<HuffmanNode>& trie = huffmanTrie();
+    size_t node = 0;
+    unsigned depth = 0;
+    bool allOnes = true;
+    for (char c : s) {
+        const uint8_t byte = static_cast<uint8_t>(c);
+        for (int bit = 7; bit >= 0; bit--) {
+            const int branch = (byte >> bit) & 1;
+            const int16_t next = trie[node].child[branch];
+            if (next < 0) return false;
+            node = static_cast<size_t>(next);
+            depth++;
+            allOnes = allOnes && branch;
+
+            const int16_t symbol = trie[node].symbol;
+            if (symbol >= 0) {
+                if (symbol == kEos) return false;
+                out.push_back(static_cast<char>(symbol));
+                node = 0;
+                depth = 0;
+                allOnes = true;
+            }
+        }
+    }
+    // Up to seven bits of EOS prefix may pad the final byte.
+    return depth <= 7 && allOnes;
+}
+
+} // namespace Hpack
+
+HpackTable::HpackTable(size_t maxSize) : d_maxSize(maxSize) {}
+
+void HpackTable::setMaxSize(size_t maxSize) {
+    d_maxSize = maxSize;
+    evict(maxSize);
+}
+
+void HpackTable::insert(std::string_view name, std::string_view value) {
+    const size_t entrySize = name.size() + value.size() + Hpack::kEntryOverhead;
+    if (entrySize > d_maxSize) {
+        // An entry larger than the whole table empties it, section 4.4.
+        evict(0);
+        return;
+    }
+    // Build the entry before evicting, the strings may view an old entry.
+    HeaderField field{std::string(name), std::string(value)};
+    evict(d_maxSize - entrySize);
+    d_entries.push_front(std::move(field));
+    d_size += entrySize;
+}
+
+void HpackTable::evict(size_t limit) {
+    while (d_size > limit && !d_entries.empty()) {
+        const HeaderField& oldest = d_entries.back();
+        d_size -= oldest.name.size() + oldest.value.size() + Hpack::kEntryOverhead;
+        d_entries.pop_back();
+    }
+}
+
+bool HpackTable::lookup(size_t index, std::string_view& name, std::string_view& value) const {
+    if (index == 0) return false;
+    if (index <= kStaticTable.size()) {
+        name = kStaticTable[index - 1].name;
+        value = kStaticTable[index - 1].value;
+        return true;
+    }
+    index -= kStaticTable.size() + 1;
+    if (index >= d_entries.size()) return false;
+    name = d_entries[index].name;
+    value = d_entries[index].value;
+    return true;
+}
+
+size_t HpackTable::find(std::string_view name, std::string_view value, bool& valueMatched) const {
+    size_t nameIndex = 0;
+    valueMatched = false;
+    for (size_t i = 0; i < kStaticTable.size(); i++) {
+        if (kStaticTable[i].name != name) continue;
+        if (kStaticTable[i].value == value) {
+            valueMatched = true;
+            return i + 1;
+        }
+        if (!nameIndex) nameIndex = i + 1;
+    }
+    for (size_t i = 0; i < d_entries.size(); i++) {
+        if (d_entries[i].name != name) continue;
+        if (d_entries[i].value == value) {
+            valueMatched = true;
+            return kStaticTable.size() + i + 1;
+        }
+        if (!nameIndex) nameIndex = kStaticTable.size() + i + 1;
+    }
+    return nameIndex;
+}
+
+HpackDecoder::HpackDecoder(size_t maxTableSize)
+    : d_table(std::min(maxTableSize, Hpack::kDefaultTableSize)), d_maxTableSize(maxTableSize) {}
+
+bool HpackDecoder::readString(std::string_view& in, std::string& scratch, std::string_view& out) {
+    if (in.empty()) return false;
+    const bool huffman = static_cast<uint8_t>(in[0]) & 0x80;
+    size_t length = 0;
+    if (!readInteger(in, 7, length) || length > in.size()) return false;
+
+    std::string_view raw = in.substr(0, length);
+    in.remove_prefix(length);
+    if (!huffman) {
+        out = raw;
+        return true;
+    }
+    scratch.clear();
+    if (!Hpack::huffmanDecode(raw, scratch)) return false;
+    out = scratch;
+    return true;
+}
+
+bool HpackDecoder::decode(std::string_view in, const FieldHandler& onField) {
+    bool fieldSeen = false;
+    while (!in.empty()) {
+        const uint8_t first = static_cast<uint8_t>(in[0]);
+        std::string_view name;
+        std::string_view value;
+        size_t index = 0;
+
+        if (first & 0x80) {
+            // Indexed header field, section 6.1.
+            if (!readInteger(in, 7, index) || !d_table.lookup(index, name, value)) return false;
+            onField(name, value);
+            fieldSeen = true;
+            continue;
+        }
+
+        if ((first & 0xe0) == 0x20) {
+            // Dynamic table size update, only allowed ahead of the first field.
+            size_t size = 0;
+            if (fieldSeen || !readInteger(in, 5, size) || size > d_maxTableSize) return false;
+            d_table.setMaxSize(size);
+            continue;
+        }
+
+        // Literal header field: with incremental indexing (6-bit index),
+        // without indexing or never indexed (4-bit index).
+        const bool indexed = (first & 0xc0) == 0x40;
+        if (!readInteger(in, indexed ? 6 : 4, index)) return false;
+        if (index) {
+            std::string_view indexedValue;
+            if (!d_table.lookup(index, name, indexedValue)) return false;
+            // The entry may be evicted by the insert below.
+            d_name.assign(name);
+            name = d_name;
+        } else if (!readString(in, d_name, name)) {
+            return false;
+        }
+        if (!readString(in, d_value, value)) return false;
+
+        if (indexed) {
+            d_table.insert(name, value);
+        }
+        onField(name, value);
+        fieldSeen = true;
+    }
+    return true;
+}
+
+HpackEncoder::HpackEncoder(size_t maxTableSize)
+    : d_table(std::min(maxTableSize, Hpack::kDefaultTableSize)),
+      d_limit(maxTableSize),
+      d_smallestUpdate(d_table.maxSize()),
+      d_updatePending(maxTableSize < Hpack::kDefaultTableSize) {}
+
+void HpackEncoder::setMaxTableSize(size_t size) {
+    size = std::min(size, d_limit);
+    d_smallestUpdate = d_updatePending ? std::min(d_smallestUpdate, size) : size;
+    d_updatePending = true;
+    // Shrinking takes effect once the update has been sent; nothing is
+    // encoded against the table before then.
+    d_table.setMaxSize(std::min(d_smallestUpdate, size));
+    d_table.setMaxSize(size);
+}
+
+void HpackEncoder::beginBlock(std::string& out) {
+    if (!d_updatePending) return;
+    if (d_smallestUpdate < d_table.maxSize()) {
+        writeInteger(out, 0x20, 5, d_smallestUpdate);
+    }
+    writeInteger(out, 0x20, 5, d_table.maxSize());
+    d_smallestUpdate = d_table.maxSize();
+    d_updatePending = false;
+}
+
+void HpackEncoder::writeString(std::string_view s, std::string& out) {
+    const size_t huffmanSize = Hpack::huffmanEncodedSize(s);
+    if (huffmanSize < s.size()) {
+        writeInteger(out, 0x80, 7, huffmanSize);
+        Hpack::huffmanEncode(s, out);
+    } else {
+        writeInteger(out, 0x00, 7, s.size());
+        out.append(s);
+    }
+}
+
+void HpackEncoder::encode(std::string_view name, std::string_view value, std::string& out, Indexing indexing) {
+    bool valueMatched = false;
+    const size_t index = d_table.find(name, value, valueMatched);
+    if (index && valueMatched) {
+        writeInteger(out, 0x80, 7, index);
+        return;
+    }
+
+    switch (indexing) {
+    case Indexing::Incremental:
+        writeInteger(out, 0x40, 6, index);
+        break;
+    case Indexing::None:
+        writeInteger(out, 0x00, 4, index);
+        break;
+    case Indexing::Never:
+        writeInteger(out, 0x10, 4, index);
+        break;
+    }
+    if (!index) writeString(name, out);
+    writeString(value, out);
+
+    if (indexing == Indexing::Incremental) {
+        d_table.insert(name, value);
+    }
+}
+
+} // namespace HTTPServer
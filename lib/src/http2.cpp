@@ -0,0 +1,817 @@
+#include "httpserver/http2.h"
+
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <cstring>
+#include <memory_resource>
+#include <thread>
+#include <utility>
+
+#include "httpserver/http_parser.h"
+
+namespace HTTPServer {
+
+namespace Http2 {
+
+FrameHeader readFrameHeader(const char* in) {
+    const auto* bytes = reinterpret_cast<const unsigned char*>(in);
+    FrameHeader header;
+    header.length = (uint32_t{bytes[0]} << 16) | (uint32_t{bytes[1]} << 8) | bytes[2];
+    header.type = static_cast<FrameType>(bytes[3]);
+    header.flags = bytes[4];
+    header.streamId = readUint32(in + 5) & kMaxWindowSize;
+    return header;
+}
+
+void writeFrameHeader(std::string& out, size_t length, FrameType type, uint8_t flags, uint32_t streamId) {
+    out.push_back(static_cast<char>(length >> 16));
+    out.push_back(static_cast<char>(length >> 8));
+    out.push_back(static_cast<char>(length));
+    out.push_back(static_cast<char>(type));
+    out.push_back(static_cast<char>(flags));
+    writeUint32(out, streamId);
+}
+
+void writeSetting(std::string& out, Setting setting, uint32_t value) {
+    out.push_back(static_cast<char>(static_cast<uint16_t>(setting) >> 8));
+    out.push_back(static_cast<char>(setting));
+    writeUint32(out, value);
+}
+
+uint32_t readUint32(const char* in) {
+    const auto* bytes = reinterpret_cast<const unsigned char*>(in);
+    return (uint32_t{bytes[0]} << 24) | (uint32_t{bytes[1]} << 16) | (uint32_t{bytes[2]} << 8) | bytes[3];
+}
+
+void writeUint32(std::string& out, uint32_t value) {
+    out.push_back(static_cast<char>(value >> 24));
+    out.push_back(static_cast<char>(value >> 16));
+    out.push_back(static_cast<char>(value >> 8));
+    out.push_back(static_cast<char>(value));
+}
+
+} // namespace Http2
+
+namespace {
+
+using Http2::ErrorCode;
+using Http2::FrameType;
+
+constexpr size_t kStreamArenaSize = 16 * 1024;
+// Holds a maximum size frame with room to spare for the ones behind it.
+constexpr size_t kInputBufferSize = 64 * 1024;
+constexpr size_t kFlushThreshold = 64 * 1024;
+
+// Hop-by-hop headers have no meaning in HTTP/2 (RFC 9113 section 8.2.2).
+bool isConnectionSpecific(std::string_view lowerName) {
+    return lowerName == "connection" || lowerName == "keep-alive" || lowerName == "proxy-connection" ||
+           lowerName == "transfer-encoding" || lowerName == "upgrade";
+}
+
+bool hasUpperCase(std::string_view name) {
+    return std::any_of(name.begin(), name.end(), [](char c) { return c >= 'A' && c <= 'Z'; });
+}
+
+void toLower(std::string_view name, std::string& out) {
+    out.assign(name);
+    for (char& c : out) {
+        if (c >= 'A' && c <= 'Z') c = static_cast<char>(c - 'A' + 'a');
+    }
+}
+
+// HTTP/2 field names are lower case. Handlers written against HTTP/1.1 look
+// headers up as "Content-Type", so requests store them in that form.
+void canonicalName(std::string_view lowerName, std::pmr::string& out) {
+    out.assign(lowerName);
+    bool wordStart = true;
+    for (char& c : out) {
+        if (wordStart && c >= 'a' && c <= 'z') c = static_cast<char>(c - 'a' + 'A');
+        wordStart = c == '-';
+    }
+}
+
+// Values that change with nearly every response would only churn the
+// peer's dynamic table; credentials are never indexed by intermediaries.
+HpackEncoder::Indexing indexingFor(std::string_view lowerName) {
+    if (lowerName == "set-cookie" || lowerName == "authorization") return HpackEncoder::Indexing::Never;
+    if (lowerName == "content-length" || lowerName == "date" || lowerName == "etag" ||
+        lowerName == "last-modified" || lowerName == "server-timing" || lowerName == "age") {
+        return HpackEncoder::Indexing::None;
+    }
+    return HpackEncoder::Indexing::Incremental;
+}
+
+bool contentLengthMatches(const HttpRequest& request) {
+    auto it = request.headers.find(std::string_view("Content-Length"));
+    if (it == request.headers.end()) return true;
+    size_t length = 0;
+    const std::string_view value = it->second;
+    auto [end, ec] = std::from_chars(value.data(), value.data() + value.size(), length);
+    return ec == std::errc() && end == value.data() + value.size() && length == request.body.size();
+}
+
+// Copies 'length' bytes of the response payload starting at 'offset': the
+// in-memory body first, then the file body.
+bool appendPayload(const HttpResponse& response, size_t offset, size_t length, std::string& out) {
+    const std::string_view body = response.body;
+    if (offset < body.size()) {
+        const size_t fromBody = std::min(length, body.size() - offset);
+        out.append(body.substr(offset, fromBody));
+        offset += fromBody;
+        length -= fromBody;
+    }
+    if (length == 0) return true;
+    if (!response.file) return false;
+
+    off_t fileOffset = static_cast<off_t>(offset - body.size());
+    size_t end = out.size();
+    out.resize(end + length);
+    while (length > 0) {
+        ssize_t bytes = pread(response.file->fd(), out.data() + end, length, fileOffset);
+        if (bytes < 0 && errno == EINTR) continue;
+        if (bytes <= 0) return false;
+        end += static_cast<size_t>(bytes);
+        fileOffset += bytes;
+        length -= static_cast<size_t>(bytes);
+    }
+    return true;
+}
+
+} // namespace
+
+struct Http2Connection::Stream {
+    Stream(uint32_t streamId, int64_t sendWindowSize, int64_t recvWindowSize)
+        : id(streamId),
+          arenaBuffer(BufferPool::instance().acquire(kStreamArenaSize)),
+          arena(arenaBuffer.data(), arenaBuffer.capacity()),
+          request(&arena),
+          response(&arena),
+          sendWindow(sendWindowSize),
+          recvWindow(recvWindowSize) {}
+
+    const uint32_t id;
+    PooledBuffer arenaBuffer;
+    std::pmr::monotonic_buffer_resource arena;
+    HttpRequest request;
+    HttpResponse response;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    bool remoteClosed = false; // END_STREAM received
+    bool handling = false;     // dispatched, response not in yet
+    bool cancelled = false;    // reset while handling, dropped once answered
+    int64_t sendWindow;
+    int64_t recvWindow;
+    size_t sendOffset = 0;
+    size_t sendTotal = 0;
+    size_t bytesSent = 0;
+};
+
+Http2Connection::Http2Connection(Http2Transport transport, Dispatch dispatch, Completion completion,
+                                 const Http2Options& options)
+    : Http2Connection(
+          std::move(transport),
+          AsyncDispatch([dispatch = std::move(dispatch)](HttpRequest& request, Respond respond) {
+              respond(dispatch(request));
+          }),
+          std::move(completion), options) {}
+
+Http2Connection::Http2Connection(Http2Transport transport, AsyncDispatch dispatch, Completion completion,
+                                 const Http2Options& options)
+    : d_transport(std::move(transport)),
+      d_dispatch(std::move(dispatch)),
+      d_completion(std::move(completion)),
+      d_options(options),
+      d_wakeFd(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) {}
+
+Http2Connection::~Http2Connection() {
+    if (d_wakeFd >= 0) close(d_wakeFd);
+}
+
+void Http2Connection::run() {
+    d_thread = std::this_thread::get_id();
+    // Server preface: our SETTINGS, then the connection window opened up to
+    // the size advertised for streams.
+    Http2::writeFrameHeader(d_out, 18, FrameType::Settings, 0, 0);
+    Http2::writeSetting(d_out, Http2::Setting::MaxConcurrentStreams, d_options.maxConcurrentStreams);
+    Http2::writeSetting(d_out, Http2::Setting::InitialWindowSize, d_options.initialWindowSize);
+    Http2::writeSetting(d_out, Http2::Setting::MaxHeaderListSize, static_cast<uint32_t>(d_options.maxHeaderListSize));
+    if (d_options.initialWindowSize > Http2::kDefaultWindowSize) {
+        Http2::writeFrameHeader(d_out, 4, FrameType::WindowUpdate, 0, 0);
+        Http2::writeUint32(d_out, d_options.initialWindowSize - Http2::kDefaultWindowSize);
+        d_recvWindow = d_options.initialWindowSize;
+    }
+    if (flush()) serve();
+    flush();
+
+    // Handlers still running use their streams' requests.
+    std::unique_lock<std::mutex> lock(d_responsesMtx);
+    d_responded.wait(lock, [this]() { return d_unanswered == 0; });
+    d_responses.clear();
+}
+
+void Http2Connection::serve() {
+    while (!d_closed) {
+        takeResponses();
+        if (!d_goingAway && d_options.draining && d_options.draining()) {
+            sendGoAway(ErrorCode::NoError);
+            d_goingAway = true;
+        }
+        const bool sendable = hasSendableData();
+        if (!sendable) {
+            if ((d_peerGoAway || d_goingAway) && d_streams.empty()) break;
+            if (!flush()) break;
+            if (d_inBuffered == 0) {
+                d_in.reset();
+                BufferPool::instance().trimThreadCache();
+            }
+        }
+
+        // Waiting on handlers is not idle: only a response, input or a drain
+        // ends the wait then.
+        const std::chrono::milliseconds timeout = sendable         ? std::chrono::milliseconds(0)
+                                                  : d_handling > 0 ? std::chrono::milliseconds(-1)
+                                                                   : d_options.idleTimeout;
+        if (d_transport.waitReadable(timeout, d_wakeFd)) {
+            if (!readInput()) break;
+        } else if (!sendable) {
+            // The wait also ends early when a drain starts or a response is in.
+            if (d_handling > 0) continue;
+            if (!d_goingAway && d_options.draining && d_options.draining()) continue;
+            // Idle, or stalled on the peer's flow control, for a whole timeout.
+            if (!d_goingAway) sendGoAway(ErrorCode::NoError);
+            break;
+        }
+
+        sendData();
+        if (d_out.size() >= kFlushThreshold && !flush()) break;
+    }
+}
+
+bool Http2Connection::readInput() {
+    if (!d_in) d_in = BufferPool::instance().acquire(kInputBufferSize);
+
+    ssize_t bytes = d_transport.read(d_in.data() + d_inBuffered, d_in.capacity() - d_inBuffered);
+    if (bytes <= 0) {
+        return bytes < 0 && errno == EINTR;
+    }
+    d_inBuffered += static_cast<size_t>(bytes);
+
+    size_t offset = 0;
+    if (!d_prefaceReceived) {
+        const std::string_view preface = Http2::kClientPreface;
+        const size_t available = std::min(d_inBuffered, preface.size());
+        if (std::string_view(d_in.data(), available) != preface.substr(0, available)) {
+            return connectionError(ErrorCode::ProtocolError);
+        }
+        if (available < preface.size()) return true;
+        offset = preface.size();
+        d_prefaceReceived = true;
+    }
+
+    while (!d_closed && d_inBuffered - offset >= Http2::kFrameHeaderSize) {
+        const Http2::FrameHeader header = Http2::readFrameHeader(d_in.data() + offset);
+        // We never raise SETTINGS_MAX_FRAME_SIZE above the default.
+        if (header.length > Http2::kDefaultMaxFrameSize) return connectionError(ErrorCode::FrameSizeError);
+        if (d_inBuffered - offset < Http2::kFrameHeaderSize + header.length) break;
+
+        const std::string_view payload(d_in.data() + offset + Http2::kFrameHeaderSize, header.length);
+        offset += Http2::kFrameHeaderSize + header.length;
+        if (!processFrame(header, payload)) return false;
+    }
+
+    d_inBuffered -= offset;
+    if (d_inBuffered > 0 && offset > 0) {
+        std::memmove(d_in.data(), d_in.data() + offset, d_inBuffered);
+    }
+    return !d_closed;
+}
+
+bool Http2Connection::processFrame(const Http2::FrameHeader& header, std::string_view payload) {
+    // A header block must arrive uninterrupted, section 6.10.
+    if (d_headerStream != 0 && (header.type != FrameType::Continuation || header.streamId != d_headerStream)) {
+        return connectionError(ErrorCode::ProtocolError);
+    }
+
+    switch (header.type) {
+    case FrameType::Data:
+        return onData(header, payload);
+    case FrameType::Headers:
+        return onHeaders(header, payload);
+    case FrameType::Continuation:
+        return onContinuation(header, payload);
+    case FrameType::Settings:
+        return onSettings(header, payload);
+    case FrameType::WindowUpdate:
+        return onWindowUpdate(header, payload);
+    case FrameType::Priority:
+        // Prioritisation is advisory and ignored, responses are interleaved
+        // round robin.
+        if (header.streamId == 0) return connectionError(ErrorCode::ProtocolError);
+        if (payload.size() != 5) return connectionError(ErrorCode::FrameSizeError);
+        return true;
+    case FrameType::RstStream:
+        if (header.streamId == 0 || header.streamId > d_lastStreamId) {
+            return connectionError(ErrorCode::ProtocolError);
+        }
+        if (payload.size() != 4) return connectionError(ErrorCode::FrameSizeError);
+        closeStream(header.streamId);
+        return true;
+    case FrameType::Ping:
+        if (header.streamId != 0) return connectionError(ErrorCode::ProtocolError);
+        if (payload.size() != 8) return connectionError(ErrorCode::FrameSizeError);
+        if (!(header.flags & Http2::Flags::Ack)) {
+            Http2::writeFrameHeader(d_out, payload.size(), FrameType::Ping, Http2::Flags::Ack, 0);
+            d_out.append(payload);
+        }
+        return true;
+    case FrameType::GoAway:
+        if (header.streamId != 0) return connectionError(ErrorCode::ProtocolError);
+        if (payload.size() < 8) return connectionError(ErrorCode::FrameSizeError);
+        // Streams already open are finished, new ones are ignored.
+        d_peerGoAway = true;
+        return true;
+    case FrameType::PushPromise:
+        return connectionError(ErrorCode::ProtocolError);
+    }
+    // Unknown frame types are ignored, section 5.5.
+    return true;
+}
+
+bool Http2Connection::onData(const Http2::FrameHeader& header, std::string_view payload) {
+    if (header.streamId == 0) return connectionError(ErrorCode::ProtocolError);
+
+    // Padding counts against flow control along with the data.
+    const int64_t flowLength = static_cast<int64_t>(payload.size());
+    if (header.flags & Http2::Flags::Padded) {
+        if (payload.empty()) return connectionError(ErrorCode::FrameSizeError);
+        const size_t padding = static_cast<uint8_t>(payload[0]);
+        payload.remove_prefix(1);
+        if (padding > payload.size()) return connectionError(ErrorCode::ProtocolError);
+        payload.remove_suffix(padding);
+    }
+
+    d_recvWindow -= flowLength;
+    if (d_recvWindow < 0) return connectionError(ErrorCode::FlowControlError);
+    if (d_recvWindow < static_cast<int64_t>(d_options.initialWindowSize / 2)) {
+        Http2::writeFrameHeader(d_out, 4, FrameType::WindowUpdate, 0, 0);
+        Http2::writeUint32(d_out, static_cast<uint32_t>(d_options.initialWindowSize - d_recvWindow));
+        d_recvWindow = d_options.initialWindowSize;
+    }
+
+    auto it = d_streams.find(header.streamId);
+    if (it == d_streams.end() || it->second->remoteClosed) {
+        if (header.streamId > d_lastStreamId) return connectionError(ErrorCode::ProtocolError);
+        resetStream(header.streamId, ErrorCode::StreamClosed);
+        return true;
+    }
+
+    Stream& stream = *it->second;
+    stream.recvWindow -= flowLength;
+    if (stream.recvWindow < 0) {
+        resetStream(stream.id, ErrorCode::FlowControlError);
+        return true;
+    }
+    if (stream.request.body.size() + payload.size() > d_options.maxRequestBodySize) {
+        resetStream(stream.id, ErrorCode::Cancel);
+        return true;
+    }
+    stream.request.body.append(payload);
+
+    if (header.flags & Http2::Flags::EndStream) {
+        stream.remoteClosed = true;
+        dispatch(stream);
+    } else if (stream.recvWindow < static_cast<int64_t>(d_options.initialWindowSize / 2)) {
+        Http2::writeFrameHeader(d_out, 4, FrameType::WindowUpdate, 0, stream.id);
+        Http2::writeUint32(d_out, static_cast<uint32_t>(d_options.initialWindowSize - stream.recvWindow));
+        stream.recvWindow = d_options.initialWindowSize;
+    }
+    return true;
+}
+
+bool Http2Connection::onHeaders(const Http2::FrameHeader& header, std::string_view payload) {
+    if (header.streamId == 0 || header.streamId % 2 == 0) return connectionError(ErrorCode::ProtocolError);
+
+    if (header.flags & Http2::Flags::Padded) {
+        if (payload.empty()) return connectionError(ErrorCode::FrameSizeError);
+        const size_t padding = static_cast<uint8_t>(payload[0]);
+        payload.remove_prefix(1);
+        if (padding > payload.size()) return connectionError(ErrorCode::ProtocolError);
+        payload.remove_suffix(padding);
+    }
+    if (header.flags & Http2::Flags::Priority) {
+        if (payload.size() < 5) return connectionError(ErrorCode::FrameSizeError);
+        payload.remove_prefix(5);
+    }
+
+    d_headerStream = header.streamId;
+    d_headerEndStream = header.flags & Http2::Flags::EndStream;
+    d_headerBlock.assign(payload);
+    if (d_headerBlock.size() > d_options.maxHeaderListSize) return connectionError(ErrorCode::EnhanceYourCalm);
+    return (header.flags & Http2::Flags::EndHeaders) ? finishHeaderBlock() : true;
+}
+
+bool Http2Connection::onContinuation(const Http2::FrameHeader& header, std::string_view payload) {
+    if (d_headerStream == 0) return connectionError(ErrorCode::ProtocolError);
+
+    d_headerBlock.append(payload);
+    if (d_headerBlock.size() > d_options.maxHeaderListSize) return connectionError(ErrorCode::EnhanceYourCalm);
+    return (header.flags & Http2::Flags::EndHeaders) ? finishHeaderBlock() : true;
+}
+
+bool Http2Connection::finishHeaderBlock() {
+    const uint32_t streamId = d_headerStream;
+    d_headerStream = 0;
+
+    Stream* stream = nullptr;
+    bool trailers = false;
+    bool refused = false;
+    auto it = d_streams.find(streamId);
+    if (it != d_streams.end()) {
+        stream = it->second.get();
+        trailers = true;
+    } else if (streamId <= d_lastStreamId) {
+        // Stream ids only ever increase, this one has been closed.
+        return connectionError(ErrorCode::StreamClosed);
+    } else {
+        d_lastStreamId = streamId;
+        if (d_peerGoAway || d_goingAway || d_streams.size() >= d_options.maxConcurrentStreams) {
+            refused = true;
+        } else {
+            auto created = std::make_unique<Stream>(streamId, d_peerInitialWindow, d_options.initialWindowSize);
+            stream = created.get();
+            d_streams.emplace(streamId, std::move(created));
+        }
+    }
+
+    // The block is decoded even when the fields are discarded, the HPACK
+    // state is shared by the whole connection.
+    bool malformed = false;
+    bool regularSeen = false;
+    bool schemeSeen = false;
+    size_t listSize = 0;
+    std::pmr::string target(stream ? &stream->arena : std::pmr::get_default_resource());
+    std::pmr::string authority(target.get_allocator());
+    std::pmr::string name(target.get_allocator());
+
+    const bool decoded = d_decoder.decode(d_headerBlock, [&](std::string_view field, std::string_view value) {
+        listSize += field.size() + value.size() + Hpack::kEntryOverhead;
+        if (listSize > d_options.maxHeaderListSize) malformed = true;
+        if (!stream || trailers || malformed) return;
+
+        HttpRequest& request = stream->request;
+        if (field.starts_with(':')) {
+            if (regularSeen) {
+                malformed = true;
+            } else if (field == ":method" && request.method.empty()) {
+                request.method.assign(value);
+            } else if (field == ":path" && target.empty()) {
+                target.assign(value);
+            } else if (field == ":scheme" && !schemeSeen) {
+                schemeSeen = true;
+            } else if (field == ":authority" && authority.empty()) {
+                authority.assign(value);
+            } else {
+                malformed = true;
+            }
+            return;
+        }
+
+        regularSeen = true;
+        if (field.empty() || hasUpperCase(field) || isConnectionSpecific(field) ||
+            (field == "te" && value != "trailers")) {
+            malformed = true;
+            return;
+        }
+        canonicalName(field, name);
+        auto existing = request.headers.find(name);
+        if (existing == request.headers.end()) {
+            request.headers.emplace(name, value);
+        } else {
+            // Repeated fields are combined; cookies may be split across
+            // fields for better compression, section 8.2.3.
+            existing->second.append(field == "cookie" ? "; " : ", ");
+            existing->second.append(value);
+        }
+    });
+    d_headerBlock.clear();
+    if (!decoded) return connectionError(ErrorCode::CompressionError);
+
+    if (refused) {
+        resetStream(streamId, ErrorCode::RefusedStream);
+        return true;
+    }
+
+    if (trailers) {
+        // Trailers are accepted and dropped; they must end the stream.
+        if (stream->remoteClosed || !d_headerEndStream || malformed) {
+            resetStream(streamId, stream->remoteClosed ? ErrorCode::StreamClosed : ErrorCode::ProtocolError);
+            return true;
+        }
+        stream->remoteClosed = true;
+        dispatch(*stream);
+        return true;
+    }
+
+    HttpRequest& request = stream->request;
+    if (malformed || request.method.empty() || target.empty() || !schemeSeen) {
+        resetStream(streamId, ErrorCode::ProtocolError);
+        return true;
+    }
+    HttpParser::parseTarget(target, request);
+    request.version.assign("HTTP/2");
+    if (!authority.empty() && request.headers.find(std::string_view("Host")) == request.headers.end()) {
+        request.headers.emplace("Host", authority);
+    }
+
+    if (d_headerEndStream) {
+        stream->remoteClosed = true;
+        dispatch(*stream);
+    }
+    return true;
+}
+
+void Http2Connection::dispatch(Stream& stream) {
+    if (!contentLengthMatches(stream.request)) {
+        resetStream(stream.id, ErrorCode::ProtocolError);
+        return;
+    }
+
+    stream.handling = true;
+    d_handling++;
+    {
+        std::lock_guard<std::mutex> lock(d_responsesMtx);
+        d_unanswered++;
+    }
+    const uint32_t streamId = stream.id;
+    d_dispatch(stream.request, [this, streamId](HttpResponse response) {
+        std::lock_guard<std::mutex> lock(d_responsesMtx);
+        d_responses.emplace_back(streamId, std::move(response));
+        if (--d_unanswered == 0) d_responded.notify_all();
+        // Taken right after dispatch returns when answered inline.
+        if (!d_woken && std::this_thread::get_id() != d_thread) {
+            d_woken = true;
+            const uint64_t one = 1;
+            [[maybe_unused]] ssize_t ignored = write(d_wakeFd, &one, sizeof(one));
+        }
+    });
+    // A synchronous handler has answered already.
+    takeResponses();
+}
+
+void Http2Connection::takeResponses() {
+    std::vector<std::pair<uint32_t, HttpResponse>> responses;
+    {
+        std::lock_guard<std::mutex> lock(d_responsesMtx);
+        if (d_responses.empty()) return;
+        responses.swap(d_responses);
+        if (d_woken) {
+            uint64_t count;
+            [[maybe_unused]] ssize_t ignored = read(d_wakeFd, &count, sizeof(count));
+            d_woken = false;
+        }
+    }
+    for (auto& [streamId, response] : responses) respond(streamId, std::move(response));
+}
+
+void Http2Connection::respond(uint32_t streamId, HttpResponse&& result) {
+    auto it = d_streams.find(streamId);
+    if (it == d_streams.end()) return;
+    Stream& stream = *it->second;
+    stream.handling = false;
+    d_handling--;
+    if (stream.cancelled) {
+        d_streams.erase(it);
+        return;
+    }
+
+    stream.response = std::move(result);
+    d_streamsServed++;
+
+    const HttpResponse& response = stream.response;
+    d_encoded.clear();
+    d_encoder.beginBlock(d_encoded);
+    char status[8];
+    auto [end, ec] = std::to_chars(status, status + sizeof(status), static_cast<int>(response.code));
+    d_encoder.encode(":status", std::string_view(status, end - status), d_encoded);
+    for (const auto& [field, value] : response.headers) {
+        toLower(field, d_name);
+        if (isConnectionSpecific(d_name)) continue;
+        d_encoder.encode(d_name, value, d_encoded, indexingFor(d_name));
+    }
+
+    stream.sendTotal = response.body.size() + (response.file ? response.file->size() : 0);
+    const bool endStream = stream.sendTotal == 0;
+
+    // HEADERS followed by as many CONTINUATION frames as the peer's maximum
+    // frame size requires, written back to back.
+    const std::string_view block = d_encoded;
+    size_t offset = 0;
+    FrameType type = FrameType::Headers;
+    do {
+        const size_t chunk = std::min<size_t>(block.size() - offset, d_peerMaxFrameSize);
+        uint8_t flags = offset + chunk == block.size() ? Http2::Flags::EndHeaders : 0;
+        if (type == FrameType::Headers && endStream) flags |= Http2::Flags::EndStream;
+        Http2::writeFrameHeader(d_out, chunk, type, flags, stream.id);
+        d_out.append(block.substr(offset, chunk));
+        stream.bytesSent += Http2::kFrameHeaderSize + chunk;
+        offset += chunk;
+        type = FrameType::Continuation;
+    } while (offset < block.size());
+
+    if (endStream) {
+        completeStream(stream.id);
+    } else {
+        d_sendQueue.push_back(stream.id);
+    }
+}
+
+bool Http2Connection::hasSendableData() const {
+    if (d_sendWindow <= 0) return false;
+    return std::any_of(d_sendQueue.begin(), d_sendQueue.end(), [this](uint32_t streamId) {
+        auto it = d_streams.find(streamId);
+        return it != d_streams.end() && it->second->sendWindow > 0;
+    });
+}
+
+// Writes one DATA frame per stream per pass, rotating through the queue until
+// the windows close, nothing is left or enough is buffered to flush.
+void Http2Connection::sendData() {
+    while (!d_sendQueue.empty() && d_sendWindow > 0 && d_out.size() < kFlushThreshold) {
+        bool progressed = false;
+        const size_t passes = d_sendQueue.size();
+        for (size_t i = 0; i < passes && d_sendWindow > 0 && d_out.size() < kFlushThreshold; i++) {
+            const uint32_t streamId = d_sendQueue.front();
+            d_sendQueue.pop_front();
+            auto it = d_streams.find(streamId);
+            if (it == d_streams.end()) continue; // reset meanwhile
+
+            Stream& stream = *it->second;
+            if (stream.sendWindow <= 0) {
+                d_sendQueue.push_back(streamId);
+                continue;
+            }
+
+            const size_t chunk = std::min({stream.sendTotal - stream.sendOffset, static_cast<size_t>(stream.sendWindow),
+                                           static_cast<size_t>(d_sendWindow), size_t{d_peerMaxFrameSize}});
+            const bool last = stream.sendOffset + chunk == stream.sendTotal;
+            const size_t frameStart = d_out.size();
+            Http2::writeFrameHeader(d_out, chunk, FrameType::Data, last ? Http2::Flags::EndStream : 0, streamId);
+            if (!appendPayload(stream.response, stream.sendOffset, chunk, d_out)) {
+                d_out.resize(frameStart);
+                resetStream(streamId, ErrorCode::InternalError);
+                continue;
+            }
+
+            stream.sendOffset += chunk;
+            stream.sendWindow -= static_cast<int64_t>(chunk);
+            d_sendWindow -= static_cast<int64_t>(chunk);
+            stream.bytesSent += Http2::kFrameHeaderSize + chunk;
+            progressed = true;
+
+            if (last) {
+                completeStream(streamId);
+            } else {
+                d_sendQueue.push_back(streamId);
+            }
+        }
+        if (!progressed) break;
+    }
+}
+
+void Http2Connection::completeStream(uint32_t streamId) {
+    auto it = d_streams.find(streamId);
+    if (it == d_streams.end()) return;
+
+    const Stream& stream = *it->second;
+    if (d_completion) {
+        d_completion(stream.request, stream.response, stream.bytesSent,
+                     std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() -
+                                                                          stream.start));
+    }
+    d_streams.erase(it);
+}
+
+void Http2Connection::resetStream(uint32_t streamId, ErrorCode code) {
+    Http2::writeFrameHeader(d_out, 4, FrameType::RstStream, 0, streamId);
+    Http2::writeUint32(d_out, static_cast<uint32_t>(code));
+    closeStream(streamId);
+}
+
+// A stream whose handler is still running keeps its request alive until the
+// response comes in, and is only dropped then.
+void Http2Connection::closeStream(uint32_t streamId) {
+    auto it = d_streams.find(streamId);
+    if (it == d_streams.end()) return;
+    if (it->second->handling) {
+        it->second->cancelled = true;
+    } else {
+        d_streams.erase(it);
+    }
+}
+
+bool Http2Connection::onSettings(const Http2::FrameHeader& header, std::string_view payload) {
+    if (header.streamId != 0) return connectionError(ErrorCode::ProtocolError);
+    if (header.flags & Http2::Flags::Ack) {
+        return payload.empty() ? true : connectionError(ErrorCode::FrameSizeError);
+    }
+    if (payload.size() % 6 != 0) return connectionError(ErrorCode::FrameSizeError);
+
+    for (size_t i = 0; i < payload.size(); i += 6) {
+        const auto id = static_cast<Http2::Setting>((static_cast<uint8_t>(payload[i]) << 8) |
+                                                    static_cast<uint8_t>(payload[i + 1]));
+        const uint32_t value = Http2::readUint32(payload.data() + i + 2);
+        switch (id) {
+        case Http2::Setting::HeaderTableSize:
+            d_encoder.setMaxTableSize(value);
+            break;
+        case Http2::Setting::EnablePush:
+            if (value > 1) return connectionError(ErrorCode::ProtocolError);
+            break;
+        case Http2::Setting::InitialWindowSize: {
+            if (value > Http2::kMaxWindowSize) return connectionError(ErrorCode::FlowControlError);
+            // Applies retroactively to every open stream, section 6.9.2.
+            const int64_t delta = static_cast<int64_t>(value) - d_peerInitialWindow;
+            for (auto& [streamId, stream] : d_streams) {
+                stream->sendWindow += delta;
+                if (stream->sendWindow > Http2::kMaxWindowSize) return connectionError(ErrorCode::FlowControlError);
+            }
+            d_peerInitialWindow = value;
+            break;
+        }
+        case Http2::Setting::MaxFrameSize:
+            if (value < Http2::kDefaultMaxFrameSize || value > Http2::kMaxFrameSizeLimit) {
+                return connectionError(ErrorCode::ProtocolError);
+            }
+            d_peerMaxFrameSize = value;
+            break;
+        default:
+            // MAX_CONCURRENT_STREAMS only limits pushes, which are never
+            // sent; MAX_HEADER_LIST_SIZE is advisory. Unknown ids are ignored.
+            break;
+        }
+    }
+
+    Http2::writeFrameHeader(d_out, 0, FrameType::Settings, Http2::Flags::Ack, 0);
+    return true;
+}
+
+bool Http2Connection::onWindowUpdate(const Http2::FrameHeader& header, std::string_view payload) {
+    if (payload.size() != 4) return connectionError(ErrorCode::FrameSizeError);
+    const uint32_t increment = Http2::readUint32(payload.data()) & Http2::kMaxWindowSize;
+
+    if (header.streamId == 0) {
+        if (increment == 0) return connectionError(ErrorCode::ProtocolError);
+        d_sendWindow += increment;
+        if (d_sendWindow > Http2::kMaxWindowSize) return connectionError(ErrorCode::FlowControlError);
+        return true;
+    }
+
+    auto it = d_streams.find(header.streamId);
+    if (it == d_streams.end()) {
+        // Updates can race with the end of a stream; only idle ones are errors.
+        return header.streamId > d_lastStreamId ? connectionError(ErrorCode::ProtocolError) : true;
+    }
+    Stream& stream = *it->second;
+    if (increment == 0) {
+        resetStream(stream.id, ErrorCode::ProtocolError);
+        return true;
+    }
+    stream.sendWindow += increment;
+    if (stream.sendWindow > Http2::kMaxWindowSize) resetStream(stream.id, ErrorCode::FlowControlError);
+    return true;
+}
+
+bool Http2Connection::connectionError(ErrorCode code) {
+    sendGoAway(code);
+    flush();
+    d_closed = true;
+    return false;
+}
+
+void Http2Connection::sendGoAway(ErrorCode code) {
+    Http2::writeFrameHeader(d_out, 8, FrameType::GoAway, 0, 0);
+    Http2::writeUint32(d_out, d_lastStreamId);
+    Http2::writeUint32(d_out, static_cast<uint32_t>(code));
+}
+
+bool Http2Connection::flush() {
+    size_t offset = 0;
+    while (offset < d_out.size()) {
+        ssize_t bytes = d_transport.write(d_out.data() + offset, d_out.size() - offset);
+        if (bytes < 0 && errno == EINTR) continue;
+        if (bytes <= 0) {
+            d_out.clear();
+            d_closed = true;
+            return false;
+        }
+        offset += static_cast<size_t>(bytes);
+    }
+    d_out.clear();
+    return true;
+}
+
+} // namespace HTTPServer
@@ -1,26 +1,58 @@
 #include "httpserver/http_object.h"
 
+#include <unistd.h>
+
+#include <cerrno>
+#include <charconv>
 #include <string>
-#include <sstream>
+#include <string_view>
 
 #include "httpserver/utils.h"
 
 namespace HTTPServer {
 
+HttpRequest::HttpRequest(const allocator_type& alloc)
+    : method(alloc), path(alloc), query(alloc), version(alloc), headers(alloc), body(alloc), params(alloc) {}
+
+HttpRequest::HttpRequest(const HttpRequest& other, const allocator_type& alloc)
+    : method(other.method, alloc),
+      path(other.path, alloc),
+      query(other.query, alloc),
+      version(other.version, alloc),
+      headers(other.headers, alloc),
+      body(other.body, alloc),
+      params(other.params, alloc),
+      route(other.route) {}
+
+FileBody::~FileBody() {
+    if (d_fd >= 0) ::close(d_fd);
+}
+
+HttpResponse::HttpResponse(const allocator_type& alloc)
+    : version("HTTP/1.1", alloc), headers(alloc), body(alloc) {}
+
+HttpResponse::HttpResponse(const HttpResponse& other, const allocator_type& alloc)
+    : code(other.code),
+      version(other.version, alloc),
+      headers(other.headers, alloc),
+      body(other.body, alloc),
+      file(other.file) {}
+
 HttpResponse& HttpResponse::setStatus(StatusCode newCode) {
     code = newCode;
     return *this;
 }
 
-HttpResponse& HttpResponse::addHeader(const std::string& key, const std::string& value) {
-    headers[key] = value;
+HttpResponse& HttpResponse::addHeader(std::string_view key, std::string_view value) {
+    headers.insert_or_assign(std::pmr::string(key, get_allocator()), value);
     return *this;
 }
 
-HttpResponse& HttpResponse::setBody(const std::string& newBody) {
-    body = newBody;
-    headers["Content-Length"] = std::to_string(body.size());
-    return *this;
+HttpResponse& HttpResponse::setBody(std::string_view newBody) {
+    body.assign(newBody);
+    char length[24];
+    auto [end, ec] = std::to_chars(length, length + sizeof(length), body.size());
+    return addHeader("Content-Length", std::string_view(length, end - length));
 }
 
 HttpResponse& HttpResponse::applyRequestDefaults(const HttpRequest& request) {
@@ -29,29 +61,73 @@ HttpResponse& HttpResponse::applyRequestDefaults(const HttpRequest& request) {
     }
 
     if (requestWantsKeepAlive(request)) {
-        headers["Connection"] = "keep-alive";
+        addHeader("Connection", "keep-alive");
     } else {
-        headers["Connection"] = "close";
+        addHeader("Connection", "close");
     }
 
     return *this;
 }
 
-std::string HttpResponse::serialize() const {
-    std::ostringstream out;
+namespace {
 
-    out << version << " " 
-        << static_cast<int>(code) << " "
-        << statusCodeToString(code) << "\r\n";
+std::string_view statusDigits(StatusCode code, char (&buffer)[16]) {
+    auto [end, ec] = std::to_chars(buffer, buffer + sizeof(buffer), static_cast<int>(code));
+    return std::string_view(buffer, end - buffer);
+}
+
+char* append(char* out, std::string_view s) {
+    s.copy(out, s.size());
+    return out + s.size();
+}
+
+} // namespace
+
+size_t HttpResponse::headSize() const {
+    char status[16];
+    size_t size = version.size() + 1 + statusDigits(code, status).size() + 1 + statusCodeToString(code).size() + 2;
+    for (const auto& [key, value] : headers) {
+        size += key.size() + 2 + value.size() + 2;
+    }
+    return size + 2;
+}
+
+char* HttpResponse::serializeHead(char* out) const {
+    char status[16];
+    out = append(out, version);
+    out = append(out, " ");
+    out = append(out, statusDigits(code, status));
+    out = append(out, " ");
+    out = append(out, statusCodeToString(code));
+    out = append(out, "\r\n");
 
     for (const auto& [key, value] : headers) {
-        out << key << ": " << value << "\r\n";
+        out = append(out, key);
+        out = append(out, ": ");
+        out = append(out, value);
+        out = append(out, "\r\n");
     }
 
-    out << "\r\n"
-        << body;
+    return append(out, "\r\n");
+}
+
+std::pmr::string HttpResponse::serialize() const {
+    // Size the output up front so the whole message is a single allocation.
+    const size_t fileSize = file ? file->size() : 0;
+    std::pmr::string out(get_allocator());
+    out.resize(headSize() + body.size() + fileSize);
+    char* end = serializeHead(out.data());
+    end += body.copy(end, body.size());
 
-    return out.str();
-}    
+    size_t read = 0;
+    while (read < fileSize) {
+        ssize_t n = ::pread(file->fd(), end + read, fileSize - read, static_cast<off_t>(read));
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        read += static_cast<size_t>(n);
+    }
+    out.resize(out.size() - (fileSize - read));
+    return out;
+}
 
-} // namespace HTTPServer
\ No newline at end of file
+} // namespace HTTPServer
@@ -1,44 +1,76 @@
 #include "httpserver/http_parser.h"
 
-#include <sstream>
+#include <cctype>
+#include <limits>
 #include <string>
-#include <unordered_map>
+#include <string_view>
 
 namespace HTTPServer {
 
-ParseError HttpParser::parse(const std::string &raw, HttpRequest &request) {
+namespace {
+
+bool isSpace(char c) { return std::isspace(static_cast<unsigned char>(c)); }
+
+// Splits the next whitespace separated token off the front of 'rest'.
+std::string_view nextToken(std::string_view &rest) {
+    size_t start = 0;
+    while (start < rest.size() && isSpace(rest[start]))
+        start++;
+    size_t end = start;
+    while (end < rest.size() && !isSpace(rest[end]))
+        end++;
+    std::string_view token = rest.substr(start, end - start);
+    rest.remove_prefix(end);
+    return token;
+}
+
+// Clamp for absurd Content-Length values, keeps totalBytes() from wrapping.
+constexpr size_t kMaxContentLength = std::numeric_limits<size_t>::max() / 4;
+
+bool equalsIgnoreCase(std::string_view a, std::string_view b) {
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); i++) {
+        if (std::tolower(static_cast<unsigned char>(a[i])) != b[i]) return false;
+    }
+    return true;
+}
+
+int hexValue(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+} // namespace
+
+ParseError HttpParser::parse(std::string_view raw, HttpRequest &request) {
     if (raw.empty()) {
         return ParseError::EMPTY_REQUEST;
     }
 
-    std::istringstream stream(raw);
-    std::string line;
+    std::string_view line;
 
     // -----------------------------
     // Parse request line
     // -----------------------------
-    if (!std::getline(stream, line)) {
+    if (!nextLine(raw, line)) {
         return ParseError::INVALID_REQUEST_LINE;
     }
 
-    if (!line.empty() && line.back() == '\r')
-        line.pop_back();
-
-    std::istringstream request_line(line);
-    if (!(request_line >> request.method >> request.path >> request.version)) {
+    std::string_view method = nextToken(line);
+    std::string_view target = nextToken(line);
+    std::string_view version = nextToken(line);
+    if (method.empty() || target.empty() || version.empty()) {
         return ParseError::INVALID_REQUEST_LINE;
     }
+    request.method.assign(method);
+    request.version.assign(version);
 
     // -------------------------------------
     // Extract and parse query string
     // -------------------------------------
-    size_t qmark = request.path.find('?');
-    if (qmark != std::string::npos) {
-        std::string qs = request.path.substr(qmark + 1);
-        request.path = request.path.substr(0, qmark);
-
-        parseQueryParams(qs, request.params);
-    }
+    parseTarget(target, request);
 
     // -----------------------------
     // Validate method
@@ -57,61 +89,142 @@ ParseError HttpParser::parse(const std::string &raw, HttpRequest &request) {
     // -----------------------------
     // Parse headers
     // -----------------------------
-    while (std::getline(stream, line)) {
-        if (!line.empty() && line.back() == '\r')
-            line.pop_back();
-
+    while (nextLine(raw, line)) {
         if (line.empty()) {
             break; // end of headers
         }
 
         auto colon = line.find(':');
-        if (colon == std::string::npos) {
+        if (colon == std::string_view::npos) {
             return ParseError::INVALID_HEADER_FORMAT;
         }
 
-        std::string name = line.substr(0, colon);
-        std::string value = line.substr(colon + 1);
-
-        trim(value);
+        std::string_view name = line.substr(0, colon);
+        std::string_view value = trim(line.substr(colon + 1));
 
         if (!isValidHeaderName(name)) {
             return ParseError::INVALID_HEADER_NAME;
         }
 
-        request.headers[name] = value;
+        request.headers.insert_or_assign(std::pmr::string(name, request.get_allocator()), value);
     }
 
     // -----------------------------
     // Parse body
     // -----------------------------
-    std::string body;
-    while (std::getline(stream, line)) {
-        body.append(line);
-        body.push_back('\n');
+    // Every body line is newline terminated, including a final partial line.
+    request.body.assign(raw);
+    if (!request.body.empty() && request.body.back() != '\n') {
+        request.body.push_back('\n');
     }
-    request.body = body;
 
     return ParseError::NONE;
 }
 
-void HttpParser::trim(std::string &s) {
-    while (!s.empty() && std::isspace((unsigned char)s.front()))
-        s.erase(s.begin());
-    while (!s.empty() && std::isspace((unsigned char)s.back()))
-        s.pop_back();
+void HttpParser::parseTarget(std::string_view target, HttpRequest &request) {
+    size_t qmark = target.find('?');
+    if (qmark != std::string_view::npos) {
+        request.path.assign(target.substr(0, qmark));
+        request.query.assign(target.substr(qmark + 1));
+        parseQueryParams(request.query, request.params);
+    } else {
+        request.path.assign(target);
+    }
+}
+
+RequestFrame HttpParser::frame(std::string_view raw) {
+    RequestFrame frame;
+
+    // Bytes that cannot begin a request line (e.g. a TLS ClientHello sent to
+    // a plain HTTP port) are framed as complete right away, so the parser
+    // rejects them instead of the connection waiting for a line that never
+    // comes.
+    size_t methodEnd = raw.find(' ');
+    for (char c : raw.substr(0, methodEnd)) {
+        if (!std::isupper(static_cast<unsigned char>(c))) {
+            frame.headersComplete = true;
+            frame.headerBytes = raw.size();
+            return frame;
+        }
+    }
+
+    size_t start = 0;
+
+    while (true) {
+        size_t newline = raw.find('\n', start);
+        if (newline == std::string_view::npos) {
+            return frame;
+        }
+
+        std::string_view line = raw.substr(start, newline - start);
+        if (!line.empty() && line.back() == '\r')
+            line.remove_suffix(1);
+        start = newline + 1;
+
+        if (line.empty()) {
+            frame.headersComplete = true;
+            frame.headerBytes = start;
+            return frame;
+        }
+
+        auto colon = line.find(':');
+        if (colon != std::string_view::npos && equalsIgnoreCase(line.substr(0, colon), "content-length")) {
+            std::string_view value = trim(line.substr(colon + 1));
+            size_t length = 0;
+            for (char c : value) {
+                if (c < '0' || c > '9') {
+                    length = 0;
+                    break;
+                }
+                length = length * 10 + static_cast<size_t>(c - '0');
+                if (length > kMaxContentLength) {
+                    length = kMaxContentLength;
+                    break;
+                }
+            }
+            frame.contentLength = length;
+        }
+    }
+}
+
+// Splits the next line off the front of 'rest', dropping the line terminator
+// and any '\r' before it. Fails once 'rest' is exhausted.
+bool HttpParser::nextLine(std::string_view &rest, std::string_view &line) {
+    if (rest.empty())
+        return false;
+
+    size_t newline = rest.find('\n');
+    if (newline == std::string_view::npos) {
+        line = rest;
+        rest = {};
+    } else {
+        line = rest.substr(0, newline);
+        rest.remove_prefix(newline + 1);
+    }
+
+    if (!line.empty() && line.back() == '\r')
+        line.remove_suffix(1);
+    return true;
+}
+
+std::string_view HttpParser::trim(std::string_view s) {
+    while (!s.empty() && isSpace(s.front()))
+        s.remove_prefix(1);
+    while (!s.empty() && isSpace(s.back()))
+        s.remove_suffix(1);
+    return s;
 }
 
-bool HttpParser::isValidMethod(const std::string &m) {
+bool HttpParser::isValidMethod(std::string_view m) {
     for (char c : m)
         if (!std::isupper((unsigned char)c))
             return false;
     return !m.empty();
 }
 
-bool HttpParser::isValidVersion(const std::string &v) { return v.rfind("HTTP/", 0) == 0 && v.size() >= 6; }
+bool HttpParser::isValidVersion(std::string_view v) { return v.starts_with("HTTP/") && v.size() >= 6; }
 
-bool HttpParser::isValidHeaderName(const std::string &name) {
+bool HttpParser::isValidHeaderName(std::string_view name) {
     if (name.empty())
         return false;
     for (char c : name) {
@@ -121,14 +234,19 @@ bool HttpParser::isValidHeaderName(const std::string &name) {
     return true;
 }
 
-std::string HttpParser::urlDecode(const std::string& s) {
-    std::string out;
+void HttpParser::urlDecode(std::string_view s, std::pmr::string &out) {
+    out.clear();
     out.reserve(s.size());
 
     for (size_t i = 0; i < s.size(); i++) {
+        int hi = -1, lo = -1;
         if (s[i] == '%' && i + 2 < s.size()) {
-            char hex[3] = { s[i+1], s[i+2], 0 };
-            out.push_back(static_cast<char>(std::strtol(hex, nullptr, 16)));
+            hi = hexValue(s[i + 1]);
+            lo = hexValue(s[i + 2]);
+        }
+
+        if (hi >= 0 && lo >= 0) {
+            out.push_back(static_cast<char>(hi * 16 + lo));
             i += 2;
         } else if (s[i] == '+') {
             out.push_back(' ');
@@ -136,33 +254,32 @@ std::string HttpParser::urlDecode(const std::string& s) {
             out.push_back(s[i]);
         }
     }
-    return out;
 }
 
-void HttpParser::parseQueryParams(const std::string& qs,
-                             std::unordered_map<std::string, std::string>& map)
-{
+void HttpParser::parseQueryParams(std::string_view qs, HeaderMap &map) {
     size_t start = 0;
 
     while (start < qs.size()) {
         size_t amp = qs.find('&', start);
-        if (amp == std::string::npos)
+        if (amp == std::string_view::npos)
             amp = qs.size();
 
-        std::string pair = qs.substr(start, amp - start);
+        std::string_view pair = qs.substr(start, amp - start);
 
+        std::pmr::string key(map.get_allocator());
+        std::pmr::string val(map.get_allocator());
         size_t eq = pair.find('=');
-        if (eq != std::string::npos) {
-            std::string key = urlDecode(pair.substr(0, eq));
-            std::string val = urlDecode(pair.substr(eq + 1));
-            map[ key ] = val;
+        if (eq != std::string_view::npos) {
+            urlDecode(pair.substr(0, eq), key);
+            urlDecode(pair.substr(eq + 1), val);
         } else {
             // key with no value
-            map[ urlDecode(pair) ] = "";
+            urlDecode(pair, key);
         }
+        map.insert_or_assign(std::move(key), std::move(val));
 
         start = amp + 1;
     }
 }
 
-} // namespace HTTPServer
\ No newline at end of file
+} // namespace HTTPServer
@@ -1,9 +1,13 @@
 #include "httpserver/http_response_builder.h"
 
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <memory>
 #include <string>
-#include <fstream>
-#include <sstream>
-#include <string>
+#include <string_view>
 
 #include "httpserver/http_object.h"
 #include "httpserver/utils.h"
@@ -14,8 +18,8 @@ namespace HTTPServer {
 
 namespace Responses {
 
-HttpResponse ok(const HttpRequest& req, const std::string& body, const std::string& type) {
-    HttpResponse res;
+HttpResponse ok(const HttpRequest& req, std::string_view body, std::string_view type) {
+    HttpResponse res(req.get_allocator());
     res.setStatus(StatusCode::OK)
         .applyRequestDefaults(req)
         .addHeader("Content-Type", type)
@@ -24,55 +28,132 @@ HttpResponse ok(const HttpRequest& req, const std::string& body, const std::stri
 }
 
 HttpResponse notFound(const HttpRequest& req) {
-    HttpResponse res;
-    return res.setStatus(StatusCode::NotFound)
-              .addHeader("Content-Type", "text/plain")
-              .addHeader("Connection", "close")
-              .setBody("404 Not Found: " + req.path);
+    HttpResponse res(req.get_allocator());
+    res.setStatus(StatusCode::NotFound)
+        .addHeader("Content-Type", "text/plain")
+        .addHeader("Connection", "close");
+
+    constexpr std::string_view prefix = "404 Not Found: ";
+    std::pmr::string body(res.get_allocator());
+    body.reserve(prefix.size() + req.path.size());
+    body.append(prefix).append(req.path);
+    return res.setBody(body);
 }
 
-HttpResponse badRequest() {
-    HttpResponse res;
+HttpResponse badRequest(const HttpResponse::allocator_type& alloc) {
+    HttpResponse res(alloc);
     return res.setStatus(StatusCode::BadRequest)
               .addHeader("Content-Type", "text/plain")
               .addHeader("Connection", "close")
               .setBody("400 Bad Request");
 }
 
+HttpResponse tooManyRequests(const HttpRequest& req, std::chrono::seconds retryAfter) {
+    HttpResponse res(req.get_allocator());
+    return res.setStatus(StatusCode::TooManyRequests)
+              .applyRequestDefaults(req)
+              .addHeader("Content-Type", "text/plain")
+              .addHeader("Retry-After", std::to_string(retryAfter.count()))
+              .setBody("429 Too Many Requests");
+}
+
+HttpResponse serviceUnavailable(const HttpRequest& req, std::chrono::seconds retryAfter) {
+    HttpResponse res(req.get_allocator());
+    return res.setStatus(StatusCode::ServiceUnavailable)
+              .applyRequestDefaults(req)
+              .addHeader("Content-Type", "text/plain")
+              .addHeader("Retry-After", std::to_string(retryAfter.count()))
+              .setBody("503 Service Unavailable");
+}
+
+HttpResponse internalServerError(const HttpRequest& req) {
+    HttpResponse res(req.get_allocator());
+    return res.setStatus(StatusCode::InternalServerError)
+              .addHeader("Content-Type", "text/plain")
+              .addHeader("Connection", "close")
+              .setBody("500 Internal Server Error");
+}
+
+HttpResponse badGateway(const HttpRequest& req) {
+    HttpResponse res(req.get_allocator());
+    return res.setStatus(StatusCode::BadGateway)
+              .applyRequestDefaults(req)
+              .addHeader("Content-Type", "text/plain")
+              .setBody("502 Bad Gateway");
+}
+
+HttpResponse gatewayTimeout(const HttpRequest& req) {
+    HttpResponse res(req.get_allocator());
+    return res.setStatus(StatusCode::GatewayTimeout)
+              .applyRequestDefaults(req)
+              .addHeader("Content-Type", "text/plain")
+              .setBody("504 Gateway Timeout");
+}
+
 HttpResponse redirection(const HttpRequest& req, const Port& port) {
-    std::string host = req.headers.count("Host") ? req.headers.at("Host") : "localhost";
+    auto hostIt = req.headers.find("Host");
+    std::string_view host = hostIt != req.headers.end() ? std::string_view(hostIt->second) : "localhost";
 
     auto colonPos = host.find(':');
-    if (colonPos != std::string::npos) {
+    if (colonPos != std::string_view::npos) {
         host = host.substr(0, colonPos);
     }
 
     // Only include port if HTTPS is not on 443
     std::string portStr = (port.value() == 443) ? "" : ":" + port.toString();
-    HttpResponse res;
+    HttpResponse res(req.get_allocator());
+    std::pmr::string location(res.get_allocator());
+    location.append("https://").append(host).append(portStr).append(req.path);
     return res.setStatus(StatusCode::MovedPermanently)
-            .addHeader("Location", "https://" + host + portStr + req.path)
+            .addHeader("Location", location)
             .setBody("Redirecting to HTTPS...");
 }
 
 HttpResponse file(const HttpRequest& req, const std::string& filepath) {
-    std::ifstream file(filepath, std::ios::binary);
+    int fd = ::open(filepath.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return Responses::notFound(req);
+    }
 
-    if (!file) {
+    struct stat st{};
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        ::close(fd);
         return Responses::notFound(req);
     }
+    const size_t size = static_cast<size_t>(st.st_size);
+
+    HttpResponse res(req.get_allocator());
+    res.setStatus(StatusCode::OK);
+
+    // Large files are attached rather than read, and the server streams them
+    // with sendfile(2) (or SSL_sendfile under kTLS) straight from the page cache.
+    if (size > kMaxInlineFileSize) {
+        res.file = std::make_shared<FileBody>(fd, size);
+        res.addHeader("Content-Length", std::to_string(size))
+           .addHeader("Content-Type", Mime::fromExtension(filepath));
+        return res;
+    }
 
-    std::ostringstream buffer;
-    buffer << file.rdbuf();
-    std::string content = buffer.str();
+    res.body.resize(size);
+    size_t read = 0;
+    while (read < size) {
+        ssize_t n = ::pread(fd, res.body.data() + read, size - read, static_cast<off_t>(read));
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        read += static_cast<size_t>(n);
+    }
+    ::close(fd);
 
-    HttpResponse res;
-    return res.setStatus(StatusCode::OK)
-              .addHeader("Content-Length", std::to_string(content.size()))
-              .addHeader("Content-Type", Mime::fromExtension(filepath))
-              .setBody(content);
+    // A short read means the file shrank under us; the length promised by
+    // fstat can no longer be honoured, so fail rather than misframe.
+    if (read != size) {
+        return Responses::internalServerError(req);
+    }
+    res.addHeader("Content-Length", std::to_string(read))
+       .addHeader("Content-Type", Mime::fromExtension(filepath));
+    return res;
 }
 
 } // namespace Responses
 
-} // namespace HTTPServer
\ No newline at end of file
+} // namespace HTTPServer
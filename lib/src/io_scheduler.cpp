@@ -0,0 +1,187 @@
+#include "httpserver/io_scheduler.h"
+
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <array>
+#include <cerrno>
+#include <fstream>
+#include <iterator>
+
+#include "httpserver/logger.h"
+
+namespace HTTPServer {
+
+IoScheduler& IoScheduler::instance() {
+    static IoScheduler scheduler;
+    return scheduler;
+}
+
+IoScheduler::IoScheduler()
+    : d_epollFd(epoll_create1(EPOLL_CLOEXEC)),
+      d_wakeFd(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) {
+    if (d_epollFd < 0 || d_wakeFd < 0) {
+        LOG_ERROR_ERRNO("IoScheduler: Fatal: Failed to create the event loop");
+        return;
+    }
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.ptr = nullptr;
+    epoll_ctl(d_epollFd, EPOLL_CTL_ADD, d_wakeFd, &event);
+    d_loop = std::thread([this]() { run(); });
+    d_fileThread = std::thread([this]() { runFileReads(); });
+}
+
+IoScheduler::~IoScheduler() {
+    {
+        std::lock_guard<std::mutex> lock(d_mtx);
+        d_stopping = true;
+    }
+    {
+        std::lock_guard<std::mutex> lock(d_fileMtx);
+        d_fileStopping = true;
+    }
+    wake();
+    d_fileCv.notify_one();
+    if (d_loop.joinable()) d_loop.join();
+    if (d_fileThread.joinable()) d_fileThread.join();
+    if (d_wakeFd >= 0) close(d_wakeFd);
+    if (d_epollFd >= 0) close(d_epollFd);
+}
+
+void IoScheduler::Operation::await_suspend(std::coroutine_handle<> handle) {
+    d_handle = handle;
+    d_scheduler.submit(*this);
+}
+
+void IoScheduler::FileRead::await_suspend(std::coroutine_handle<> handle) {
+    d_handle = handle;
+    d_scheduler.submit(*this);
+}
+
+// The operation lives in the suspended coroutine's frame, which the loop
+// thread may resume and free as soon as the lock is released: nothing here
+// touches it afterwards.
+void IoScheduler::submit(Operation& operation) {
+    d_pending.fetch_add(1, std::memory_order_relaxed);
+    std::lock_guard<std::mutex> lock(d_mtx);
+    d_submitted.push_back(&operation);
+    if (!d_woken) {
+        d_woken = true;
+        wake();
+    }
+}
+
+void IoScheduler::submit(FileRead& read) {
+    d_pending.fetch_add(1, std::memory_order_relaxed);
+    {
+        std::lock_guard<std::mutex> lock(d_fileMtx);
+        d_fileReads.push_back(&read);
+    }
+    d_fileCv.notify_one();
+}
+
+void IoScheduler::resume(std::coroutine_handle<> handle) {
+    std::lock_guard<std::mutex> lock(d_mtx);
+    d_resumable.push_back(handle);
+    if (!d_woken) {
+        d_woken = true;
+        wake();
+    }
+}
+
+void IoScheduler::wake() {
+    const uint64_t one = 1;
+    [[maybe_unused]] ssize_t ignored = write(d_wakeFd, &one, sizeof(one));
+}
+
+void IoScheduler::run() {
+    std::array<epoll_event, kMaxEvents> events;
+    std::vector<Operation*> submitted;
+    std::vector<std::coroutine_handle<>> resumable;
+    while (true) {
+        {
+            std::lock_guard<std::mutex> lock(d_mtx);
+            if (d_stopping) break;
+            submitted.swap(d_submitted);
+            resumable.swap(d_resumable);
+            if (d_woken) {
+                uint64_t count;
+                [[maybe_unused]] ssize_t ignored = read(d_wakeFd, &count, sizeof(count));
+                d_woken = false;
+            }
+        }
+        for (Operation* operation : submitted) arm(*operation);
+        submitted.clear();
+        for (std::coroutine_handle<> handle : resumable) {
+            d_pending.fetch_sub(1, std::memory_order_relaxed);
+            handle.resume();
+        }
+        resumable.clear();
+
+        // Tick only while there are timeouts to expire.
+        const int timeout = d_timers.empty() ? -1 : static_cast<int>(kResolution.count());
+        const int ready = epoll_wait(d_epollFd, events.data(), kMaxEvents, timeout);
+        if (ready < 0 && errno != EINTR) {
+            LOG_ERROR_ERRNO("IoScheduler: epoll_wait failed");
+            break;
+        }
+        for (int i = 0; i < ready; i++) {
+            if (!events[i].data.ptr) continue; // woken
+            complete(*static_cast<Operation*>(events[i].data.ptr), true);
+        }
+        d_timers.advance(Clock::now(), [this](TimerWheel::Timer& timer) {
+            Operation& operation = static_cast<Operation&>(timer);
+            complete(operation, operation.d_fd < 0);
+        });
+    }
+}
+
+void IoScheduler::arm(Operation& operation) {
+    if (operation.d_fd >= 0) {
+        epoll_event event{};
+        event.events = operation.d_events | EPOLLONESHOT;
+        event.data.ptr = &operation;
+        if (epoll_ctl(d_epollFd, EPOLL_CTL_ADD, operation.d_fd, &event) < 0 &&
+            (errno != EEXIST || epoll_ctl(d_epollFd, EPOLL_CTL_MOD, operation.d_fd, &event) < 0)) {
+            // Regular files and the like are always ready; anything else
+            // (a closed descriptor) reports ready so the caller's own
+            // read or write surfaces the error.
+            complete(operation, true);
+            return;
+        }
+    }
+    if (operation.d_timeout.count() >= 0) {
+        d_timers.schedule(operation, Clock::now() + operation.d_timeout);
+    }
+}
+
+void IoScheduler::complete(Operation& operation, bool ready) {
+    if (operation.scheduled()) d_timers.cancel(operation);
+    // Leaves the descriptor free for the next waiter, whichever its owner.
+    if (operation.d_fd >= 0) epoll_ctl(d_epollFd, EPOLL_CTL_DEL, operation.d_fd, nullptr);
+    operation.d_ready = ready;
+    d_pending.fetch_sub(1, std::memory_order_relaxed);
+    operation.d_handle.resume();
+}
+
+void IoScheduler::runFileReads() {
+    while (true) {
+        FileRead* read = nullptr;
+        {
+            std::unique_lock<std::mutex> lock(d_fileMtx);
+            d_fileCv.wait(lock, [this]() { return d_fileStopping || !d_fileReads.empty(); });
+            if (d_fileReads.empty()) return;
+            read = d_fileReads.front();
+            d_fileReads.pop_front();
+        }
+        std::ifstream file(read->d_path, std::ios::binary);
+        if (file) {
+            read->d_contents.emplace((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+            if (file.bad()) read->d_contents.reset();
+        }
+        resume(read->d_handle);
+    }
+}
+
+} // namespace HTTPServer
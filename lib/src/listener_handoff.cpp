@@ -0,0 +1,182 @@
+#include "httpserver/listener_handoff.h"
+
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <string_view>
+
+#include "httpserver/logger.h"
+#include "httpserver/unix_socket.h"
+
+extern char** environ;
+
+namespace HTTPServer {
+
+namespace {
+
+// Sockets named in the environment that are still waiting to be taken.
+std::vector<int>& inherited() {
+    static std::vector<int> fds = []() {
+        std::vector<int> parsed;
+        const char* list = std::getenv(ListenerHandoff::kFdsEnv);
+        if (!list) return parsed;
+        for (const char* p = list; *p;) {
+            char* end = nullptr;
+            const long fd = std::strtol(p, &end, 10);
+            if (end == p) break;
+            int listening = 0;
+            socklen_t length = sizeof(listening);
+            if (fd >= 0 && fd <= INT_MAX &&
+                getsockopt(static_cast<int>(fd), SOL_SOCKET, SO_ACCEPTCONN, &listening, &length) == 0 && listening) {
+                parsed.push_back(static_cast<int>(fd));
+            } else {
+                LOG_WARN("Startup: Ignoring inherited fd [" + std::to_string(fd) + "], not a listening socket");
+            }
+            p = *end == ',' ? end + 1 : end;
+        }
+        return parsed;
+    }();
+    return fds;
+}
+
+int boundPort(int fd) {
+    sockaddr_storage address{};
+    socklen_t length = sizeof(address);
+    if (getsockname(fd, reinterpret_cast<sockaddr*>(&address), &length) < 0) return -1;
+    if (address.ss_family == AF_INET6) return ntohs(reinterpret_cast<sockaddr_in6*>(&address)->sin6_port);
+    if (address.ss_family == AF_INET) return ntohs(reinterpret_cast<sockaddr_in*>(&address)->sin_port);
+    return -1;
+}
+
+std::string describe(int fd) {
+    const int port = boundPort(fd);
+    if (port >= 0) return "port " + std::to_string(port);
+    return "unix socket " + UnixSocket::boundPath(fd);
+}
+
+int takeIf(auto matches) {
+    std::vector<int>& fds = inherited();
+    auto it = std::find_if(fds.begin(), fds.end(), matches);
+    if (it == fds.end()) return -1;
+    const int fd = *it;
+    fds.erase(it);
+    fcntl(fd, F_SETFD, FD_CLOEXEC);
+    return fd;
+}
+
+// The path the binary was started from; after a deploy has replaced the
+// file the kernel reports the old inode as "(deleted)", while the path now
+// holds the new binary.
+std::string executablePath() {
+    char path[PATH_MAX];
+    const ssize_t length = readlink("/proc/self/exe", path, sizeof(path) - 1);
+    if (length <= 0) return {};
+    std::string exe(path, static_cast<size_t>(length));
+    constexpr std::string_view kDeleted = " (deleted)";
+    if (exe.ends_with(kDeleted)) exe.resize(exe.size() - kDeleted.size());
+    return exe;
+}
+
+std::vector<std::string> commandLine() {
+    std::ifstream file("/proc/self/cmdline", std::ios::binary);
+    const std::string raw((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    std::vector<std::string> args;
+    for (size_t start = 0; start < raw.size();) {
+        const size_t end = std::min(raw.find('\0', start), raw.size());
+        args.emplace_back(raw, start, end - start);
+        start = end + 1;
+    }
+    return args;
+}
+
+std::vector<char*> pointers(std::vector<std::string>& strings) {
+    std::vector<char*> result;
+    for (std::string& s : strings) result.push_back(s.data());
+    result.push_back(nullptr);
+    return result;
+}
+
+} // namespace
+
+int ListenerHandoff::take(const Port& port) {
+    return takeIf([&port](int fd) { return boundPort(fd) == port.value(); });
+}
+
+int ListenerHandoff::take(const std::string& path) {
+    return takeIf([&path](int fd) { return UnixSocket::boundPath(fd) == path; });
+}
+
+void ListenerHandoff::complete() {
+    std::vector<int>& fds = inherited();
+    for (int fd : fds) {
+        LOG_WARN("Startup: Closing inherited listening socket [" + std::to_string(fd) + "] on " + describe(fd) +
+                 ", no listener took it");
+        close(fd);
+    }
+    fds.clear();
+
+    const char* parent = std::getenv(kParentEnv);
+    const pid_t pid = parent ? static_cast<pid_t>(std::atol(parent)) : 0;
+    unsetenv(kFdsEnv);
+    unsetenv(kParentEnv);
+    // Only ever the process that started us: a stale variable must not let
+    // us signal whatever now has that pid.
+    if (pid <= 0 || getppid() != pid) return;
+    LOG_INFO("Startup: Listening, telling previous process [" + std::to_string(pid) + "] to drain");
+    kill(pid, SIGTERM);
+}
+
+pid_t ListenerHandoff::spawn(const std::vector<int>& fds) {
+    std::string exe = executablePath();
+    std::vector<std::string> args = commandLine();
+    if (exe.empty() || args.empty()) {
+        LOG_ERROR("Upgrade: Cannot determine the executable to start");
+        return -1;
+    }
+
+    std::string fdList;
+    for (int fd : fds) fdList += (fdList.empty() ? "" : ",") + std::to_string(fd);
+    std::vector<std::string> env;
+    for (char** var = environ; *var; ++var) {
+        const std::string_view entry(*var);
+        if (entry.starts_with(std::string(kFdsEnv) + "=") || entry.starts_with(std::string(kParentEnv) + "=")) continue;
+        env.emplace_back(entry);
+    }
+    env.push_back(std::string(kFdsEnv) + "=" + fdList);
+    env.push_back(std::string(kParentEnv) + "=" + std::to_string(getpid()));
+
+    // Everything the child needs is built before fork: other threads may
+    // hold locks, so the child only makes system calls until exec.
+    std::vector<char*> argv = pointers(args);
+    std::vector<char*> envp = pointers(env);
+
+    const pid_t pid = fork();
+    if (pid < 0) {
+        LOG_ERROR_ERRNO("Upgrade: fork failed");
+        return -1;
+    }
+    if (pid == 0) {
+        // Called from a signal handler the mask blocks that signal, and a
+        // mask survives exec.
+        sigset_t none;
+        sigemptyset(&none);
+        sigprocmask(SIG_SETMASK, &none, nullptr);
+        close_range(3, ~0U, CLOSE_RANGE_CLOEXEC);
+        for (int fd : fds) fcntl(fd, F_SETFD, 0);
+        execve(exe.c_str(), argv.data(), envp.data());
+        _exit(127);
+    }
+    return pid;
+}
+
+} // namespace HTTPServer
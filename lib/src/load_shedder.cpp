@@ -0,0 +1,111 @@
+#include "httpserver/load_shedder.h"
+
+#include <algorithm>
+#include <thread>
+
+#include "httpserver/metrics.h"
+
+namespace HTTPServer {
+
+void LoadShedder::configure(const LoadSheddingOptions& options) {
+    d_options = options;
+    d_limit = options.maxConcurrentHandlers ? options.maxConcurrentHandlers
+                                            : std::max(1u, std::thread::hardware_concurrency());
+}
+
+LoadShedder::Permit LoadShedder::admit() {
+    if (!enabled()) return Permit(nullptr, true);
+
+    // Fast path: a free slot and nobody queued ahead of us. Such requests
+    // wait for nothing, which tells CoDel the queue drained this interval.
+    if (d_waiting.load() == 0 && tryAcquire()) {
+        d_fastAdmits.store(true, std::memory_order_relaxed);
+        return Permit(this, true);
+    }
+
+    std::unique_lock<std::mutex> lock(d_mtx);
+    Waiter self;
+    self.enqueued = Clock::now();
+    d_queue.push_back(&self);
+    d_waiting.fetch_add(1);
+    // A slot released between the fast path and queueing would otherwise
+    // find nobody to hand it to.
+    grantWaiters();
+
+    const auto slough = 2 * d_options.target;
+    while (!self.granted) {
+        const auto deadline = d_overloaded ? self.enqueued + slough : Clock::now() + d_options.interval;
+        self.cv.wait_until(lock, deadline, [&self]() { return self.granted; });
+        if (self.granted) break;
+
+        const auto now = Clock::now();
+        if (d_overloaded && now - self.enqueued >= slough) {
+            removeWaiter(self);
+            recordDelay(now - self.enqueued, now);
+            Metrics::instance().requestShed();
+            return Permit();
+        }
+    }
+
+    const auto now = Clock::now();
+    recordDelay(now - self.enqueued, now);
+    return Permit(this, true);
+}
+
+bool LoadShedder::tryAcquire() {
+    size_t current = d_active.load(std::memory_order_relaxed);
+    do {
+        if (current >= d_limit) return false;
+    } while (!d_active.compare_exchange_weak(current, current + 1, std::memory_order_acquire));
+    return true;
+}
+
+void LoadShedder::release() {
+    d_active.fetch_sub(1, std::memory_order_release);
+    // Pairs with the waiter's increment before it re-checks for a slot under
+    // the lock: either it sees this release or this sees it waiting.
+    if (d_waiting.load() == 0) return;
+    std::lock_guard<std::mutex> lock(d_mtx);
+    grantWaiters();
+}
+
+// Hands free slots directly to waiters, oldest first unless overloaded.
+void LoadShedder::grantWaiters() {
+    while (!d_queue.empty() && tryAcquire()) {
+        Waiter* waiter;
+        if (d_overloaded && d_options.lifoWhenOverloaded) {
+            waiter = d_queue.back();
+            d_queue.pop_back();
+        } else {
+            waiter = d_queue.front();
+            d_queue.pop_front();
+        }
+        d_waiting.fetch_sub(1);
+        waiter->granted = true;
+        waiter->cv.notify_one();
+    }
+}
+
+void LoadShedder::removeWaiter(Waiter& waiter) {
+    auto it = std::find(d_queue.begin(), d_queue.end(), &waiter);
+    if (it == d_queue.end()) return;
+    d_queue.erase(it);
+    d_waiting.fetch_sub(1);
+}
+
+// The overload decision is only revisited once per interval, from the
+// smallest delay seen during it, so a burst that drains within an interval
+// never triggers shedding.
+void LoadShedder::recordDelay(Clock::duration delay, Clock::time_point now) {
+    if (now < d_intervalEnd) {
+        d_minDelay = std::min(d_minDelay, delay);
+        return;
+    }
+    const bool drained = d_fastAdmits.exchange(false, std::memory_order_relaxed);
+    d_overloaded = !drained && d_minDelay > d_options.target;
+    d_overloadedFlag.store(d_overloaded, std::memory_order_relaxed);
+    d_minDelay = delay;
+    d_intervalEnd = now + d_options.interval;
+}
+
+} // namespace HTTPServer
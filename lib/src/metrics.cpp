@@ -0,0 +1,625 @@
+#include "httpserver/metrics.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <sstream>
+#include <string>
+
+namespace HTTPServer {
+
+namespace HistogramBuckets {
+
+size_t indexFor(uint64_t value) {
+    constexpr uint64_t kMaxValue = (uint64_t{1} << kMaxValueBits) - 1;
+    if (value > kMaxValue) value = kMaxValue;
+    if (value < kSubBucketCount) return static_cast<size_t>(value);
+
+    const unsigned exponent = 63 - std::countl_zero(value);
+    const uint64_t subBucket = (value >> (exponent - kSubBucketBits)) & (kSubBucketCount - 1);
+    return static_cast<size_t>((exponent - kSubBucketBits + 1) * kSubBucketCount + subBucket);
+}
+
+uint64_t lowerBound(size_t index) {
+    if (index < kSubBucketCount) return index;
+
+    const unsigned exponent = static_cast<unsigned>(index / kSubBucketCount) + kSubBucketBits - 1;
+    const uint64_t subBucket = index % kSubBucketCount;
+    return (kSubBucketCount + subBucket) << (exponent - kSubBucketBits);
+}
+
+uint64_t upperBound(size_t index) {
+    if (index < kSubBucketCount) return index;
+
+    const unsigned exponent = static_cast<unsigned>(index / kSubBucketCount) + kSubBucketBits - 1;
+    return lowerBound(index) + (uint64_t{1} << (exponent - kSubBucketBits)) - 1;
+}
+
+} // namespace HistogramBuckets
+
+void HistogramSnapshot::record(uint64_t value) {
+    buckets[HistogramBuckets::indexFor(value)]++;
+    count++;
+    sum += value;
+}
+
+void HistogramSnapshot::merge(const HistogramSnapshot& other) {
+    for (size_t i = 0; i < buckets.size(); i++) {
+        buckets[i] += other.buckets[i];
+    }
+    count += other.count;
+    sum += other.sum;
+}
+
+uint64_t HistogramSnapshot::percentile(double p) const {
+    if (count == 0) return 0;
+
+    uint64_t rank = static_cast<uint64_t>(std::ceil(p / 100.0 * static_cast<double>(count)));
+    if (rank == 0) rank = 1;
+
+    uint64_t seen = 0;
+    for (size_t i = 0; i < buckets.size(); i++) {
+        seen += buckets[i];
+        if (seen >= rank) return HistogramBuckets::upperBound(i);
+    }
+    return HistogramBuckets::upperBound(buckets.size() - 1);
+}
+
+uint64_t HistogramSnapshot::countAtOrBelow(uint64_t value) const {
+    uint64_t total = 0;
+    for (size_t i = 0; i < buckets.size() && HistogramBuckets::upperBound(i) <= value; i++) {
+        total += buckets[i];
+    }
+    return total;
+}
+
+void LatencyHistogram::record(uint64_t value) {
+    auto& bucket = d_buckets[HistogramBuckets::indexFor(value)];
+    bucket.store(bucket.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    d_count.store(d_count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    d_sum.store(d_sum.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+}
+
+void LatencyHistogram::addTo(HistogramSnapshot& snapshot) const {
+    for (size_t i = 0; i < d_buckets.size(); i++) {
+        snapshot.buckets[i] += d_buckets[i].load(std::memory_order_relaxed);
+    }
+    snapshot.count += d_count.load(std::memory_order_relaxed);
+    snapshot.sum += d_sum.load(std::memory_order_relaxed);
+}
+
+uint64_t MetricsSnapshot::activeConnections() const {
+    return connectionsOpened >= connectionsClosed ? connectionsOpened - connectionsClosed : 0;
+}
+
+void MetricsSnapshot::merge(const MetricsSnapshot& other) {
+    connectionsOpened += other.connectionsOpened;
+    connectionsClosed += other.connectionsClosed;
+    connectionsRejected += other.connectionsRejected;
+    requestsShed += other.requestsShed;
+    connectionsRateLimited += other.connectionsRateLimited;
+    requestsRateLimited += other.requestsRateLimited;
+    parseErrors += other.parseErrors;
+    tlsHandshakeFailures += other.tlsHandshakeFailures;
+    tlsFullHandshakes += other.tlsFullHandshakes;
+    tlsResumedHandshakes += other.tlsResumedHandshakes;
+    ktlsSendConnections += other.ktlsSendConnections;
+    ktlsFallbackConnections += other.ktlsFallbackConnections;
+    http2Connections += other.http2Connections;
+    for (size_t i = 0; i < kTimeoutKindCount; i++) {
+        connectionTimeouts[i] += other.connectionTimeouts[i];
+    }
+
+    for (const auto& [key, series] : other.requests) {
+        auto& target = requests[key];
+        target.latency.merge(series.latency);
+        target.bytesSent += series.bytesSent;
+    }
+
+    for (size_t i = 0; i < kPhaseCount; i++) {
+        phases[i].merge(other.phases[i]);
+    }
+}
+
+namespace {
+
+// Scalar counters in encoding order; a counter added to merge() belongs
+// here too.
+constexpr uint64_t MetricsSnapshot::*kEncodedCounters[] = {
+    &MetricsSnapshot::connectionsOpened,      &MetricsSnapshot::connectionsClosed,
+    &MetricsSnapshot::connectionsRejected,    &MetricsSnapshot::requestsShed,
+    &MetricsSnapshot::connectionsRateLimited, &MetricsSnapshot::requestsRateLimited,
+    &MetricsSnapshot::parseErrors,            &MetricsSnapshot::tlsHandshakeFailures,
+    &MetricsSnapshot::tlsFullHandshakes,      &MetricsSnapshot::tlsResumedHandshakes,
+    &MetricsSnapshot::ktlsSendConnections,    &MetricsSnapshot::ktlsFallbackConnections,
+    &MetricsSnapshot::http2Connections,
+};
+
+void put(std::string& out, uint64_t value) { out.append(reinterpret_cast<const char*>(&value), sizeof(value)); }
+
+void put(std::string& out, std::string_view value) {
+    put(out, value.size());
+    out.append(value);
+}
+
+// Histograms are mostly empty, so only occupied buckets are written.
+void put(std::string& out, const HistogramSnapshot& histogram) {
+    put(out, histogram.count);
+    put(out, histogram.sum);
+    const auto occupied = std::count_if(histogram.buckets.begin(), histogram.buckets.end(),
+                                        [](uint64_t bucket) { return bucket != 0; });
+    put(out, static_cast<uint64_t>(occupied));
+    for (size_t i = 0; i < histogram.buckets.size(); i++) {
+        if (histogram.buckets[i] == 0) continue;
+        put(out, i);
+        put(out, histogram.buckets[i]);
+    }
+}
+
+struct Reader {
+    std::string_view in;
+
+    bool get(uint64_t& value) {
+        if (in.size() < sizeof(value)) return false;
+        std::memcpy(&value, in.data(), sizeof(value));
+        in.remove_prefix(sizeof(value));
+        return true;
+    }
+
+    bool get(std::string& value) {
+        uint64_t size;
+        if (!get(size) || in.size() < size) return false;
+        value.assign(in.substr(0, size));
+        in.remove_prefix(size);
+        return true;
+    }
+
+    bool get(HistogramSnapshot& histogram) {
+        uint64_t occupied;
+        if (!get(histogram.count) || !get(histogram.sum) || !get(occupied)) return false;
+        for (uint64_t i = 0; i < occupied; i++) {
+            uint64_t index;
+            if (!get(index) || index >= histogram.buckets.size() || !get(histogram.buckets[index])) return false;
+        }
+        return true;
+    }
+};
+
+// Methods are client supplied, so only the standard ones get a series of
+// their own; anything else shares one, keeping the series set bounded.
+constexpr std::string_view kStandardMethods[] = {"GET",   "HEAD",    "POST",    "PUT",  "DELETE",
+                                                 "PATCH", "OPTIONS", "CONNECT", "TRACE"};
+
+std::string_view methodLabel(std::string_view method) {
+    for (std::string_view known : kStandardMethods) {
+        if (method == known) return known;
+    }
+    return Metrics::kOtherMethod;
+}
+
+} // namespace
+
+std::string MetricsSnapshot::encode() const {
+    std::string out;
+    for (auto counter : kEncodedCounters) put(out, this->*counter);
+    for (uint64_t timeouts : connectionTimeouts) put(out, timeouts);
+    for (const HistogramSnapshot& phase : phases) put(out, phase);
+
+    put(out, requests.size());
+    for (const auto& [key, series] : requests) {
+        put(out, std::get<0>(key));
+        put(out, std::get<1>(key));
+        put(out, static_cast<uint64_t>(std::get<2>(key)));
+        put(out, series.bytesSent);
+        put(out, series.latency);
+    }
+    return out;
+}
+
+bool MetricsSnapshot::decode(std::string_view in, MetricsSnapshot& snapshot) {
+    Reader reader{in};
+    snapshot = MetricsSnapshot();
+    for (auto counter : kEncodedCounters) {
+        if (!reader.get(snapshot.*counter)) return false;
+    }
+    for (uint64_t& timeouts : snapshot.connectionTimeouts) {
+        if (!reader.get(timeouts)) return false;
+    }
+    for (HistogramSnapshot& phase : snapshot.phases) {
+        if (!reader.get(phase)) return false;
+    }
+
+    uint64_t seriesCount;
+    if (!reader.get(seriesCount)) return false;
+    for (uint64_t i = 0; i < seriesCount; i++) {
+        std::string method, route;
+        uint64_t status;
+        RequestSeriesSnapshot series;
+        if (!reader.get(method) || !reader.get(route) || !reader.get(status) || !reader.get(series.bytesSent) ||
+            !reader.get(series.latency)) {
+            return false;
+        }
+        snapshot.requests[{std::move(method), std::move(route), static_cast<int>(status)}] = series;
+    }
+    return reader.in.empty();
+}
+
+struct Metrics::Shard {
+    struct Series {
+        std::string method;
+        std::string route;
+        int status;
+        LatencyHistogram latency;
+        LocalCounter bytesSent;
+    };
+
+    // Views into the strings owned by the Series the key maps to, so lookups
+    // from the request path never allocate.
+    struct Key {
+        std::string_view method;
+        std::string_view route;
+        int status;
+
+        bool operator==(const Key&) const = default;
+    };
+
+    struct KeyHash {
+        size_t operator()(const Key& key) const {
+            size_t h = std::hash<std::string_view>{}(key.route);
+            h ^= std::hash<std::string_view>{}(key.method) + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2);
+            return h ^ (static_cast<size_t>(key.status) * 0x9e3779b97f4a7c15ULL);
+        }
+    };
+
+    LocalCounter connectionsOpened;
+    LocalCounter connectionsClosed;
+    LocalCounter connectionsRejected;
+    LocalCounter requestsShed;
+    LocalCounter connectionsRateLimited;
+    LocalCounter requestsRateLimited;
+    LocalCounter parseErrors;
+    LocalCounter tlsHandshakeFailures;
+    LocalCounter tlsFullHandshakes;
+    LocalCounter tlsResumedHandshakes;
+    LocalCounter ktlsSendConnections;
+    LocalCounter ktlsFallbackConnections;
+    LocalCounter http2Connections;
+    std::array<LocalCounter, kTimeoutKindCount> connectionTimeouts;
+
+    // Only the owning thread touches 'index'; 'series' is also walked by
+    // scrapers, so appending to it takes the (otherwise uncontended) mutex.
+    std::unordered_map<Key, Series*, KeyHash> index;
+    mutable std::mutex seriesMtx;
+    std::vector<std::unique_ptr<Series>> series;
+
+    // Allocated on first use so threads that never time phases stay small.
+    using PhaseHistograms = std::array<LatencyHistogram, kPhaseCount>;
+    std::atomic<PhaseHistograms*> phases{nullptr};
+
+    ~Shard() { delete phases.load(); }
+
+    PhaseHistograms& phaseHistograms() {
+        PhaseHistograms* current = phases.load(std::memory_order_relaxed);
+        if (!current) {
+            current = new PhaseHistograms();
+            phases.store(current, std::memory_order_release);
+        }
+        return *current;
+    }
+
+    Series& find(std::string_view method, std::string_view route, int status) {
+        auto it = index.find(Key{method, route, status});
+        if (it != index.end()) return *it->second;
+
+        auto created = std::make_unique<Series>();
+        created->method = method;
+        created->route = route;
+        created->status = status;
+
+        Series* raw = created.get();
+        {
+            std::lock_guard<std::mutex> lock(seriesMtx);
+            series.push_back(std::move(created));
+        }
+        index.emplace(Key{raw->method, raw->route, status}, raw);
+        return *raw;
+    }
+
+    void addTo(MetricsSnapshot& snapshot) const {
+        snapshot.connectionsOpened += connectionsOpened.value();
+        snapshot.connectionsClosed += connectionsClosed.value();
+        snapshot.connectionsRejected += connectionsRejected.value();
+        snapshot.requestsShed += requestsShed.value();
+        snapshot.connectionsRateLimited += connectionsRateLimited.value();
+        snapshot.requestsRateLimited += requestsRateLimited.value();
+        snapshot.parseErrors += parseErrors.value();
+        snapshot.tlsHandshakeFailures += tlsHandshakeFailures.value();
+        snapshot.tlsFullHandshakes += tlsFullHandshakes.value();
+        snapshot.tlsResumedHandshakes += tlsResumedHandshakes.value();
+        snapshot.ktlsSendConnections += ktlsSendConnections.value();
+        snapshot.ktlsFallbackConnections += ktlsFallbackConnections.value();
+        snapshot.http2Connections += http2Connections.value();
+        for (size_t i = 0; i < kTimeoutKindCount; i++) {
+            snapshot.connectionTimeouts[i] += connectionTimeouts[i].value();
+        }
+
+        std::lock_guard<std::mutex> lock(seriesMtx);
+        for (const auto& entry : series) {
+            auto& target = snapshot.requests[{entry->method, entry->route, entry->status}];
+            entry->latency.addTo(target.latency);
+            target.bytesSent += entry->bytesSent.value();
+        }
+
+        if (const PhaseHistograms* histograms = phases.load(std::memory_order_acquire)) {
+            for (size_t i = 0; i < kPhaseCount; i++) {
+                (*histograms)[i].addTo(snapshot.phases[i]);
+            }
+        }
+    }
+};
+
+struct Metrics::ShardHandle {
+    Metrics& owner;
+    Shard* shard;
+
+    explicit ShardHandle(Metrics& metrics) : owner(metrics), shard(new Shard) {
+        std::lock_guard<std::mutex> lock(owner.d_mtx);
+        owner.d_shards.push_back(shard);
+    }
+
+    ~ShardHandle() { owner.retire(shard); }
+};
+
+Metrics& Metrics::instance() {
+    static Metrics metrics;
+    return metrics;
+}
+
+void Metrics::setEnabled(bool enabled) { d_enabled.store(enabled, std::memory_order_relaxed); }
+
+Metrics::Shard& Metrics::localShard() {
+    thread_local ShardHandle handle(*this);
+    return *handle.shard;
+}
+
+void Metrics::retire(Shard* shard) {
+    std::lock_guard<std::mutex> lock(d_mtx);
+    shard->addTo(d_retired);
+    std::erase(d_shards, shard);
+    delete shard;
+}
+
+void Metrics::connectionOpened() {
+    if (enabled()) localShard().connectionsOpened.add();
+}
+
+void Metrics::connectionClosed() {
+    if (enabled()) localShard().connectionsClosed.add();
+}
+
+void Metrics::connectionRejected() {
+    if (enabled()) localShard().connectionsRejected.add();
+}
+
+void Metrics::requestShed() {
+    if (enabled()) localShard().requestsShed.add();
+}
+
+void Metrics::connectionRateLimited() {
+    if (enabled()) localShard().connectionsRateLimited.add();
+}
+
+void Metrics::requestRateLimited() {
+    if (enabled()) localShard().requestsRateLimited.add();
+}
+
+void Metrics::parseError() {
+    if (enabled()) localShard().parseErrors.add();
+}
+
+void Metrics::tlsHandshakeFailed() {
+    if (enabled()) localShard().tlsHandshakeFailures.add();
+}
+
+void Metrics::tlsHandshakeCompleted(bool resumed) {
+    if (!enabled()) return;
+    auto& shard = localShard();
+    (resumed ? shard.tlsResumedHandshakes : shard.tlsFullHandshakes).add();
+}
+
+void Metrics::ktlsSendNegotiated(bool offloaded) {
+    if (!enabled()) return;
+    auto& shard = localShard();
+    (offloaded ? shard.ktlsSendConnections : shard.ktlsFallbackConnections).add();
+}
+
+void Metrics::http2Negotiated() {
+    if (enabled()) localShard().http2Connections.add();
+}
+
+void Metrics::connectionTimedOut(TimeoutKind kind) {
+    if (enabled()) localShard().connectionTimeouts[static_cast<size_t>(kind)].add();
+}
+
+void Metrics::recordRequest(std::string_view method, std::string_view route, int status, uint64_t latencyNs,
+                            uint64_t bytesSent) {
+    if (!enabled()) return;
+
+    auto& series = localShard().find(methodLabel(method), route, status);
+    series.latency.record(latencyNs);
+    series.bytesSent.add(bytesSent);
+}
+
+void Metrics::recordPhases(const std::array<uint64_t, kPhaseCount>& nanoseconds, bool includesAccept) {
+    if (!enabled()) return;
+
+    auto& histograms = localShard().phaseHistograms();
+    for (size_t i = 0; i < kPhaseCount; i++) {
+        if (i == static_cast<size_t>(Phase::Accept) && !includesAccept) continue;
+        histograms[i].record(nanoseconds[i]);
+    }
+}
+
+void Metrics::setPeers(std::function<MetricsSnapshot()> peers) {
+    std::lock_guard<std::mutex> lock(d_mtx);
+    d_peers = std::move(peers);
+}
+
+MetricsSnapshot Metrics::localSnapshot() const {
+    std::lock_guard<std::mutex> lock(d_mtx);
+    MetricsSnapshot result = d_retired;
+    for (const Shard* shard : d_shards) {
+        shard->addTo(result);
+    }
+    return result;
+}
+
+MetricsSnapshot Metrics::snapshot() const {
+    MetricsSnapshot result = localSnapshot();
+    std::function<MetricsSnapshot()> peers;
+    {
+        std::lock_guard<std::mutex> lock(d_mtx);
+        peers = d_peers;
+    }
+    if (peers) result.merge(peers());
+    return result;
+}
+
+namespace {
+
+// Prometheus bucket boundaries in seconds. HDR buckets are folded into the
+// largest boundary that fully contains them.
+constexpr double kPrometheusBuckets[] = {0.0001, 0.00025, 0.0005, 0.001, 0.0025, 0.005, 0.01, 0.025,
+                                         0.05,   0.1,     0.25,   0.5,   1.0,    2.5,   5.0,  10.0};
+
+std::string escapeLabel(std::string_view value) {
+    std::string out;
+    out.reserve(value.size());
+    for (char c : value) {
+        if (c == '\\' || c == '"') {
+            out.push_back('\\');
+            out.push_back(c);
+        } else if (c == '\n') {
+            out.append("\\n");
+        } else {
+            out.push_back(c);
+        }
+    }
+    return out;
+}
+
+std::string formatSeconds(double seconds) {
+    char buf[32];
+    std::snprintf(buf, sizeof(buf), "%g", seconds);
+    return buf;
+}
+
+void writeHeader(std::ostringstream& out, const char* name, const char* type, const char* help) {
+    out << "# HELP " << name << " " << help << "\n"
+        << "# TYPE " << name << " " << type << "\n";
+}
+
+void writeHistogram(std::ostringstream& out, const std::string& name, const std::string& label,
+                    const HistogramSnapshot& histogram) {
+    for (double le : kPrometheusBuckets) {
+        const auto leNs = static_cast<uint64_t>(le * 1e9);
+        out << name << "_bucket{" << label << ",le=\"" << formatSeconds(le) << "\"} "
+            << histogram.countAtOrBelow(leNs) << "\n";
+    }
+    out << name << "_bucket{" << label << ",le=\"+Inf\"} " << histogram.count << "\n";
+    out << name << "_sum{" << label << "} " << formatSeconds(static_cast<double>(histogram.sum) / 1e9) << "\n";
+    out << name << "_count{" << label << "} " << histogram.count << "\n";
+}
+
+} // namespace
+
+std::string Metrics::renderPrometheus() const {
+    MetricsSnapshot snap = snapshot();
+    std::ostringstream out;
+
+    writeHeader(out, "httpserver_connections_total", "counter", "Client connections accepted.");
+    out << "httpserver_connections_total " << snap.connectionsOpened << "\n";
+
+    writeHeader(out, "httpserver_active_connections", "gauge", "Client connections currently open.");
+    out << "httpserver_active_connections " << snap.activeConnections() << "\n";
+
+    writeHeader(out, "httpserver_connections_rejected_total", "counter",
+                "Connections turned away because a connection limit was reached.");
+    out << "httpserver_connections_rejected_total " << snap.connectionsRejected << "\n";
+
+    writeHeader(out, "httpserver_requests_shed_total", "counter",
+                "Requests answered 503 because they queued too long for a handler under overload.");
+    out << "httpserver_requests_shed_total " << snap.requestsShed << "\n";
+
+    writeHeader(out, "httpserver_rate_limited_total", "counter",
+                "Connections and requests refused with 429 because the client IP ran out of tokens.");
+    out << "httpserver_rate_limited_total{scope=\"connection\"} " << snap.connectionsRateLimited << "\n";
+    out << "httpserver_rate_limited_total{scope=\"request\"} " << snap.requestsRateLimited << "\n";
+
+    writeHeader(out, "httpserver_parse_errors_total", "counter", "Requests rejected as malformed.");
+    out << "httpserver_parse_errors_total " << snap.parseErrors << "\n";
+
+    writeHeader(out, "httpserver_tls_handshake_failures_total", "counter", "Failed TLS handshakes.");
+    out << "httpserver_tls_handshake_failures_total " << snap.tlsHandshakeFailures << "\n";
+
+    writeHeader(out, "httpserver_tls_handshakes_total", "counter", "Completed TLS handshakes, full or resumed.");
+    out << "httpserver_tls_handshakes_total{type=\"full\"} " << snap.tlsFullHandshakes << "\n";
+    out << "httpserver_tls_handshakes_total{type=\"resumed\"} " << snap.tlsResumedHandshakes << "\n";
+
+    writeHeader(out, "httpserver_tls_ktls_connections_total", "counter",
+                "TLS connections with kTLS requested, by whether the kernel took over sending.");
+    out << "httpserver_tls_ktls_connections_total{offload=\"active\"} " << snap.ktlsSendConnections << "\n";
+    out << "httpserver_tls_ktls_connections_total{offload=\"fallback\"} " << snap.ktlsFallbackConnections << "\n";
+
+    writeHeader(out, "httpserver_http2_connections_total", "counter", "Connections that negotiated HTTP/2 via ALPN.");
+    out << "httpserver_http2_connections_total " << snap.http2Connections << "\n";
+
+    writeHeader(out, "httpserver_connection_timeouts_total", "counter",
+                "Connections closed because a deadline expired, by deadline.");
+    for (size_t i = 0; i < kTimeoutKindCount; i++) {
+        out << "httpserver_connection_timeouts_total{deadline=\"" << timeoutKindName(static_cast<TimeoutKind>(i))
+            << "\"} " << snap.connectionTimeouts[i] << "\n";
+    }
+
+    writeHeader(out, "httpserver_request_phase_seconds", "histogram", "Time spent in each request processing phase.");
+    for (size_t p = 0; p < kPhaseCount; p++) {
+        const HistogramSnapshot& histogram = snap.phases[p];
+        if (histogram.count == 0) continue;
+
+        const std::string label = std::string("phase=\"") + phaseName(static_cast<Phase>(p)) + "\"";
+        writeHistogram(out, "httpserver_request_phase_seconds", label, histogram);
+    }
+
+    std::vector<std::string> labels;
+    labels.reserve(snap.requests.size());
+    for (const auto& [key, series] : snap.requests) {
+        const auto& [method, route, status] = key;
+        labels.push_back("method=\"" + escapeLabel(method) + "\",route=\"" + escapeLabel(route) + "\",status=\"" +
+                         std::to_string(status) + "\"");
+    }
+
+    writeHeader(out, "httpserver_requests_total", "counter", "Requests served by method, route and status.");
+    size_t i = 0;
+    for (const auto& [key, series] : snap.requests) {
+        out << "httpserver_requests_total{" << labels[i++] << "} " << series.latency.count << "\n";
+    }
+
+    writeHeader(out, "httpserver_response_bytes_total", "counter", "Response bytes written.");
+    i = 0;
+    for (const auto& [key, series] : snap.requests) {
+        out << "httpserver_response_bytes_total{" << labels[i++] << "} " << series.bytesSent << "\n";
+    }
+
+    writeHeader(out, "httpserver_request_duration_seconds", "histogram", "Time from request receipt to response sent.");
+    i = 0;
+    for (const auto& [key, series] : snap.requests) {
+        writeHistogram(out, "httpserver_request_duration_seconds", labels[i++], series.latency);
+    }
+
+    return out.str();
+}
+
+} // namespace HTTPServer
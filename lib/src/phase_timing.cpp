@@ -0,0 +1,134 @@
+#include "httpserver/phase_timing.h"
+
+#include <time.h>
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <thread>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HTTPSERVER_HAS_TSC 1
+#endif
+
+namespace HTTPServer {
+
+namespace {
+
+uint64_t readClock(clockid_t id) {
+    timespec ts{};
+    clock_gettime(id, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000ULL + static_cast<uint64_t>(ts.tv_nsec);
+}
+
+} // namespace
+
+const char* phaseName(Phase phase) {
+    switch (phase) {
+    case Phase::Accept:
+        return "accept";
+    case Phase::Recv:
+        return "recv";
+    case Phase::Parse:
+        return "parse";
+    case Phase::Route:
+        return "route";
+    case Phase::Handler:
+        return "handler";
+    case Phase::Send:
+        return "send";
+    default:
+        return "unknown";
+    }
+}
+
+PhaseTiming& PhaseTiming::instance() {
+    static PhaseTiming timing;
+    return timing;
+}
+
+void PhaseTiming::enable(TimingClock clock) {
+#ifndef HTTPSERVER_HAS_TSC
+    if (clock == TimingClock::Tsc) clock = TimingClock::Monotonic;
+#endif
+    if (clock == TimingClock::Tsc && d_tscNsPerTick.load() == 0.0) {
+        calibrateTsc();
+    }
+    d_clock.store(clock, std::memory_order_relaxed);
+    d_enabled.store(true, std::memory_order_relaxed);
+}
+
+void PhaseTiming::disable() { d_enabled.store(false, std::memory_order_relaxed); }
+
+void PhaseTiming::setServerTimingHeader(bool enabled) {
+    d_serverTimingHeader.store(enabled, std::memory_order_relaxed);
+}
+
+uint64_t PhaseTiming::now(TimingClock clock) {
+    switch (clock) {
+#ifdef HTTPSERVER_HAS_TSC
+    case TimingClock::Tsc:
+        return __rdtsc();
+#endif
+    case TimingClock::MonotonicCoarse:
+        return readClock(CLOCK_MONOTONIC_COARSE);
+    default:
+        return readClock(CLOCK_MONOTONIC);
+    }
+}
+
+double PhaseTiming::nanosecondsPerTick(TimingClock clock) const {
+    if (clock != TimingClock::Tsc) return 1.0;
+    return d_tscNsPerTick.load(std::memory_order_relaxed);
+}
+
+void PhaseTiming::calibrateTsc() {
+#ifdef HTTPSERVER_HAS_TSC
+    const uint64_t startNs = readClock(CLOCK_MONOTONIC);
+    const uint64_t startTicks = __rdtsc();
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    const uint64_t elapsedNs = readClock(CLOCK_MONOTONIC) - startNs;
+    const uint64_t elapsedTicks = __rdtsc() - startTicks;
+
+    d_tscNsPerTick.store(elapsedTicks ? static_cast<double>(elapsedNs) / static_cast<double>(elapsedTicks) : 1.0);
+#endif
+}
+
+PhaseRecorder::PhaseRecorder(bool active) : d_active(active) {
+    if (!d_active) return;
+
+    d_clock = PhaseTiming::instance().clock();
+    d_nsPerTick = PhaseTiming::instance().nanosecondsPerTick(d_clock);
+}
+
+uint64_t PhaseRecorder::nanoseconds(Phase phase) const {
+    return static_cast<uint64_t>(static_cast<double>(d_ticks[static_cast<size_t>(phase)]) * d_nsPerTick);
+}
+
+std::array<uint64_t, kPhaseCount> PhaseRecorder::nanoseconds() const {
+    std::array<uint64_t, kPhaseCount> result{};
+    for (size_t i = 0; i < kPhaseCount; i++) {
+        result[i] = nanoseconds(static_cast<Phase>(i));
+    }
+    return result;
+}
+
+// Formats every phase completed before the response is serialized, i.e. all
+// but Send, as durations in milliseconds (https://w3c.github.io/server-timing/).
+std::string PhaseRecorder::serverTimingHeader() const {
+    std::string header;
+    for (size_t i = 0; i < kPhaseCount; i++) {
+        const auto phase = static_cast<Phase>(i);
+        if (phase == Phase::Send) continue;
+        if (phase == Phase::Accept && d_ticks[i] == 0) continue;
+
+        char entry[48];
+        std::snprintf(entry, sizeof(entry), "%s%s;dur=%.3f", header.empty() ? "" : ", ", phaseName(phase),
+                      static_cast<double>(nanoseconds(phase)) / 1e6);
+        header.append(entry);
+    }
+    return header;
+}
+
+} // namespace HTTPServer
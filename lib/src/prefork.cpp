@@ -0,0 +1,135 @@
+#include "httpserver/prefork.h"
+
+#include <sys/mman.h>
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+
+#include "httpserver/logger.h"
+
+namespace HTTPServer {
+
+struct SharedMetrics::Slot {
+    // Odd while the slot is being written.
+    std::atomic<uint64_t> sequence;
+    std::atomic<uint64_t> size;
+    char data[kSlotBytes];
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "slots are shared between processes");
+
+SharedMetrics::~SharedMetrics() {
+    detach();
+    if (d_mapping) munmap(d_mapping, d_mappedSize);
+}
+
+bool SharedMetrics::create(size_t workers) {
+    // One slot per worker and one for the metrics of workers that exited.
+    d_mappedSize = (workers + 1) * sizeof(Slot);
+    void* mapping = mmap(nullptr, d_mappedSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (mapping == MAP_FAILED) {
+        LOG_ERROR_ERRNO("Prefork: Failed to map shared metrics");
+        return false;
+    }
+    d_mapping = mapping;
+    d_workers = workers;
+    return true;
+}
+
+SharedMetrics::Slot* SharedMetrics::slot(size_t index) const { return static_cast<Slot*>(d_mapping) + index; }
+
+void SharedMetrics::attach(size_t worker, std::chrono::milliseconds interval) {
+    d_self = worker;
+    d_stopping = false;
+    Metrics::instance().setPeers([this]() { return collect(d_self); });
+    d_publisher = std::thread([this, interval]() {
+        std::unique_lock<std::mutex> lock(d_mtx);
+        bool stopping = false;
+        while (!stopping) {
+            stopping = d_cv.wait_for(lock, interval, [this]() { return d_stopping; });
+            publish(d_self, Metrics::instance().localSnapshot());
+        }
+    });
+}
+
+void SharedMetrics::detach() {
+    if (!d_publisher.joinable()) return;
+    {
+        std::lock_guard<std::mutex> lock(d_mtx);
+        d_stopping = true;
+    }
+    d_cv.notify_one();
+    d_publisher.join();
+    Metrics::instance().setPeers({});
+}
+
+void SharedMetrics::retire(size_t worker) {
+    MetricsSnapshot last;
+    if (read(worker, last)) {
+        last.connectionsClosed = last.connectionsOpened;
+        MetricsSnapshot retired;
+        read(d_workers, retired);
+        retired.merge(last);
+        publish(d_workers, retired);
+    }
+    publish(worker, MetricsSnapshot());
+}
+
+MetricsSnapshot SharedMetrics::collect(size_t exclude) const {
+    MetricsSnapshot result;
+    for (size_t i = 0; i <= d_workers; i++) {
+        MetricsSnapshot peer;
+        if (i != exclude && read(i, peer)) result.merge(peer);
+    }
+    return result;
+}
+
+// A snapshot that outgrows the slot loses its request series, but keeps the
+// counters, which are what capacity and error dashboards sum across workers.
+void SharedMetrics::publish(size_t index, const MetricsSnapshot& snapshot) {
+    std::string encoded = snapshot.encode();
+    if (encoded.size() > kSlotBytes) {
+        MetricsSnapshot trimmed = snapshot;
+        trimmed.requests.clear();
+        encoded = trimmed.encode();
+        if (!d_trimmed.exchange(true))
+            LOG_WARN("Prefork: Request metrics of worker [" + std::to_string(index) +
+                     "] no longer fit in shared memory, publishing counters only");
+    }
+
+    // Already odd only if a worker died mid-write; the supervisor then
+    // finishes the write in its place.
+    Slot* target = slot(index);
+    uint64_t writing = target->sequence.load(std::memory_order_relaxed);
+    writing |= 1;
+    target->sequence.store(writing, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    std::memcpy(target->data, encoded.data(), encoded.size());
+    target->size.store(encoded.size(), std::memory_order_relaxed);
+    target->sequence.store(writing + 1, std::memory_order_release);
+}
+
+bool SharedMetrics::read(size_t index, MetricsSnapshot& snapshot) const {
+    const Slot* source = slot(index);
+    std::string encoded;
+    // Bounded, as a worker that died mid-write leaves its slot odd until the
+    // supervisor retires it.
+    for (int attempt = 0; attempt < kReadAttempts; attempt++) {
+        const uint64_t before = source->sequence.load(std::memory_order_acquire);
+        if (before == 0) return false; // never published
+        if (before & 1) {
+            std::this_thread::yield();
+            continue;
+        }
+        const size_t size = std::min<uint64_t>(source->size.load(std::memory_order_relaxed), kSlotBytes);
+        encoded.assign(source->data, size);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (source->sequence.load(std::memory_order_relaxed) == before) {
+            return MetricsSnapshot::decode(encoded, snapshot);
+        }
+    }
+    return false;
+}
+
+} // namespace HTTPServer
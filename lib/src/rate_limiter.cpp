@@ -0,0 +1,156 @@
+#include "httpserver/rate_limiter.h"
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <random>
+
+#include "httpserver/metrics.h"
+#include "httpserver/phase_timing.h"
+
+namespace HTTPServer {
+
+namespace {
+
+constexpr std::string_view kRejectionBody = "429 Too Many Requests";
+constexpr int kClaimAttempts = 4;
+
+std::string rejectionResponse(std::chrono::seconds retryAfter) {
+    return "HTTP/1.1 429 Too Many Requests\r\n"
+           "Content-Type: text/plain\r\n"
+           "Content-Length: " +
+           std::to_string(kRejectionBody.size()) +
+           "\r\n"
+           "Retry-After: " +
+           std::to_string(retryAfter.count()) +
+           "\r\n"
+           "Connection: close\r\n"
+           "\r\n" +
+           std::string(kRejectionBody);
+}
+
+uint64_t mix(uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+// Bucket arithmetic stays exact however coarse the clock, and a tick of a
+// few milliseconds only lets a refill land that much later; the coarse clock
+// is read from the vDSO without touching the hardware counter.
+uint64_t nowNs() { return PhaseTiming::now(TimingClock::MonotonicCoarse); }
+
+} // namespace
+
+void RateLimiter::configure(const RateLimits& limits) {
+    d_limits = limits;
+    d_connections = toBucket(limits.connections);
+    d_requests = toBucket(limits.requests);
+    d_rejection = rejectionResponse(limits.retryAfter);
+
+    d_entries.reset();
+    d_sets = 0;
+    if (d_connections.interval == 0 && d_requests.interval == 0) return;
+
+    d_sets = std::bit_ceil(std::max<size_t>(limits.maxClients / kWays, 1));
+    d_entries = std::make_unique<Entry[]>(d_sets * kWays);
+    d_seed = (static_cast<uint64_t>(std::random_device{}()) << 32) ^ std::random_device{}();
+}
+
+RateLimiter::Bucket RateLimiter::toBucket(const RateLimit& limit) {
+    if (limit.perSecond <= 0) return {};
+    Bucket bucket;
+    bucket.interval = std::max<uint64_t>(static_cast<uint64_t>(1e9 / limit.perSecond), 1);
+    bucket.tolerance = static_cast<uint64_t>((std::max(limit.burst, 1.0) - 1) * static_cast<double>(bucket.interval));
+    return bucket;
+}
+
+// GCRA: the bucket is empty while the theoretical arrival time of the next
+// token runs further ahead of now than the burst allows; each token taken
+// pushes it out by one interval.
+bool RateLimiter::take(std::atomic<uint64_t>& tat, const Bucket& bucket, uint64_t now) {
+    if (bucket.interval == 0) return true;
+    uint64_t current = tat.load(std::memory_order_relaxed);
+    uint64_t next;
+    do {
+        const uint64_t base = std::max(current, now);
+        if (base - now > bucket.tolerance) return false;
+        next = base + bucket.interval;
+    } while (!tat.compare_exchange_weak(current, next, std::memory_order_relaxed));
+    return true;
+}
+
+// IPv6 clients are keyed by their /64, the smallest block a subscriber is
+// usually handed, so rotating through one's own addresses gains nothing.
+RateLimiter::Entry& RateLimiter::find(const ClientAddress& address, uint64_t now) {
+    uint64_t prefix, suffix;
+    std::memcpy(&prefix, address.bytes.data(), sizeof(prefix));
+    std::memcpy(&suffix, address.bytes.data() + sizeof(prefix), sizeof(suffix));
+    if (!address.isIPv4()) suffix = 0;
+    const uint64_t hash = mix(mix(prefix ^ d_seed) ^ suffix);
+    const uint64_t key = hash | 1;
+    Entry* set = &d_entries[((hash >> 32) & (d_sets - 1)) * kWays];
+
+    Entry* victim = set;
+    for (int attempt = 0; attempt < kClaimAttempts; attempt++) {
+        uint64_t oldest = UINT64_MAX;
+        for (size_t way = 0; way < kWays; way++) {
+            Entry& entry = set[way];
+            const uint64_t entryKey = entry.key.load(std::memory_order_relaxed);
+            if (entryKey == key) {
+                entry.lastSeen.store(now, std::memory_order_relaxed);
+                return entry;
+            }
+            const uint64_t seen = entryKey ? entry.lastSeen.load(std::memory_order_relaxed) : 0;
+            if (seen < oldest) {
+                oldest = seen;
+                victim = &entry;
+            }
+        }
+
+        // Another thread may claim the same victim; the loser rescans, as the
+        // winner may well have been inserting this very address.
+        uint64_t victimKey = victim->key.load(std::memory_order_relaxed);
+        if (victimKey != key && victim->key.compare_exchange_strong(victimKey, key, std::memory_order_relaxed)) {
+            victim->connectionsTat.store(0, std::memory_order_relaxed);
+            victim->requestsTat.store(0, std::memory_order_relaxed);
+            victim->lastSeen.store(now, std::memory_order_relaxed);
+            return *victim;
+        }
+    }
+    // Only reachable under a storm of claims on one set; borrowing another
+    // client's bucket for a single check does no lasting harm.
+    return *victim;
+}
+
+bool RateLimiter::allowConnection(const ClientAddress& address) {
+    if (!enabled() || d_connections.interval == 0 || address.unixSocket) return true;
+    const uint64_t now = nowNs();
+    if (take(find(address, now).connectionsTat, d_connections, now)) return true;
+    Metrics::instance().connectionRateLimited();
+    return false;
+}
+
+bool RateLimiter::allowRequest(const ClientAddress& address) {
+    if (!enabled() || d_requests.interval == 0 || address.unixSocket) return true;
+    const uint64_t now = nowNs();
+    if (take(find(address, now).requestsTat, d_requests, now)) return true;
+    Metrics::instance().requestRateLimited();
+    return false;
+}
+
+void RateLimiter::reject(int fd, bool sendResponse) const {
+    if (sendResponse) {
+        [[maybe_unused]] ssize_t sent =
+            send(fd, d_rejection.data(), d_rejection.size(), MSG_DONTWAIT | MSG_NOSIGNAL);
+        shutdown(fd, SHUT_WR);
+    }
+    close(fd);
+}
+
+} // namespace HTTPServer
@@ -0,0 +1,388 @@
+#include "httpserver/redirect_listener.h"
+
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <array>
+#include <cctype>
+#include <cerrno>
+#include <cstring>
+#include <memory_resource>
+
+#include "httpserver/http_object.h"
+#include "httpserver/http_parser.h"
+#include "httpserver/logger.h"
+#include "httpserver/utils.h"
+
+namespace HTTPServer {
+
+namespace {
+
+constexpr int kMaxEvents = 64;
+
+constexpr std::string_view kResponseSuffix = "\r\n\r\nRedirecting to HTTPS...";
+constexpr std::string_view kBadRequest = "HTTP/1.1 400 Bad Request\r\n"
+                                         "Content-Type: text/plain\r\n"
+                                         "Content-Length: 15\r\n"
+                                         "Connection: close\r\n"
+                                         "\r\n"
+                                         "400 Bad Request";
+
+std::string responsePrefix(std::string_view connection) {
+    std::string prefix = "HTTP/1.1 301 Moved Permanently\r\n"
+                         "Content-Type: text/plain\r\n"
+                         "Content-Length: ";
+    prefix.append(std::to_string(kResponseSuffix.size() - 4));
+    prefix.append("\r\nConnection: ").append(connection);
+    prefix.append("\r\nLocation: https://");
+    return prefix;
+}
+
+// The Host header without its port. Anything but a name or an address
+// literal yields an empty view, so nothing from the client other than those
+// characters is ever copied into the Location header.
+std::string_view redirectHost(std::string_view host) {
+    if (host.starts_with('[')) {
+        size_t end = host.find(']');
+        if (end == std::string_view::npos) return {};
+        host = host.substr(0, end + 1);
+    } else {
+        host = host.substr(0, host.find(':'));
+    }
+    for (char c : host) {
+        if (!std::isalnum(static_cast<unsigned char>(c)) && c != '-' && c != '.' && c != '[' && c != ']' &&
+            c != ':') {
+            return {};
+        }
+    }
+    return host;
+}
+
+// Request target as sent, query string included; origin-form only.
+std::string_view requestTarget(std::string_view head) {
+    size_t start = head.find(' ');
+    if (start == std::string_view::npos) return "/";
+    size_t end = head.find_first_of(" \r\n", start + 1);
+    std::string_view target = head.substr(start + 1, end == std::string_view::npos ? end : end - start - 1);
+    if (!target.starts_with('/')) return "/";
+    for (char c : target) {
+        if (static_cast<unsigned char>(c) <= 0x20 || c == 0x7f) return "/";
+    }
+    return target;
+}
+
+} // namespace
+
+RedirectListener::RedirectListener(const Port& httpsPort, std::chrono::milliseconds idleTimeout,
+                                   ListenerAdmission* admission)
+    : d_keepAlivePrefix(responsePrefix("keep-alive")),
+      d_closePrefix(responsePrefix("close")),
+      d_portSuffix(httpsPort.value() == 443 ? "" : ":" + httpsPort.toString()),
+      d_idleTimeout(idleTimeout),
+      d_admission(admission),
+      d_wakeFd(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) {}
+
+RedirectListener::~RedirectListener() {
+    if (d_wakeFd >= 0) close(d_wakeFd);
+}
+
+void RedirectListener::stop() {
+    d_stopping = true;
+    const uint64_t one = 1;
+    [[maybe_unused]] ssize_t ignored = write(d_wakeFd, &one, sizeof(one));
+}
+
+void RedirectListener::run(int listenFd) {
+    fcntl(listenFd, F_SETFL, fcntl(listenFd, F_GETFL) | O_NONBLOCK);
+    d_listenFd = listenFd;
+    d_epollFd = epoll_create1(EPOLL_CLOEXEC);
+    if (d_epollFd < 0) {
+        LOG_ERROR_ERRNO("Redirection Server: Fatal: epoll_create1 failed");
+        close(listenFd);
+        return;
+    }
+
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.fd = listenFd;
+    epoll_ctl(d_epollFd, EPOLL_CTL_ADD, listenFd, &event);
+    event.data.fd = d_wakeFd;
+    epoll_ctl(d_epollFd, EPOLL_CTL_ADD, d_wakeFd, &event);
+
+    std::array<epoll_event, kMaxEvents> events;
+    while (!d_stopping) {
+        // Wake once per wheel tick only while there are deadlines to expire,
+        // or while paused to notice slots freed by other listeners.
+        const int timeout = d_idleTimers.empty() && !d_acceptPaused
+                                ? -1
+                                : static_cast<int>(d_idleTimers.resolution().count());
+        const int ready = epoll_wait(d_epollFd, events.data(), kMaxEvents, timeout);
+        if (ready < 0) {
+            if (errno == EINTR) continue;
+            LOG_ERROR_ERRNO("Redirection Server: epoll_wait failed");
+            break;
+        }
+
+        for (int i = 0; i < ready; i++) {
+            const int fd = events[i].data.fd;
+            if (fd == listenFd) {
+                acceptClients();
+                continue;
+            }
+            if (fd == d_wakeFd) continue;
+
+            auto it = d_connections.find(fd);
+            if (it == d_connections.end()) continue;
+            Connection& connection = *it->second;
+            if (events[i].events & EPOLLOUT) {
+                onWritable(connection);
+            } else if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+                onReadable(connection);
+            }
+        }
+
+        d_idleTimers.advance(TimerWheel::Clock::now(), [this](TimerWheel::Timer& timer) {
+            const int fd = static_cast<Connection&>(timer).fd;
+            LOG_INFO("Redirection Server: Client [" + std::to_string(fd) + "] idle timeout reached, closing");
+            closeConnection(fd);
+        });
+        if (d_acceptPaused && d_admission->hasCapacity()) setAcceptPaused(false);
+    }
+
+    while (!d_connections.empty()) {
+        closeConnection(d_connections.begin()->first);
+    }
+    close(listenFd);
+    d_listenFd = -1;
+    close(d_epollFd);
+    d_epollFd = -1;
+}
+
+void RedirectListener::acceptClients() {
+    while (true) {
+        if (d_admission && d_admission->action() == OverloadAction::PauseAccept && !d_admission->hasCapacity()) {
+            setAcceptPaused(true);
+            return;
+        }
+
+        const int fd = accept4(d_listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR) continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                LOG_ERROR_ERRNO("Redirection Server: accept failed");
+            }
+            return;
+        }
+        if (d_admission && !d_admission->tryAdmit()) {
+            d_admission->reject(fd, true);
+            continue;
+        }
+
+        auto connection = std::make_unique<Connection>();
+        connection->fd = fd;
+
+        epoll_event event{};
+        event.events = EPOLLIN;
+        event.data.fd = fd;
+        if (epoll_ctl(d_epollFd, EPOLL_CTL_ADD, fd, &event) < 0) {
+            LOG_ERROR_ERRNO("Redirection Server: epoll_ctl failed");
+            close(fd);
+            if (d_admission) d_admission->release();
+            continue;
+        }
+        touch(*connection);
+        d_connections.emplace(fd, std::move(connection));
+        d_connectionCount.fetch_add(1, std::memory_order_relaxed);
+        LOG_INFO("Accepted client [" + std::to_string(fd) + "] on redirect server");
+    }
+}
+
+void RedirectListener::onReadable(Connection& connection) {
+    const int fd = connection.fd;
+    while (!connection.closeAfterWrite) {
+        if (!connection.in) connection.in = BufferPool::instance().acquire(kMaxRequestHead);
+        const size_t space = connection.in.capacity() - connection.buffered;
+        if (space == 0) {
+            sendBadRequest(connection);
+            return;
+        }
+
+        const ssize_t bytes = recv(fd, connection.in.data() + connection.buffered, space, 0);
+        if (bytes < 0 && errno == EINTR) continue;
+        if (bytes < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+        if (bytes <= 0) {
+            closeConnection(fd);
+            return;
+        }
+
+        connection.buffered += static_cast<size_t>(bytes);
+        touch(connection);
+        if (!processRequests(connection)) return;
+        if (!connection.out.empty()) return; // resumes once the socket drains
+    }
+    if (connection.buffered == 0) connection.in.reset();
+}
+
+void RedirectListener::onWritable(Connection& connection) {
+    const int fd = connection.fd;
+    while (connection.outOffset < connection.out.size()) {
+        const ssize_t bytes = ::send(fd, connection.out.data() + connection.outOffset,
+                                     connection.out.size() - connection.outOffset, MSG_NOSIGNAL);
+        if (bytes < 0 && errno == EINTR) continue;
+        if (bytes < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return;
+        if (bytes <= 0) {
+            closeConnection(fd);
+            return;
+        }
+        connection.outOffset += static_cast<size_t>(bytes);
+        touch(connection);
+    }
+
+    connection.out.clear();
+    connection.outOffset = 0;
+    if (connection.closeAfterWrite) {
+        closeConnection(fd);
+        return;
+    }
+
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.fd = fd;
+    epoll_ctl(d_epollFd, EPOLL_CTL_MOD, fd, &event);
+    // Requests pipelined behind the one that filled the socket.
+    if (processRequests(connection) && connection.buffered == 0) connection.in.reset();
+}
+
+// Answers every complete request in the buffer. Returns false once the
+// connection has been closed.
+bool RedirectListener::processRequests(Connection& connection) {
+    while (connection.buffered > 0 && connection.out.empty()) {
+        const std::string_view buffered(connection.in.data(), connection.buffered);
+        const RequestFrame frame = HttpParser::frame(buffered);
+        if (!frame.headersComplete) return true;
+
+        const int fd = connection.fd;
+        if (frame.totalBytes() > connection.in.capacity()) {
+            // A body too large to buffer is not worth reading just to skip it.
+            respond(connection, buffered.substr(0, frame.headerBytes), true);
+            return d_connections.count(fd) != 0;
+        }
+        if (connection.buffered < frame.totalBytes()) return true;
+
+        respond(connection, buffered.substr(0, frame.headerBytes), false);
+        if (!d_connections.count(fd)) return false;
+
+        connection.buffered -= frame.totalBytes();
+        std::memmove(connection.in.data(), connection.in.data() + frame.totalBytes(), connection.buffered);
+        if (connection.closeAfterWrite) return true;
+    }
+    return true;
+}
+
+void RedirectListener::respond(Connection& connection, std::string_view head, bool forceClose) {
+    // Request strings are short lived; keep them off the heap.
+    std::array<std::byte, 2048> arenaBytes;
+    std::pmr::monotonic_buffer_resource arena(arenaBytes.data(), arenaBytes.size());
+    HttpRequest request(&arena);
+    if (HttpParser::parse(head, request) != ParseError::NONE) {
+        sendBadRequest(connection);
+        return;
+    }
+
+    std::string_view host = "localhost";
+    auto hostIt = request.headers.find(std::string_view("Host"));
+    if (hostIt != request.headers.end()) {
+        host = redirectHost(hostIt->second);
+        if (host.empty()) {
+            sendBadRequest(connection);
+            return;
+        }
+    }
+    send(connection, host, requestTarget(head), !forceClose && requestWantsKeepAlive(request));
+}
+
+void RedirectListener::send(Connection& connection, std::string_view host, std::string_view target,
+                            bool keepAlive) {
+    const std::string& prefix = keepAlive ? d_keepAlivePrefix : d_closePrefix;
+    std::array<iovec, 5> iov = {{
+        {const_cast<char*>(prefix.data()), prefix.size()},
+        {const_cast<char*>(host.data()), host.size()},
+        {const_cast<char*>(d_portSuffix.data()), d_portSuffix.size()},
+        {const_cast<char*>(target.data()), target.size()},
+        {const_cast<char*>(kResponseSuffix.data()), kResponseSuffix.size()},
+    }};
+    connection.closeAfterWrite = !keepAlive;
+
+    msghdr message{};
+    message.msg_iov = iov.data();
+    message.msg_iovlen = iov.size();
+    ssize_t sent = sendmsg(connection.fd, &message, MSG_NOSIGNAL);
+    if (sent < 0) {
+        if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+            closeConnection(connection.fd);
+            return;
+        }
+        sent = 0;
+    }
+
+    // Keep whatever the socket did not take and wait until it is writable.
+    size_t skip = static_cast<size_t>(sent);
+    for (const iovec& part : iov) {
+        if (skip >= part.iov_len) {
+            skip -= part.iov_len;
+            continue;
+        }
+        connection.out.append(static_cast<const char*>(part.iov_base) + skip, part.iov_len - skip);
+        skip = 0;
+    }
+
+    if (!connection.out.empty()) {
+        epoll_event event{};
+        event.events = EPOLLOUT;
+        event.data.fd = connection.fd;
+        epoll_ctl(d_epollFd, EPOLL_CTL_MOD, connection.fd, &event);
+    } else if (!keepAlive) {
+        closeConnection(connection.fd);
+    }
+}
+
+void RedirectListener::sendBadRequest(Connection& connection) {
+    // Best effort, the connection is closed either way.
+    [[maybe_unused]] ssize_t sent = ::send(connection.fd, kBadRequest.data(), kBadRequest.size(), MSG_NOSIGNAL);
+    closeConnection(connection.fd);
+}
+
+// While paused the listening socket stays registered without events, so
+// pending connections wait in the kernel backlog.
+void RedirectListener::setAcceptPaused(bool paused) {
+    epoll_event event{};
+    event.events = paused ? 0u : static_cast<uint32_t>(EPOLLIN);
+    event.data.fd = d_listenFd;
+    epoll_ctl(d_epollFd, EPOLL_CTL_MOD, d_listenFd, &event);
+    d_acceptPaused = paused;
+}
+
+// Restarts the idle deadline; any request bytes read or response bytes
+// accepted by the socket count as activity.
+void RedirectListener::touch(Connection& connection) {
+    d_idleTimers.schedule(connection, TimerWheel::Clock::now() + d_idleTimeout);
+}
+
+void RedirectListener::closeConnection(int fd) {
+    auto it = d_connections.find(fd);
+    if (it == d_connections.end()) return;
+    d_idleTimers.cancel(*it->second);
+    d_connections.erase(it);
+    // Counted out before the close, so a client that sees the close also
+    // sees the count without it.
+    if (d_admission) d_admission->release();
+    d_connectionCount.fetch_sub(1, std::memory_order_relaxed);
+    close(fd);
+    LOG_INFO("Client [" + std::to_string(fd) + "] disconnected from redirect server");
+}
+
+} // namespace HTTPServer
@@ -0,0 +1,479 @@
+#include "httpserver/reverse_proxy.h"
+
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <cstring>
+#include <optional>
+#include <utility>
+
+#include "httpserver/http_response_builder.h"
+#include "httpserver/io_scheduler.h"
+#include "httpserver/logger.h"
+#include "httpserver/utils.h"
+
+namespace HTTPServer {
+
+namespace {
+
+constexpr size_t kMaxResponseHead = 64 * 1024;
+constexpr size_t kReadChunk = 16 * 1024;
+
+std::string_view trim(std::string_view s) {
+    while (!s.empty() && (s.front() == ' ' || s.front() == '\t')) s.remove_prefix(1);
+    while (!s.empty() && (s.back() == ' ' || s.back() == '\t')) s.remove_suffix(1);
+    return s;
+}
+
+// Headers that describe one connection rather than the message, and so stop
+// at the proxy (RFC 9110 section 7.6.1), together with any the 'connection'
+// header names. Content-Length is recomputed for the body actually sent.
+bool isHopByHop(std::string_view name, std::string_view connection) {
+    static constexpr std::string_view kHopByHop[] = {
+        "connection", "keep-alive", "proxy-connection", "proxy-authenticate", "proxy-authorization",
+        "te",         "trailer",    "transfer-encoding", "upgrade",           "content-length",
+    };
+    for (std::string_view hop : kHopByHop) {
+        if (equalsIgnoreCase(name, hop)) return true;
+    }
+    return hasToken(connection, name);
+}
+
+bool isIdempotent(std::string_view method) {
+    return method == "GET" || method == "HEAD" || method == "PUT" || method == "DELETE" || method == "OPTIONS";
+}
+
+void closeFd(int fd) {
+    if (fd >= 0) ::close(fd);
+}
+
+} // namespace
+
+ReverseProxy::ReverseProxy(const ProxyOptions& options) : d_options(options) {
+    for (const std::string& spec : d_options.upstreams) {
+        auto upstream = std::make_unique<Upstream>();
+        if (!resolve(spec, *upstream)) {
+            LOG_ERROR("Proxy: Ignoring upstream [" + spec + "], cannot resolve it");
+            continue;
+        }
+        d_upstreams.push_back(std::move(upstream));
+    }
+}
+
+ReverseProxy::~ReverseProxy() {
+    for (const auto& upstream : d_upstreams) {
+        for (int fd : upstream->idle) closeFd(fd);
+    }
+}
+
+bool ReverseProxy::resolve(std::string_view spec, Upstream& upstream) {
+    upstream.name = spec;
+    upstream.authority = spec;
+    if (spec.starts_with("unix:")) {
+        const std::string_view path = spec.substr(5);
+        sockaddr_un address{};
+        if (path.empty() || path.size() >= sizeof(address.sun_path)) return false;
+        address.sun_family = AF_UNIX;
+        path.copy(address.sun_path, path.size());
+        std::memcpy(&upstream.address, &address, sizeof(address));
+        upstream.addressLength = static_cast<socklen_t>(offsetof(sockaddr_un, sun_path) + path.size() + 1);
+        upstream.authority = "localhost";
+        return true;
+    }
+
+    std::string host;
+    std::string port;
+    if (spec.starts_with('[')) {
+        const size_t close = spec.find("]:");
+        if (close == std::string_view::npos) return false;
+        host = spec.substr(1, close - 1);
+        port = spec.substr(close + 2);
+    } else {
+        const size_t colon = spec.rfind(':');
+        if (colon == std::string_view::npos) return false;
+        host = spec.substr(0, colon);
+        port = spec.substr(colon + 1);
+    }
+    if (host.empty() || port.empty()) return false;
+
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* results = nullptr;
+    if (getaddrinfo(host.c_str(), port.c_str(), &hints, &results) != 0 || !results) return false;
+    std::memcpy(&upstream.address, results->ai_addr, results->ai_addrlen);
+    upstream.addressLength = results->ai_addrlen;
+    freeaddrinfo(results);
+    return true;
+}
+
+size_t ReverseProxy::idleConnections() const {
+    size_t idle = 0;
+    for (const auto& upstream : d_upstreams) {
+        std::lock_guard<std::mutex> lock(upstream->mtx);
+        idle += upstream->idle.size();
+    }
+    return idle;
+}
+
+ReverseProxy::Upstream* ReverseProxy::pick() {
+    const size_t count = d_upstreams.size();
+    const size_t start = d_next.fetch_add(1, std::memory_order_relaxed);
+    const Clock::rep now = Clock::now().time_since_epoch().count();
+
+    Upstream* best = nullptr;
+    for (size_t i = 0; i < count; i++) {
+        Upstream* upstream = d_upstreams[(start + i) % count].get();
+        if (upstream->ejectedUntil.load(std::memory_order_relaxed) > now) continue;
+        if (d_options.balancing == LoadBalancing::RoundRobin) return upstream;
+        if (!best || upstream->active.load(std::memory_order_relaxed) < best->active.load(std::memory_order_relaxed))
+            best = upstream;
+    }
+    return best ? best : d_upstreams[start % count].get();
+}
+
+int ReverseProxy::takeIdle(Upstream& upstream) {
+    while (true) {
+        int fd;
+        {
+            std::lock_guard<std::mutex> lock(upstream.mtx);
+            if (upstream.idle.empty()) return -1;
+            fd = upstream.idle.back();
+            upstream.idle.pop_back();
+        }
+        // An idle connection has nothing to say: anything readable means the
+        // upstream closed it (or sent something unsolicited) while it sat in
+        // the pool.
+        char byte;
+        if (recv(fd, &byte, 1, MSG_PEEK | MSG_DONTWAIT) < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return fd;
+        closeFd(fd);
+    }
+}
+
+void ReverseProxy::putIdle(Upstream& upstream, int fd) {
+    {
+        std::lock_guard<std::mutex> lock(upstream.mtx);
+        if (upstream.idle.size() < d_options.maxIdlePerUpstream) {
+            upstream.idle.push_back(fd);
+            return;
+        }
+    }
+    closeFd(fd);
+}
+
+void ReverseProxy::succeeded(Upstream& upstream) { upstream.failures.store(0, std::memory_order_relaxed); }
+
+void ReverseProxy::failed(Upstream& upstream) {
+    if (upstream.failures.fetch_add(1, std::memory_order_relaxed) + 1 < d_options.maxFails) return;
+    upstream.failures.store(0, std::memory_order_relaxed);
+    const auto until = Clock::now() + d_options.ejectFor;
+    upstream.ejectedUntil.store(until.time_since_epoch().count(), std::memory_order_relaxed);
+    LOG_WARN("Proxy: Ejecting upstream [" + upstream.name + "] for " + std::to_string(d_options.ejectFor.count()) +
+             "ms after " + std::to_string(d_options.maxFails) + " failed requests");
+}
+
+Task<int> ReverseProxy::connect(const Upstream& upstream) {
+    const int fd = socket(upstream.address.ss_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) co_return -1;
+    if (upstream.address.ss_family != AF_UNIX) {
+        const int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    }
+
+    if (::connect(fd, reinterpret_cast<const sockaddr*>(&upstream.address), upstream.addressLength) != 0) {
+        if (errno != EINPROGRESS || !co_await IoScheduler::instance().writable(fd, d_options.connectTimeout)) {
+            closeFd(fd);
+            co_return -1;
+        }
+        int error = 0;
+        socklen_t length = sizeof(error);
+        if (getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &length) != 0 || error != 0) {
+            closeFd(fd);
+            co_return -1;
+        }
+    }
+    co_return fd;
+}
+
+Task<bool> ReverseProxy::sendAll(int fd, std::string_view data, bool& timedOut) {
+    while (!data.empty()) {
+        const ssize_t sent = send(fd, data.data(), data.size(), MSG_NOSIGNAL);
+        if (sent > 0) {
+            data.remove_prefix(static_cast<size_t>(sent));
+        } else if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            if (!co_await IoScheduler::instance().writable(fd, d_options.ioTimeout)) {
+                timedOut = true;
+                co_return false;
+            }
+        } else if (sent < 0 && errno == EINTR) {
+            continue;
+        } else {
+            co_return false;
+        }
+    }
+    co_return true;
+}
+
+Task<ssize_t> ReverseProxy::receive(int fd, std::string& in, bool& timedOut) {
+    while (true) {
+        const size_t used = in.size();
+        in.resize(used + kReadChunk);
+        const ssize_t received = recv(fd, in.data() + used, kReadChunk, 0);
+        in.resize(used + std::max<ssize_t>(received, 0));
+        if (received >= 0) co_return received;
+        if (errno == EINTR) continue;
+        if (errno != EAGAIN && errno != EWOULDBLOCK) co_return -1;
+        if (!co_await IoScheduler::instance().readable(fd, d_options.ioTimeout)) {
+            timedOut = true;
+            co_return -1;
+        }
+    }
+}
+
+Task<ReverseProxy::Result> ReverseProxy::exchange(int fd, bool reused, std::string_view head, const HttpRequest& req,
+                                                  HttpResponse& res, bool& reusable) {
+    bool timedOut = false;
+    // A pooled connection the upstream has since closed fails before a
+    // single byte of the response arrives; nothing was processed, so the
+    // caller may try again on a fresh connection.
+    const Result lost = reused ? Result::Stale : Result::Failed;
+
+    if (!co_await sendAll(fd, head, timedOut)) co_return timedOut ? Result::TimedOut : lost;
+    if (!req.body.empty() && !co_await sendAll(fd, req.body, timedOut))
+        co_return timedOut ? Result::TimedOut : lost;
+
+    // Status line and headers, skipping interim 1xx responses.
+    std::string in;
+    size_t headEnd;
+    int status = 0;
+    while (true) {
+        while ((headEnd = in.find("\r\n\r\n")) == std::string::npos) {
+            if (in.size() > kMaxResponseHead) co_return Result::Failed;
+            const bool first = in.empty();
+            if (co_await receive(fd, in, timedOut) <= 0) {
+                if (timedOut) co_return Result::TimedOut;
+                co_return first ? lost : Result::Failed;
+            }
+        }
+        // "HTTP/1.x NNN reason"
+        if (headEnd < 12 || !in.starts_with("HTTP/1.")) co_return Result::Failed;
+        auto [end, ec] = std::from_chars(in.data() + 9, in.data() + 12, status);
+        if (ec != std::errc() || end != in.data() + 12 || status < 100 || status > 999) co_return Result::Failed;
+        if (status == 101) co_return Result::Failed; // upgrades are not proxied
+        if (status >= 200) break;
+        in.erase(0, headEnd + 4);
+    }
+
+    const std::string_view headView(in.data(), headEnd);
+    const bool http11 = headView.starts_with("HTTP/1.1");
+    std::vector<std::pair<std::string_view, std::string_view>> headers;
+    std::string_view connection;
+    std::string_view transferEncoding;
+    std::optional<size_t> contentLength;
+    std::string_view contentLengthValue;
+
+    size_t lineStart = headView.find("\r\n") + 2;
+    while (lineStart < headView.size()) {
+        size_t lineEnd = headView.find("\r\n", lineStart);
+        if (lineEnd == std::string_view::npos) lineEnd = headView.size();
+        const std::string_view line = headView.substr(lineStart, lineEnd - lineStart);
+        lineStart = lineEnd + 2;
+
+        const size_t colon = line.find(':');
+        if (colon == std::string_view::npos || colon == 0) co_return Result::Failed;
+        const std::string_view name = line.substr(0, colon);
+        const std::string_view value = trim(line.substr(colon + 1));
+        if (equalsIgnoreCase(name, "connection")) {
+            connection = value;
+        } else if (equalsIgnoreCase(name, "transfer-encoding")) {
+            transferEncoding = value;
+        } else if (equalsIgnoreCase(name, "content-length")) {
+            size_t length = 0;
+            auto [end, ec] = std::from_chars(value.data(), value.data() + value.size(), length);
+            if (ec != std::errc() || end != value.data() + value.size()) co_return Result::Failed;
+            if (contentLength && *contentLength != length) co_return Result::Failed;
+            contentLength = length;
+            contentLengthValue = value;
+        }
+        headers.emplace_back(name, value);
+    }
+
+    reusable = http11 ? !hasToken(connection, "close") : hasToken(connection, "keep-alive");
+
+    res.setStatus(static_cast<StatusCode>(status));
+    for (const auto& [name, value] : headers) {
+        if (isHopByHop(name, connection)) continue;
+        auto existing = res.headers.find(name);
+        if (existing == res.headers.end()) {
+            res.addHeader(name, value);
+        } else {
+            existing->second.append(", ").append(value);
+        }
+    }
+    res.applyRequestDefaults(req);
+
+    // Body, framed by whichever of the three ways the response uses.
+    const bool bodiless = req.method == "HEAD" || status == 204 || status == 304;
+    if (bodiless) {
+        if (!contentLengthValue.empty()) res.addHeader("Content-Length", contentLengthValue);
+        if (in.size() != headEnd + 4) reusable = false;
+        co_return Result::Ok;
+    }
+
+    std::string body;
+    size_t at = headEnd + 4;
+    auto need = [&](size_t bytes) { return in.size() - at < bytes; };
+
+    if (!transferEncoding.empty()) {
+        if (!hasToken(transferEncoding, "chunked")) co_return Result::Failed;
+        while (true) {
+            size_t lineEnd;
+            while ((lineEnd = in.find("\r\n", at)) == std::string::npos) {
+                if (in.size() - at > kMaxResponseHead || co_await receive(fd, in, timedOut) <= 0)
+                    co_return timedOut ? Result::TimedOut : Result::Failed;
+            }
+            size_t chunk = 0;
+            auto [end, ec] = std::from_chars(in.data() + at, in.data() + lineEnd, chunk, 16);
+            if (ec != std::errc() || end == in.data() + at) co_return Result::Failed;
+            at = lineEnd + 2;
+
+            if (chunk == 0) {
+                // Trailers are dropped; read up to the blank line ending them.
+                while (true) {
+                    while ((lineEnd = in.find("\r\n", at)) == std::string::npos) {
+                        if (in.size() - at > kMaxResponseHead || co_await receive(fd, in, timedOut) <= 0)
+                            co_return timedOut ? Result::TimedOut : Result::Failed;
+                    }
+                    const bool blank = lineEnd == at;
+                    at = lineEnd + 2;
+                    if (blank) break;
+                }
+                break;
+            }
+
+            if (chunk > d_options.maxResponseBodySize - body.size()) {
+                LOG_WARN("Proxy: Response from upstream exceeds the maximum body size");
+                co_return Result::Failed;
+            }
+            while (need(chunk + 2)) {
+                if (co_await receive(fd, in, timedOut) <= 0) co_return timedOut ? Result::TimedOut : Result::Failed;
+            }
+            body.append(in, at, chunk);
+            at += chunk + 2;
+            // Keep the buffer from holding the whole body twice.
+            in.erase(0, at);
+            at = 0;
+        }
+    } else if (contentLength) {
+        if (*contentLength > d_options.maxResponseBodySize) {
+            LOG_WARN("Proxy: Response from upstream exceeds the maximum body size");
+            co_return Result::Failed;
+        }
+        while (need(*contentLength)) {
+            if (co_await receive(fd, in, timedOut) <= 0) co_return timedOut ? Result::TimedOut : Result::Failed;
+        }
+        body.assign(in, at, *contentLength);
+        at += *contentLength;
+    } else {
+        // Delimited by the upstream closing the connection.
+        reusable = false;
+        while (true) {
+            const ssize_t received = co_await receive(fd, in, timedOut);
+            if (received == 0) break;
+            if (received < 0) co_return timedOut ? Result::TimedOut : Result::Failed;
+            if (in.size() - at > d_options.maxResponseBodySize) {
+                LOG_WARN("Proxy: Response from upstream exceeds the maximum body size");
+                co_return Result::Failed;
+            }
+        }
+        body.assign(in, at);
+        at = in.size();
+    }
+
+    // Bytes past the response mean the upstream and the proxy disagree on
+    // framing; the connection cannot be trusted for another request.
+    if (at != in.size()) reusable = false;
+    res.setBody(body);
+    co_return Result::Ok;
+}
+
+Task<HttpResponse> ReverseProxy::forward(const HttpRequest& req) {
+    if (d_upstreams.empty()) co_return Responses::badGateway(req);
+
+    std::string_view clientConnection;
+    bool hasHost = false;
+    for (const auto& [name, value] : req.headers) {
+        if (equalsIgnoreCase(name, "connection")) clientConnection = value;
+        if (equalsIgnoreCase(name, "host")) hasHost = true;
+    }
+
+    std::string head;
+    head.append(req.method).append(" ").append(req.path.empty() ? "/" : std::string_view(req.path));
+    if (!req.query.empty()) head.append("?").append(req.query);
+    head.append(" HTTP/1.1\r\n");
+    for (const auto& [name, value] : req.headers) {
+        if (isHopByHop(name, clientConnection)) continue;
+        head.append(name).append(": ").append(value).append("\r\n");
+    }
+    const size_t hostAt = head.size();
+    if (!req.body.empty() || req.method == "POST" || req.method == "PUT" || req.method == "PATCH")
+        head.append("Content-Length: ").append(std::to_string(req.body.size())).append("\r\n");
+    head.append("Connection: keep-alive\r\n\r\n");
+
+    // Each upstream is tried at most once, and only moved on from when the
+    // request never reached it; once sent, a failure is the answer.
+    for (size_t attempt = 0; attempt < d_upstreams.size(); attempt++) {
+        Upstream& upstream = *pick();
+        std::string upstreamHead = head;
+        if (!hasHost) upstreamHead.insert(hostAt, "Host: " + upstream.authority + "\r\n");
+
+        upstream.active.fetch_add(1, std::memory_order_relaxed);
+        int fd = takeIdle(upstream);
+        bool reused = fd >= 0;
+        if (!reused) fd = co_await connect(upstream);
+        if (fd < 0) {
+            upstream.active.fetch_sub(1, std::memory_order_relaxed);
+            failed(upstream);
+            continue;
+        }
+
+        HttpResponse res(req.get_allocator());
+        bool reusable = false;
+        Result result = co_await exchange(fd, reused, upstreamHead, req, res, reusable);
+        if (result == Result::Stale && isIdempotent(req.method)) {
+            closeFd(fd);
+            fd = co_await connect(upstream);
+            if (fd >= 0) {
+                res = HttpResponse(req.get_allocator());
+                result = co_await exchange(fd, false, upstreamHead, req, res, reusable);
+            } else {
+                result = Result::Failed;
+            }
+        }
+        upstream.active.fetch_sub(1, std::memory_order_relaxed);
+
+        if (result == Result::Ok) {
+            succeeded(upstream);
+            if (reusable) {
+                putIdle(upstream, fd);
+            } else {
+                closeFd(fd);
+            }
+            co_return res;
+        }
+
+        closeFd(fd);
+        if (result != Result::Stale) failed(upstream);
+        co_return result == Result::TimedOut ? Responses::gatewayTimeout(req) : Responses::badGateway(req);
+    }
+
+    co_return Responses::badGateway(req);
+}
+
+} // namespace HTTPServer
@@ -1,11 +1,17 @@
 #include "httpserver/router.h"
 
+#include <exception>
+#include <memory>
+#include <optional>
+#include <semaphore>
 #include <string>
-#include <sstream>
+#include <string_view>
 
+#include "httpserver/handler_executor.h"
 #include "httpserver/http_object.h"
 #include "httpserver/http_response_builder.h"
 #include "httpserver/logger.h"
+#include "httpserver/metrics.h"
 
 namespace HTTPServer {
 
@@ -14,17 +20,84 @@ Router& Router::instance() {
     return router;
 }
 
-void Router::addRoute(const std::string& method, const std::string& path, RequestHandler handler) {
+namespace {
+
+Task<HttpResponse> guarded(const AsyncRequestHandler& handler, const HttpRequest& request) {
+    try {
+        co_return co_await handler(request);
+    } catch (const std::exception& e) {
+        LOG_ERROR("Handler for " + std::string(request.method) + " " + std::string(request.path) +
+                  " failed: " + e.what());
+    } catch (...) {
+        LOG_ERROR("Handler for " + std::string(request.method) + " " + std::string(request.path) + " failed");
+    }
+    co_return Responses::internalServerError(request);
+}
+
+} // namespace
+
+HttpResponse RouteHandler::operator()(const HttpRequest& request) const {
+    if (!d_asyncHandler && !isOffloaded()) return d_handler(request);
+
+    std::optional<HttpResponse> response;
+    std::binary_semaphore finished(0);
+    start(request, [&response, &finished](HttpResponse result) {
+        response.emplace(std::move(result));
+        finished.release();
+    });
+    finished.acquire();
+    return std::move(*response);
+}
+
+void RouteHandler::start(const HttpRequest& request, Done done) const {
+    if (!isOffloaded()) {
+        startHere(request, std::move(done));
+        return;
+    }
+    // Only a shared handle to 'done' goes into the job, so it is still ours
+    // to answer with if the job is refused.
+    auto shared = std::make_shared<Done>(std::move(done));
+    if (!HandlerExecutor::instance().submit([this, &request, shared]() { startHere(request, std::move(*shared)); })) {
+        Metrics::instance().requestShed();
+        (*shared)(Responses::serviceUnavailable(request, HandlerExecutor::instance().options().retryAfter));
+    }
+}
+
+void RouteHandler::startHere(const HttpRequest& request, Done done) const {
+    if (!d_asyncHandler) {
+        done(d_handler(request));
+        return;
+    }
+    detach(guarded(d_asyncHandler, request), std::move(done));
+}
+
+RouteHandler::RouteHandler(std::shared_ptr<const EventStreamRoute> route)
+    : d_handler([select = route->select](const HttpRequest& req) {
+          return select(req) ? EventStream::accept(req) : Responses::notFound(req);
+      }),
+      d_execution(HandlerExecution::Inline), d_eventStream(std::move(route)) {}
+
+void Router::addRoute(const std::string& method, const std::string& path, RequestHandler handler,
+                      HandlerExecution execution) {
+    addRoute(method, path, RouteHandler(std::move(handler), execution));
+}
+
+void Router::addRoute(const std::string& method, const std::string& path, AsyncRequestHandler handler,
+                      HandlerExecution execution) {
+    addRoute(method, path, RouteHandler(std::move(handler), execution));
+}
+
+void Router::addRoute(const std::string& method, const std::string& path, RouteHandler handler) {
     if (path.find('{') != std::string::npos) {
-        d_dynamicRoutes[method].push_back({path, handler});
+        d_dynamicRoutes[method].push_back({path, std::move(handler)});
     } else {
-        d_routes[method][path] = handler;
+        d_routes[method].insert_or_assign(path, std::move(handler));
     }
 }
 
 void Router::addStaticDirectoryRoute(const std::string& urlBase, const std::string& directory) {
     addRoute("GET", urlBase + "*", [directory, urlBase](const HttpRequest& req) {
-        std::string relative = req.path.substr(urlBase.size());
+        std::string relative(std::string_view(req.path).substr(urlBase.size()));
         if (relative.empty() || relative == "/") relative = "/index.html";
 
         // Sanitize 'bad' input
@@ -36,17 +109,65 @@ void Router::addStaticDirectoryRoute(const std::string& urlBase, const std::stri
     });
 }
 
-bool Router::matchDynamic(const std::string& pattern,
-                          const std::string& path,
+void Router::addMetricsRoute(const std::string& path) {
+    addRoute("GET", path, [](const HttpRequest& req) {
+        return Responses::ok(req, Metrics::instance().renderPrometheus(), "text/plain; version=0.0.4");
+    });
+}
+
+void Router::addProxyRoute(const std::string& urlBase, const ProxyOptions& options) {
+    auto proxy = std::make_shared<ReverseProxy>(options);
+    AsyncRequestHandler handler = [proxy](const HttpRequest& req) { return proxy->forward(req); };
+    for (const char* method : {"GET", "HEAD", "POST", "PUT", "DELETE", "PATCH", "OPTIONS"}) {
+        addRoute(method, urlBase + "*", handler);
+    }
+}
+
+void Router::addWebSocketRoute(const std::string& path, WebSocketHandler handler,
+                               const WebSocketOptions& options) {
+    addRoute("GET", path,
+             RouteHandler(std::make_shared<const WebSocketRoute>(WebSocketRoute{std::move(handler), options})));
+}
+
+void Router::addEventStreamRoute(const std::string& path, EventStreamHub& hub, const EventStreamOptions& options) {
+    addEventStreamRoute(path, [&hub](const HttpRequest&) { return &hub; }, options);
+}
+
+void Router::addEventStreamRoute(const std::string& path, EventStreamSelector select,
+                                 const EventStreamOptions& options) {
+    addRoute("GET", path,
+             RouteHandler(std::make_shared<const EventStreamRoute>(EventStreamRoute{std::move(select), options})));
+}
+
+namespace {
+
+// Splits the next '/' separated segment off the front of 'rest'. A trailing
+// '/' does not produce an empty final segment.
+bool nextSegment(std::string_view& rest, std::string_view& segment) {
+    if (rest.empty()) return false;
+    size_t slash = rest.find('/');
+    if (slash == std::string_view::npos) {
+        segment = rest;
+        rest = {};
+    } else {
+        segment = rest.substr(0, slash);
+        rest.remove_prefix(slash + 1);
+    }
+    return true;
+}
+
+} // namespace
+
+bool Router::matchDynamic(std::string_view pattern,
+                          std::string_view path,
                           HttpRequest& req) const
 {
-    std::stringstream p(pattern), u(path);
-    std::string segP, segU;
+    std::string_view segP, segU;
 
-    while (std::getline(p, segP, '/') && std::getline(u, segU, '/')) {
+    while (nextSegment(pattern, segP) && nextSegment(path, segU)) {
         if (!segP.empty() && segP.front() == '{' && segP.back() == '}') {
-            std::string key = segP.substr(1, segP.size() - 2);
-            req.params[key] = segU;
+            std::string_view key = segP.substr(1, segP.size() - 2);
+            req.params.insert_or_assign(std::pmr::string(key, req.get_allocator()), segU);
             continue;
         }
 
@@ -57,13 +178,13 @@ bool Router::matchDynamic(const std::string& pattern,
     }
 
     // Ensure no extra segments exist in path
-    if (std::getline(u, segU, '/')) {
+    if (nextSegment(path, segU)) {
         req.params.clear();
         return false;
     }
 
     // Ensure no pattern segments left unmatched
-    if (std::getline(p, segP, '/')) {
+    if (nextSegment(pattern, segP)) {
         req.params.clear();
         return false;
     }
@@ -71,10 +192,10 @@ bool Router::matchDynamic(const std::string& pattern,
     return true;
 }
 
-HttpResponse Router::route(HttpRequest& request) const {
+const RouteHandler* Router::match(HttpRequest& request) const {
     auto methodIt = d_routes.find(request.method);
     if (methodIt == d_routes.end()) {
-        return Responses::notFound(request);
+        return nullptr;
     }
 
     const auto& pathMap = methodIt->second;
@@ -82,7 +203,8 @@ HttpResponse Router::route(HttpRequest& request) const {
     // Try exact match first
     auto pathIt = pathMap.find(request.path);
     if (pathIt != pathMap.end()) {
-        return pathIt->second(request);
+        request.route = pathIt->first;
+        return &pathIt->second;
     }
 
     // Try dynamic routes /{uuid}
@@ -90,31 +212,42 @@ HttpResponse Router::route(HttpRequest& request) const {
     if (it != d_dynamicRoutes.end()) {
         for (auto& dynamicRoute : it->second) {
             if (matchDynamic(dynamicRoute.d_pattern, request.path, request)) {
-                return dynamicRoute.d_handler(request);
+                request.route = dynamicRoute.d_pattern;
+                return &dynamicRoute.d_handler;
             }
         }
     }
 
     // Try wildcard /* static-prefix routes
-    const RequestHandler* bestHandler = nullptr;
+    const RouteHandler* bestHandler = nullptr;
+    const std::string* bestPattern = nullptr;
     size_t bestPrefixLen = 0;
 
     for (const auto& [pattern, handler] : pathMap) {
         if (pattern.size() > 1 && pattern.ends_with("*")) {
-            std::string prefix = pattern.substr(0, pattern.size() - 1);
+            std::string_view prefix(pattern.data(), pattern.size() - 1);
             if (request.path.starts_with(prefix)) {
                 if (prefix.size() > bestPrefixLen) {
                     bestPrefixLen = prefix.size();
                     bestHandler = &handler;
+                    bestPattern = &pattern;
                 }
             }
         }
     }
 
     if (bestHandler) {
-        return (*bestHandler)(request);
+        request.route = *bestPattern;
+    }
+    return bestHandler;
+}
+
+HttpResponse Router::route(HttpRequest& request) const {
+    const RouteHandler* handler = match(request);
+    if (!handler) {
+        return Responses::notFound(request);
     }
-    return Responses::notFound(request);
+    return (*handler)(request);
 }
 
 } // namespace HTTPServer
\ No newline at end of file
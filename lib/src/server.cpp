@@ -1,27 +1,51 @@
 #include "httpserver/server.h"
 
+#include <fcntl.h>
 #include <netinet/in.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/sendfile.h>
 #include <sys/socket.h>
+#include <sys/wait.h>
 
+#include <algorithm>
 #include <csignal>
 #include <cstring>
 #include <iostream>
+#include <system_error>
 #include <thread>
 
 namespace {
 
-HTTPServer::Server* g_activeServer = nullptr;
+constexpr size_t kFileChunkSize = 64 * 1024;
+// How often an idle supervisor checks for exited workers while it waits
+// for a signal.
+constexpr int kSupervisorPollMs = 100;
 
-void sig_handler(int) {
-  LOG_INFO("SIGINT or SIGTERM received, shutting down ...");
-  if (g_activeServer) {
-    g_activeServer->stop();
-  }
+// Stopping and upgrading allocate, log, take locks and join threads, none
+// of which is safe in a handler, so the handlers only note the request and
+// wake the thread polling g_signalFd (the main accept loop, or the
+// supervisor), which acts on it. Handlers may run on any thread.
+std::atomic<bool> g_stopRequested{false};
+std::atomic<bool> g_upgradeRequested{false};
+int g_signalFd = -1;
+
+void notify_signal(std::atomic<bool>& requested) {
+  const int savedErrno = errno;
+  requested = true;
+  const uint64_t wake = 1;
+  [[maybe_unused]] ssize_t written = write(g_signalFd, &wake, sizeof(wake));
+  errno = savedErrno;
 }
 
+void sig_handler(int) { notify_signal(g_stopRequested); }
+
+void upgrade_handler(int) { notify_signal(g_upgradeRequested); }
+
 int create_listening_socket(const sockaddr* addr, socklen_t addrlen,
-                            bool dualStackIPv6 = true) {
-  int fd = socket(AF_INET6, SOCK_STREAM, 0);
+                            const HTTPServer::SocketOptions& options,
+                            bool dualStackIPv6 = true, bool reusePort = false) {
+  int fd = socket(addr->sa_family, SOCK_STREAM, 0);
   if (fd < 0) {
     LOG_ERROR_ERRNO("Socket creation failed");
     return -1;
@@ -32,10 +56,16 @@ int create_listening_socket(const sockaddr* addr, socklen_t addrlen,
     LOG_ERROR_ERRNO("setsockopt(SO_REUSEADDR) failed");
   }
 
+  if (reusePort && setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &opt,
+                              sizeof(opt)) < 0) {
+    LOG_ERROR_ERRNO("setsockopt(SO_REUSEPORT) failed");
+  }
+
   if (dualStackIPv6) {
     int off = 0;
     setsockopt(fd, IPPROTO_IPV6, IPV6_V6ONLY, &off, sizeof(off));
   }
+  HTTPServer::configureListeningSocket(fd, options, true);
 
   if (bind(fd, addr, addrlen) < 0) {
     LOG_ERROR_ERRNO("Bind failed");
@@ -43,7 +73,7 @@ int create_listening_socket(const sockaddr* addr, socklen_t addrlen,
     return -1;
   }
 
-  if (listen(fd, SOMAXCONN) < 0) {
+  if (listen(fd, options.backlog) < 0) {
     LOG_ERROR_ERRNO("Listen failed");
     close(fd);
     return -1;
@@ -52,33 +82,153 @@ int create_listening_socket(const sockaddr* addr, socklen_t addrlen,
   return fd;
 }
 
-template <typename Address, typename Handler>
-void accept_loop(int listen_fd, std::atomic<bool>& running, Handler handler) {
+// Admission happens before any work is spawned for a connection; the
+// handler owns the admitted slot and must release it.
+//
+// The listening socket is non-blocking and polled next to 'wake_fd', and
+// the loop ends once that becomes readable; closing a socket does not wake
+// a thread blocked on it. A 'signal_fd' (-1 for none) that becomes readable
+// runs 'on_signal' on this thread.
+template <typename Handler, typename OnSignal>
+void accept_loop(int listen_fd, std::atomic<bool>& running,
+                 HTTPServer::ListenerAdmission& admission,
+                 HTTPServer::RateLimiter& rateLimiter, bool tls, int wake_fd,
+                 int signal_fd, OnSignal on_signal, Handler handler) {
   while (running) {
-    Address client_addr{};
+    if (admission.action() == HTTPServer::OverloadAction::PauseAccept &&
+        !admission.waitForCapacity(running)) {
+      break;
+    }
+
+    pollfd pfds[3] = {{listen_fd, POLLIN, 0},
+                      {wake_fd, POLLIN, 0},
+                      {signal_fd, POLLIN, 0}};
+    if (poll(pfds, 3, -1) < 0) {
+      if (errno == EINTR) continue;
+      LOG_ERROR_ERRNO("Listening socket poll failed");
+      break;
+    }
+    if (pfds[1].revents) break;
+    if (pfds[2].revents) {
+      on_signal();
+      if (!running) break;  // stopped, and listen_fd closed
+    }
+    if (!pfds[0].revents) continue;
+
+    sockaddr_storage client_addr{};
     socklen_t addrlen = sizeof(client_addr);
 
+    // Close-on-exec from the start, so nothing the server execs inherits a
+    // connection. Connections are served with blocking I/O, so they are not
+    // made non-blocking.
     int client_fd =
-        accept(listen_fd, reinterpret_cast<sockaddr*>(&client_addr), &addrlen);
+        accept4(listen_fd, reinterpret_cast<sockaddr*>(&client_addr),
+                &addrlen, SOCK_CLOEXEC);
 
     if (client_fd < 0) {
       if (!running || errno == EBADF || errno == EINVAL) break;
+      // Another process or worker accepted it first.
+      if (errno == EAGAIN || errno == EWOULDBLOCK) continue;
       LOG_ERROR_ERRNO("Incoming connection accept failed");
       continue;
     }
 
-    handler(client_fd);
+    HTTPServer::AcceptedClient accepted;
+    accepted.fd = client_fd;
+    accepted.address = HTTPServer::ClientAddress::fromSockaddr(client_addr);
+
+    // Checked first so a client over its rate never takes a slot.
+    if (!rateLimiter.allowConnection(accepted.address)) {
+      rateLimiter.reject(client_fd, !tls);
+      continue;
+    }
+    if (!admission.tryAdmit()) {
+      admission.reject(client_fd, !tls);
+      continue;
+    }
+
+    auto& timing = HTTPServer::PhaseTiming::instance();
+    if (timing.enabled()) {
+      accepted.acceptClock = timing.clock();
+      accepted.acceptTicks = HTTPServer::PhaseTiming::now(accepted.acceptClock);
+    }
+
+    handler(accepted);
+  }
+}
+
+bool send_file_plain(int client_fd, int file_fd, size_t size, size_t& written,
+                     HTTPServer::ConnectionDeadline& deadline) {
+  off_t offset = 0;
+  while (size > 0) {
+    ssize_t sent = sendfile(client_fd, file_fd, &offset, size);
+    if (sent < 0 && errno == EINTR) continue;
+    if (sent <= 0) return false;
+    size -= static_cast<size_t>(sent);
+    written += static_cast<size_t>(sent);
+    if (size > 0) deadline.extend();
   }
+  return true;
 }
 
-void set_socket_recv_timeout(int fd, int seconds) {
-  struct timeval timeout{};
-  timeout.tv_sec = seconds;
-  timeout.tv_usec = 0;
+// Kernel TLS: records are built and encrypted in the kernel, so file pages
+// go from the page cache to the socket without passing through userspace.
+bool send_file_ktls(SSL* ssl, int file_fd, size_t size, size_t& written,
+                    HTTPServer::ConnectionDeadline& deadline) {
+  off_t offset = 0;
+  while (size > 0) {
+    ossl_ssize_t sent = SSL_sendfile(ssl, file_fd, offset, size, 0);
+    if (sent <= 0) return false;
+    offset += sent;
+    size -= static_cast<size_t>(sent);
+    written += static_cast<size_t>(sent);
+    if (size > 0) deadline.extend();
+  }
+  return true;
+}
+
+// Userspace TLS fallback: read through a pooled buffer and SSL_write it.
+bool send_file_tls(SSL* ssl, int file_fd, size_t size, size_t& written,
+                   HTTPServer::ConnectionDeadline& deadline) {
+  HTTPServer::PooledBuffer buffer =
+      HTTPServer::BufferPool::instance().acquire(kFileChunkSize);
+  off_t offset = 0;
+  while (size > 0) {
+    ssize_t bytes =
+        pread(file_fd, buffer.data(), std::min(size, buffer.capacity()), offset);
+    if (bytes < 0 && errno == EINTR) continue;
+    if (bytes <= 0) return false;
+    if (SSL_write(ssl, buffer.data(), static_cast<int>(bytes)) != bytes)
+      return false;
+    offset += bytes;
+    size -= static_cast<size_t>(bytes);
+    written += static_cast<size_t>(bytes);
+    if (size > 0) deadline.extend();
+  }
+  return true;
+}
 
-  if (setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout)) < 0) {
-    LOG_ERROR_ERRNO("setsockopt(SO_RCVTIMEO) failed");
+// Prefers h2 when HTTP/2 is enabled; a client offering neither protocol
+// carries on without ALPN.
+int select_alpn(SSL*, const unsigned char** out, unsigned char* outlen,
+                const unsigned char* in, unsigned int inlen, void*) {
+  static constexpr unsigned char kProtocols[] = "\x02h2\x08http/1.1";
+  unsigned char* selected = nullptr;
+  if (SSL_select_next_proto(&selected, outlen, kProtocols,
+                            sizeof(kProtocols) - 1, in,
+                            inlen) != OPENSSL_NPN_NEGOTIATED) {
+    return SSL_TLSEXT_ERR_NOACK;
   }
+  *out = selected;
+  return SSL_TLSEXT_ERR_OK;
+}
+
+bool negotiated_http2(SSL* ssl) {
+  const unsigned char* protocol = nullptr;
+  unsigned int length = 0;
+  SSL_get0_alpn_selected(ssl, &protocol, &length);
+  return std::string_view(reinterpret_cast<const char*>(protocol), length) ==
+         HTTPServer::Http2::kAlpnProtocol;
 }
 
 }  // namespace
@@ -99,29 +249,149 @@ void Server::stop() {
   if (!d_running) return;
   d_running = false;
 
+  // The supervisor has nothing to drain itself; it waits for its workers
+  // to drain and exit.
+  if (prefork_enabled && d_workerIndex < 0) {
+    for (const auto& pid : d_workerPids) {
+      if (pid > 0) kill(pid, SIGTERM);
+    }
+    return;
+  }
+
   if (server_fd >= 0) {
     close(server_fd);
   }
 
-  if (!(redirection_server_fd < 0)) {
-    close(redirection_server_fd);
+  if (d_redirectListener) {
+    d_redirectListener->stop();
   }
 
-  cleanup_ssl_context();
+  // Unix listeners stop accepting when the drain eventfd is written.
+  drain();
+  for (auto& t : d_acceptThreads) {
+    if (t.joinable()) t.join();
+  }
+  d_acceptThreads.clear();
+  close_unix_listeners();
 
-  // Join all client threads
-  for (auto& t : client_threads) {
+  // Every connection has finished or been shut down by now; the reaper
+  // keeps running until their threads are gone.
+  std::list<std::thread> threads;
+  {
+    std::lock_guard<std::mutex> lock(client_threads_mtx);
+    threads.swap(client_threads);
+  }
+  for (auto& t : threads) {
     if (t.joinable()) t.join();
   }
-  client_threads.clear();
+  {
+    std::lock_guard<std::mutex> lock(finished_client_threads_mtx);
+    finished_client_threads.clear();
+  }
+  cleanup_ssl_context();
+  d_deadlines.stop();
+  d_accessLog.close();
+  close(d_drainFd);
+  d_drainFd = -1;
   LOG_INFO("Shutdown: All client threads finished.");
 }
 
+// Runs once accepting has stopped. Idle connections see the drain eventfd
+// and close at once, busy ones close after the response in flight, and the
+// drain timeout bounds how long any of them may take.
+void Server::drain() {
+  const auto start = std::chrono::steady_clock::now();
+  d_drainAtStart = d_admission.active();
+  d_draining = true;
+  const uint64_t wake = 1;
+  [[maybe_unused]] ssize_t written = write(d_drainFd, &wake, sizeof(wake));
+  LOG_INFO("Shutdown: Draining " + std::to_string(d_drainAtStart) +
+           " connections ...");
+
+  while (d_admission.active() > 0 &&
+         std::chrono::steady_clock::now() - start < d_drainTimeout) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  if (const size_t remaining = d_admission.active(); remaining > 0) {
+    LOG_WARN("Shutdown: Drain timeout reached with " +
+             std::to_string(remaining) + " connections open, closing them");
+    d_drainForced = remaining;
+    d_deadlines.expireAll();
+  }
+
+  const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::steady_clock::now() - start);
+  LOG_INFO("Shutdown: Drained in " + std::to_string(elapsed.count()) +
+           "ms (" + std::to_string(d_drainIdleClosed) + " idle closed, " +
+           std::to_string(d_drainForced) + " forced)");
+}
+
+void Server::setDrainTimeout(std::chrono::milliseconds timeout) {
+  d_drainTimeout = timeout;
+}
+
+DrainProgress Server::drainProgress() const {
+  DrainProgress progress;
+  progress.draining = d_draining;
+  if (!progress.draining) return progress;
+  progress.connectionsAtStart = d_drainAtStart;
+  progress.remaining = d_admission.active();
+  progress.idleClosed = d_drainIdleClosed;
+  progress.forced = d_drainForced;
+  return progress;
+}
+
 void Server::installSignalHandlers() {
-  g_activeServer = this;
+  if (d_signalFd < 0) d_signalFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+  g_signalFd = d_signalFd;
   std::signal(SIGPIPE, SIG_IGN);
   std::signal(SIGINT, sig_handler);
   std::signal(SIGTERM, sig_handler);
+  std::signal(SIGUSR2, upgrade_handler);
+}
+
+void Server::handle_signals() {
+  uint64_t wakes = 0;
+  if (read(d_signalFd, &wakes, sizeof(wakes)) != sizeof(wakes)) return;
+  if (g_stopRequested.exchange(false)) {
+    LOG_INFO("SIGINT or SIGTERM received, shutting down ...");
+    stop();
+  }
+  if (g_upgradeRequested.exchange(false)) {
+    LOG_INFO("SIGUSR2 received, upgrading ...");
+    upgrade();
+  }
+}
+
+bool Server::upgrade() {
+  if (!d_running || d_workerIndex >= 0) return false;
+  if (d_upgradePid > 0 && waitpid(d_upgradePid, nullptr, WNOHANG) == 0) {
+    LOG_WARN("Upgrade: Process [" + std::to_string(d_upgradePid) +
+             "] from the last upgrade is still starting");
+    return false;
+  }
+
+  std::vector<int> fds = d_listenFds;
+  for (const UnixListener& listener : d_unixListeners) {
+    if (listener.fd >= 0) fds.push_back(listener.fd);
+  }
+  if (redirection_server_fd >= 0) fds.push_back(redirection_server_fd);
+  d_upgradePid = ListenerHandoff::spawn(fds);
+  if (d_upgradePid < 0) return false;
+  LOG_INFO("Upgrade: Started process [" + std::to_string(d_upgradePid) +
+           "] with " + std::to_string(fds.size()) + " listening sockets");
+  return true;
+}
+
+void Server::addUnixListener(const std::string& path,
+                             const UnixListenerOptions& options) {
+  d_unixListeners.push_back({path, options});
+}
+
+void Server::disableTcpListener() { tcp_enabled = false; }
+
+void Server::setSocketOptions(const SocketOptions& options) {
+  d_socketOptions = options;
 }
 
 void Server::enableHttps(const std::string& certFile,
@@ -136,6 +406,85 @@ void Server::enableHttpRedirection(Port redirection_port) {
   d_redirection_port = redirection_port;
 }
 
+void Server::enableHsts(std::chrono::seconds maxAge, bool includeSubDomains) {
+  hsts_header = "max-age=" + std::to_string(maxAge.count());
+  if (includeSubDomains) hsts_header += "; includeSubDomains";
+}
+
+void Server::enableKernelTls(bool enabled) { ktls_enabled = enabled; }
+
+void Server::enableHttp2(bool enabled) { http2_enabled = enabled; }
+
+void Server::setTlsSessionOptions(const TlsSessionOptions& options) {
+  d_tlsSessionOptions = options;
+}
+
+void Server::enableAccessLog(const std::string& path, size_t capacity) {
+  access_log_path = path;
+  access_log_capacity = capacity;
+}
+
+void Server::setConnectionTimeouts(const ConnectionTimeouts& timeouts) {
+  d_timeouts = timeouts;
+}
+
+void Server::setConnectionLimits(const ConnectionLimits& limits) {
+  d_limits = limits;
+}
+
+void Server::setRateLimits(const RateLimits& limits) {
+  d_rateLimiter.configure(limits);
+}
+
+void Server::enableLoadShedding(const LoadSheddingOptions& options) {
+  d_loadShedder.configure(options);
+}
+
+void Server::setHandlerExecutor(const HandlerExecutorOptions& options) {
+  HandlerExecutor::instance().configure(options);
+}
+
+void Server::enablePrefork(const PreforkOptions& options) {
+  prefork_enabled = true;
+  d_prefork = options;
+}
+
+// Unmatched requests cost next to nothing, so only handlers queue for a slot.
+// Offloaded handlers are bounded by the HandlerExecutor instead, so slow
+// routes never take the slots the inline ones need.
+HttpResponse Server::run_handler(const RouteHandler& handler,
+                                 const HttpRequest& request) {
+  if (handler.isOffloaded()) return handler(request);
+  LoadShedder::Permit permit = d_loadShedder.admit();
+  if (!permit) {
+    return Responses::serviceUnavailable(request,
+                                         d_loadShedder.options().retryAfter);
+  }
+  return handler(request);
+}
+
+// As run_handler, with the slot held until an asynchronous handler finishes.
+void Server::start_handler(const RouteHandler& handler,
+                           const HttpRequest& request,
+                           RouteHandler::Done done) {
+  if (handler.isOffloaded()) {
+    handler.start(request, std::move(done));
+    return;
+  }
+  LoadShedder::Permit permit = d_loadShedder.admit();
+  if (!permit) {
+    done(Responses::serviceUnavailable(request,
+                                       d_loadShedder.options().retryAfter));
+    return;
+  }
+  auto held = std::make_shared<LoadShedder::Permit>(std::move(permit));
+  handler.start(request, [held, done = std::move(done)](
+                             HttpResponse response) mutable {
+    held.reset();
+    done(std::move(response));
+  });
+}
+
 bool Server::init_ssl_context() {
   SSL_load_error_strings();
   OpenSSL_add_ssl_algorithms();
@@ -155,6 +504,29 @@ bool Server::init_ssl_context() {
   }
 
   SSL_CTX_set_min_proto_version(ssl_ctx, TLS1_2_VERSION);
+
+  if (ktls_enabled) {
+    // Whether the kernel accepts the offload is only known per connection,
+    // once the handshake has negotiated the cipher.
+    SSL_CTX_set_options(ssl_ctx, SSL_OP_ENABLE_KTLS);
+    LOG_INFO("Startup: Kernel TLS offload requested");
+  }
+
+  if (http2_enabled) {
+    SSL_CTX_set_alpn_select_cb(ssl_ctx, select_alpn, nullptr);
+    LOG_INFO("Startup: HTTP/2 offered via ALPN");
+  }
+
+  if (d_tlsSessionOptions.sessionTickets) {
+    d_ticketKeys = std::make_unique<TicketKeyRing>(
+        d_tlsSessionOptions.ticketKeyRotation,
+        d_tlsSessionOptions.sessionLifetime);
+  }
+  configureTlsSessions(ssl_ctx, d_tlsSessionOptions, d_ticketKeys.get());
+  LOG_INFO(std::string("Startup: TLS session cache ") +
+           (d_tlsSessionOptions.sessionCache ? "enabled" : "disabled") +
+           ", session tickets " +
+           (d_ticketKeys ? "enabled" : "disabled"));
   return true;
 }
 
@@ -163,6 +535,7 @@ void Server::cleanup_ssl_context() {
 
   SSL_CTX_free(ssl_ctx);
   ssl_ctx = nullptr;
+  d_ticketKeys.reset();
   EVP_cleanup();
 }
 
@@ -177,98 +550,549 @@ void Server::start() {
     LOG_INFO("Startup: HTTPS enabled");
   }
 
-  // 2. Start main server
+  if (!access_log_path.empty()) {
+    if (!d_accessLog.open(access_log_path, access_log_capacity)) {
+      LOG_ERROR("Startup: Fatal: Failed to open access log " +
+                access_log_path);
+      return;
+    }
+    LOG_INFO("Startup: Access log enabled at " + access_log_path);
+  }
+
+  // 2. Open the listening sockets; prefork workers inherit them
+  if (!open_listeners()) return;
+  if (prefork_enabled) {
+    run_supervisor();
+    return;
+  }
+  serve();
+}
+
+// Sockets handed over by a previous process are taken over instead of
+// bound; see ListenerHandoff.
+int Server::open_listener(const Port& port, bool reusePort) {
+  const int fd = ListenerHandoff::take(port);
+  if (fd >= 0) {
+    LOG_INFO("Startup: Took over listening socket [" + std::to_string(fd) +
+             "] on port " + port.toString() + " from the previous process");
+    // Listening again only updates the backlog, so a new configuration
+    // takes effect across an upgrade.
+    configureListeningSocket(fd, d_socketOptions, true);
+    listen(fd, d_socketOptions.backlog);
+    return fd;
+  }
+
   sockaddr_in6 address{};
   address.sin6_family = AF_INET6;
   address.sin6_addr = in6addr_any;
-  address.sin6_port = d_port.toNetwork();
-
-  server_fd = create_listening_socket(reinterpret_cast<sockaddr*>(&address),
-                                      sizeof(address));
+  address.sin6_port = port.toNetwork();
+  return create_listening_socket(reinterpret_cast<sockaddr*>(&address),
+                                 sizeof(address), d_socketOptions, true,
+                                 reusePort);
+}
 
-  if (server_fd < 0) {
-    LOG_ERROR("Startup: Fatal: Failed to create main server socket");
-    return;
+bool Server::open_listeners() {
+  if (!tcp_enabled && d_unixListeners.empty()) {
+    LOG_ERROR("Startup: Fatal: TCP listener disabled and no unix listener "
+              "added");
+    return false;
+  }
+  const size_t sockets = !tcp_enabled ? 0
+                         : prefork_enabled && d_prefork.reusePort
+                             ? worker_count()
+                             : 1;
+  d_listenFds.clear();
+  for (size_t i = 0; i < sockets; i++) {
+    const int fd = open_listener(d_port, sockets > 1);
+    if (fd < 0) {
+      LOG_ERROR("Startup: Fatal: Failed to create main server socket");
+      for (int open : d_listenFds) close(open);
+      d_listenFds.clear();
+      return false;
+    }
+    d_listenFds.push_back(fd);
+  }
+  server_fd = d_listenFds.empty() ? -1 : d_listenFds.front();
+  if (!open_unix_listeners()) {
+    for (int open : d_listenFds) close(open);
+    d_listenFds.clear();
+    server_fd = -1;
+    return false;
   }
-  d_running = true;
 
-  // 3. Start HTTP -> HTTPS forwarding if enabled
   if (https_enabled && http_redirection_enabled) {
     if (d_port == d_redirection_port) {
       LOG_WARN("Startup: Redirection port [" + d_redirection_port.toString() +
                "] cannot be the same as server port [" + d_port.toString() +
                "]: Failed to start HTTP redirection");
     } else {
-      client_threads.emplace_back(
-          [this]() { start_http_redirect(d_redirection_port); });
+      redirection_server_fd = open_listener(d_redirection_port, false);
+    }
+  }
+  return true;
+}
+
+// Unix listeners are shared by every prefork worker, as SO_REUSEPORT does
+// not spread connections across Unix domain sockets.
+bool Server::open_unix_listeners() {
+  for (UnixListener& listener : d_unixListeners) {
+    listener.fd = ListenerHandoff::take(listener.path);
+    if (listener.fd >= 0) {
+      LOG_INFO("Startup: Took over unix socket " + listener.path + " [" +
+               std::to_string(listener.fd) + "] from the previous process");
+      configureListeningSocket(listener.fd, d_socketOptions, false);
+      listen(listener.fd, d_socketOptions.backlog);
+    } else {
+      listener.fd = UnixSocket::listen(listener.path, listener.options.mode,
+                                       d_socketOptions);
+    }
+    if (listener.fd < 0) {
+      LOG_ERROR("Startup: Fatal: Failed to listen on unix socket " +
+                listener.path);
+      close_unix_listeners();
+      return false;
     }
+    // Accepted from a thread that also polls the drain eventfd; see
+    // accept_loop.
+    fcntl(listener.fd, F_SETFL, fcntl(listener.fd, F_GETFL) | O_NONBLOCK);
+    LOG_INFO("Startup: Listening on unix socket " + listener.path +
+             " with fd [" + std::to_string(listener.fd) + "]");
+  }
+  return true;
+}
+
+// The socket file is left for the process an upgrade handed it to, and
+// only the process that created it removes it.
+void Server::close_unix_listeners() {
+  const bool owner = d_upgradePid <= 0 && d_workerIndex < 0;
+  for (UnixListener& listener : d_unixListeners) {
+    if (listener.fd < 0) continue;
+    close(listener.fd);
+    listener.fd = -1;
+    if (owner && listener.path.front() != UnixSocket::kAbstractPrefix)
+      unlink(listener.path.c_str());
   }
+}
 
-  LOG_INFO("Server running on port " + d_port.toString() + " with fd [" +
-           std::to_string(server_fd) + "] ...");
-  accept_loop<sockaddr_in>(server_fd, d_running, [this](int client_fd) {
-    set_socket_recv_timeout(client_fd, kClientRecvTimeoutSec);
+void Server::serve() {
+  d_running = true;
+  d_draining = false;
+  d_drainAtStart = d_drainIdleClosed = d_drainForced = 0;
+  d_drainFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+  d_deadlines.start();
+  d_totalConnections.setLimit(d_limits.maxTotalConnections);
+  d_admission.configure(d_limits.maxConnections, d_limits.onOverload,
+                        d_limits.retryAfter);
 
-    LOG_INFO("Accepted client [" + std::to_string(client_fd) + "]");
-    dispatch_client(client_fd);
-  });
+  // 3. Start HTTP -> HTTPS forwarding if enabled
+  if (https_enabled && http_redirection_enabled &&
+      !(d_port == d_redirection_port)) {
+    d_redirectAdmission.configure(d_limits.maxRedirectConnections,
+                                  d_limits.onOverload, d_limits.retryAfter);
+    d_redirectListener = std::make_unique<RedirectListener>(
+        d_port, d_timeouts.idle, &d_redirectAdmission);
+    start_client_thread([this]() { start_http_redirect(d_redirection_port); });
+  }
+
+  if (d_workerIndex < 0) {
+    ListenerHandoff::complete();
+    if (tcp_enabled) {
+      LOG_INFO("Server running on port " + d_port.toString() + " with fd [" +
+               std::to_string(server_fd) + "] ...");
+    } else {
+      LOG_INFO("Server running on " + std::to_string(d_unixListeners.size()) +
+               " unix sockets ...");
+    }
+  } else {
+    LOG_INFO("Prefork: Worker [" + std::to_string(d_workerIndex) +
+             "] accepting on fd [" + std::to_string(server_fd) + "] ...");
+  }
+
+  // Unix listeners accept on threads of their own, and connections from
+  // every listener share the admission limits and the drain. Without a TCP
+  // port the first Unix listener is accepted on here instead. Signals are
+  // acted on from this thread too.
+  const size_t firstThreaded = tcp_enabled ? 0 : 1;
+  for (size_t i = firstThreaded; i < d_unixListeners.size(); i++) {
+    d_acceptThreads.emplace_back([this, &listener = d_unixListeners[i]]() {
+      accept_connections(listener.fd, https_enabled && listener.options.tls,
+                         d_drainFd);
+    });
+  }
+  if (tcp_enabled) {
+    fcntl(server_fd, F_SETFL, fcntl(server_fd, F_GETFL) | O_NONBLOCK);
+    accept_connections(server_fd, https_enabled, d_drainFd, d_signalFd);
+  } else {
+    const UnixListener& listener = d_unixListeners.front();
+    accept_connections(listener.fd, https_enabled && listener.options.tls,
+                       d_drainFd, d_signalFd);
+  }
   LOG_INFO("Shutdown: Server main loop exited.");
 }
 
-void Server::dispatch_client(int client_fd) {
-  if (!https_enabled) {
-    client_threads.emplace_back(
-        [this, client_fd]() { handle_client(client_fd); });
-    return;
+void Server::accept_connections(int listen_fd, bool tls, int wake_fd,
+                                int signal_fd) {
+  accept_loop(listen_fd, d_running, d_admission, d_rateLimiter, tls, wake_fd,
+              signal_fd, [this]() { handle_signals(); },
+              [this, tls](const AcceptedClient& accepted) {
+                LOG_INFO("Accepted client [" + std::to_string(accepted.fd) +
+                         "] from " + accepted.address.toString());
+                configureAcceptedSocket(accepted.fd, d_socketOptions,
+                                        !accepted.address.unixSocket);
+                dispatch_client(accepted, tls);
+              });
+}
+
+size_t Server::worker_count() const {
+  if (d_prefork.workers) return d_prefork.workers;
+  return std::max(1u, std::thread::hardware_concurrency());
+}
+
+// The supervisor only forks, reaps and restarts: it never accepts and runs
+// no threads, so forking from it is always safe. TLS and the access log are
+// set up before the first fork, so workers share the certificate, ticket
+// keys and the access log's mapping.
+void Server::run_supervisor() {
+  const size_t workers = worker_count();
+  if (!d_sharedMetrics.create(workers)) return;
+  d_running = true;
+  d_workerPids = std::vector<std::atomic<pid_t>>(workers);
+  for (size_t i = 0; i < workers; i++) spawn_worker(i);
+  ListenerHandoff::complete();
+  LOG_INFO("Server running on port " + d_port.toString() + " with " +
+           std::to_string(workers) + " worker processes ...");
+
+  auto alive = [this]() {
+    return std::any_of(d_workerPids.begin(), d_workerPids.end(),
+                       [](const std::atomic<pid_t>& pid) { return pid > 0; });
+  };
+  // Signals only write d_signalFd, so rather than blocking in waitpid the
+  // supervisor waits on that between checks for exited workers.
+  while (d_running || alive()) {
+    int status = 0;
+    const pid_t pid = waitpid(-1, &status, WNOHANG);
+    if (pid < 0) break;
+    if (pid == 0) {
+      pollfd pfd{d_signalFd, POLLIN, 0};
+      if (poll(&pfd, 1, kSupervisorPollMs) > 0) handle_signals();
+      continue;
+    }
+    auto it = std::find_if(
+        d_workerPids.begin(), d_workerPids.end(),
+        [pid](const std::atomic<pid_t>& worker) { return worker == pid; });
+    if (it == d_workerPids.end()) continue;  // e.g. a failed upgrade
+    const size_t index = static_cast<size_t>(it - d_workerPids.begin());
+    *it = 0;
+    d_sharedMetrics.retire(index);
+    if (!d_running) continue;
+
+    const std::string cause =
+        WIFSIGNALED(status)
+            ? "killed by signal " + std::to_string(WTERMSIG(status))
+            : "exited with status " + std::to_string(WEXITSTATUS(status));
+    LOG_ERROR("Prefork: Worker [" + std::to_string(index) + "] (pid " +
+              std::to_string(pid) + ") " + cause + ", restarting");
+    std::this_thread::sleep_for(d_prefork.restartDelay);
+    if (d_running) spawn_worker(index);
+  }
+
+  for (int fd : d_listenFds) close(fd);
+  d_listenFds.clear();
+  close_unix_listeners();
+  if (redirection_server_fd >= 0) close(redirection_server_fd);
+  redirection_server_fd = -1;
+  cleanup_ssl_context();
+  d_accessLog.close();
+  LOG_INFO("Shutdown: All workers exited.");
+}
+
+void Server::spawn_worker(size_t index) {
+  // Blocked until the child knows it is a worker and the supervisor has
+  // recorded its pid, so a signal never runs the supervisor's handler in the
+  // child or misses the new worker.
+  sigset_t all, previous;
+  sigfillset(&all);
+  sigprocmask(SIG_BLOCK, &all, &previous);
+  const pid_t pid = fork();
+  if (pid == 0) {
+    d_workerIndex = static_cast<int>(index);
+    // Signals sent to a worker are its own to handle, not the supervisor's.
+    if (d_signalFd >= 0) {
+      close(d_signalFd);
+      d_signalFd = g_signalFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    }
+    sigprocmask(SIG_SETMASK, &previous, nullptr);
+    run_worker(index);
+  }
+  if (pid < 0) {
+    LOG_ERROR_ERRNO("Prefork: Failed to fork worker [" +
+                    std::to_string(index) + "]");
+  } else {
+    d_workerPids[index] = pid;
+  }
+  sigprocmask(SIG_SETMASK, &previous, nullptr);
+}
+
+void Server::run_worker(size_t index) {
+  if (d_prefork.reusePort && !d_listenFds.empty()) {
+    for (size_t i = 0; i < d_listenFds.size(); i++) {
+      if (i != index) close(d_listenFds[i]);
+    }
+    server_fd = d_listenFds[index];
+    d_listenFds = {server_fd};
+  }
+  d_sharedMetrics.attach(index, d_prefork.statsInterval);
+  serve();
+  d_sharedMetrics.detach();
+  std::exit(0);
+}
+
+// Joins the threads of connections that have finished since the last call
+// before starting the next one. Returns false, having started nothing, when
+// no thread can be created.
+bool Server::start_client_thread(std::function<void()> run) {
+  // Finished threads are moved out under the lock but joined after it is
+  // released, and an exiting thread only ever takes the short-lived
+  // finished_client_threads_mtx, so it never queues behind a join or a
+  // thread creation.
+  std::list<std::thread> finished;
+  bool started = true;
+  {
+    std::lock_guard<std::mutex> lock(client_threads_mtx);
+    std::vector<std::list<std::thread>::iterator> entries;
+    {
+      std::lock_guard<std::mutex> finishedLock(finished_client_threads_mtx);
+      entries.swap(finished_client_threads);
+    }
+    for (auto entry : entries) {
+      finished.splice(finished.end(), client_threads, entry);
+    }
+
+    auto entry = client_threads.emplace(client_threads.end());
+    try {
+      *entry = std::thread([this, entry, run = std::move(run)]() {
+        run();
+        std::lock_guard<std::mutex> finishedLock(finished_client_threads_mtx);
+        finished_client_threads.push_back(entry);
+      });
+    } catch (const std::system_error& e) {
+      client_threads.erase(entry);
+      LOG_ERROR("Failed to start a connection thread: " +
+                std::string(e.what()));
+      started = false;
+    }
   }
+  for (auto& t : finished) t.join();
+  return started;
+}
 
-  SSL* ssl = SSL_new(ssl_ctx);
-  SSL_set_fd(ssl, client_fd);
+void Server::dispatch_client(const AcceptedClient& accepted, bool tls) {
+  SSL* ssl = nullptr;
+  if (tls) {
+    ssl = SSL_new(ssl_ctx);
+    SSL_set_fd(ssl, accepted.fd);
+  }
+  const bool started = start_client_thread([this, ssl, accepted]() {
+    if (!ssl) {
+      handle_client(accepted);
+    } else if (tls_handshake(ssl, accepted.fd)) {
+      handle_client(ssl, accepted);
+    }
+    d_admission.release();
+  });
+  if (!started) {
+    if (ssl) SSL_free(ssl);
+    close(accepted.fd);
+    d_admission.release();
+  }
+}
 
-  if (SSL_accept(ssl) <= 0) {
+// Runs on the connection's own thread, so a client stalling the handshake
+// holds up nobody else; the head deadline bounds it like a request head.
+bool Server::tls_handshake(SSL* ssl, int client_fd) {
+  ConnectionDeadline handshake(d_deadlines, client_fd);
+  handshake.arm(TimeoutKind::Header, d_timeouts.header);
+  const bool handshaken = SSL_accept(ssl) > 0;
+  handshake.disarm();
+  if (!handshaken) {
     LOG_ERROR("Client [" + std::to_string(client_fd) +
               "] TLS handshake failed");
+    Metrics::instance().tlsHandshakeFailed();
     SSL_free(ssl);
     close(client_fd);
-    return;
+    return false;
   }
-
-  client_threads.emplace_back([this, ssl]() { handle_client(ssl); });
+  Metrics::instance().tlsHandshakeCompleted(SSL_session_reused(ssl) == 1);
+  if (ktls_enabled) {
+    const bool offloaded = BIO_get_ktls_send(SSL_get_wbio(ssl));
+    Metrics::instance().ktlsSendNegotiated(offloaded);
+    LOG_INFO("Client [" + std::to_string(client_fd) + "] kTLS send offload " +
+             (offloaded ? "active" : "unavailable, using userspace TLS"));
+  }
+  return true;
 }
 
-void Server::handle_client(int client_fd) {
+void Server::handle_client(const AcceptedClient& accepted) {
+  const int client_fd = accepted.fd;
   init_request_processor(
-      client_fd,
+      accepted,
       [client_fd](char* buf, size_t size) {
         return recv(client_fd, buf, size, 0);
       },
-      [client_fd](const char* data, size_t size) {
-        return send(client_fd, data, size, 0);
+      [client_fd](const char* data, size_t size, bool more) {
+        return send(client_fd, data, size,
+                    MSG_NOSIGNAL | (more ? MSG_MORE : 0));
+      },
+      [client_fd](int file_fd, size_t size, size_t& written,
+                  ConnectionDeadline& deadline) {
+        return send_file_plain(client_fd, file_fd, size, written, deadline);
       });
 }
 
-void Server::handle_client(SSL* ssl) {
-  int client_fd = SSL_get_fd(ssl);
+void Server::handle_client(SSL* ssl, const AcceptedClient& accepted) {
+  if (http2_enabled && negotiated_http2(ssl)) {
+    handle_http2_client(ssl, accepted);
+    return;
+  }
+
   init_request_processor(
-      client_fd,
+      accepted,
       [ssl](char* buf, size_t size) { return SSL_read(ssl, buf, size); },
-      [ssl](const char* data, size_t size) {
+      [ssl](const char* data, size_t size, bool) {
         return SSL_write(ssl, data, size);
       },
+      [ssl, ktls = BIO_get_ktls_send(SSL_get_wbio(ssl)) != 0](
+          int file_fd, size_t size, size_t& written,
+          ConnectionDeadline& deadline) {
+        return ktls ? send_file_ktls(ssl, file_fd, size, written, deadline)
+                    : send_file_tls(ssl, file_fd, size, written, deadline);
+      },
       true, ssl);
 }
 
+// HTTP/2 frames carry their own length and flow control, so file bodies are
+// read through the connection rather than sendfile'd, and every stream of
+// the connection is recorded as its own request.
+void Server::handle_http2_client(SSL* ssl, const AcceptedClient& accepted) {
+  const int client_fd = accepted.fd;
+  const ClientAddress& client = accepted.address;
+
+  LOG_INFO("Client [" + std::to_string(client_fd) +
+           "] connected via secure TLS (HTTP/2)");
+  Metrics::instance().connectionOpened();
+  Metrics::instance().http2Negotiated();
+
+  // The connection only reads once poll() reports data, but a TLS record
+  // can still arrive a byte at a time, so reads are bounded like a request
+  // head and writes like any other response.
+  ConnectionDeadline deadline(d_deadlines, client_fd);
+  Http2Transport transport{
+      [this, ssl, &deadline](char* buf, size_t size) -> ssize_t {
+        deadline.arm(TimeoutKind::Header, d_timeouts.header);
+        const int bytes = SSL_read(ssl, buf, static_cast<int>(size));
+        deadline.disarm();
+        return bytes;
+      },
+      [this, ssl, &deadline](const char* data, size_t size) -> ssize_t {
+        deadline.arm(TimeoutKind::Write, d_timeouts.writeStall);
+        const int bytes = SSL_write(ssl, data, static_cast<int>(size));
+        deadline.disarm();
+        return bytes;
+      },
+      // Also returns, once, when a drain starts. The wait is armed as an
+      // idle deadline so a drain that runs out of time can close it.
+      [this, ssl, client_fd, &deadline, drainSeen = false](
+          std::chrono::milliseconds timeout, int wakeFd) mutable {
+        if (SSL_pending(ssl) > 0) return true;
+        pollfd pfds[3] = {{client_fd, POLLIN, 0},
+                          {drainSeen ? -1 : d_drainFd, POLLIN, 0},
+                          {wakeFd, POLLIN, 0}};
+        if (timeout.count() > 0) deadline.arm(TimeoutKind::Idle, timeout);
+        const int ready = poll(pfds, 3, static_cast<int>(timeout.count()));
+        if (timeout.count() > 0) deadline.disarm();
+        if (ready > 0 && pfds[1].revents) drainSeen = true;
+        return ready > 0 && pfds[0].revents != 0;
+      }};
+
+  Http2Options options;
+  options.idleTimeout = d_timeouts.idle;
+  options.draining = [this]() {
+    return d_draining.load(std::memory_order_relaxed);
+  };
+  Http2Connection connection(
+      std::move(transport),
+      // Asynchronous handlers answer from wherever they finish, leaving the
+      // connection free to serve its other streams meanwhile.
+      Http2Connection::AsyncDispatch([this, client_fd, &client](
+                                         HttpRequest& request,
+                                         Http2Connection::Respond respond) {
+        LOG_INFO("Parsed HTTP/2 request from client [" +
+                 std::to_string(client_fd) + "]: " +
+                 std::string(request.method) + " " +
+                 std::string(request.path));
+        auto finish = [this, respond = std::move(respond)](
+                          HttpResponse response) {
+          if (!hsts_header.empty()) {
+            response.addHeader("Strict-Transport-Security", hsts_header);
+          }
+          respond(std::move(response));
+        };
+        if (!d_rateLimiter.allowRequest(client)) {
+          finish(Responses::tooManyRequests(
+              request, d_rateLimiter.limits().retryAfter));
+          return;
+        }
+        const RouteHandler* handler = Router::instance().match(request);
+        if (!handler) {
+          finish(Responses::notFound(request));
+          return;
+        }
+        start_handler(*handler, request, std::move(finish));
+      }),
+      [this, &client](const HttpRequest& request, const HttpResponse& response,
+                      size_t bytesSent, std::chrono::nanoseconds latency) {
+        Metrics::instance().recordRequest(request.method, request.route,
+                                          static_cast<int>(response.code),
+                                          latency.count(), bytesSent);
+        if (d_accessLog.isOpen()) {
+          d_accessLog.append({client, request.method, request.path,
+                              static_cast<int>(response.code), bytesSent,
+                              static_cast<uint32_t>(latency.count() / 1000),
+                              true, nullptr});
+        }
+      },
+      options);
+  connection.run();
+
+  deadline.arm(TimeoutKind::Write, d_timeouts.writeStall);
+  SSL_shutdown(ssl);
+  SSL_free(ssl);
+  deadline.disarm();
+  close(client_fd);
+  Metrics::instance().connectionClosed();
+  LOG_INFO("Client [" + std::to_string(client_fd) + "] disconnected (" +
+           std::to_string(connection.streamsServed()) + " HTTP/2 streams)");
+}
+
+bool Server::wait_for_request(int client_fd, SSL* ssl, bool drainable) {
+  if (ssl && SSL_pending(ssl) > 0) return true;
+
+  // Bounded by the idle deadline, which shuts the socket down and so wakes
+  // this poll, and ended early by a drain if 'drainable'. The drain eventfd
+  // stays readable, so a connection coming back to wait after the drain
+  // started closes too.
+  pollfd pfds[2] = {{client_fd, POLLIN, 0}, {d_drainFd, POLLIN, 0}};
+  if (poll(pfds, drainable ? 2 : 1, -1) <= 0) return false;
+  if (pfds[0].revents) return true;
+  LOG_INFO("Client [" + std::to_string(client_fd) +
+           "] idle, closing for drain");
+  d_drainIdleClosed++;
+  return false;
+}
+
 void Server::start_http_redirect(const Port& redirect_port) {
   LOG_INFO("Starting HTTP redirection on port " + redirect_port.toString() +
            " ...");
-  sockaddr_in6 address{};
-  address.sin6_family = AF_INET6;
-  address.sin6_addr = in6addr_any;
-  address.sin6_port = redirect_port.toNetwork();
-
-  redirection_server_fd = create_listening_socket(
-      reinterpret_cast<sockaddr*>(&address), sizeof(address));
-
   if (redirection_server_fd < 0) {
     LOG_ERROR("Redirection Server: Fatal: Failed to start redirect server");
     return;
@@ -277,45 +1101,10 @@ void Server::start_http_redirect(const Port& redirect_port) {
   LOG_INFO("HTTP -> HTTPS redirection enabled on port " +
            redirect_port.toString() + " with fd [" +
            std::to_string(redirection_server_fd) + "] ...");
-  accept_loop<sockaddr_in6>(
-      redirection_server_fd, d_running, [this](int client_fd) {
-        set_socket_recv_timeout(client_fd, kClientRecvTimeoutSec);
-
-        LOG_INFO("Accepted client [" + std::to_string(client_fd) +
-                 "] on redirect server");
-
-        char buffer[kRecvBufferSize];
-        int bytes = recv(client_fd, buffer, sizeof(buffer), 0);
-        if (bytes <= 0) {
-          if (bytes == 0)
-            LOG_INFO("Redirection Server: Client [" +
-                     std::to_string(client_fd) + "] closed connection");
-          else if (errno == EAGAIN || errno == EWOULDBLOCK)
-            LOG_INFO("Redirection Server: Client [" +
-                     std::to_string(client_fd) +
-                     "] idle timeout reached, closing");
-          else
-            LOG_INFO("Redirection Server: Fatal: Client [" +
-                     std::to_string(client_fd) + "] recv error");
-
-          close(client_fd);
-          return;
-        }
-
-        std::string raw(buffer, bytes);
-        HttpRequest request;
-        HttpParser::parse(raw, request);
-
-        HttpResponse response = Responses::redirection(request, d_port);
-
-        std::string payload = response.serialize();
-        send(client_fd, payload.c_str(), payload.size(), 0);
-        close(client_fd);
-
-        LOG_INFO("Client [" + std::to_string(client_fd) +
-                 "] disconnected from redirect server");
-      });
+  // The listener owns the socket from here and closes it once stopped.
+  d_redirectListener->run(redirection_server_fd);
+  redirection_server_fd = -1;
   LOG_INFO("Shutdown: HTTP -> HTTPS redirection stopped.");
 }
 
-}  // namespace HTTPServer
\ No newline at end of file
+}  // namespace HTTPServer
@@ -0,0 +1,50 @@
+#include "httpserver/socket_options.h"
+
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+#include <string>
+
+#include "httpserver/logger.h"
+
+namespace HTTPServer {
+
+namespace {
+
+bool setOption(int fd, int level, int name, int value) {
+    return setsockopt(fd, level, name, &value, sizeof(value)) == 0;
+}
+
+void setOrLog(int fd, int level, int name, int value, const char* description) {
+    if (!setOption(fd, level, name, value))
+        LOG_ERROR_ERRNO(std::string("setsockopt(") + description + ") failed");
+}
+
+} // namespace
+
+void configureListeningSocket(int fd, const SocketOptions& options, bool tcp) {
+    if (options.sendBuffer > 0) setOrLog(fd, SOL_SOCKET, SO_SNDBUF, options.sendBuffer, "SO_SNDBUF");
+    if (options.receiveBuffer > 0) setOrLog(fd, SOL_SOCKET, SO_RCVBUF, options.receiveBuffer, "SO_RCVBUF");
+    if (!tcp) return;
+
+    if (options.noDelay) setOrLog(fd, IPPROTO_TCP, TCP_NODELAY, 1, "TCP_NODELAY");
+    if (options.deferAccept.count() > 0)
+        setOrLog(fd, IPPROTO_TCP, TCP_DEFER_ACCEPT, static_cast<int>(options.deferAccept.count()), "TCP_DEFER_ACCEPT");
+    if (options.fastOpenQueue > 0) setOrLog(fd, IPPROTO_TCP, TCP_FASTOPEN, options.fastOpenQueue, "TCP_FASTOPEN");
+    if (options.busyPoll.count() > 0)
+        setOrLog(fd, SOL_SOCKET, SO_BUSY_POLL, static_cast<int>(options.busyPoll.count()), "SO_BUSY_POLL");
+}
+
+// Linux copies most of these from the listener when it creates the
+// connection; they are set again for the ones it does not.
+void configureAcceptedSocket(int fd, const SocketOptions& options, bool tcp) {
+    if (options.sendBuffer > 0) setOption(fd, SOL_SOCKET, SO_SNDBUF, options.sendBuffer);
+    if (options.receiveBuffer > 0) setOption(fd, SOL_SOCKET, SO_RCVBUF, options.receiveBuffer);
+    if (!tcp) return;
+
+    if (options.noDelay) setOption(fd, IPPROTO_TCP, TCP_NODELAY, 1);
+    if (options.busyPoll.count() > 0)
+        setOption(fd, SOL_SOCKET, SO_BUSY_POLL, static_cast<int>(options.busyPoll.count()));
+}
+
+} // namespace HTTPServer
@@ -0,0 +1,190 @@
+#include "httpserver/timer_wheel.h"
+
+#include <sys/socket.h>
+
+#include "httpserver/logger.h"
+#include "httpserver/metrics.h"
+
+namespace HTTPServer {
+
+TimerWheel::TimerWheel(std::chrono::milliseconds resolution, Clock::time_point origin)
+    : d_resolution(resolution.count() > 0 ? resolution : std::chrono::milliseconds(1)), d_origin(origin) {}
+
+TimerWheel::~TimerWheel() {
+    for (auto& level : d_slots) {
+        for (Timer*& slot : level) {
+            while (slot) unlink(*slot);
+        }
+    }
+}
+
+uint64_t TimerWheel::tickFor(Clock::time_point time) const {
+    if (time <= d_origin) return 0;
+    return static_cast<uint64_t>((time - d_origin) / d_resolution);
+}
+
+void TimerWheel::schedule(Timer& timer, Clock::time_point deadline) {
+    if (timer.d_wheel) unlink(timer);
+
+    // Round up so a timer never fires before its deadline.
+    uint64_t expiry = tickFor(deadline);
+    if (d_origin + expiry * d_resolution < deadline) expiry++;
+    timer.d_expiry = std::max(expiry, d_now + 1);
+    link(timer);
+}
+
+void TimerWheel::cancel(Timer& timer) {
+    if (timer.d_wheel) unlink(timer);
+}
+
+void TimerWheel::link(Timer& timer) {
+    constexpr uint64_t kSpan = uint64_t{1} << (kSlotBits * kLevels);
+    const uint64_t delta = timer.d_expiry - d_now;
+    // Beyond the top level: park in its furthest slot and re-place on cascade.
+    const uint64_t position = delta < kSpan ? timer.d_expiry : d_now + kSpan - 1;
+
+    size_t level = 0;
+    while (level + 1 < kLevels && (position - d_now) >> (kSlotBits * (level + 1)) != 0) level++;
+
+    Timer*& head = d_slots[level][(position >> (kSlotBits * level)) & (kSlots - 1)];
+    timer.d_wheel = this;
+    timer.d_slot = &head;
+    timer.d_level = level;
+    timer.d_prev = nullptr;
+    timer.d_next = head;
+    if (head) head->d_prev = &timer;
+    head = &timer;
+    d_levelSizes[level]++;
+    d_size++;
+}
+
+void TimerWheel::unlink(Timer& timer) {
+    if (timer.d_prev) {
+        timer.d_prev->d_next = timer.d_next;
+    } else {
+        *timer.d_slot = timer.d_next;
+    }
+    if (timer.d_next) timer.d_next->d_prev = timer.d_prev;
+    timer.d_wheel = nullptr;
+    timer.d_prev = timer.d_next = nullptr;
+    timer.d_slot = nullptr;
+    d_levelSizes[timer.d_level]--;
+    d_size--;
+}
+
+void TimerWheel::cascade(size_t level) {
+    Timer*& head = d_slots[level][(d_now >> (kSlotBits * level)) & (kSlots - 1)];
+    Timer* timer = head;
+    head = nullptr;
+    while (timer) {
+        Timer* next = timer->d_next;
+        d_levelSizes[level]--;
+        d_size--;
+        link(*timer);
+        timer = next;
+    }
+}
+
+std::string_view timeoutKindName(TimeoutKind kind) {
+    switch (kind) {
+    case TimeoutKind::Idle:
+        return "idle";
+    case TimeoutKind::Header:
+        return "header";
+    case TimeoutKind::Body:
+        return "body";
+    case TimeoutKind::Write:
+        return "write";
+    }
+    return "unknown";
+}
+
+DeadlineReaper::DeadlineReaper(std::chrono::milliseconds resolution) : d_wheel(resolution) {}
+
+DeadlineReaper::~DeadlineReaper() { stop(); }
+
+void DeadlineReaper::start() {
+    std::lock_guard<std::mutex> lock(d_mtx);
+    if (d_thread.joinable()) return;
+    d_stopping = false;
+    d_expiringAll = false;
+    d_thread = std::thread([this]() { run(); });
+}
+
+void DeadlineReaper::stop() {
+    {
+        std::lock_guard<std::mutex> lock(d_mtx);
+        if (!d_thread.joinable()) return;
+        d_stopping = true;
+    }
+    d_cv.notify_all();
+    d_thread.join();
+}
+
+size_t DeadlineReaper::pending() const {
+    std::lock_guard<std::mutex> lock(d_mtx);
+    return d_wheel.size();
+}
+
+size_t DeadlineReaper::expireAll() {
+    std::lock_guard<std::mutex> lock(d_mtx);
+    d_expiringAll = true;
+    return d_wheel.expireAll(
+        [](TimerWheel::Timer& timer) { static_cast<ConnectionDeadline::Entry&>(timer).owner->fire(true); });
+}
+
+// Expiry runs under the lock: a connection disarms under the same lock
+// before closing its socket, so a deadline can never shut down a descriptor
+// that has already been closed and reused.
+void DeadlineReaper::run() {
+    std::unique_lock<std::mutex> lock(d_mtx);
+    while (!d_stopping) {
+        d_cv.wait_for(lock, d_wheel.resolution());
+        d_wheel.advance(TimerWheel::Clock::now(), [](TimerWheel::Timer& timer) {
+            static_cast<ConnectionDeadline::Entry&>(timer).owner->fire();
+        });
+    }
+}
+
+ConnectionDeadline::ConnectionDeadline(DeadlineReaper& reaper, int fd) : d_reaper(reaper), d_fd(fd) {
+    d_entry.owner = this;
+}
+
+ConnectionDeadline::~ConnectionDeadline() { disarm(); }
+
+void ConnectionDeadline::arm(TimeoutKind kind, std::chrono::milliseconds timeout) {
+    std::lock_guard<std::mutex> lock(d_reaper.d_mtx);
+    if (expired()) return;
+    d_entry.kind = kind;
+    d_entry.timeout = timeout;
+    if (d_reaper.d_expiringAll) {
+        fire(true);
+        return;
+    }
+    d_reaper.d_wheel.schedule(d_entry, TimerWheel::Clock::now() + timeout);
+}
+
+void ConnectionDeadline::extend() {
+    std::lock_guard<std::mutex> lock(d_reaper.d_mtx);
+    if (expired() || !d_entry.scheduled()) return;
+    d_reaper.d_wheel.schedule(d_entry, TimerWheel::Clock::now() + d_entry.timeout);
+}
+
+void ConnectionDeadline::disarm() {
+    std::lock_guard<std::mutex> lock(d_reaper.d_mtx);
+    d_reaper.d_wheel.cancel(d_entry);
+}
+
+void ConnectionDeadline::fire(bool forced) {
+    d_expired.store(true, std::memory_order_release);
+    if (forced) {
+        LOG_INFO("Client [" + std::to_string(d_fd) + "] still open at the drain deadline, closing");
+    } else {
+        LOG_INFO("Client [" + std::to_string(d_fd) + "] " + std::string(timeoutKindName(d_entry.kind)) +
+                 " timeout reached, closing");
+        Metrics::instance().connectionTimedOut(d_entry.kind);
+    }
+    shutdown(d_fd, SHUT_RDWR);
+}
+
+} // namespace HTTPServer
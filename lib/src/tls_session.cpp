@@ -0,0 +1,139 @@
+#include "httpserver/tls_session.h"
+
+#include <openssl/core_names.h>
+#include <openssl/evp.h>
+#include <openssl/rand.h>
+
+#include <algorithm>
+#include <cstring>
+
+#include "httpserver/logger.h"
+
+namespace HTTPServer {
+
+namespace {
+
+constexpr unsigned char kSessionIdContext[] = "httpserver";
+
+int ringIndex() {
+    static const int index = SSL_CTX_get_ex_new_index(0, nullptr, nullptr, nullptr, nullptr);
+    return index;
+}
+
+bool initMac(EVP_MAC_CTX* mac, const unsigned char* key, size_t length) {
+    char digest[] = "SHA256";
+    OSSL_PARAM params[] = {
+        OSSL_PARAM_construct_octet_string(OSSL_MAC_PARAM_KEY, const_cast<unsigned char*>(key), length),
+        OSSL_PARAM_construct_utf8_string(OSSL_MAC_PARAM_DIGEST, digest, 0),
+        OSSL_PARAM_construct_end(),
+    };
+    return EVP_MAC_CTX_set_params(mac, params) == 1;
+}
+
+} // namespace
+
+TicketKeyRing::TicketKeyRing(std::chrono::seconds rotationInterval, std::chrono::seconds sessionLifetime)
+    : d_rotationInterval(rotationInterval), d_sessionLifetime(sessionLifetime) {
+    rotate();
+}
+
+bool TicketKeyRing::install(SSL_CTX* ctx) {
+    if (ringIndex() < 0 || SSL_CTX_set_ex_data(ctx, ringIndex(), this) != 1) return false;
+    return SSL_CTX_set_tlsext_ticket_key_evp_cb(ctx, &TicketKeyRing::ticketCallback) == 1;
+}
+
+void TicketKeyRing::rotate() {
+    std::lock_guard<std::mutex> lock(d_mtx);
+    rotateLocked(std::chrono::steady_clock::now());
+}
+
+size_t TicketKeyRing::keyCount() const {
+    std::lock_guard<std::mutex> lock(d_mtx);
+    return d_keys.size();
+}
+
+void TicketKeyRing::rotateLocked(std::chrono::steady_clock::time_point now) {
+    Key key;
+    if (RAND_bytes(key.name.data(), key.name.size()) != 1 || RAND_bytes(key.aesKey.data(), key.aesKey.size()) != 1 ||
+        RAND_bytes(key.hmacKey.data(), key.hmacKey.size()) != 1) {
+        LOG_ERROR("TLS: Failed to generate session ticket key, keeping current key");
+        return;
+    }
+    key.created = now;
+    d_keys.push_front(key);
+
+    // A key stops sealing when its successor is created and is kept until
+    // every ticket it sealed has expired.
+    while (d_keys.size() > 1) {
+        const auto retiredAt = d_keys[d_keys.size() - 2].created;
+        if (now - retiredAt < d_sessionLifetime) break;
+        d_keys.pop_back();
+    }
+}
+
+int TicketKeyRing::ticketCallback(SSL* ssl, unsigned char* keyName, unsigned char* iv, EVP_CIPHER_CTX* cipher,
+                                  EVP_MAC_CTX* mac, int encrypt) {
+    auto* ring = static_cast<TicketKeyRing*>(SSL_CTX_get_ex_data(SSL_get_SSL_CTX(ssl), ringIndex()));
+    if (!ring) return -1;
+    return encrypt ? ring->seal(keyName, iv, cipher, mac) : ring->open(keyName, iv, cipher, mac);
+}
+
+int TicketKeyRing::seal(unsigned char* keyName, unsigned char* iv, EVP_CIPHER_CTX* cipher, EVP_MAC_CTX* mac) {
+    std::lock_guard<std::mutex> lock(d_mtx);
+    const auto now = std::chrono::steady_clock::now();
+    if (d_keys.empty() || now - d_keys.front().created >= d_rotationInterval) {
+        rotateLocked(now);
+        LOG_INFO("TLS: Rotated session ticket key (" + std::to_string(d_keys.size()) + " active)");
+    }
+    if (d_keys.empty()) return -1;
+
+    const Key& key = d_keys.front();
+    const int ivLength = EVP_CIPHER_get_iv_length(EVP_aes_256_cbc());
+    if (RAND_bytes(iv, ivLength) != 1) return -1;
+
+    std::memcpy(keyName, key.name.data(), kNameLength);
+    if (EVP_EncryptInit_ex(cipher, EVP_aes_256_cbc(), nullptr, key.aesKey.data(), iv) != 1) return -1;
+    if (!initMac(mac, key.hmacKey.data(), key.hmacKey.size())) return -1;
+    return 1;
+}
+
+int TicketKeyRing::open(const unsigned char* keyName, const unsigned char* iv, EVP_CIPHER_CTX* cipher,
+                        EVP_MAC_CTX* mac) {
+    std::lock_guard<std::mutex> lock(d_mtx);
+    auto it = std::find_if(d_keys.begin(), d_keys.end(), [keyName](const Key& key) {
+        return std::memcmp(key.name.data(), keyName, kNameLength) == 0;
+    });
+    if (it == d_keys.end()) {
+        return 0; // unknown or expired key: fall back to a full handshake
+    }
+
+    if (!initMac(mac, it->hmacKey.data(), it->hmacKey.size())) return -1;
+    if (EVP_DecryptInit_ex(cipher, EVP_aes_256_cbc(), nullptr, it->aesKey.data(), iv) != 1) return -1;
+
+    const bool current = it == d_keys.begin() &&
+                         std::chrono::steady_clock::now() - it->created < d_rotationInterval;
+    return current ? 1 : 2; // 2 asks OpenSSL to issue a fresh ticket
+}
+
+void configureTlsSessions(SSL_CTX* ctx, const TlsSessionOptions& options, TicketKeyRing* ticketKeys) {
+    SSL_CTX_set_session_id_context(ctx, kSessionIdContext, sizeof(kSessionIdContext) - 1);
+    SSL_CTX_set_timeout(ctx, static_cast<long>(options.sessionLifetime.count()));
+
+    if (options.sessionCache) {
+        SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_SERVER);
+        SSL_CTX_sess_set_cache_size(ctx, static_cast<long>(options.sessionCacheSize));
+    } else {
+        SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_OFF);
+    }
+
+    if (options.sessionTickets && ticketKeys && ticketKeys->install(ctx)) {
+        SSL_CTX_clear_options(ctx, SSL_OP_NO_TICKET);
+    } else {
+        if (options.sessionTickets) {
+            LOG_WARN("TLS: Failed to install session ticket keys, tickets disabled");
+        }
+        SSL_CTX_set_options(ctx, SSL_OP_NO_TICKET);
+    }
+}
+
+} // namespace HTTPServer
@@ -0,0 +1,107 @@
+#include "httpserver/unix_socket.h"
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+
+#include "httpserver/logger.h"
+
+namespace HTTPServer {
+
+namespace UnixSocket {
+
+namespace {
+
+// Removes a socket file nothing listens on any more. Only sockets are
+// touched, and only once a connection to them is refused.
+bool removeStale(const std::string& path, const sockaddr_un& address, socklen_t length) {
+    struct stat info{};
+    if (lstat(path.c_str(), &info) < 0) return errno == ENOENT;
+    if (!S_ISSOCK(info.st_mode)) {
+        LOG_ERROR("Unix socket path " + path + " exists and is not a socket");
+        return false;
+    }
+
+    const int probe = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (probe < 0) return false;
+    const bool refused = connect(probe, reinterpret_cast<const sockaddr*>(&address), length) < 0 &&
+                         errno == ECONNREFUSED;
+    close(probe);
+    if (!refused) {
+        LOG_ERROR("Unix socket " + path + " is in use by another process");
+        return false;
+    }
+    LOG_INFO("Startup: Removing stale unix socket " + path);
+    return unlink(path.c_str()) == 0 || errno == ENOENT;
+}
+
+} // namespace
+
+bool makeAddress(std::string_view path, sockaddr_un& address, socklen_t& length) {
+    // Abstract names are not NUL terminated, so may use the whole of sun_path.
+    const bool abstract = !path.empty() && path.front() == kAbstractPrefix;
+    if (path.empty() || (abstract && path.size() == 1)) return false;
+    if (path.size() + (abstract ? 0 : 1) > sizeof(address.sun_path)) return false;
+
+    address = {};
+    address.sun_family = AF_UNIX;
+    std::memcpy(address.sun_path, path.data(), path.size());
+    if (abstract) address.sun_path[0] = '\0';
+    length = static_cast<socklen_t>(offsetof(sockaddr_un, sun_path) + path.size() + (abstract ? 0 : 1));
+    return true;
+}
+
+std::string boundPath(int fd) {
+    sockaddr_un address{};
+    socklen_t length = sizeof(address);
+    if (getsockname(fd, reinterpret_cast<sockaddr*>(&address), &length) < 0 || address.sun_family != AF_UNIX)
+        return {};
+    const size_t size = length > offsetof(sockaddr_un, sun_path) ? length - offsetof(sockaddr_un, sun_path) : 0;
+    if (size == 0) return {};
+    if (address.sun_path[0] == '\0') return kAbstractPrefix + std::string(address.sun_path + 1, size - 1);
+    return std::string(address.sun_path, strnlen(address.sun_path, size));
+}
+
+int listen(const std::string& path, mode_t mode, const SocketOptions& options) {
+    sockaddr_un address;
+    socklen_t length;
+    if (!makeAddress(path, address, length)) {
+        LOG_ERROR("Invalid unix socket path '" + path + "'");
+        return -1;
+    }
+    const bool abstract = path.front() == kAbstractPrefix;
+    if (!abstract && !removeStale(path, address, length)) return -1;
+
+    const int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        LOG_ERROR_ERRNO("Socket creation failed");
+        return -1;
+    }
+    configureListeningSocket(fd, options, false);
+    if (bind(fd, reinterpret_cast<sockaddr*>(&address), length) < 0) {
+        LOG_ERROR_ERRNO("Bind failed on unix socket " + path);
+        close(fd);
+        return -1;
+    }
+    // Set before listen() so nobody can connect with the umask's defaults.
+    if (!abstract && chmod(path.c_str(), mode) < 0) {
+        LOG_ERROR_ERRNO("chmod failed on unix socket " + path);
+        unlink(path.c_str());
+        close(fd);
+        return -1;
+    }
+    if (::listen(fd, options.backlog) < 0) {
+        LOG_ERROR_ERRNO("Listen failed on unix socket " + path);
+        if (!abstract) unlink(path.c_str());
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+} // namespace UnixSocket
+
+} // namespace HTTPServer
@@ -1,33 +1,73 @@
 #include "httpserver/utils.h"
 
-#include <string>
 #include <algorithm>
+#include <cctype>
+#include <string_view>
 
 #include "httpserver/http_object.h"
 
 namespace HTTPServer {
 
-std::string statusCodeToString(StatusCode code) {
+std::string_view statusCodeToString(StatusCode code) {
     switch (code) {
+        case StatusCode::SwitchingProtocols:
+            return "Switching Protocols";
         case StatusCode::OK:
             return "OK";
+        case StatusCode::Created:
+            return "Created";
+        case StatusCode::Accepted:
+            return "Accepted";
+        case StatusCode::NoContent:
+            return "No Content";
+        case StatusCode::MovedPermanently:
+            return "Moved Permanently";
+        case StatusCode::Found:
+            return "Found";
+        case StatusCode::SeeOther:
+            return "See Other";
+        case StatusCode::NotModified:
+            return "Not Modified";
+        case StatusCode::TemporaryRedirect:
+            return "Temporary Redirect";
+        case StatusCode::PermanentRedirect:
+            return "Permanent Redirect";
         case StatusCode::BadRequest:
             return "Bad Request";
+        case StatusCode::Unauthorized:
+            return "Unauthorized";
+        case StatusCode::Forbidden:
+            return "Forbidden";
         case StatusCode::NotFound:
             return "Not Found";
+        case StatusCode::MethodNotAllowed:
+            return "Method Not Allowed";
+        case StatusCode::Conflict:
+            return "Conflict";
+        case StatusCode::PayloadTooLarge:
+            return "Payload Too Large";
+        case StatusCode::TooManyRequests:
+            return "Too Many Requests";
         case StatusCode::InternalServerError:
             return "Internal Server Error";
+        case StatusCode::BadGateway:
+            return "Bad Gateway";
+        case StatusCode::ServiceUnavailable:
+            return "Service Unavailable";
+        case StatusCode::GatewayTimeout:
+            return "Gateway Timeout";
         default:
             return "Unknown";
     }
 }
 
 bool requestWantsKeepAlive(const HttpRequest& req) {
-    auto it = req.headers.find("Connection");
+    auto it = req.headers.find(std::string_view("Connection"));
     if (it != req.headers.end()) {
-        std::string value = it->second;
-        std::transform(value.begin(), value.end(), value.begin(), ::tolower);
-        return value == "keep-alive";
+        constexpr std::string_view keepAlive = "keep-alive";
+        const std::string_view value = it->second;
+        return std::equal(value.begin(), value.end(), keepAlive.begin(), keepAlive.end(),
+                          [](char a, char b) { return std::tolower(static_cast<unsigned char>(a)) == b; });
     }
 
     if (req.version == "HTTP/1.1")
@@ -36,11 +76,39 @@ bool requestWantsKeepAlive(const HttpRequest& req) {
     return false;
 }
 
-std::string Mime::fromExtension(const std::string& path) {
+bool equalsIgnoreCase(std::string_view a, std::string_view b) {
+    return std::equal(a.begin(), a.end(), b.begin(), b.end(), [](char x, char y) {
+        return std::tolower(static_cast<unsigned char>(x)) == std::tolower(static_cast<unsigned char>(y));
+    });
+}
+
+std::string_view findHeader(const HeaderMap& headers, std::string_view name) {
+    auto it = headers.find(name);
+    if (it != headers.end()) return it->second;
+    for (const auto& [key, value] : headers) {
+        if (equalsIgnoreCase(key, name)) return value;
+    }
+    return {};
+}
+
+bool hasToken(std::string_view value, std::string_view token) {
+    while (!value.empty()) {
+        const size_t comma = value.find(',');
+        std::string_view item = value.substr(0, comma);
+        while (!item.empty() && (item.front() == ' ' || item.front() == '\t')) item.remove_prefix(1);
+        while (!item.empty() && (item.back() == ' ' || item.back() == '\t')) item.remove_suffix(1);
+        if (equalsIgnoreCase(item, token)) return true;
+        if (comma == std::string_view::npos) break;
+        value.remove_prefix(comma + 1);
+    }
+    return false;
+}
+
+std::string_view Mime::fromExtension(std::string_view path) {
     auto pos = path.find_last_of('.');
-    if (pos == std::string::npos) return "application/octet-stream";
+    if (pos == std::string_view::npos) return "application/octet-stream";
 
-    std::string ext = path.substr(pos + 1);
+    std::string_view ext = path.substr(pos + 1);
 
     if (ext == "html") return "text/html";
     if (ext == "css") return "text/css";
@@ -53,4 +121,4 @@ std::string Mime::fromExtension(const std::string& path) {
     return "application/octet-stream";
 }
 
-} // namespace HTTPServer
\ No newline at end of file
+} // namespace HTTPServer
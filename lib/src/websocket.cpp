@@ -0,0 +1,516 @@
+#include "httpserver/websocket.h"
+
+#include <openssl/evp.h>
+#include <openssl/sha.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <utility>
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#include "httpserver/http_response_builder.h"
+#include "httpserver/logger.h"
+#include "httpserver/utils.h"
+
+namespace HTTPServer {
+
+namespace WebSocket {
+
+bool readFrameHeader(std::string_view in, FrameHeader& header) {
+    if (in.size() < 2) return false;
+    const auto* bytes = reinterpret_cast<const unsigned char*>(in.data());
+    header.fin = (bytes[0] & 0x80) != 0;
+    header.reserved = (bytes[0] >> 4) & 0x7;
+    header.opcode = static_cast<Opcode>(bytes[0] & 0x0f);
+    header.masked = (bytes[1] & 0x80) != 0;
+
+    uint64_t length = bytes[1] & 0x7f;
+    size_t size = 2;
+    if (length == 126) {
+        if (in.size() < 4) return false;
+        length = (static_cast<uint64_t>(bytes[2]) << 8) | bytes[3];
+        size = 4;
+    } else if (length == 127) {
+        if (in.size() < 10) return false;
+        length = 0;
+        for (size_t i = 2; i < 10; i++) length = (length << 8) | bytes[i];
+        size = 10;
+    }
+    if (header.masked) {
+        if (in.size() < size + 4) return false;
+        std::memcpy(&header.maskKey, bytes + size, 4);
+        size += 4;
+    }
+    header.length = length;
+    header.size = size;
+    return true;
+}
+
+void writeFrame(std::string& out, Opcode opcode, std::string_view payload, bool fin) {
+    const size_t length = payload.size();
+    out.reserve(out.size() + kMaxFrameHeaderSize + length);
+    out.push_back(static_cast<char>((fin ? 0x80 : 0x00) | static_cast<uint8_t>(opcode)));
+    if (length < 126) {
+        out.push_back(static_cast<char>(length));
+    } else if (length <= 0xffff) {
+        out.push_back(static_cast<char>(126));
+        out.push_back(static_cast<char>(length >> 8));
+        out.push_back(static_cast<char>(length));
+    } else {
+        out.push_back(static_cast<char>(127));
+        for (int shift = 56; shift >= 0; shift -= 8) out.push_back(static_cast<char>(length >> shift));
+    }
+    out.append(payload);
+}
+
+// Every wide step covers a multiple of four bytes, so the key lines up with
+// the data the same way in each lane and no rotation is needed until the
+// last few bytes.
+void unmask(char* data, size_t size, uint32_t key) {
+    size_t i = 0;
+#if defined(__AVX2__)
+    const __m256i mask256 = _mm256_set1_epi32(static_cast<int>(key));
+    for (; i + 32 <= size; i += 32) {
+        auto* p = reinterpret_cast<__m256i*>(data + i);
+        _mm256_storeu_si256(p, _mm256_xor_si256(_mm256_loadu_si256(p), mask256));
+    }
+#endif
+#if defined(__SSE2__)
+    const __m128i mask128 = _mm_set1_epi32(static_cast<int>(key));
+    for (; i + 16 <= size; i += 16) {
+        auto* p = reinterpret_cast<__m128i*>(data + i);
+        _mm_storeu_si128(p, _mm_xor_si128(_mm_loadu_si128(p), mask128));
+    }
+#elif defined(__ARM_NEON)
+    const uint8x16_t mask128 = vreinterpretq_u8_u32(vdupq_n_u32(key));
+    for (; i + 16 <= size; i += 16) {
+        auto* p = reinterpret_cast<uint8_t*>(data + i);
+        vst1q_u8(p, veorq_u8(vld1q_u8(p), mask128));
+    }
+#endif
+    const uint64_t mask64 = (static_cast<uint64_t>(key) << 32) | key;
+    for (; i + 8 <= size; i += 8) {
+        uint64_t word;
+        std::memcpy(&word, data + i, 8);
+        word ^= mask64;
+        std::memcpy(data + i, &word, 8);
+    }
+    const auto* keyBytes = reinterpret_cast<const unsigned char*>(&key);
+    for (; i < size; i++) data[i] = static_cast<char>(data[i] ^ keyBytes[i % 4]);
+}
+
+bool isValidUtf8(std::string_view text) {
+    static constexpr uint32_t kMinimum[] = {0, 0, 0x80, 0x800, 0x10000};
+    const auto* bytes = reinterpret_cast<const unsigned char*>(text.data());
+    const size_t size = text.size();
+    size_t i = 0;
+    while (i < size) {
+        // Skip ASCII eight bytes at a time.
+        if (i + 8 <= size) {
+            uint64_t word;
+            std::memcpy(&word, bytes + i, 8);
+            if ((word & 0x8080808080808080ULL) == 0) {
+                i += 8;
+                continue;
+            }
+        }
+        const unsigned char lead = bytes[i];
+        if (lead < 0x80) {
+            i++;
+            continue;
+        }
+
+        size_t length;
+        uint32_t codePoint;
+        if ((lead & 0xe0) == 0xc0) {
+            length = 2;
+            codePoint = lead & 0x1f;
+        } else if ((lead & 0xf0) == 0xe0) {
+            length = 3;
+            codePoint = lead & 0x0f;
+        } else if ((lead & 0xf8) == 0xf0) {
+            length = 4;
+            codePoint = lead & 0x07;
+        } else {
+            return false;
+        }
+        if (i + length > size) return false;
+        for (size_t k = 1; k < length; k++) {
+            if ((bytes[i + k] & 0xc0) != 0x80) return false;
+            codePoint = (codePoint << 6) | (bytes[i + k] & 0x3f);
+        }
+        // Overlong encodings, UTF-16 surrogates and values past Unicode.
+        if (codePoint < kMinimum[length] || codePoint > 0x10ffff || (codePoint >= 0xd800 && codePoint <= 0xdfff))
+            return false;
+        i += length;
+    }
+    return true;
+}
+
+std::string acceptKey(std::string_view clientKey) {
+    std::string input(clientKey);
+    input += kAcceptGuid;
+    unsigned char digest[SHA_DIGEST_LENGTH];
+    SHA1(reinterpret_cast<const unsigned char*>(input.data()), input.size(), digest);
+    unsigned char encoded[4 * ((SHA_DIGEST_LENGTH + 2) / 3) + 1];
+    const int length = EVP_EncodeBlock(encoded, digest, SHA_DIGEST_LENGTH);
+    return std::string(reinterpret_cast<const char*>(encoded), length);
+}
+
+HttpResponse handshake(const HttpRequest& req) {
+    // The key is 16 random bytes in base64.
+    const std::string_view key = findHeader(req.headers, "Sec-WebSocket-Key");
+    if (req.method != "GET" || req.version != "HTTP/1.1" || key.size() != 24 ||
+        !hasToken(findHeader(req.headers, "Upgrade"), "websocket") ||
+        !hasToken(findHeader(req.headers, "Connection"), "upgrade")) {
+        return Responses::badRequest(req.get_allocator());
+    }
+    if (findHeader(req.headers, "Sec-WebSocket-Version") != "13") {
+        HttpResponse res = Responses::badRequest(req.get_allocator());
+        res.addHeader("Sec-WebSocket-Version", "13");
+        return res;
+    }
+
+    HttpResponse res(req.get_allocator());
+    res.setStatus(StatusCode::SwitchingProtocols)
+        .addHeader("Upgrade", "websocket")
+        .addHeader("Connection", "Upgrade")
+        .addHeader("Sec-WebSocket-Accept", acceptKey(key));
+    return res;
+}
+
+} // namespace WebSocket
+
+using WebSocket::CloseCode;
+using WebSocket::Opcode;
+
+WebSocketConnection::WebSocketConnection(WebSocketTransport transport, WebSocketHandler handler,
+                                         const WebSocketOptions& options)
+    : d_transport(std::move(transport)), d_handler(std::move(handler)), d_options(options),
+      d_wakeFd(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) {
+    if (d_wakeFd < 0) LOG_ERROR_ERRNO("WebSocket: Failed to create wake eventfd");
+}
+
+WebSocketConnection::~WebSocketConnection() {
+    if (d_wakeFd >= 0) ::close(d_wakeFd);
+}
+
+void WebSocketConnection::run(const HttpRequest& upgrade, std::string_view pending) {
+    const WebSocketPtr self = shared_from_this();
+    d_lastHeard = Clock::now();
+    d_input.assign(pending);
+    if (d_handler.onOpen) d_handler.onOpen(self, upgrade);
+
+    while (true) {
+        processInput();
+        if (d_state.load(std::memory_order_relaxed) == State::Open && d_options.draining && d_options.draining())
+            sendClose(CloseCode::GoingAway, "");
+        if (!flush() || d_state.load(std::memory_order_relaxed) == State::Closed) break;
+
+        const auto now = Clock::now();
+        if (d_state.load(std::memory_order_relaxed) == State::Closing) {
+            if (now >= d_closeSent + kCloseTimeout) break;
+        } else if (d_options.pingInterval.count() > 0 && now >= d_lastHeard + d_options.pingInterval) {
+            if (d_pingSent) {
+                if (now >= d_lastHeard + 2 * d_options.pingInterval) break; // peer is gone
+            } else {
+                WebSocket::writeFrame(d_control, Opcode::Ping, "");
+                d_pingSent = true;
+                continue;
+            }
+        }
+
+        const bool readable = d_transport.waitReadable(nextTimeout(now), d_wakeFd);
+        uint64_t wakes;
+        if (::read(d_wakeFd, &wakes, sizeof(wakes)) > 0) {
+            std::lock_guard<std::mutex> lock(d_mtx);
+            d_woken = false;
+        }
+        if (!readable) continue;
+
+        const size_t used = d_input.size();
+        d_input.resize(used + kReadSize);
+        const ssize_t bytes = d_transport.read(d_input.data() + used, kReadSize);
+        d_input.resize(used + static_cast<size_t>(std::max<ssize_t>(bytes, 0)));
+        if (bytes <= 0) break;
+        d_lastHeard = Clock::now();
+        d_pingSent = false;
+    }
+
+    d_state.store(State::Closed, std::memory_order_relaxed);
+    {
+        std::lock_guard<std::mutex> lock(d_mtx);
+        d_outbox.clear();
+        d_queuedBytes = 0;
+    }
+    if (d_handler.onClose) d_handler.onClose(self, d_closeCode);
+}
+
+std::chrono::milliseconds WebSocketConnection::nextTimeout(Clock::time_point now) const {
+    Clock::time_point deadline;
+    if (d_state.load(std::memory_order_relaxed) == State::Closing) {
+        deadline = d_closeSent + kCloseTimeout;
+    } else if (d_options.pingInterval.count() > 0) {
+        deadline = d_lastHeard + (d_pingSent ? 2 : 1) * d_options.pingInterval;
+    } else {
+        return std::chrono::milliseconds(-1);
+    }
+    // Rounded up, so the wait never ends just short of the deadline.
+    const auto remaining = std::chrono::ceil<std::chrono::milliseconds>(deadline - now);
+    return std::max(remaining, std::chrono::milliseconds(1));
+}
+
+// Handles every complete frame buffered. Sizes are checked from the header,
+// so an oversized message is refused before its payload is read.
+void WebSocketConnection::processInput() {
+    size_t at = 0;
+    while (d_state.load(std::memory_order_relaxed) != State::Closed) {
+        WebSocket::FrameHeader header;
+        const std::string_view rest(d_input.data() + at, d_input.size() - at);
+        if (!WebSocket::readFrameHeader(rest, header)) break;
+
+        const bool control = (static_cast<uint8_t>(header.opcode) & 0x8) != 0;
+        const bool known = header.opcode == Opcode::Continuation || header.opcode == Opcode::Text ||
+                           header.opcode == Opcode::Binary || header.opcode == Opcode::Close ||
+                           header.opcode == Opcode::Ping || header.opcode == Opcode::Pong;
+        // Frames from a client are always masked.
+        if (!known || header.reserved != 0 || !header.masked ||
+            (control && (!header.fin || header.length > WebSocket::kMaxControlPayload))) {
+            fail(CloseCode::ProtocolError);
+            break;
+        }
+        const size_t assembled = header.opcode == Opcode::Continuation ? d_message.size() : 0;
+        if (!control && header.length > d_options.maxMessageSize - assembled) {
+            fail(CloseCode::MessageTooBig);
+            break;
+        }
+        if (rest.size() - header.size < header.length) break;
+
+        char* payload = d_input.data() + at + header.size;
+        WebSocket::unmask(payload, header.length, header.maskKey);
+        processFrame(header, std::string_view(payload, header.length));
+        at += header.size + header.length;
+    }
+    d_input.erase(0, at);
+}
+
+void WebSocketConnection::processFrame(const WebSocket::FrameHeader& header, std::string_view payload) {
+    switch (header.opcode) {
+    case Opcode::Text:
+    case Opcode::Binary:
+        if (d_inMessage) return fail(CloseCode::ProtocolError);
+        if (header.fin) return deliver(payload, header.opcode == Opcode::Binary);
+        d_message.assign(payload);
+        d_inMessage = true;
+        d_messageBinary = header.opcode == Opcode::Binary;
+        return;
+    case Opcode::Continuation:
+        if (!d_inMessage) return fail(CloseCode::ProtocolError);
+        d_message.append(payload);
+        if (header.fin) {
+            d_inMessage = false;
+            deliver(d_message, d_messageBinary);
+            d_message.clear();
+        }
+        return;
+    case Opcode::Ping:
+        if (d_state.load(std::memory_order_relaxed) == State::Open)
+            WebSocket::writeFrame(d_control, Opcode::Pong, payload);
+        return;
+    case Opcode::Pong:
+        return;
+    case Opcode::Close: {
+        CloseCode code = CloseCode::NoStatus;
+        if (payload.size() == 1) return fail(CloseCode::ProtocolError);
+        if (payload.size() >= 2) {
+            code = static_cast<CloseCode>((static_cast<uint8_t>(payload[0]) << 8) | static_cast<uint8_t>(payload[1]));
+            if (!WebSocket::isValidUtf8(payload.substr(2))) return fail(CloseCode::InvalidPayload);
+        }
+        // Answers a close the peer started by echoing its code.
+        if (d_state.load(std::memory_order_relaxed) == State::Open)
+            WebSocket::writeFrame(d_control, Opcode::Close, payload.substr(0, std::min<size_t>(payload.size(), 2)));
+        d_closeCode = code;
+        d_state.store(State::Closed, std::memory_order_relaxed);
+        return;
+    }
+    }
+}
+
+void WebSocketConnection::deliver(std::string_view message, bool binary) {
+    if (!binary && !WebSocket::isValidUtf8(message)) return fail(CloseCode::InvalidPayload);
+    if (d_handler.onMessage) d_handler.onMessage(shared_from_this(), message, binary);
+}
+
+// Control frames go first, then the queued messages, then a Close frame if
+// one was asked for, so a close never overtakes what was sent before it.
+bool WebSocketConnection::flush() {
+    auto writeControl = [this]() {
+        if (d_control.empty()) return true;
+        const bool written = writeAll(d_control);
+        d_control.clear();
+        return written;
+    };
+    if (!writeControl()) return false;
+
+    while (true) {
+        std::shared_ptr<const std::string> frame;
+        {
+            std::lock_guard<std::mutex> lock(d_mtx);
+            if (d_outbox.empty()) break;
+            frame = std::move(d_outbox.front());
+            d_outbox.pop_front();
+            d_queuedBytes -= frame->size();
+        }
+        if (d_state.load(std::memory_order_relaxed) != State::Open) continue;
+        if (!writeAll(*frame)) return false;
+    }
+
+    std::unique_lock<std::mutex> lock(d_mtx);
+    if (d_closeRequested) {
+        d_closeRequested = false;
+        const CloseCode code = d_requestedCode;
+        const std::string reason = std::move(d_requestedReason);
+        lock.unlock();
+        sendClose(code, reason);
+    } else {
+        lock.unlock();
+    }
+    return writeControl();
+}
+
+bool WebSocketConnection::writeAll(std::string_view data) {
+    while (!data.empty()) {
+        const ssize_t written = d_transport.write(data.data(), data.size());
+        if (written <= 0) {
+            if (written < 0 && errno == EINTR) continue;
+            return false;
+        }
+        data.remove_prefix(static_cast<size_t>(written));
+    }
+    return true;
+}
+
+void WebSocketConnection::sendClose(CloseCode code, std::string_view reason) {
+    if (d_state.load(std::memory_order_relaxed) != State::Open) return;
+    const auto value = static_cast<uint16_t>(code);
+    std::string payload{static_cast<char>(value >> 8), static_cast<char>(value & 0xff)};
+    payload.append(reason.substr(0, WebSocket::kMaxControlPayload - 2));
+    WebSocket::writeFrame(d_control, Opcode::Close, payload);
+    d_closeCode = code;
+    d_closeSent = Clock::now();
+    d_state.store(State::Closing, std::memory_order_relaxed);
+}
+
+// A peer that breaks the protocol is sent a Close frame and dropped without
+// waiting for its reply.
+void WebSocketConnection::fail(CloseCode code) {
+    sendClose(code, "");
+    d_closeCode = code;
+    d_state.store(State::Closed, std::memory_order_relaxed);
+}
+
+bool WebSocketConnection::send(std::string_view text) {
+    auto frame = std::make_shared<std::string>();
+    WebSocket::writeFrame(*frame, Opcode::Text, text);
+    return sendFrame(std::move(frame));
+}
+
+bool WebSocketConnection::sendBinary(std::string_view data) {
+    auto frame = std::make_shared<std::string>();
+    WebSocket::writeFrame(*frame, Opcode::Binary, data);
+    return sendFrame(std::move(frame));
+}
+
+bool WebSocketConnection::sendFrame(std::shared_ptr<const std::string> frame) {
+    bool accepted = true;
+    {
+        std::lock_guard<std::mutex> lock(d_mtx);
+        if (!isOpen() || d_closeRequested) return false;
+        if (d_queuedBytes + frame->size() > d_options.maxQueuedBytes) {
+            d_outbox.clear();
+            d_queuedBytes = 0;
+            d_closeRequested = true;
+            d_requestedCode = CloseCode::PolicyViolation;
+            d_requestedReason = "too slow";
+            accepted = false;
+        } else {
+            d_queuedBytes += frame->size();
+            d_outbox.push_back(std::move(frame));
+        }
+        if (d_woken) return accepted;
+        d_woken = true;
+    }
+    wake();
+    return accepted;
+}
+
+void WebSocketConnection::close(CloseCode code, std::string_view reason) {
+    {
+        std::lock_guard<std::mutex> lock(d_mtx);
+        if (!isOpen() || d_closeRequested) return;
+        d_closeRequested = true;
+        d_requestedCode = code;
+        d_requestedReason = reason;
+        if (d_woken) return;
+        d_woken = true;
+    }
+    wake();
+}
+
+size_t WebSocketConnection::queuedBytes() const {
+    std::lock_guard<std::mutex> lock(d_mtx);
+    return d_queuedBytes;
+}
+
+void WebSocketConnection::wake() {
+    const uint64_t one = 1;
+    if (::write(d_wakeFd, &one, sizeof(one)) < 0 && errno != EAGAIN)
+        LOG_ERROR_ERRNO("WebSocket: Failed to wake connection");
+}
+
+void WebSocketHub::add(WebSocketPtr connection) {
+    std::lock_guard<std::mutex> lock(d_mtx);
+    d_connections.push_back(std::move(connection));
+}
+
+void WebSocketHub::remove(const WebSocketConnection* connection) {
+    std::lock_guard<std::mutex> lock(d_mtx);
+    std::erase_if(d_connections, [connection](const WebSocketPtr& c) { return c.get() == connection; });
+}
+
+size_t WebSocketHub::size() const {
+    std::lock_guard<std::mutex> lock(d_mtx);
+    return d_connections.size();
+}
+
+size_t WebSocketHub::broadcast(std::string_view text) {
+    auto frame = std::make_shared<std::string>();
+    WebSocket::writeFrame(*frame, Opcode::Text, text);
+    return broadcastFrame(frame);
+}
+
+size_t WebSocketHub::broadcastBinary(std::string_view data) {
+    auto frame = std::make_shared<std::string>();
+    WebSocket::writeFrame(*frame, Opcode::Binary, data);
+    return broadcastFrame(frame);
+}
+
+size_t WebSocketHub::broadcastFrame(const std::shared_ptr<const std::string>& frame) {
+    std::lock_guard<std::mutex> lock(d_mtx);
+    std::erase_if(d_connections, [](const WebSocketPtr& c) { return !c->isOpen(); });
+    size_t accepted = 0;
+    for (const WebSocketPtr& connection : d_connections) {
+        if (connection->sendFrame(frame)) accepted++;
+    }
+    return accepted;
+}
+
+} // namespace HTTPServer
@@ -7,6 +7,7 @@ int main() {
     Server server(Port(443));
     server.installSignalHandlers();
     server.enableHttps(".env/cert.pem", ".env/key.pem");
+    server.enableHttp2();
     server.enableHttpRedirection(Port(80));
 
     Router::instance().addRoute("GET", "/", [](const HttpRequest& req) {
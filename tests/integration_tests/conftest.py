@@ -26,13 +26,17 @@ class HttpServerRunner:
         self._output_lines: list[str] = []
         self._output_lock = threading.Lock()
 
-    def start(self, timeout: float = 2.0, with_https: bool = False) -> None:
+    def start(self, timeout: float = 2.0, with_https: bool = False,
+              extra_env: Optional[dict[str, str]] = None) -> None:
         if self.is_alive():
             return
         
         if with_https:
             self._env["TEST_ENABLE_HTTPS"] = "1"
 
+        if extra_env:
+            self._env.update(extra_env)
+
         self._process = subprocess.Popen(
             [str(SERVER_BINARY)],
             stdout=subprocess.PIPE,
@@ -98,9 +102,24 @@ class HttpServerRunner:
         with self._output_lock:
             return any(text in line for line in self._output_lines)
 
+    def send_signal(self, sig: int) -> None:
+        if self._process and self._process.poll() is None:
+            self._process.send_signal(sig)
+
+    def wait_for_exit(self, timeout: float) -> Optional[int]:
+        assert self._process is not None
+        try:
+            return self._process.wait(timeout=timeout)
+        except subprocess.TimeoutExpired:
+            return None
+
     def is_alive(self) -> bool:
         return self._process is not None and self._process.poll() is None
 
+    def pid(self) -> int:
+        assert self._process is not None
+        return self._process.pid
+
     def exit_code(self) -> Optional[int]:
         return None if not self._process else self._process.poll()
 
@@ -1,6 +1,9 @@
 #include <httpserver/httpserver.h>
+#include <atomic>
 #include <iostream>
+#include <thread>
 #include <cstdlib>
+#include <unistd.h>
 
 using namespace HTTPServer;
 
@@ -21,6 +24,36 @@ int main() {
     const char* cert = getenv("TEST_HTTPS_CERT");
     const char* key  = getenv("TEST_HTTPS_KEY");
     int enable_https = getEnvInt("TEST_ENABLE_HTTPS", 0);
+    std::string access_log = getEnvStr("TEST_ACCESS_LOG", "");
+    std::string phase_timing = getEnvStr("TEST_PHASE_TIMING", "");
+    int tls_session_cache = getEnvInt("TEST_TLS_SESSION_CACHE", 1);
+    int tls_tickets = getEnvInt("TEST_TLS_TICKETS", 1);
+    int ktls = getEnvInt("TEST_KTLS", 0);
+    int http2 = getEnvInt("TEST_HTTP2", 0);
+    int redirect_port = getEnvInt("TEST_HTTP_REDIRECT_PORT", 0);
+    int hsts = getEnvInt("TEST_HSTS", 0);
+    int idle_timeout_ms = getEnvInt("TEST_IDLE_TIMEOUT_MS", 0);
+    int header_timeout_ms = getEnvInt("TEST_HEADER_TIMEOUT_MS", 0);
+    int max_connections = getEnvInt("TEST_MAX_CONNECTIONS", 0);
+    std::string overload = getEnvStr("TEST_OVERLOAD_ACTION", "reject");
+    int max_handlers = getEnvInt("TEST_MAX_HANDLERS", 0);
+    int offload_threads = getEnvInt("TEST_OFFLOAD_THREADS", 0);
+    int offload_queue = getEnvInt("TEST_OFFLOAD_QUEUE", 1024);
+    int connection_rate = getEnvInt("TEST_CONNECTION_RATE", 0);
+    int request_rate = getEnvInt("TEST_REQUEST_RATE", 0);
+    int rate_burst = getEnvInt("TEST_RATE_BURST", 1);
+    int drain_timeout_ms = getEnvInt("TEST_DRAIN_TIMEOUT_MS", 0);
+    int workers = getEnvInt("TEST_WORKERS", 0);
+    int reuse_port = getEnvInt("TEST_REUSE_PORT", 0);
+    std::string unix_sockets = getEnvStr("TEST_UNIX_SOCKETS", "");
+    int tcp = getEnvInt("TEST_TCP", 1);
+    int tcp_nodelay = getEnvInt("TEST_TCP_NODELAY", 1);
+    int defer_accept_s = getEnvInt("TEST_DEFER_ACCEPT_S", 0);
+    int fast_open_queue = getEnvInt("TEST_FAST_OPEN_QUEUE", 0);
+    int send_buffer = getEnvInt("TEST_SEND_BUFFER", 0);
+    int receive_buffer = getEnvInt("TEST_RECEIVE_BUFFER", 0);
+    int backlog = getEnvInt("TEST_BACKLOG", SOMAXCONN);
+    int busy_poll_us = getEnvInt("TEST_BUSY_POLL_US", 0);
 
     Port http_port = enable_https ? Port(8443) : Port(8080);
     Server server(http_port);
@@ -28,6 +61,95 @@ int main() {
 
     if (enable_https && cert && key) {
         server.enableHttps(cert, key);
+
+        TlsSessionOptions sessions;
+        sessions.sessionCache = tls_session_cache != 0;
+        sessions.sessionTickets = tls_tickets != 0;
+        server.setTlsSessionOptions(sessions);
+        server.enableKernelTls(ktls != 0);
+        server.enableHttp2(http2 != 0);
+
+        if (redirect_port != 0) {
+            server.enableHttpRedirection(Port(redirect_port));
+        }
+        if (hsts != 0) {
+            server.enableHsts();
+        }
+    }
+
+    ConnectionTimeouts timeouts;
+    if (idle_timeout_ms > 0) timeouts.idle = std::chrono::milliseconds(idle_timeout_ms);
+    if (header_timeout_ms > 0) timeouts.header = std::chrono::milliseconds(header_timeout_ms);
+    server.setConnectionTimeouts(timeouts);
+
+    ConnectionLimits limits;
+    limits.maxConnections = static_cast<size_t>(max_connections);
+    limits.onOverload = overload == "pause" ? OverloadAction::PauseAccept : OverloadAction::Reject;
+    limits.retryAfter = std::chrono::seconds(2);
+    server.setConnectionLimits(limits);
+
+    if (drain_timeout_ms > 0) {
+        server.setDrainTimeout(std::chrono::milliseconds(drain_timeout_ms));
+    }
+
+    RateLimits rates;
+    rates.connections = {static_cast<double>(connection_rate), static_cast<double>(rate_burst)};
+    rates.requests = {static_cast<double>(request_rate), static_cast<double>(rate_burst)};
+    rates.retryAfter = std::chrono::seconds(2);
+    server.setRateLimits(rates);
+
+    if (max_handlers > 0) {
+        LoadSheddingOptions shedding;
+        shedding.maxConcurrentHandlers = static_cast<size_t>(max_handlers);
+        shedding.retryAfter = std::chrono::seconds(2);
+        server.enableLoadShedding(shedding);
+    }
+
+    HandlerExecutorOptions executor;
+    executor.threads = static_cast<size_t>(offload_threads);
+    executor.maxQueued = static_cast<size_t>(offload_queue);
+    executor.retryAfter = std::chrono::seconds(2);
+    server.setHandlerExecutor(executor);
+
+    if (workers > 0) {
+        PreforkOptions prefork;
+        prefork.workers = static_cast<size_t>(workers);
+        prefork.reusePort = reuse_port != 0;
+        prefork.statsInterval = std::chrono::milliseconds(100);
+        server.enablePrefork(prefork);
+    }
+
+    SocketOptions sockets;
+    sockets.noDelay = tcp_nodelay != 0;
+    sockets.deferAccept = std::chrono::seconds(defer_accept_s);
+    sockets.fastOpenQueue = fast_open_queue;
+    sockets.sendBuffer = send_buffer;
+    sockets.receiveBuffer = receive_buffer;
+    sockets.backlog = backlog;
+    sockets.busyPoll = std::chrono::microseconds(busy_poll_us);
+    server.setSocketOptions(sockets);
+
+    // Comma separated socket paths, '@' for the abstract namespace
+    for (size_t start = 0; start < unix_sockets.size();) {
+        size_t end = unix_sockets.find(',', start);
+        if (end == std::string::npos) end = unix_sockets.size();
+        server.addUnixListener(unix_sockets.substr(start, end - start));
+        start = end + 1;
+    }
+    if (tcp == 0) {
+        server.disableTcpListener();
+    }
+
+    if (!access_log.empty()) {
+        server.enableAccessLog(access_log);
+    }
+
+    if (!phase_timing.empty()) {
+        TimingClock clock = TimingClock::Monotonic;
+        if (phase_timing == "coarse") clock = TimingClock::MonotonicCoarse;
+        if (phase_timing == "tsc") clock = TimingClock::Tsc;
+        PhaseTiming::instance().enable(clock);
+        PhaseTiming::instance().setServerTimingHeader(true);
     }
 
     // Basic route case
@@ -54,9 +176,66 @@ int main() {
         return Responses::notFound(req);
     });
 
+    // Slow route for exercising overload
+    Router::instance().addRoute("GET", "/slow", [](const HttpRequest& req) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        return Responses::ok(req, "Slow");
+    });
+
+    // Blocks a thread of the handler executor, for exercising offloading
+    Router::instance().addRoute("GET", "/slow-offloaded", [](const HttpRequest& req) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(300));
+        return Responses::ok(req, "Slow");
+    }, HandlerExecution::Offloaded);
+
+    // Waits without holding a thread, for exercising asynchronous handlers
+    Router::instance().addRoute("GET", "/async-sleep", [](const HttpRequest& req) -> Task<HttpResponse> {
+        co_await IoScheduler::instance().sleepFor(std::chrono::milliseconds(500));
+        co_return Responses::ok(req, "Awake");
+    });
+
+    // Identifies the process serving, for exercising upgrades
+    Router::instance().addRoute("GET", "/pid", [](const HttpRequest& req) {
+        return Responses::ok(req, std::to_string(getpid()));
+    });
+
+    // Takes the whole process down, for exercising prefork restarts
+    Router::instance().addRoute("GET", "/crash", [](const HttpRequest&) -> HttpResponse {
+        std::abort();
+    });
+
+    // WebSocket echo, and a channel whose messages go to every member
+    WebSocketHandler echo;
+    echo.onMessage = [](const WebSocketPtr& ws, std::string_view message, bool binary) {
+        binary ? ws->sendBinary(message) : ws->send(message);
+    };
+    Router::instance().addWebSocketRoute("/ws/echo", echo);
+
+    static WebSocketHub channel;
+    WebSocketHandler member;
+    member.onOpen = [](const WebSocketPtr& ws, const HttpRequest&) { channel.add(ws); };
+    member.onMessage = [](const WebSocketPtr&, std::string_view message, bool) { channel.broadcast(message); };
+    member.onClose = [](const WebSocketPtr& ws, WebSocket::CloseCode) { channel.remove(ws.get()); };
+    Router::instance().addWebSocketRoute("/ws/channel", member);
+
+    // Event stream, and a route publishing its 'msg' parameter to it that
+    // answers with how many subscribers the event was queued for
+    static EventStreamHub events(16);
+    Router::instance().addEventStreamRoute("/events", events);
+    Router::instance().addRoute("GET", "/events/publish", [](const HttpRequest& req) {
+        static std::atomic<int> nextId{1};
+        auto it = req.params.find("msg");
+        if (it == req.params.end()) return Responses::badRequest(req.get_allocator());
+        const size_t queued = events.publish(it->second, {}, std::to_string(nextId++));
+        return Responses::ok(req, std::to_string(queued));
+    });
+
     // Static directory route
     Router::instance().addStaticDirectoryRoute("/static", static_dir);
 
+    // Built-in Prometheus metrics route
+    Router::instance().addMetricsRoute("/metrics");
+
     server.start();
     std::cout << "Server exited cleanly" << std::endl;
     return 0;
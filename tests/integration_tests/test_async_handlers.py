@@ -0,0 +1,49 @@
+import shutil
+import subprocess
+import time
+
+import pytest # type: ignore
+from conftest import HttpServerRunner
+from common import _make_request
+
+
+def test_async_route_answers_over_http1(runnable_server_instance: HttpServerRunner):
+    """
+    Verifies that a coroutine route answers like any other over HTTP/1.1.
+    """
+    # GIVEN:
+    runnable_server_instance.start()
+
+    # WHEN:
+    resp, body = _make_request("GET", "/async-sleep")
+
+    # THEN:
+    assert resp.status == 200
+    assert body == "Awake"
+
+
+@pytest.mark.skipif(shutil.which("curl") is None, reason="curl is not installed")
+def test_waiting_http2_streams_do_not_hold_up_each_other(runnable_server_instance: HttpServerRunner):
+    """
+    Verifies that many streams of one HTTP/2 connection wait on an
+    asynchronous route at the same time rather than one after the other.
+    """
+    # GIVEN: 40 requests that each wait 500ms, 20s if served in turn
+    runnable_server_instance.start(with_https=True, extra_env={"TEST_HTTP2": "1"})
+    args = ["curl", "-k", "-s", "--http2", "--parallel", "--parallel-max", "100"]
+    for _ in range(40):
+        args += ["https://localhost:8443/async-sleep", "-o", "/dev/null",
+                 "-w", "%{http_version} %{response_code} %{num_connects}\\n"]
+
+    # WHEN:
+    start = time.monotonic()
+    result = subprocess.run(args, capture_output=True, text=True, timeout=30)
+    elapsed = time.monotonic() - start
+
+    # THEN:
+    assert result.returncode == 0, result.stderr
+    lines = result.stdout.split()
+    assert lines[0::3] == ["2"] * 40
+    assert lines[1::3] == ["200"] * 40
+    assert sum(int(c) for c in lines[2::3]) == 1
+    assert elapsed < 5
@@ -0,0 +1,101 @@
+import socket
+import time
+
+from common import _make_request
+from conftest import HttpServerRunner
+
+REQUEST = b"GET / HTTP/1.1\r\nHost: localhost\r\nConnection: close\r\n\r\n"
+
+
+def _read_all(sock: socket.socket) -> bytes:
+    data = b""
+    try:
+        while chunk := sock.recv(4096):
+            data += chunk
+    except ConnectionResetError:
+        pass
+    return data
+
+
+def test_connections_over_the_limit_get_503(runnable_server_instance: HttpServerRunner):
+    """
+    Verifies that once the connection cap is reached new connections get a
+    503 with Retry-After, and are admitted again once a slot frees up.
+    """
+    # GIVEN: one admitted connection holding the only slot.
+    runnable_server_instance.start(extra_env={"TEST_MAX_CONNECTIONS": "1"})
+    holder = socket.create_connection(("localhost", 8080), timeout=2)
+    time.sleep(0.1)
+
+    # WHEN:
+    with socket.create_connection(("localhost", 8080), timeout=2) as sock:
+        rejected = _read_all(sock)
+    holder.close()
+    time.sleep(0.1)
+    resp, body = _make_request("GET", "/")
+
+    # THEN:
+    assert rejected.startswith(b"HTTP/1.1 503 Service Unavailable\r\n")
+    assert b"Retry-After: 2\r\n" in rejected
+    assert resp.status == 200
+    assert body == "OK"
+    time.sleep(0.1)
+    _, metrics = _make_request("GET", "/metrics")
+    assert "httpserver_connections_rejected_total 1" in metrics
+
+
+def test_paused_accept_serves_waiting_connection_later(runnable_server_instance: HttpServerRunner):
+    """
+    Verifies that with the pause policy a connection over the cap waits in
+    the listen backlog and is served once the slot is released.
+    """
+    # GIVEN:
+    runnable_server_instance.start(extra_env={"TEST_MAX_CONNECTIONS": "1", "TEST_OVERLOAD_ACTION": "pause"})
+    holder = socket.create_connection(("localhost", 8080), timeout=2)
+    time.sleep(0.1)
+
+    with socket.create_connection(("localhost", 8080), timeout=2) as waiting:
+        waiting.sendall(REQUEST)
+
+        # WHEN: nothing is answered while the slot is held.
+        waiting.settimeout(0.5)
+        try:
+            early = waiting.recv(4096)
+        except socket.timeout:
+            early = b""
+        holder.close()
+        waiting.settimeout(2)
+        response = early + _read_all(waiting)
+
+    # THEN:
+    assert early == b""
+    assert response.startswith(b"HTTP/1.1 200 OK\r\n")
+
+
+def _mapping_count(pid: int) -> int:
+    # An exited thread that is never joined leaves the task list but keeps
+    # its stack mapped, so mappings show leaked threads where a thread count
+    # would not.
+    with open(f"/proc/{pid}/maps") as maps:
+        return sum(1 for _ in maps)
+
+
+def test_finished_connections_do_not_keep_threads(runnable_server_instance: HttpServerRunner):
+    """
+    Verifies that the threads of finished connections are reclaimed while
+    the server runs, so serving many more connections than the cap does not
+    leave a thread stack behind per connection.
+    """
+    # GIVEN:
+    runnable_server_instance.start(extra_env={"TEST_MAX_CONNECTIONS": "4"})
+    _make_request("GET", "/")
+    baseline = _mapping_count(runnable_server_instance.pid())
+
+    # WHEN:
+    for _ in range(500):
+        with socket.create_connection(("localhost", 8080), timeout=2) as sock:
+            sock.sendall(REQUEST)
+            assert _read_all(sock).startswith(b"HTTP/1.1 200 OK\r\n")
+
+    # THEN: a leaked stack is a mapping and its guard page per connection.
+    assert _mapping_count(runnable_server_instance.pid()) - baseline < 200
@@ -0,0 +1,94 @@
+import socket
+import time
+
+from common import _make_request
+from conftest import HttpServerRunner
+
+
+def _wait_closed(sock: socket.socket, timeout: float) -> bool:
+    sock.settimeout(timeout)
+    try:
+        while sock.recv(4096):
+            pass
+        return True
+    except socket.timeout:
+        return False
+    except ConnectionResetError:
+        return True
+
+
+def test_slow_header_is_cut_off(runnable_server_instance: HttpServerRunner):
+    """
+    Verifies that a client trickling its request head one byte at a time is
+    closed once the header deadline passes, even though every single read
+    makes progress.
+    """
+    # GIVEN:
+    runnable_server_instance.start(extra_env={"TEST_HEADER_TIMEOUT_MS": "1000"})
+    request = b"GET / HTTP/1.1\r\nHost: localhost\r\nX-Padding: " + b"a" * 100
+
+    with socket.create_connection(("localhost", 8080), timeout=2) as sock:
+        # WHEN:
+        start = time.monotonic()
+        closed = False
+        for byte in request:
+            try:
+                sock.sendall(bytes([byte]))
+            except (BrokenPipeError, ConnectionResetError):
+                closed = True
+                break
+            if _wait_closed(sock, 0.2):
+                closed = True
+                break
+        elapsed = time.monotonic() - start
+
+    # THEN:
+    assert closed
+    assert 0.9 < elapsed < 2.5
+    assert "header timeout reached, closing" in runnable_server_instance.get_output()
+
+
+def test_idle_keep_alive_connection_is_closed(runnable_server_instance: HttpServerRunner):
+    """
+    Verifies that a keep-alive connection is closed after the idle deadline
+    and the timeout shows up in /metrics.
+    """
+    # GIVEN:
+    runnable_server_instance.start(extra_env={"TEST_IDLE_TIMEOUT_MS": "500"})
+
+    with socket.create_connection(("localhost", 8080), timeout=2) as sock:
+        sock.sendall(b"GET / HTTP/1.1\r\nHost: localhost\r\n\r\n")
+        assert sock.recv(4096).startswith(b"HTTP/1.1 200")
+
+        # WHEN:
+        start = time.monotonic()
+        closed = _wait_closed(sock, 2)
+        elapsed = time.monotonic() - start
+
+    # THEN:
+    assert closed
+    assert 0.4 < elapsed < 1.5
+    _, body = _make_request("GET", "/metrics")
+    assert 'httpserver_connection_timeouts_total{deadline="idle"} 1' in body
+
+
+def test_stalled_tls_handshake_does_not_block_other_clients(runnable_server_instance: HttpServerRunner):
+    """
+    Verifies that a client which connects to the HTTPS port and never starts
+    the handshake holds up only its own connection: other clients complete
+    theirs at once, and the stalled one is closed at the head deadline.
+    """
+    # GIVEN:
+    runnable_server_instance.start(with_https=True, extra_env={"TEST_HEADER_TIMEOUT_MS": "1500"})
+    stalled = socket.create_connection(("localhost", 8443))
+
+    # WHEN:
+    start = time.monotonic()
+    resp, body, _ = _make_request("GET", "/", port=8443, use_https=True)
+    elapsed = time.monotonic() - start
+
+    # THEN:
+    assert resp.status == 200 and body == "OK"
+    assert elapsed < 0.5
+    assert _wait_closed(stalled, timeout=3)
+    stalled.close()
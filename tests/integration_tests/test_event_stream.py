@@ -0,0 +1,78 @@
+import socket
+import time
+
+from common import _make_request
+from conftest import HttpServerRunner
+
+
+def _subscribe(headers: str = "") -> tuple[socket.socket, bytes, bytes]:
+    sock = socket.create_connection(("localhost", 8080), timeout=2)
+    sock.sendall(f"GET /events HTTP/1.1\r\nHost: localhost\r\n{headers}\r\n".encode())
+    response = b""
+    while b"\r\n\r\n" not in response:
+        response += sock.recv(4096)
+    head, rest = response.split(b"\r\n\r\n", 1)
+    return sock, head, rest
+
+
+def _publish(message: str, subscribers: int) -> None:
+    # The stream's head is sent before it subscribes, so publish until the
+    # event reaches every subscriber expected.
+    for _ in range(100):
+        response, body = _make_request("GET", f"/events/publish?msg={message}")
+        assert response.status == 200
+        if int(body) >= subscribers:
+            return
+        time.sleep(0.02)
+    raise AssertionError("subscribers never registered")
+
+
+def _read_event(sock: socket.socket, buffer: bytes, data: bytes) -> bytes:
+    while data not in buffer:
+        chunk = sock.recv(4096)
+        assert chunk, "connection closed"
+        buffer += chunk
+    return buffer
+
+
+def test_event_stream_pushes_published_events(runnable_server_instance: HttpServerRunner):
+    """
+    Verifies that an event stream route answers with a text/event-stream that
+    stays open, and that events published afterwards are pushed down it to
+    every subscriber.
+    """
+    # GIVEN:
+    runnable_server_instance.start()
+    subscribers = [_subscribe() for _ in range(2)]
+    for _, head, _ in subscribers:
+        assert head.startswith(b"HTTP/1.1 200 OK\r\n")
+        assert b"Content-Type: text/event-stream" in head
+
+    # WHEN:
+    _publish("hello", 2)
+
+    # THEN:
+    for sock, _, rest in subscribers:
+        assert b"data: hello\n\n" in _read_event(sock, rest, b"data: hello\n\n")
+        sock.close()
+
+
+def test_event_stream_resumes_from_last_event_id(runnable_server_instance: HttpServerRunner):
+    """
+    Verifies that a client reconnecting with Last-Event-ID is first sent the
+    events published since the one it last saw.
+    """
+    # GIVEN: events 1 to 3 published while the client was away
+    runnable_server_instance.start()
+    for message in ["one", "two", "three"]:
+        _make_request("GET", f"/events/publish?msg={message}")
+
+    # WHEN:
+    sock, head, rest = _subscribe("Last-Event-ID: 1\r\n")
+
+    # THEN:
+    assert head.startswith(b"HTTP/1.1 200 OK\r\n")
+    events = _read_event(sock, rest, b"data: three\n\n")
+    assert b"data: one" not in events
+    assert events.index(b"id: 2\ndata: two\n\n") < events.index(b"id: 3\ndata: three\n\n")
+    sock.close()
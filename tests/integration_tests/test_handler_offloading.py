@@ -0,0 +1,43 @@
+import time
+from concurrent.futures import ThreadPoolExecutor
+
+from common import _make_request
+from conftest import HttpServerRunner
+
+
+def _slow_offloaded_request(_):
+    resp, _ = _make_request("GET", "/slow-offloaded")
+    return resp.status, resp.getheader("Retry-After")
+
+
+def test_saturated_offloaded_routes_do_not_slow_inline_ones(runnable_server_instance: HttpServerRunner):
+    """
+    Verifies that offloaded handlers are confined to their executor: with
+    its threads and queue full, extra offloaded requests get 503 while an
+    inline route keeps answering at once, even with a single handler slot.
+    """
+    # GIVEN: two executor threads with room for two more queued, and one
+    # handler slot for inline routes.
+    runnable_server_instance.start(extra_env={"TEST_OFFLOAD_THREADS": "2",
+                                              "TEST_OFFLOAD_QUEUE": "2",
+                                              "TEST_MAX_HANDLERS": "1"})
+
+    with ThreadPoolExecutor(max_workers=8) as pool:
+        # WHEN: far more slow requests arrive than the executor takes.
+        slow = pool.map(_slow_offloaded_request, range(8))
+        time.sleep(0.1)
+        latencies = []
+        for _ in range(5):
+            start = time.monotonic()
+            resp, body = _make_request("GET", "/")
+            latencies.append(time.monotonic() - start)
+            assert resp.status == 200 and body == "OK"
+        results = list(slow)
+
+    # THEN:
+    assert max(latencies) < 0.2
+    served = [r for r in results if r[0] == 200]
+    refused = [r for r in results if r[0] == 503]
+    assert len(served) >= 4 and refused
+    assert len(served) + len(refused) == len(results)
+    assert all(retry == "2" for _, retry in refused)
@@ -0,0 +1,99 @@
+import shutil
+import socket
+import ssl
+import subprocess
+
+import pytest # type: ignore
+from conftest import HttpServerRunner
+
+
+def _negotiated_protocol(offered: list[str], port: int = 8443):
+    context = ssl.create_default_context()
+    context.check_hostname = False
+    context.verify_mode = ssl.CERT_NONE
+    context.set_alpn_protocols(offered)
+    with socket.create_connection(("localhost", port), timeout=2) as raw:
+        with context.wrap_socket(raw, server_hostname="localhost") as tls:
+            return tls.selected_alpn_protocol()
+
+
+@pytest.mark.parametrize("http2, expected", [("1", "h2"), ("0", None)])
+def test_alpn_selects_h2_only_when_enabled(runnable_server_instance: HttpServerRunner, http2: str, expected):
+    """
+    Verifies that h2 is offered via ALPN only when HTTP/2 is enabled.
+    """
+    # GIVEN:
+    runnable_server_instance.start(with_https=True, extra_env={"TEST_HTTP2": http2})
+    assert runnable_server_instance.is_alive()
+
+    # WHEN:
+    protocol = _negotiated_protocol(["h2", "http/1.1"])
+
+    # THEN:
+    assert protocol == expected
+
+
+def test_alpn_keeps_http1_clients(runnable_server_instance: HttpServerRunner):
+    """
+    Verifies that clients only offering http/1.1 keep using it.
+    """
+    # GIVEN:
+    runnable_server_instance.start(with_https=True, extra_env={"TEST_HTTP2": "1"})
+
+    # WHEN / THEN:
+    assert _negotiated_protocol(["http/1.1"]) == "http/1.1"
+
+
+@pytest.mark.skipif(shutil.which("curl") is None, reason="curl is not installed")
+def test_requests_are_multiplexed_over_one_connection(runnable_server_instance: HttpServerRunner,
+                                                      server_temp_dir):
+    """
+    Verifies that parallel requests from one client share a single HTTP/2
+    connection and each get the right response, including a large static
+    file interleaved with small responses.
+    """
+    # GIVEN:
+    contents = "".join(f"line {i:06d} of a large static file\n" for i in range(10000))
+    (server_temp_dir["static_dir"] / "large_file.txt").write_text(contents, encoding="utf-8")
+    runnable_server_instance.start(with_https=True, extra_env={"TEST_HTTP2": "1"})
+    large_out = server_temp_dir["base"] / "large_out.txt"
+    urls = [
+        ("https://localhost:8443/static/large_file.txt", str(large_out)),
+        ("https://localhost:8443/", "/dev/null"),
+        ("https://localhost:8443/dynamic/abc", "/dev/null"),
+        ("https://localhost:8443/param?input=xyz", "/dev/null"),
+    ]
+    args = ["curl", "-k", "-s", "--http2", "--parallel"]
+    for url, out in urls:
+        args += [url, "-o", out, "-w", "%{http_version} %{response_code} %{num_connects}\\n"]
+
+    # WHEN:
+    result = subprocess.run(args, capture_output=True, text=True, timeout=10)
+
+    # THEN:
+    assert result.returncode == 0, result.stderr
+    lines = result.stdout.split()
+    versions, codes, connects = lines[0::3], lines[1::3], lines[2::3]
+    assert versions == ["2"] * 4
+    assert codes == ["200"] * 4
+    assert sum(int(c) for c in connects) == 1
+    assert large_out.read_text(encoding="utf-8") == contents
+
+
+@pytest.mark.skipif(shutil.which("curl") is None, reason="curl is not installed")
+def test_http2_request_body_and_not_found(runnable_server_instance: HttpServerRunner):
+    """
+    Verifies that a POST body sent in DATA frames reaches the router and
+    unknown routes answer 404 over HTTP/2.
+    """
+    # GIVEN:
+    runnable_server_instance.start(with_https=True, extra_env={"TEST_HTTP2": "1"})
+
+    # WHEN:
+    result = subprocess.run(
+        ["curl", "-k", "-s", "--http2", "-o", "/dev/null", "-w", "%{http_version} %{response_code}",
+         "-d", "payload", "https://localhost:8443/missing"],
+        capture_output=True, text=True, timeout=10)
+
+    # THEN:
+    assert result.stdout == "2 404"
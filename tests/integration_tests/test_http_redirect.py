@@ -0,0 +1,88 @@
+import socket
+import ssl
+import time
+
+from conftest import HttpServerRunner
+
+REDIRECT_ENV = {"TEST_HTTP_REDIRECT_PORT": "8081"}
+
+
+def _read_response(sock: socket.socket) -> str:
+    data = b""
+    while b"Redirecting to HTTPS..." not in data:
+        chunk = sock.recv(4096)
+        if not chunk:
+            break
+        data += chunk
+    return data.decode("latin-1")
+
+
+def test_redirect_keeps_connection_alive(runnable_server_instance: HttpServerRunner):
+    """
+    Verifies that the plain HTTP listener answers with a 301 to the HTTPS
+    port, preserving the path and query, and serves several requests on one
+    connection.
+    """
+    # GIVEN:
+    runnable_server_instance.start(with_https=True, extra_env=REDIRECT_ENV)
+
+    with socket.create_connection(("localhost", 8081), timeout=2) as sock:
+        # WHEN:
+        sock.sendall(b"GET /param?input=1 HTTP/1.1\r\nHost: localhost:8081\r\n\r\n")
+        first = _read_response(sock)
+        sock.sendall(b"GET /static/index.html HTTP/1.1\r\nHost: localhost:8081\r\n\r\n")
+        second = _read_response(sock)
+
+    # THEN:
+    assert first.startswith("HTTP/1.1 301 Moved Permanently\r\n")
+    assert "Location: https://localhost:8443/param?input=1\r\n" in first
+    assert "Connection: keep-alive\r\n" in first
+    assert "Location: https://localhost:8443/static/index.html\r\n" in second
+
+
+def test_idle_redirect_client_does_not_block_others(runnable_server_instance: HttpServerRunner):
+    """
+    Verifies that a client holding an idle connection open does not delay
+    redirects for other clients.
+    """
+    # GIVEN:
+    runnable_server_instance.start(with_https=True, extra_env=REDIRECT_ENV)
+    idle = socket.create_connection(("localhost", 8081), timeout=2)
+    idle.sendall(b"GET / HTTP/1.1\r\n")
+
+    try:
+        # WHEN:
+        start = time.monotonic()
+        with socket.create_connection(("localhost", 8081), timeout=2) as sock:
+            sock.sendall(b"GET / HTTP/1.1\r\nHost: localhost\r\nConnection: close\r\n\r\n")
+            response = _read_response(sock)
+        elapsed = time.monotonic() - start
+    finally:
+        idle.close()
+
+    # THEN:
+    assert "Location: https://localhost:8443/\r\n" in response
+    assert elapsed < 0.5
+
+
+def test_hsts_header_on_https_responses(runnable_server_instance: HttpServerRunner):
+    """
+    Verifies that HTTPS responses carry Strict-Transport-Security when HSTS
+    is enabled.
+    """
+    # GIVEN:
+    runnable_server_instance.start(with_https=True, extra_env={"TEST_HSTS": "1"})
+    context = ssl.create_default_context()
+    context.check_hostname = False
+    context.verify_mode = ssl.CERT_NONE
+
+    # WHEN:
+    with socket.create_connection(("localhost", 8443), timeout=2) as raw:
+        with context.wrap_socket(raw, server_hostname="localhost") as tls:
+            tls.sendall(b"GET / HTTP/1.1\r\nHost: localhost\r\nConnection: close\r\n\r\n")
+            response = b""
+            while chunk := tls.recv(4096):
+                response += chunk
+
+    # THEN:
+    assert b"Strict-Transport-Security: max-age=31536000\r\n" in response
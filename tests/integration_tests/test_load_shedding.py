@@ -0,0 +1,35 @@
+from concurrent.futures import ThreadPoolExecutor
+
+from common import _make_request
+from conftest import HttpServerRunner
+
+
+def _slow_request(_):
+    resp, body = _make_request("GET", "/slow")
+    return resp.status, resp.getheader("Retry-After"), body
+
+
+def test_overload_sheds_queued_requests_with_503(runnable_server_instance: HttpServerRunner):
+    """
+    Verifies that once requests queue for a handler slot longer than the
+    target for a whole interval, the queue is trimmed with 503 responses
+    while the admitted ones are still served.
+    """
+    # GIVEN: one handler slot, each /slow request holding it for 50ms.
+    runnable_server_instance.start(extra_env={"TEST_MAX_HANDLERS": "1"})
+
+    # WHEN: far more requests arrive than the slot can serve in time.
+    with ThreadPoolExecutor(max_workers=16) as pool:
+        results = list(pool.map(_slow_request, range(16)))
+
+    # THEN:
+    served = [r for r in results if r[0] == 200]
+    shed = [r for r in results if r[0] == 503]
+    assert served and shed
+    assert len(served) + len(shed) == len(results)
+    assert all(retry == "2" and body == "503 Service Unavailable" for _, retry, body in shed)
+
+    # THEN: with the queue drained requests are admitted again.
+    resp, metrics = _make_request("GET", "/metrics")
+    assert resp.status == 200
+    assert f"httpserver_requests_shed_total {len(shed)}" in metrics
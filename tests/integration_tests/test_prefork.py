@@ -0,0 +1,81 @@
+import re
+import time
+
+import pytest
+
+from common import _make_request
+from conftest import HttpServerRunner
+
+
+def _request_count(metrics: str, route: str) -> int:
+    pattern = r'httpserver_requests_total\{method="GET",route="' + re.escape(route) + r'",status="200"\} (\d+)'
+    return sum(int(count) for count in re.findall(pattern, metrics))
+
+
+def _serving_pids(requests: int) -> set[str]:
+    pids = set()
+    for _ in range(requests):
+        resp, body = _make_request("GET", "/pid")
+        assert resp.status == 200
+        pids.add(body)
+    return pids
+
+
+@pytest.mark.parametrize("reuse_port", ["0", "1"])
+def test_workers_share_connections_and_report_combined_metrics(
+    runnable_server_instance: HttpServerRunner, reuse_port: str
+):
+    """
+    Verifies that prefork workers all accept connections, whether they share
+    one listening socket or each have a SO_REUSEPORT socket, and that a
+    scrape served by any worker counts the requests of all of them.
+    """
+    # GIVEN:
+    runnable_server_instance.start(extra_env={"TEST_WORKERS": "2", "TEST_REUSE_PORT": reuse_port})
+    assert runnable_server_instance.wait_for_output("Worker [1] accepting")
+
+    # WHEN: every request comes in on a connection of its own.
+    pids = _serving_pids(60)
+    time.sleep(0.3)
+
+    # THEN:
+    assert len(pids) == 2
+    _, metrics = _make_request("GET", "/metrics")
+    assert _request_count(metrics, "/pid") == 60
+
+
+def test_crashed_worker_is_restarted_and_its_metrics_kept(
+    runnable_server_instance: HttpServerRunner
+):
+    """
+    Verifies that a worker killed by a crashing handler is replaced while
+    the other keeps serving, that the requests it served stay counted, and
+    that the supervisor shuts its workers down on SIGTERM.
+    """
+    # GIVEN:
+    runnable_server_instance.start(extra_env={"TEST_WORKERS": "2"})
+    assert runnable_server_instance.wait_for_output("Worker [1] accepting")
+    before = _serving_pids(20)
+    time.sleep(0.3)
+
+    # WHEN:
+    with pytest.raises(Exception):
+        _make_request("GET", "/crash")
+
+    # THEN:
+    assert runnable_server_instance.wait_for_output("killed by signal 6, restarting")
+    deadline = time.time() + 5
+    after: set[str] = set()
+    served = 20
+    while time.time() < deadline and len(after - before) == 0:
+        after |= _serving_pids(10)
+        served += 10
+    assert len(after - before) == 1
+    time.sleep(0.3)
+    _, metrics = _make_request("GET", "/metrics")
+    assert _request_count(metrics, "/pid") == served
+
+    # THEN:
+    runnable_server_instance.stop()
+    assert runnable_server_instance.exit_code() == 0
+    assert "Shutdown: All workers exited." in runnable_server_instance.get_output()
@@ -0,0 +1,67 @@
+import socket
+from http.client import HTTPConnection
+
+from common import _make_request
+from conftest import HttpServerRunner
+
+
+def _read_all(sock: socket.socket) -> bytes:
+    data = b""
+    try:
+        while chunk := sock.recv(4096):
+            data += chunk
+    except ConnectionResetError:
+        pass
+    return data
+
+
+def test_requests_over_the_rate_get_429(runnable_server_instance: HttpServerRunner):
+    """
+    Verifies that a client out of request tokens is answered 429 with
+    Retry-After, while another client address keeps its own bucket.
+    """
+    # GIVEN: a burst of three requests per client, refilled at one a second.
+    runnable_server_instance.start(extra_env={"TEST_REQUEST_RATE": "1", "TEST_RATE_BURST": "3"})
+
+    # WHEN: four requests arrive on one keep-alive connection.
+    conn = HTTPConnection("127.0.0.1", 8080, timeout=2)
+    statuses = []
+    for _ in range(4):
+        conn.request("GET", "/")
+        resp = conn.getresponse()
+        body = resp.read().decode()
+        statuses.append(resp.status)
+    conn.close()
+
+    # THEN:
+    assert statuses == [200, 200, 200, 429]
+    assert resp.getheader("Retry-After") == "2"
+    assert body == "429 Too Many Requests"
+
+    # THEN: the IPv6 loopback is a different client.
+    _, metrics = _make_request("GET", "/metrics", host="::1")
+    assert 'httpserver_rate_limited_total{scope="request"} 1' in metrics
+
+
+def test_connections_over_the_rate_are_refused_at_accept(runnable_server_instance: HttpServerRunner):
+    """
+    Verifies that a client opening connections faster than its connection
+    rate gets a pre-serialized 429 and is closed without being served.
+    """
+    # GIVEN:
+    runnable_server_instance.start(extra_env={"TEST_CONNECTION_RATE": "1", "TEST_RATE_BURST": "2"})
+
+    # WHEN:
+    responses = []
+    for _ in range(3):
+        with socket.create_connection(("127.0.0.1", 8080), timeout=2) as sock:
+            sock.sendall(b"GET / HTTP/1.1\r\nHost: localhost\r\nConnection: close\r\n\r\n")
+            responses.append(_read_all(sock))
+
+    # THEN:
+    assert responses[0].startswith(b"HTTP/1.1 200 OK\r\n")
+    assert responses[1].startswith(b"HTTP/1.1 200 OK\r\n")
+    assert responses[2].startswith(b"HTTP/1.1 429 Too Many Requests\r\n")
+    assert b"Retry-After: 2\r\n" in responses[2]
+    _, metrics = _make_request("GET", "/metrics", host="::1")
+    assert 'httpserver_rate_limited_total{scope="connection"} 1' in metrics
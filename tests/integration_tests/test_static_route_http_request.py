@@ -1,3 +1,7 @@
+import re
+import socket
+import time
+
 import pytest # type: ignore
 from conftest import HttpServerRunner
 from common import _make_request
@@ -47,3 +51,76 @@ def test_static_directory_change_file_path_is_not_allowed(runnable_server_instan
     
     # THEN:
     assert response.status == 400
+
+
+def _write_large_file(static_dir) -> str:
+    # Larger than Responses::kMaxInlineFileSize so it is streamed with sendfile
+    contents = "".join(f"line {i:06d} of a large static file\n" for i in range(10000))
+    (static_dir / "large_file.txt").write_text(contents, encoding="utf-8")
+    return contents
+
+
+def test_static_large_file_is_streamed(runnable_server_instance: HttpServerRunner, server_temp_dir):
+    """
+    Verifies a static file above the inline size limit is sent intact over HTTP
+    """
+    # GIVEN:
+    contents = _write_large_file(server_temp_dir["static_dir"])
+    runnable_server_instance.start()
+    assert runnable_server_instance.is_alive()
+
+    # WHEN:
+    response, body = _make_request("GET", "/static/large_file.txt")
+
+    # THEN:
+    assert response.status == 200
+    assert int(response.getheader("Content-Length")) == len(contents)
+    assert body == contents
+
+
+def test_abandoned_download_counts_only_bytes_sent(runnable_server_instance: HttpServerRunner, server_temp_dir):
+    """
+    Verifies that a client closing mid-download is recorded with the bytes
+    that were actually sent, not the whole file
+    """
+    # GIVEN: a file far larger than the socket buffers.
+    size = 64 * 1024 * 1024
+    with open(server_temp_dir["static_dir"] / "huge_file.bin", "wb") as f:
+        f.truncate(size)
+    runnable_server_instance.start()
+
+    # WHEN: the client reads the start of the response and resets the connection.
+    client = socket.create_connection(("localhost", 8080), timeout=2)
+    client.sendall(b"GET /static/huge_file.bin HTTP/1.1\r\nHost: localhost\r\n\r\n")
+    assert client.recv(4096).startswith(b"HTTP/1.1 200 OK")
+    client.close()
+
+    # THEN:
+    pattern = re.compile(r'httpserver_response_bytes_total\{method="GET",route="/static\*",status="200"\} (\d+)')
+    deadline = time.time() + 5
+    while not (match := pattern.search(_make_request("GET", "/metrics")[1])) and time.time() < deadline:
+        time.sleep(0.05)
+    assert match
+    assert 0 < int(match.group(1)) < size
+
+
+@pytest.mark.parametrize("ktls", ["0", "1"])
+def test_static_large_file_over_https(runnable_server_instance: HttpServerRunner, server_temp_dir, ktls: str):
+    """
+    Verifies a streamed static file is sent intact over HTTPS, with kTLS
+    offload requested or not. When the kernel refuses the offload the server
+    falls back to userspace TLS transparently.
+    """
+    # GIVEN:
+    contents = _write_large_file(server_temp_dir["static_dir"])
+    runnable_server_instance.start(with_https=True, extra_env={"TEST_KTLS": ktls})
+    assert runnable_server_instance.is_alive()
+
+    # WHEN:
+    response, body, _ = _make_request("GET", "/static/large_file.txt", port=8443, use_https=True)
+
+    # THEN:
+    assert response.status == 200
+    assert body == contents
+    if ktls == "1":
+        assert "kTLS send offload" in runnable_server_instance.get_output()
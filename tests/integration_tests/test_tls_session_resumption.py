@@ -0,0 +1,101 @@
+import socket
+import ssl
+from typing import Optional
+
+import pytest # type: ignore
+from conftest import HttpServerRunner
+
+
+def _client_context() -> ssl.SSLContext:
+    context = ssl.create_default_context()
+    context.check_hostname = False
+    context.verify_mode = ssl.CERT_NONE
+    return context
+
+
+def _tls_get(context: ssl.SSLContext, path: str, session: Optional[ssl.SSLSession] = None, port: int = 8443):
+    """
+    Performs one GET over a fresh TLS connection and returns
+    (response bytes, session, session_reused). Reading the response first
+    ensures TLS 1.3 session tickets sent after the handshake have arrived.
+    """
+    with socket.create_connection(("localhost", port), timeout=2) as raw:
+        with context.wrap_socket(raw, server_hostname="localhost", session=session) as tls:
+            tls.sendall(f"GET {path} HTTP/1.1\r\nHost: localhost\r\nConnection: close\r\n\r\n".encode())
+            data = b""
+            while True:
+                chunk = tls.recv(4096)
+                if not chunk:
+                    break
+                data += chunk
+            return data, tls.session, tls.session_reused
+
+
+@pytest.mark.parametrize("extra_env", [
+    {},                                                  # tickets and cache
+    {"TEST_TLS_TICKETS": "0"},                           # session cache only
+    {"TEST_TLS_SESSION_CACHE": "0"},                     # stateless tickets only
+])
+def test_tls_session_is_resumed(runnable_server_instance: HttpServerRunner, extra_env: dict[str, str]):
+    """
+    Verifies that a client presenting the session from a previous connection
+    resumes it instead of performing a full handshake.
+    """
+    # GIVEN:
+    runnable_server_instance.start(with_https=True, extra_env=extra_env)
+    assert runnable_server_instance.is_alive()
+    context = _client_context()
+
+    first, session, reused = _tls_get(context, "/")
+    assert b"200 OK" in first
+    assert not reused
+    assert session is not None
+
+    # WHEN:
+    second, _, reused = _tls_get(context, "/", session=session)
+
+    # THEN:
+    assert b"200 OK" in second
+    assert reused
+
+
+def test_tls_resumption_disabled(runnable_server_instance: HttpServerRunner):
+    """
+    Verifies that with both the cache and tickets disabled every connection
+    performs a full handshake.
+    """
+    # GIVEN:
+    runnable_server_instance.start(with_https=True, extra_env={
+        "TEST_TLS_TICKETS": "0",
+        "TEST_TLS_SESSION_CACHE": "0",
+    })
+    assert runnable_server_instance.is_alive()
+    context = _client_context()
+
+    _, session, _ = _tls_get(context, "/")
+
+    # WHEN:
+    _, _, reused = _tls_get(context, "/", session=session)
+
+    # THEN:
+    assert not reused
+
+
+def test_tls_handshake_counters(runnable_server_instance: HttpServerRunner):
+    """
+    Verifies that /metrics reports full and resumed handshakes separately.
+    """
+    # GIVEN:
+    runnable_server_instance.start(with_https=True)
+    assert runnable_server_instance.is_alive()
+    context = _client_context()
+
+    # WHEN:
+    _, session, _ = _tls_get(context, "/")
+    _tls_get(context, "/", session=session)
+    _tls_get(context, "/", session=session)
+    metrics, _, _ = _tls_get(context, "/metrics")
+
+    # THEN:
+    assert b'httpserver_tls_handshakes_total{type="resumed"} 2' in metrics
+    assert b'httpserver_tls_handshakes_total{type="full"} 2' in metrics
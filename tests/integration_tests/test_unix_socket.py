@@ -0,0 +1,92 @@
+import os
+import socket
+import stat
+import uuid
+from concurrent.futures import ThreadPoolExecutor
+from pathlib import Path
+
+import pytest # type: ignore
+
+from common import _make_request
+from conftest import HttpServerRunner
+
+
+def _request_over_unix(address: str, path: str = "/") -> bytes:
+    sock = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+    sock.settimeout(2)
+    sock.connect("\0" + address[1:] if address.startswith("@") else address)
+    sock.sendall(f"GET {path} HTTP/1.1\r\nHost: localhost\r\nConnection: close\r\n\r\n".encode())
+    response = b""
+    while chunk := sock.recv(4096):
+        response += chunk
+    sock.close()
+    return response
+
+
+def test_unix_sockets_serve_alongside_tcp(runnable_server_instance: HttpServerRunner, tmp_path: Path):
+    """
+    Verifies that the server accepts on a socket file and an abstract socket
+    as well as its TCP port, through the same routes, and removes the socket
+    file once it stops.
+    """
+    # GIVEN:
+    socket_file = str(tmp_path / "server.sock")
+    abstract = f"@httpserver-test-{uuid.uuid4().hex}"
+    runnable_server_instance.start(extra_env={"TEST_UNIX_SOCKETS": f"{socket_file},{abstract}"})
+
+    # WHEN / THEN:
+    for address in [socket_file, abstract]:
+        response = _request_over_unix(address, "/param?input=unix")
+        assert response.startswith(b"HTTP/1.1 200 OK\r\n")
+        assert response.endswith(b"Parameter: unix")
+    resp, body = _make_request("GET", "/")
+    assert resp.status == 200 and body == "OK"
+    assert stat.S_IMODE(os.stat(socket_file).st_mode) == 0o660
+
+    # WHEN:
+    runnable_server_instance.stop()
+
+    # THEN:
+    assert not os.path.exists(socket_file)
+
+
+def test_concurrent_tcp_and_unix_clients_are_all_served(runnable_server_instance: HttpServerRunner,
+                                                         tmp_path: Path):
+    """
+    Verifies that connections accepted at the same time on the TCP port and
+    on two Unix sockets, each accepted on a thread of its own, are all served
+    and that the server then shuts down cleanly.
+    """
+    # GIVEN:
+    socket_files = [str(tmp_path / "a.sock"), str(tmp_path / "b.sock")]
+    runnable_server_instance.start(extra_env={"TEST_UNIX_SOCKETS": ",".join(socket_files)})
+
+    def request(i: int) -> bool:
+        if i % 3 == 0:
+            resp, body = _make_request("GET", "/")
+            return resp.status == 200 and body == "OK"
+        return _request_over_unix(socket_files[i % 3 - 1]).startswith(b"HTTP/1.1 200 OK\r\n")
+
+    # WHEN:
+    with ThreadPoolExecutor(max_workers=12) as pool:
+        results = list(pool.map(request, range(300)))
+    runnable_server_instance.stop()
+
+    # THEN:
+    assert all(results)
+    assert runnable_server_instance.exit_code() == 0
+
+
+def test_tcp_listener_can_be_disabled(runnable_server_instance: HttpServerRunner, tmp_path: Path):
+    """
+    Verifies that with the TCP listener disabled the server is only reachable
+    over its Unix socket.
+    """
+    # GIVEN:
+    socket_file = str(tmp_path / "only.sock")
+    runnable_server_instance.start(extra_env={"TEST_UNIX_SOCKETS": socket_file, "TEST_TCP": "0"})
+
+    # WHEN / THEN:
+    assert _request_over_unix(socket_file).startswith(b"HTTP/1.1 200 OK\r\n")
+    with pytest.raises(ConnectionRefusedError):
+        socket.create_connection(("localhost", 8080), timeout=2)
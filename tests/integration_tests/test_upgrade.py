@@ -0,0 +1,70 @@
+import os
+import signal
+import socket
+import threading
+import time
+
+from common import _make_request
+from conftest import HttpServerRunner
+
+
+def _wait_until_closed(port: int, timeout: float) -> bool:
+    deadline = time.time() + timeout
+    while time.time() < deadline:
+        try:
+            socket.create_connection(("127.0.0.1", port), timeout=0.2).close()
+        except OSError:
+            return True
+        time.sleep(0.05)
+    return False
+
+
+def test_upgrade_hands_over_listening_socket_without_refusals(
+    runnable_server_instance: HttpServerRunner
+):
+    """
+    Verifies that on SIGUSR2 a new process takes over the listening socket,
+    the old one drains and exits, and no connection is refused throughout.
+    """
+    # GIVEN: a client opening a new connection for every request.
+    runnable_server_instance.start()
+    _, old_pid = _make_request("GET", "/pid")
+    failures: list[str] = []
+    served_by: set[str] = set()
+    stop = threading.Event()
+
+    def hammer() -> None:
+        while not stop.is_set():
+            try:
+                resp, body = _make_request("GET", "/pid")
+                assert resp.status == 200
+                served_by.add(body)
+            except Exception as e:
+                failures.append(repr(e))
+
+    client = threading.Thread(target=hammer)
+    client.start()
+    new_pid = None
+    try:
+        # WHEN:
+        runnable_server_instance.send_signal(signal.SIGUSR2)
+
+        # THEN: the old process drains once the new one is listening.
+        assert runnable_server_instance.wait_for_exit(timeout=10) == 0
+        time.sleep(0.2)
+    finally:
+        stop.set()
+        client.join()
+        _, new_pid = _make_request("GET", "/pid")
+
+    try:
+        # THEN:
+        assert failures == []
+        assert new_pid != old_pid
+        assert served_by == {old_pid, new_pid}
+        output = runnable_server_instance.get_output()
+        assert "Took over listening socket" in output
+        assert f"telling previous process [{old_pid}] to drain" in output
+    finally:
+        os.kill(int(new_pid), signal.SIGTERM)
+        assert _wait_until_closed(8080, timeout=10)
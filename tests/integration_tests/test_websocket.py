@@ -0,0 +1,118 @@
+import base64
+import os
+import socket
+import struct
+
+from conftest import HttpServerRunner
+
+
+def _connect(path: str) -> tuple[socket.socket, bytes]:
+    sock = socket.create_connection(("localhost", 8080), timeout=2)
+    key = base64.b64encode(os.urandom(16)).decode()
+    sock.sendall((f"GET {path} HTTP/1.1\r\nHost: localhost\r\nUpgrade: websocket\r\n"
+                  f"Connection: Upgrade\r\nSec-WebSocket-Key: {key}\r\n"
+                  "Sec-WebSocket-Version: 13\r\n\r\n").encode())
+    response = b""
+    while b"\r\n\r\n" not in response:
+        response += sock.recv(4096)
+    head, rest = response.split(b"\r\n\r\n", 1)
+    return sock, head + b"\r\n\r\n" + rest
+
+
+def _send(sock: socket.socket, opcode: int, payload: bytes) -> None:
+    mask = os.urandom(4)
+    length = len(payload)
+    if length < 126:
+        header = struct.pack("!BB", 0x80 | opcode, 0x80 | length)
+    else:
+        header = struct.pack("!BBH", 0x80 | opcode, 0x80 | 126, length)
+    masked = bytes(b ^ mask[i % 4] for i, b in enumerate(payload))
+    sock.sendall(header + mask + masked)
+
+
+def _receive(sock: socket.socket, buffer: bytearray) -> tuple[int, bytes]:
+    def fill(size: int) -> None:
+        while len(buffer) < size:
+            chunk = sock.recv(4096)
+            assert chunk, "connection closed"
+            buffer.extend(chunk)
+
+    fill(2)
+    opcode = buffer[0] & 0x0F
+    length = buffer[1] & 0x7F
+    offset = 2
+    if length == 126:
+        fill(4)
+        length = struct.unpack("!H", buffer[2:4])[0]
+        offset = 4
+    fill(offset + length)
+    payload = bytes(buffer[offset:offset + length])
+    del buffer[:offset + length]
+    return opcode, payload
+
+
+def test_websocket_upgrade_echoes_messages(runnable_server_instance: HttpServerRunner):
+    """
+    Verifies that a WebSocket route completes the upgrade handshake and then
+    carries messages both ways over the same connection until it is closed.
+    """
+    # GIVEN:
+    runnable_server_instance.start()
+    sock, head = _connect("/ws/echo")
+    assert head.startswith(b"HTTP/1.1 101 Switching Protocols\r\n")
+    buffer = bytearray()
+
+    # WHEN:
+    for message in [b"hello", "café".encode(), b"x" * 1000]:
+        _send(sock, 0x1, message)
+
+        # THEN:
+        assert _receive(sock, buffer) == (0x1, message)
+
+    # WHEN: the client closes
+    _send(sock, 0x8, struct.pack("!H", 1000))
+
+    # THEN: the close is answered and the connection ends
+    assert _receive(sock, buffer) == (0x8, struct.pack("!H", 1000))
+    assert sock.recv(16) == b""
+    sock.close()
+
+
+def test_websocket_messages_are_broadcast_to_every_member(runnable_server_instance: HttpServerRunner):
+    """
+    Verifies that a message sent by one member of a channel is pushed to all
+    of its members without any of them asking for it.
+    """
+    # GIVEN: three members of one channel
+    runnable_server_instance.start()
+    members = [_connect("/ws/channel")[0] for _ in range(3)]
+    buffers = [bytearray() for _ in members]
+    # A pong shows the member's session, and so its onOpen, has run.
+    for sock, buffer in zip(members, buffers):
+        _send(sock, 0x9, b"")
+        assert _receive(sock, buffer) == (0xA, b"")
+
+    # WHEN:
+    _send(members[0], 0x1, b"news")
+
+    # THEN:
+    for sock, buffer in zip(members, buffers):
+        assert _receive(sock, buffer) == (0x1, b"news")
+        sock.close()
+
+
+def test_invalid_upgrade_is_refused(runnable_server_instance: HttpServerRunner):
+    """
+    Verifies that a request to a WebSocket route without a valid handshake is
+    answered 400.
+    """
+    # GIVEN:
+    runnable_server_instance.start()
+    sock = socket.create_connection(("localhost", 8080), timeout=2)
+
+    # WHEN:
+    sock.sendall(b"GET /ws/echo HTTP/1.1\r\nHost: localhost\r\n\r\n")
+
+    # THEN:
+    assert sock.recv(4096).startswith(b"HTTP/1.1 400 Bad Request\r\n")
+    sock.close()
@@ -0,0 +1,176 @@
+#include <gtest/gtest.h>
+
+#include <httpserver/access_log.h>
+#include <httpserver/client_address.h>
+
+#include <netinet/in.h>
+
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace HTTPServer;
+
+namespace fs = std::filesystem;
+
+static ClientAddress makeIPv4Client(uint8_t last, uint16_t port) {
+    sockaddr_storage storage{};
+    auto* in4 = reinterpret_cast<sockaddr_in*>(&storage);
+    in4->sin_family = AF_INET;
+    in4->sin_port = htons(port);
+    in4->sin_addr.s_addr = htonl(0x7f000000u | last);
+    return ClientAddress::fromSockaddr(storage);
+}
+
+static std::vector<AccessLogRecord> readAll(const fs::path& path) {
+    std::vector<AccessLogRecord> records;
+    EXPECT_TRUE(AccessLog::forEachRecord(path.string(), [&](const AccessLogRecord& r) { records.push_back(r); }));
+    return records;
+}
+
+TEST(ClientAddressTests, IPv4IsStoredAsMappedAddress) {
+    // GIVEN:
+    ClientAddress client = makeIPv4Client(1, 5555);
+
+    // THEN:
+    EXPECT_TRUE(client.isIPv4());
+    EXPECT_EQ(client.ip(), "127.0.0.1");
+    EXPECT_EQ(client.toString(), "127.0.0.1:5555");
+}
+
+TEST(AccessLogTests, AppendedRecordsRoundTrip) {
+    // GIVEN:
+    fs::path file = fs::temp_directory_path() / "httpserver_access_log_roundtrip.bin";
+    fs::remove(file);
+
+    AccessLog log;
+    ASSERT_TRUE(log.open(file.string(), 16));
+
+    // WHEN:
+    log.append({makeIPv4Client(7, 4242), "GET", "/index.html", 200, 1234, 56, true});
+    log.append({makeIPv4Client(8, 4343), "POST", "/submit", 404, 10, 7, false});
+    log.close();
+
+    // THEN:
+    auto records = readAll(file);
+    ASSERT_EQ(records.size(), 2u);
+
+    EXPECT_EQ(std::string(records[0].method), "GET");
+    EXPECT_EQ(std::string(records[0].path, records[0].pathLength), "/index.html");
+    EXPECT_EQ(records[0].status, 200);
+    EXPECT_EQ(records[0].bytesSent, 1234u);
+    EXPECT_EQ(records[0].latencyUs, 56u);
+    EXPECT_EQ(records[0].clientPort, 4242);
+    EXPECT_TRUE(records[0].flags & AccessLogRecord::kFlagTLS);
+
+    EXPECT_EQ(std::string(records[1].method), "POST");
+    EXPECT_EQ(records[1].status, 404);
+    EXPECT_FALSE(records[1].flags & AccessLogRecord::kFlagTLS);
+
+    // CLEANUP:
+    fs::remove(file);
+}
+
+TEST(AccessLogTests, RingKeepsOnlyNewestRecords) {
+    // GIVEN:
+    fs::path file = fs::temp_directory_path() / "httpserver_access_log_ring.bin";
+    fs::remove(file);
+
+    AccessLog log;
+    ASSERT_TRUE(log.open(file.string(), 4));
+
+    // WHEN:
+    for (int i = 0; i < 10; i++) {
+        std::string path = "/" + std::to_string(i);
+        log.append({makeIPv4Client(1, 1), "GET", path, 200, 0, 0, false});
+    }
+    log.close();
+
+    // THEN:
+    auto records = readAll(file);
+    ASSERT_EQ(records.size(), 4u);
+    for (size_t i = 0; i < records.size(); i++) {
+        EXPECT_EQ(std::string(records[i].path, records[i].pathLength), "/" + std::to_string(6 + i));
+    }
+
+    // CLEANUP:
+    fs::remove(file);
+}
+
+TEST(AccessLogTests, ReopenContinuesAfterExistingRecords) {
+    // GIVEN:
+    fs::path file = fs::temp_directory_path() / "httpserver_access_log_reopen.bin";
+    fs::remove(file);
+
+    {
+        AccessLog log;
+        ASSERT_TRUE(log.open(file.string(), 8));
+        log.append({makeIPv4Client(1, 1), "GET", "/first", 200, 0, 0, false});
+    }
+
+    // WHEN:
+    AccessLog log;
+    ASSERT_TRUE(log.open(file.string(), 8));
+    log.append({makeIPv4Client(1, 1), "GET", "/second", 200, 0, 0, false});
+    log.close();
+
+    // THEN:
+    auto records = readAll(file);
+    ASSERT_EQ(records.size(), 2u);
+    EXPECT_EQ(std::string(records[0].path, records[0].pathLength), "/first");
+    EXPECT_EQ(std::string(records[1].path, records[1].pathLength), "/second");
+
+    // CLEANUP:
+    fs::remove(file);
+}
+
+TEST(AccessLogTests, ConcurrentAppendsAreAllCommitted) {
+    // GIVEN:
+    fs::path file = fs::temp_directory_path() / "httpserver_access_log_concurrent.bin";
+    fs::remove(file);
+
+    AccessLog log;
+    ASSERT_TRUE(log.open(file.string(), 4096));
+
+    // WHEN:
+    std::vector<std::thread> writers;
+    for (int t = 0; t < 4; t++) {
+        writers.emplace_back([&log, t]() {
+            for (int i = 0; i < 500; i++) {
+                log.append({makeIPv4Client(static_cast<uint8_t>(t), 1), "GET", "/concurrent", 200, 1, 1, false});
+            }
+        });
+    }
+    for (auto& writer : writers) writer.join();
+    log.close();
+
+    // THEN:
+    EXPECT_EQ(readAll(file).size(), 2000u);
+
+    // CLEANUP:
+    fs::remove(file);
+}
+
+TEST(AccessLogTests, LongPathsAreTruncated) {
+    // GIVEN:
+    fs::path file = fs::temp_directory_path() / "httpserver_access_log_truncate.bin";
+    fs::remove(file);
+
+    AccessLog log;
+    ASSERT_TRUE(log.open(file.string(), 2));
+    std::string longPath(200, 'a');
+
+    // WHEN:
+    log.append({makeIPv4Client(1, 1), "GET", longPath, 200, 0, 0, false});
+    log.close();
+
+    // THEN:
+    auto records = readAll(file);
+    ASSERT_EQ(records.size(), 1u);
+    EXPECT_EQ(records[0].pathLength, AccessLogRecord::kMaxPathLength);
+
+    // CLEANUP:
+    fs::remove(file);
+}
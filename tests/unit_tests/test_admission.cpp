@@ -0,0 +1,114 @@
+#include <gtest/gtest.h>
+
+#include <httpserver/admission.h>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <string>
+#include <thread>
+
+using namespace HTTPServer;
+using namespace std::chrono_literals;
+
+TEST(AdmissionTests, LimiterCapsActiveConnections) {
+    // GIVEN:
+    ConnectionLimiter limiter(2);
+
+    // WHEN / THEN:
+    EXPECT_TRUE(limiter.tryAcquire());
+    EXPECT_TRUE(limiter.tryAcquire());
+    EXPECT_FALSE(limiter.hasCapacity());
+    EXPECT_FALSE(limiter.tryAcquire());
+    limiter.release();
+    EXPECT_TRUE(limiter.tryAcquire());
+    EXPECT_EQ(limiter.active(), 2u);
+}
+
+TEST(AdmissionTests, ZeroLimitIsUnlimited) {
+    // GIVEN:
+    ConnectionLimiter limiter;
+
+    // WHEN:
+    for (int i = 0; i < 1000; i++) ASSERT_TRUE(limiter.tryAcquire());
+
+    // THEN:
+    EXPECT_TRUE(limiter.hasCapacity());
+    EXPECT_EQ(limiter.active(), 1000u);
+}
+
+TEST(AdmissionTests, SharedLimitSpansListeners) {
+    // GIVEN: two listeners of up to two connections each, three in total.
+    ConnectionLimiter total(3);
+    ListenerAdmission first(&total), second(&total);
+    first.configure(2, OverloadAction::Reject, 1s);
+    second.configure(2, OverloadAction::Reject, 1s);
+
+    // WHEN:
+    ASSERT_TRUE(first.tryAdmit());
+    ASSERT_TRUE(first.tryAdmit());
+    ASSERT_TRUE(second.tryAdmit());
+
+    // THEN: the refused admission took no slot on the listener either.
+    EXPECT_FALSE(first.tryAdmit());
+    EXPECT_FALSE(second.tryAdmit());
+    EXPECT_EQ(second.active(), 1u);
+    EXPECT_EQ(total.active(), 3u);
+
+    first.release();
+    EXPECT_TRUE(second.hasCapacity());
+    EXPECT_TRUE(second.tryAdmit());
+}
+
+TEST(AdmissionTests, RejectionIsPreSerialized503) {
+    // GIVEN:
+    ListenerAdmission admission;
+    admission.configure(1, OverloadAction::Reject, 7s);
+    int fds[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+
+    // WHEN:
+    admission.reject(fds[0], true);
+    std::string received(512, '\0');
+    received.resize(std::max<ssize_t>(recv(fds[1], received.data(), received.size(), 0), 0));
+
+    // THEN:
+    EXPECT_EQ(received, std::string(admission.rejection()));
+    EXPECT_EQ(received.find("HTTP/1.1 503 Service Unavailable\r\n"), 0u);
+    EXPECT_NE(received.find("Retry-After: 7\r\n"), std::string::npos);
+    EXPECT_NE(received.find("Connection: close\r\n"), std::string::npos);
+    char byte;
+    EXPECT_EQ(recv(fds[1], &byte, 1, 0), 0);
+    close(fds[1]);
+}
+
+TEST(AdmissionTests, WaitForCapacityReturnsOnReleaseOrStop) {
+    // GIVEN:
+    ListenerAdmission admission;
+    admission.configure(1, OverloadAction::PauseAccept, 1s);
+    ASSERT_TRUE(admission.tryAdmit());
+    std::atomic<bool> running{true};
+
+    // WHEN: a slot is released while the listener waits.
+    std::thread releaser([&admission]() {
+        std::this_thread::sleep_for(20ms);
+        admission.release();
+    });
+    const bool resumed = admission.waitForCapacity(running);
+    releaser.join();
+
+    // THEN:
+    EXPECT_TRUE(resumed);
+
+    // WHEN: the listener is full and the server stops.
+    ASSERT_TRUE(admission.tryAdmit());
+    std::thread stopper([&running]() {
+        std::this_thread::sleep_for(20ms);
+        running = false;
+    });
+    const bool stopped = !admission.waitForCapacity(running);
+    stopper.join();
+
+    // THEN:
+    EXPECT_TRUE(stopped);
+}
@@ -0,0 +1,90 @@
+#include <gtest/gtest.h>
+
+#include <httpserver/buffer_pool.h>
+
+#include <cstring>
+#include <thread>
+#include <utility>
+
+using namespace HTTPServer;
+
+TEST(BufferPoolTests, SizeClassesArePowersOfFour) {
+    EXPECT_EQ(BufferPool::sizeClassFor(1), 0u);
+    EXPECT_EQ(BufferPool::sizeClassFor(4096), 0u);
+    EXPECT_EQ(BufferPool::sizeClassFor(4097), 1u);
+    EXPECT_EQ(BufferPool::sizeClassFor(16 * 1024), 1u);
+    EXPECT_EQ(BufferPool::sizeClassFor(16 * 1024 + 1), 2u);
+    EXPECT_EQ(BufferPool::sizeClassFor(BufferPool::kMaxBufferSize), BufferPool::kSizeClassCount - 1);
+    EXPECT_EQ(BufferPool::sizeClassFor(BufferPool::kMaxBufferSize + 1), BufferPool::kSizeClassCount);
+}
+
+TEST(BufferPoolTests, AcquireRoundsUpToClassSize) {
+    // WHEN:
+    PooledBuffer small = BufferPool::instance().acquire(100);
+    PooledBuffer medium = BufferPool::instance().acquire(20 * 1024);
+
+    // THEN:
+    ASSERT_TRUE(small);
+    ASSERT_TRUE(medium);
+    EXPECT_EQ(small.capacity(), 4096u);
+    EXPECT_EQ(medium.capacity(), 64u * 1024);
+    std::memset(medium.data(), 0xab, medium.capacity());
+}
+
+TEST(BufferPoolTests, ReleasedBufferIsReusedByThread) {
+    // GIVEN:
+    PooledBuffer first = BufferPool::instance().acquire(4096);
+    char* data = first.data();
+
+    // WHEN:
+    first.reset();
+    PooledBuffer second = BufferPool::instance().acquire(4096);
+
+    // THEN:
+    EXPECT_FALSE(first);
+    EXPECT_EQ(second.data(), data);
+}
+
+TEST(BufferPoolTests, TrimmedBuffersMoveToOtherThreads) {
+    // GIVEN:
+    char* data = nullptr;
+    std::thread([&] {
+        PooledBuffer buffer = BufferPool::instance().acquire(256 * 1024);
+        data = buffer.data();
+        buffer.reset();
+        BufferPool::instance().trimThreadCache();
+    }).join();
+
+    // WHEN:
+    PooledBuffer buffer = BufferPool::instance().acquire(256 * 1024);
+
+    // THEN:
+    EXPECT_EQ(buffer.data(), data);
+}
+
+TEST(BufferPoolTests, InUseBytesTrackBorrowedBuffers) {
+    // GIVEN:
+    const uint64_t before = BufferPool::instance().stats().inUseBytes;
+
+    // WHEN:
+    PooledBuffer a = BufferPool::instance().acquire(4096);
+    PooledBuffer b = BufferPool::instance().acquire(10000);
+    PooledBuffer moved = std::move(b);
+
+    // THEN:
+    EXPECT_EQ(BufferPool::instance().stats().inUseBytes, before + 4096 + 16 * 1024);
+    a.reset();
+    moved.reset();
+    EXPECT_EQ(BufferPool::instance().stats().inUseBytes, before);
+}
+
+TEST(BufferPoolTests, OversizedRequestsAreUnpooled) {
+    // WHEN:
+    const uint64_t reserved = BufferPool::instance().stats().reservedBytes;
+    PooledBuffer huge = BufferPool::instance().acquire(BufferPool::kMaxBufferSize + 1);
+
+    // THEN:
+    ASSERT_TRUE(huge);
+    EXPECT_EQ(huge.capacity(), BufferPool::kMaxBufferSize + 1);
+    EXPECT_EQ(BufferPool::instance().stats().reservedBytes, reserved);
+}
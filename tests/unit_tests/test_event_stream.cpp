@@ -0,0 +1,176 @@
+#include <gtest/gtest.h>
+
+#include <httpserver/event_stream.h>
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+
+using namespace HTTPServer;
+using namespace std::chrono_literals;
+
+namespace {
+
+// Reads from 'fd' until 'buffer' holds 'size' bytes, or nothing more comes
+// within the timeout.
+void readAtLeast(int fd, std::string& buffer, size_t size, std::chrono::milliseconds timeout = 2s) {
+    while (buffer.size() < size) {
+        pollfd pfd{fd, POLLIN, 0};
+        if (poll(&pfd, 1, static_cast<int>(timeout.count())) <= 0) return;
+        char chunk[4096];
+        const ssize_t n = recv(fd, chunk, sizeof(chunk), 0);
+        if (n <= 0) return;
+        buffer.append(chunk, n);
+    }
+}
+
+// One subscriber over a socketpair, run on its own thread.
+class Stream {
+  public:
+    explicit Stream(EventStreamOptions options = {}) {
+        EXPECT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, d_fds), 0);
+        const int fd = d_fds[0];
+        EventStreamTransport transport{
+            [fd](char* buf, size_t size) -> ssize_t { return recv(fd, buf, size, 0); },
+            [fd](const char* data, size_t size) -> ssize_t { return send(fd, data, size, MSG_NOSIGNAL); },
+            [fd](std::chrono::milliseconds timeout, int wakeFd) {
+                pollfd pfds[2] = {{fd, POLLIN, 0}, {wakeFd, POLLIN, 0}};
+                return poll(pfds, 2, static_cast<int>(timeout.count())) > 0 && pfds[0].revents != 0;
+            }};
+        d_subscriber = std::make_shared<EventStreamSubscriber>(std::move(transport), options);
+    }
+
+    ~Stream() {
+        shutdown(d_fds[1], SHUT_RDWR);
+        if (d_thread.joinable()) d_thread.join();
+        close(d_fds[0]);
+        close(d_fds[1]);
+    }
+
+    void start() {
+        d_thread = std::thread([this]() { d_subscriber->run(); });
+    }
+
+    int client() const { return d_fds[1]; }
+    const EventStreamSubscriberPtr& subscriber() const { return d_subscriber; }
+
+  private:
+    int d_fds[2];
+    EventStreamSubscriberPtr d_subscriber;
+    std::thread d_thread;
+};
+
+} // namespace
+
+TEST(EventStreamTests, EventsAreEncodedOneFieldPerLine) {
+    // GIVEN:
+    std::string out;
+
+    // WHEN:
+    EventStream::writeEvent(out, "first\r\nsecond\nthird", "update", "7");
+    EventStream::writeEvent(out, "");
+
+    // THEN:
+    EXPECT_EQ(out, "id: 7\nevent: update\ndata: first\ndata: second\ndata: third\n\ndata: \n\n");
+}
+
+TEST(EventStreamTests, PublishedEventsReachEverySubscriber) {
+    // GIVEN:
+    EventStreamOptions options;
+    options.retry = 2000ms;
+    EventStreamHub hub;
+    Stream first(options), second(options);
+    hub.subscribe(first.subscriber());
+    hub.subscribe(second.subscriber());
+    first.start();
+    second.start();
+
+    // WHEN:
+    EXPECT_EQ(hub.publish("hello", "greeting", "1"), 2u);
+    EXPECT_EQ(hub.publish("world"), 2u);
+
+    // THEN:
+    const std::string expected = "retry: 2000\n\nid: 1\nevent: greeting\ndata: hello\n\ndata: world\n\n";
+    for (Stream* stream : {&first, &second}) {
+        std::string received;
+        readAtLeast(stream->client(), received, expected.size());
+        EXPECT_EQ(received, expected);
+    }
+}
+
+TEST(EventStreamTests, SubscriberThatFallsBehindIsEvicted) {
+    // GIVEN: a subscriber whose thread never drains its queue
+    EventStreamOptions options;
+    options.maxQueuedEvents = 2;
+    EventStreamHub hub;
+    Stream stream(options);
+    hub.subscribe(stream.subscriber());
+
+    // WHEN:
+    EXPECT_EQ(hub.publish("one"), 1u);
+    EXPECT_EQ(hub.publish("two"), 1u);
+    EXPECT_EQ(hub.publish("three"), 0u);
+
+    // THEN:
+    EXPECT_TRUE(stream.subscriber()->evicted());
+    EXPECT_FALSE(stream.subscriber()->isOpen());
+    EXPECT_EQ(stream.subscriber()->queuedEvents(), 0u);
+    EXPECT_EQ(hub.subscribers(), 0u);
+    EXPECT_EQ(hub.evicted(), 1u);
+}
+
+TEST(EventStreamTests, ReconnectingSubscriberIsSentTheEventsItMissed) {
+    // GIVEN:
+    EventStreamHub hub(10);
+    hub.publish("one", {}, "1");
+    hub.publish("two", {}, "2");
+    hub.publish("three", {}, "3");
+    Stream stream;
+
+    // WHEN:
+    hub.subscribe(stream.subscriber(), "1");
+
+    // THEN:
+    EXPECT_EQ(stream.subscriber()->queuedEvents(), 2u);
+    stream.start();
+    const std::string expected = "id: 2\ndata: two\n\nid: 3\ndata: three\n\n";
+    std::string received;
+    readAtLeast(stream.client(), received, expected.size());
+    EXPECT_EQ(received, expected);
+}
+
+TEST(EventStreamTests, IdleStreamSendsHeartbeats) {
+    // GIVEN:
+    EventStreamOptions options;
+    options.heartbeatInterval = 50ms;
+    Stream stream(options);
+
+    // WHEN:
+    stream.start();
+
+    // THEN:
+    std::string received;
+    readAtLeast(stream.client(), received, 3);
+    EXPECT_EQ(received.substr(0, 3), ":\n\n");
+}
+
+TEST(EventStreamTests, StreamEndsWhenClientGoesAway) {
+    // GIVEN:
+    EventStreamHub hub;
+    Stream stream;
+    hub.subscribe(stream.subscriber());
+    stream.start();
+
+    // WHEN:
+    shutdown(stream.client(), SHUT_WR);
+
+    // THEN:
+    for (int i = 0; i < 200 && stream.subscriber()->isOpen(); i++) std::this_thread::sleep_for(10ms);
+    EXPECT_FALSE(stream.subscriber()->isOpen());
+    EXPECT_EQ(hub.publish("late"), 0u);
+}
@@ -0,0 +1,83 @@
+#include <gtest/gtest.h>
+
+#include <httpserver/handler_executor.h>
+#include <httpserver/http_response_builder.h>
+#include <httpserver/router.h>
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <semaphore>
+#include <sstream>
+#include <string>
+#include <thread>
+
+using namespace HTTPServer;
+using namespace std::chrono_literals;
+
+namespace {
+
+std::string threadName(std::thread::id id) {
+    std::ostringstream out;
+    out << id;
+    return out.str();
+}
+
+} // namespace
+
+// One test, as the executor is process wide and is configured only once.
+TEST(HandlerExecutorTests, OffloadedRoutesRunOnTheExecutorWithABoundedQueue) {
+    // GIVEN: one executor thread, room for one queued request, and a
+    // route that blocks until released
+    HandlerExecutorOptions options;
+    options.threads = 1;
+    options.maxQueued = 1;
+    HandlerExecutor::instance().configure(options);
+
+    std::counting_semaphore<> release(0);
+    Router::instance().addRoute(
+        "GET", "/offloaded-test",
+        [&release](const HttpRequest& req) {
+            release.acquire();
+            return Responses::ok(req, threadName(std::this_thread::get_id()));
+        },
+        HandlerExecution::Offloaded);
+    Router::instance().addRoute("GET", "/inline-test", [](const HttpRequest& req) {
+        return Responses::ok(req, threadName(std::this_thread::get_id()));
+    });
+
+    auto request = [](const char* path) {
+        HttpRequest req;
+        req.method = "GET";
+        req.path = path;
+        return req;
+    };
+    HttpRequest running = request("/offloaded-test");
+    HttpRequest queued = request("/offloaded-test");
+    HttpRequest refused = request("/offloaded-test");
+    HttpRequest quick = request("/inline-test");
+
+    // WHEN: one request occupies the thread and another the queue
+    auto first = std::async(std::launch::async, [&]() { return Router::instance().route(running); });
+    while (HandlerExecutor::instance().active() == 0) std::this_thread::sleep_for(1ms);
+    auto second = std::async(std::launch::async, [&]() { return Router::instance().route(queued); });
+    while (HandlerExecutor::instance().queued() == 0) std::this_thread::sleep_for(1ms);
+
+    // THEN: a third is refused at once, and inline routes are unaffected
+    HttpResponse refusedResponse = Router::instance().route(refused);
+    EXPECT_EQ(refusedResponse.code, StatusCode::ServiceUnavailable);
+    HttpResponse quickResponse = Router::instance().route(quick);
+    EXPECT_EQ(quickResponse.code, StatusCode::OK);
+    EXPECT_EQ(std::string(quickResponse.body), threadName(std::this_thread::get_id()));
+
+    // WHEN: the handlers are let go
+    release.release(2);
+    HttpResponse firstResponse = first.get();
+    HttpResponse secondResponse = second.get();
+
+    // THEN: both ran on the executor's one thread
+    EXPECT_EQ(firstResponse.code, StatusCode::OK);
+    EXPECT_EQ(secondResponse.code, StatusCode::OK);
+    EXPECT_EQ(firstResponse.body, secondResponse.body);
+    EXPECT_NE(std::string(firstResponse.body), threadName(std::this_thread::get_id()));
+}
@@ -0,0 +1,208 @@
+#include <gtest/gtest.h>
+
+#include <httpserver/hpack.h>
+
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace HTTPServer;
+
+namespace {
+
+std::string fromHex(std::string_view hex) {
+    std::string out;
+    for (size_t i = 0; i + 1 < hex.size(); i += 2) {
+        out.push_back(static_cast<char>(std::stoi(std::string(hex.substr(i, 2)), nullptr, 16)));
+    }
+    return out;
+}
+
+using Fields = std::vector<std::pair<std::string, std::string>>;
+
+Fields decodeAll(HpackDecoder& decoder, std::string_view block, bool& ok) {
+    Fields fields;
+    ok = decoder.decode(block, [&](std::string_view name, std::string_view value) {
+        fields.emplace_back(std::string(name), std::string(value));
+    });
+    return fields;
+}
+
+} // namespace
+
+TEST(HpackTests, HuffmanRoundTrip) {
+    // GIVEN:
+    const std::string text = "www.example.com";
+
+    // WHEN:
+    std::string encoded;
+    Hpack::huffmanEncode(text, encoded);
+    std::string decoded;
+    const bool ok = Hpack::huffmanDecode(encoded, decoded);
+
+    // THEN:
+    EXPECT_EQ(encoded, fromHex("f1e3c2e5f23a6ba0ab90f4ff"));
+    EXPECT_EQ(Hpack::huffmanEncodedSize(text), encoded.size());
+    EXPECT_TRUE(ok);
+    EXPECT_EQ(decoded, text);
+}
+
+TEST(HpackTests, HuffmanRejectsInvalidPadding) {
+    std::string decoded;
+    // 'a' is 00011; zero padding is not a prefix of EOS.
+    EXPECT_FALSE(Hpack::huffmanDecode(fromHex("18"), decoded));
+    // Thirty ones encode EOS itself.
+    decoded.clear();
+    EXPECT_FALSE(Hpack::huffmanDecode(fromHex("ffffffff"), decoded));
+}
+
+// RFC 7541 Appendix C.3: requests without Huffman coding.
+TEST(HpackTests, DecodesRequestsWithoutHuffman) {
+    // GIVEN:
+    HpackDecoder decoder;
+    bool ok = false;
+
+    // WHEN:
+    Fields first = decodeAll(decoder, fromHex("828684410f7777772e6578616d706c652e636f6d"), ok);
+    ASSERT_TRUE(ok);
+    Fields second = decodeAll(decoder, fromHex("828684be58086e6f2d6361636865"), ok);
+    ASSERT_TRUE(ok);
+    Fields third =
+        decodeAll(decoder, fromHex("828785bf400a637573746f6d2d6b65790c637573746f6d2d76616c7565"), ok);
+    ASSERT_TRUE(ok);
+
+    // THEN:
+    EXPECT_EQ(first, (Fields{{":method", "GET"}, {":scheme", "http"}, {":path", "/"},
+                             {":authority", "www.example.com"}}));
+    EXPECT_EQ(second, (Fields{{":method", "GET"}, {":scheme", "http"}, {":path", "/"},
+                              {":authority", "www.example.com"}, {"cache-control", "no-cache"}}));
+    EXPECT_EQ(third, (Fields{{":method", "GET"}, {":scheme", "https"}, {":path", "/index.html"},
+                             {":authority", "www.example.com"}, {"custom-key", "custom-value"}}));
+    EXPECT_EQ(decoder.table().entryCount(), 3u);
+    EXPECT_EQ(decoder.table().size(), 164u);
+}
+
+// RFC 7541 Appendix C.4: the same requests with Huffman coding, produced by
+// the encoder byte for byte.
+TEST(HpackTests, EncodesRequestsWithHuffman) {
+    // GIVEN:
+    HpackEncoder encoder;
+    const std::vector<Fields> requests = {
+        {{":method", "GET"}, {":scheme", "http"}, {":path", "/"}, {":authority", "www.example.com"}},
+        {{":method", "GET"},
+         {":scheme", "http"},
+         {":path", "/"},
+         {":authority", "www.example.com"},
+         {"cache-control", "no-cache"}},
+        {{":method", "GET"},
+         {":scheme", "https"},
+         {":path", "/index.html"},
+         {":authority", "www.example.com"},
+         {"custom-key", "custom-value"}},
+    };
+    const std::vector<std::string> expected = {
+        fromHex("828684418cf1e3c2e5f23a6ba0ab90f4ff"),
+        fromHex("828684be5886a8eb10649cbf"),
+        fromHex("828785bf408825a849e95ba97d7f8925a849e95bb8e8b4bf"),
+    };
+
+    // WHEN / THEN:
+    HpackDecoder decoder;
+    for (size_t i = 0; i < requests.size(); i++) {
+        std::string block;
+        encoder.beginBlock(block);
+        for (const auto& [name, value] : requests[i]) {
+            encoder.encode(name, value, block);
+        }
+        EXPECT_EQ(block, expected[i]) << "request " << i;
+
+        bool ok = false;
+        EXPECT_EQ(decodeAll(decoder, block, ok), requests[i]);
+        EXPECT_TRUE(ok);
+    }
+    EXPECT_EQ(encoder.table().size(), 164u);
+}
+
+// RFC 7541 Appendix C.5: responses with a 256 byte table, evicting entries.
+TEST(HpackTests, EvictsOldestEntries) {
+    // GIVEN:
+    HpackDecoder decoder(256);
+    bool ok = false;
+    // Shrink the table from the default before the first field.
+    const std::string resize = fromHex("3fe101");
+
+    // WHEN:
+    decodeAll(decoder,
+              resize + fromHex("4803333032580770726976617465611d4d6f6e2c203231204f637420323031332032303a31333a3231"
+                               "20474d546e1768747470733a2f2f7777772e6578616d706c652e636f6d"),
+              ok);
+    ASSERT_TRUE(ok);
+    EXPECT_EQ(decoder.table().size(), 222u);
+    Fields second = decodeAll(decoder, fromHex("4803333037c1c0bf"), ok);
+    ASSERT_TRUE(ok);
+
+    // THEN:
+    EXPECT_EQ(second, (Fields{{":status", "307"},
+                              {"cache-control", "private"},
+                              {"date", "Mon, 21 Oct 2013 20:13:21 GMT"},
+                              {"location", "https://www.example.com"}}));
+    EXPECT_EQ(decoder.table().entryCount(), 4u);
+    EXPECT_EQ(decoder.table().size(), 222u);
+}
+
+TEST(HpackTests, RejectsInvalidBlocks) {
+    HpackDecoder decoder(4096);
+    bool ok = true;
+
+    // Index 0 and indices past the dynamic table.
+    decodeAll(decoder, fromHex("80"), ok);
+    EXPECT_FALSE(ok);
+    decodeAll(decoder, fromHex("be"), ok);
+    EXPECT_FALSE(ok);
+    // Table size update above the advertised limit.
+    decodeAll(decoder, fromHex("3fe21f"), ok);
+    EXPECT_FALSE(ok);
+    // String length running past the end of the block.
+    decodeAll(decoder, fromHex("400a6162"), ok);
+    EXPECT_FALSE(ok);
+}
+
+TEST(HpackTests, EncoderAnnouncesTableSizeChanges) {
+    // GIVEN:
+    HpackEncoder encoder;
+    std::string block;
+    encoder.beginBlock(block);
+    encoder.encode("x-trace", "abc", block);
+    ASSERT_EQ(encoder.table().entryCount(), 1u);
+
+    // WHEN:
+    encoder.setMaxTableSize(0);
+    encoder.setMaxTableSize(1024);
+    block.clear();
+    encoder.beginBlock(block);
+
+    // THEN: the smallest size is signalled before the final one.
+    EXPECT_EQ(block, fromHex("203fe107"));
+    EXPECT_EQ(encoder.table().entryCount(), 0u);
+    EXPECT_EQ(encoder.table().maxSize(), 1024u);
+}
+
+TEST(HpackTests, NeverIndexedFieldsStayOutOfTheTable) {
+    // GIVEN:
+    HpackEncoder encoder;
+    HpackDecoder decoder;
+    std::string block;
+
+    // WHEN:
+    encoder.encode("set-cookie", "id=1", block, HpackEncoder::Indexing::Never);
+    encoder.encode("content-length", "42", block, HpackEncoder::Indexing::None);
+    bool ok = false;
+    Fields fields = decodeAll(decoder, block, ok);
+
+    // THEN:
+    EXPECT_TRUE(ok);
+    EXPECT_EQ(fields, (Fields{{"set-cookie", "id=1"}, {"content-length", "42"}}));
+    EXPECT_EQ(static_cast<uint8_t>(block[0]) & 0xf0, 0x10);
+    EXPECT_EQ(encoder.table().entryCount(), 0u);
+    EXPECT_EQ(decoder.table().entryCount(), 0u);
+}
@@ -0,0 +1,396 @@
+#include <gtest/gtest.h>
+
+#include <httpserver/http2.h>
+#include <httpserver/http_response_builder.h>
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+using namespace HTTPServer;
+using namespace std::chrono_literals;
+
+namespace {
+
+struct Frame {
+    Http2::FrameHeader header;
+    std::string payload;
+};
+
+struct StreamResult {
+    std::map<std::string, std::string> headers;
+    std::string body;
+    bool ended = false;
+};
+
+// Serves one Http2Connection on a socket pair and plays the client side by
+// hand, so tests control exactly which frames are sent and when.
+class Http2ConnectionTest : public ::testing::Test {
+  protected:
+    void SetUp() override { ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0); }
+
+    void TearDown() override {
+        if (fds[0] >= 0) close(fds[0]);
+        if (server.joinable()) server.join();
+        close(fds[1]);
+    }
+
+    // Takes a Dispatch or an AsyncDispatch.
+    template <typename Dispatch>
+    void start(Dispatch dispatch, std::function<bool()> draining = {}) {
+        const int fd = fds[1];
+        server = std::thread([fd, dispatch = std::move(dispatch), draining = std::move(draining)]() {
+            Http2Options options;
+            options.idleTimeout = 2s;
+            options.draining = draining;
+            Http2Connection connection(
+                Http2Transport{[fd](char* buf, size_t size) { return recv(fd, buf, size, 0); },
+                               [fd](const char* data, size_t size) { return send(fd, data, size, MSG_NOSIGNAL); },
+                               [fd](std::chrono::milliseconds timeout, int wakeFd) {
+                                   pollfd pfds[2] = {{fd, POLLIN, 0}, {wakeFd, POLLIN, 0}};
+                                   return poll(pfds, 2, static_cast<int>(timeout.count())) > 0 && pfds[0].revents;
+                               }},
+                std::move(dispatch), {}, options);
+            connection.run();
+            shutdown(fd, SHUT_RDWR);
+        });
+    }
+
+    void sendRaw(std::string_view bytes) {
+        ASSERT_EQ(send(fds[0], bytes.data(), bytes.size(), 0), static_cast<ssize_t>(bytes.size()));
+    }
+
+    static std::string frame(Http2::FrameType type, uint8_t flags, uint32_t streamId, std::string_view payload) {
+        std::string frame;
+        Http2::writeFrameHeader(frame, payload.size(), type, flags, streamId);
+        frame.append(payload);
+        return frame;
+    }
+
+    void sendFrame(Http2::FrameType type, uint8_t flags, uint32_t streamId, std::string_view payload) {
+        sendRaw(frame(type, flags, streamId, payload));
+    }
+
+    void handshake() {
+        sendRaw(Http2::kClientPreface);
+        sendFrame(Http2::FrameType::Settings, 0, 0, "");
+    }
+
+    std::string requestFrame(uint32_t streamId, std::string_view method, std::string_view path,
+                             bool endStream = true) {
+        std::string block;
+        encoder.beginBlock(block);
+        encoder.encode(":method", method, block);
+        encoder.encode(":scheme", "https", block);
+        encoder.encode(":path", path, block);
+        encoder.encode(":authority", "localhost", block);
+        return frame(Http2::FrameType::Headers, Http2::Flags::EndHeaders | (endStream ? Http2::Flags::EndStream : 0),
+                     streamId, block);
+    }
+
+    void sendRequest(uint32_t streamId, std::string_view method, std::string_view path, bool endStream = true) {
+        sendRaw(requestFrame(streamId, method, path, endStream));
+    }
+
+    void sendWindowUpdate(uint32_t streamId, uint32_t increment) {
+        std::string payload;
+        Http2::writeUint32(payload, increment);
+        sendFrame(Http2::FrameType::WindowUpdate, 0, streamId, payload);
+    }
+
+    bool readFrame(Frame& frame) {
+        char header[Http2::kFrameHeaderSize];
+        if (!readExactly(header, sizeof(header))) return false;
+        frame.header = Http2::readFrameHeader(header);
+        frame.payload.resize(frame.header.length);
+        return readExactly(frame.payload.data(), frame.payload.size());
+    }
+
+    // Reads frames into 'streams' until 'done' holds or the server goes quiet.
+    template <typename Done>
+    void readUntil(Done done) {
+        Frame frame;
+        while (!done() && readFrame(frame)) {
+            frames.push_back(frame);
+            StreamResult& stream = streams[frame.header.streamId];
+            if (frame.header.type == Http2::FrameType::Headers) {
+                decoder.decode(frame.payload, [&](std::string_view name, std::string_view value) {
+                    stream.headers[std::string(name)] = std::string(value);
+                });
+            } else if (frame.header.type == Http2::FrameType::Data) {
+                stream.body += frame.payload;
+                if (frame.header.flags & Http2::Flags::EndStream) completionOrder.push_back(frame.header.streamId);
+            }
+            if ((frame.header.type == Http2::FrameType::Headers || frame.header.type == Http2::FrameType::Data) &&
+                (frame.header.flags & Http2::Flags::EndStream)) {
+                stream.ended = true;
+            }
+        }
+    }
+
+    bool received(Http2::FrameType type, uint8_t flags = 0) const {
+        for (const Frame& frame : frames) {
+            if (frame.header.type == type && (frame.header.flags & flags) == flags) return true;
+        }
+        return false;
+    }
+
+    int fds[2] = {-1, -1};
+    std::thread server;
+    HpackEncoder encoder;
+    HpackDecoder decoder;
+    std::vector<Frame> frames;
+    std::map<uint32_t, StreamResult> streams;
+    std::vector<uint32_t> completionOrder;
+
+  private:
+    bool readExactly(char* out, size_t size) {
+        while (size > 0) {
+            pollfd pfd{fds[0], POLLIN, 0};
+            if (poll(&pfd, 1, 3000) <= 0) return false;
+            ssize_t bytes = recv(fds[0], out, size, 0);
+            if (bytes <= 0) return false;
+            out += bytes;
+            size -= static_cast<size_t>(bytes);
+        }
+        return true;
+    }
+};
+
+HttpResponse echoPath(HttpRequest& request) {
+    return Responses::ok(request, "path=" + std::string(request.path));
+}
+
+} // namespace
+
+TEST_F(Http2ConnectionTest, ServesMultiplexedStreams) {
+    // GIVEN:
+    start(echoPath);
+    handshake();
+
+    // WHEN:
+    sendRequest(1, "GET", "/one");
+    sendRequest(3, "GET", "/two?x=1");
+    readUntil([&] { return streams[1].ended && streams[3].ended; });
+
+    // THEN:
+    EXPECT_TRUE(received(Http2::FrameType::Settings));
+    EXPECT_TRUE(received(Http2::FrameType::Settings, Http2::Flags::Ack));
+    EXPECT_EQ(streams[1].headers[":status"], "200");
+    EXPECT_EQ(streams[1].body, "path=/one");
+    EXPECT_EQ(streams[3].body, "path=/two");
+    EXPECT_EQ(streams[3].headers["content-type"], "text/plain");
+    EXPECT_EQ(streams[3].headers.count("connection"), 0u);
+}
+
+TEST_F(Http2ConnectionTest, RequestsCarryHttp1HeaderNamesAndBody) {
+    // GIVEN:
+    std::string seen;
+    start([&seen](HttpRequest& request) {
+        seen = std::string(request.method) + " " + std::string(request.version) + " host=" +
+               std::string(request.headers[std::pmr::string("Host")]) + " body=" + std::string(request.body);
+        return Responses::ok(request, "done");
+    });
+    handshake();
+
+    // WHEN:
+    sendRequest(1, "POST", "/submit", false);
+    sendFrame(Http2::FrameType::Data, 0, 1, "hello ");
+    sendFrame(Http2::FrameType::Data, Http2::Flags::EndStream, 1, "world");
+    readUntil([&] { return streams[1].ended; });
+
+    // THEN:
+    EXPECT_EQ(streams[1].body, "done");
+    EXPECT_EQ(seen, "POST HTTP/2 host=localhost body=hello world");
+}
+
+TEST_F(Http2ConnectionTest, LargeResponseDoesNotBlockSmallOne) {
+    // GIVEN: a body larger than the client's initial 64 KiB window.
+    const std::string large(200 * 1024, 'x');
+    start([&large](HttpRequest& request) {
+        return Responses::ok(request, request.path == "/large" ? std::string_view(large) : "small");
+    });
+    handshake();
+
+    // WHEN: both requests arrive together, so neither is served before the
+    // other has been seen.
+    std::string requests = requestFrame(1, "GET", "/large");
+    requests += requestFrame(3, "GET", "/small");
+    sendRaw(requests);
+    readUntil([&] {
+        return streams[3].ended && streams[1].body.size() + streams[3].body.size() >= Http2::kDefaultWindowSize;
+    });
+
+    // THEN: the small response finished while the large one waits for window.
+    EXPECT_EQ(streams[3].body, "small");
+    EXPECT_FALSE(streams[1].ended);
+    EXPECT_EQ(streams[1].body.size() + streams[3].body.size(), Http2::kDefaultWindowSize);
+
+    // WHEN: the client opens its windows.
+    sendWindowUpdate(0, 1 << 20);
+    sendWindowUpdate(1, 1 << 20);
+    readUntil([&] { return streams[1].ended; });
+
+    // THEN:
+    EXPECT_EQ(streams[1].body, large);
+    ASSERT_EQ(completionOrder.size(), 2u);
+    EXPECT_EQ(completionOrder[0], 3u);
+}
+
+TEST_F(Http2ConnectionTest, AsynchronousHandlersAnswerOutOfOrder) {
+    // GIVEN: a handler that answers /slow only when the test says so
+    std::mutex mtx;
+    std::vector<std::pair<Http2Connection::Respond, HttpResponse>> parked;
+    start([&](HttpRequest& request, Http2Connection::Respond respond) {
+        HttpResponse response = Responses::ok(request, request.path);
+        if (request.path != "/slow") {
+            respond(std::move(response));
+            return;
+        }
+        std::lock_guard<std::mutex> lock(mtx);
+        parked.emplace_back(std::move(respond), std::move(response));
+    });
+    handshake();
+
+    // WHEN:
+    std::string requests = requestFrame(1, "GET", "/slow");
+    requests += requestFrame(3, "GET", "/fast");
+    sendRaw(requests);
+    readUntil([&] { return streams[3].ended; });
+
+    // THEN: the later stream was not held up by the pending one
+    EXPECT_EQ(streams[3].body, "/fast");
+    EXPECT_FALSE(streams[1].ended);
+
+    // WHEN: the pending handler answers from another thread
+    std::thread([&]() {
+        std::lock_guard<std::mutex> lock(mtx);
+        ASSERT_EQ(parked.size(), 1u);
+        parked[0].first(std::move(parked[0].second));
+    }).join();
+    readUntil([&] { return streams[1].ended; });
+
+    // THEN:
+    EXPECT_EQ(streams[1].body, "/slow");
+    ASSERT_EQ(completionOrder.size(), 2u);
+    EXPECT_EQ(completionOrder[0], 3u);
+}
+
+TEST_F(Http2ConnectionTest, ResetWhileHandlingDropsTheLateResponse) {
+    // GIVEN: a request whose handler is still running
+    std::mutex mtx;
+    std::vector<std::pair<Http2Connection::Respond, HttpResponse>> parked;
+    start([&](HttpRequest& request, Http2Connection::Respond respond) {
+        HttpResponse response = Responses::ok(request, request.path);
+        if (request.path != "/slow") {
+            respond(std::move(response));
+            return;
+        }
+        std::lock_guard<std::mutex> lock(mtx);
+        parked.emplace_back(std::move(respond), std::move(response));
+    });
+    handshake();
+    sendRequest(1, "GET", "/slow");
+
+    // WHEN: the client resets it, the handler answers anyway, and another
+    // request follows
+    std::string code;
+    Http2::writeUint32(code, static_cast<uint32_t>(Http2::ErrorCode::Cancel));
+    sendFrame(Http2::FrameType::RstStream, 0, 1, code);
+    while (true) {
+        std::lock_guard<std::mutex> lock(mtx);
+        if (!parked.empty()) break;
+    }
+    std::thread([&]() {
+        std::lock_guard<std::mutex> lock(mtx);
+        parked[0].first(std::move(parked[0].second));
+    }).join();
+    sendRequest(3, "GET", "/next");
+    readUntil([&] { return streams[3].ended; });
+
+    // THEN: nothing was sent for the reset stream
+    EXPECT_EQ(streams[3].body, "/next");
+    EXPECT_EQ(streams.count(1), 0u);
+}
+
+TEST_F(Http2ConnectionTest, AnswersPing) {
+    // GIVEN:
+    start(echoPath);
+    handshake();
+
+    // WHEN:
+    sendFrame(Http2::FrameType::Ping, 0, 0, "12345678");
+    readUntil([&] { return received(Http2::FrameType::Ping, Http2::Flags::Ack); });
+
+    // THEN:
+    ASSERT_TRUE(received(Http2::FrameType::Ping, Http2::Flags::Ack));
+    EXPECT_EQ(frames.back().payload, "12345678");
+}
+
+TEST_F(Http2ConnectionTest, ProtocolErrorsEndWithGoAway) {
+    // GIVEN:
+    start(echoPath);
+    handshake();
+
+    // WHEN: streams initiated by a client must be odd.
+    sendRequest(2, "GET", "/");
+    readUntil([&] { return received(Http2::FrameType::GoAway); });
+
+    // THEN:
+    ASSERT_TRUE(received(Http2::FrameType::GoAway));
+    EXPECT_EQ(Http2::readUint32(frames.back().payload.data() + 4),
+              static_cast<uint32_t>(Http2::ErrorCode::ProtocolError));
+}
+
+TEST_F(Http2ConnectionTest, RejectsMissingPreface) {
+    // GIVEN:
+    start(echoPath);
+
+    // WHEN:
+    sendRaw("GET / HTTP/1.1\r\nHost: localhost\r\n\r\n");
+    readUntil([&] { return received(Http2::FrameType::GoAway); });
+
+    // THEN:
+    EXPECT_TRUE(received(Http2::FrameType::GoAway));
+    EXPECT_TRUE(streams[1].headers.empty());
+}
+
+TEST_F(Http2ConnectionTest, DrainFinishesOpenStreamsAndRefusesNewOnes) {
+    // GIVEN: a stream whose body is still on its way.
+    std::atomic<bool> draining{false};
+    start(echoPath, [&draining] { return draining.load(); });
+    handshake();
+    sendRequest(1, "POST", "/upload", false);
+    sendFrame(Http2::FrameType::Ping, 0, 0, "12345678");
+    readUntil([&] { return received(Http2::FrameType::Ping, Http2::Flags::Ack); });
+
+    // WHEN: a drain starts, and the connection wakes for another PING.
+    draining = true;
+    sendFrame(Http2::FrameType::Ping, 0, 0, "87654321");
+    readUntil([&] { return received(Http2::FrameType::GoAway); });
+    const Frame goAway = frames.back();
+    sendRequest(3, "GET", "/late");
+    sendFrame(Http2::FrameType::Data, Http2::Flags::EndStream, 1, "body");
+    readUntil([] { return false; });
+
+    // THEN: GOAWAY names stream 1 as the last one served, which completes,
+    // stream 3 is refused, and the connection then closes.
+    EXPECT_EQ(Http2::readUint32(goAway.payload.data()), 1u);
+    EXPECT_EQ(Http2::readUint32(goAway.payload.data() + 4), static_cast<uint32_t>(Http2::ErrorCode::NoError));
+    EXPECT_EQ(streams[1].body, "path=/upload");
+    auto reset = std::find_if(frames.begin(), frames.end(), [](const Frame& frame) {
+        return frame.header.type == Http2::FrameType::RstStream && frame.header.streamId == 3;
+    });
+    ASSERT_NE(reset, frames.end());
+    EXPECT_EQ(Http2::readUint32(reset->payload.data()), static_cast<uint32_t>(Http2::ErrorCode::RefusedStream));
+}
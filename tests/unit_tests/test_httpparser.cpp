@@ -3,6 +3,10 @@
 #include <httpserver/http_object.h>
 #include <httpserver/http_parser.h>
 
+#include <array>
+#include <cstddef>
+#include <memory_resource>
+
 using namespace HTTPServer;
 
 TEST(HttpParserTests, EmptyRequest) {
@@ -188,4 +192,64 @@ TEST(HttpParserTests, QueryStringUTF8Decoding) {
     EXPECT_EQ(err, ParseError::NONE);
     EXPECT_EQ(req.path, "/emoji");
     EXPECT_EQ(req.params["q"], "😀");
-}
\ No newline at end of file
+}
+
+TEST(HttpParserTests, ParsesEntirelyIntoRequestArena) {
+    const std::string raw =
+        "POST /submit?name=John+Doe&age=30 HTTP/1.1\r\n"
+        "Host: localhost\r\n"
+        "Content-Type: application/x-www-form-urlencoded\r\n"
+        "X-A-Rather-Long-Header-Name: with an equally long value that defeats SSO\r\n"
+        "\r\n"
+        "field=value";
+
+    // The arena has no upstream, so any allocation that escaped it would throw.
+    std::array<std::byte, 8192> buffer;
+    std::pmr::monotonic_buffer_resource arena(buffer.data(), buffer.size(), std::pmr::null_memory_resource());
+
+    HttpRequest req(&arena);
+    ParseError err = HttpParser::parse(raw, req);
+
+    EXPECT_EQ(err, ParseError::NONE);
+    EXPECT_EQ(req.get_allocator().resource(), &arena);
+    EXPECT_EQ(req.headers.get_allocator().resource(), &arena);
+    EXPECT_EQ(req.headers.find("Host")->second.get_allocator().resource(), &arena);
+    EXPECT_EQ(req.params.find("name")->second, "John Doe");
+    EXPECT_EQ(req.body, "field=value\n");
+}
+
+TEST(HttpParserTests, FrameWaitsForBlankLine) {
+    RequestFrame frame = HttpParser::frame("GET / HTTP/1.1\r\nHost: localhost\r\n");
+    EXPECT_FALSE(frame.headersComplete);
+}
+
+TEST(HttpParserTests, FrameIncludesContentLength) {
+    const std::string head = "POST /submit HTTP/1.1\r\n"
+                             "content-length: 11\r\n"
+                             "\r\n";
+
+    RequestFrame frame = HttpParser::frame(head + "hello");
+
+    EXPECT_TRUE(frame.headersComplete);
+    EXPECT_EQ(frame.headerBytes, head.size());
+    EXPECT_EQ(frame.contentLength, 11u);
+    EXPECT_EQ(frame.totalBytes(), head.size() + 11);
+}
+
+TEST(HttpParserTests, FrameStopsAtFirstPipelinedRequest) {
+    const std::string first = "GET /a HTTP/1.1\r\nHost: localhost\r\n\r\n";
+
+    RequestFrame frame = HttpParser::frame(first + "GET /b HTTP/1.1\r\n\r\n");
+
+    EXPECT_TRUE(frame.headersComplete);
+    EXPECT_EQ(frame.totalBytes(), first.size());
+}
+
+TEST(HttpParserTests, FrameRejectsNonHttpBytesImmediately) {
+    const std::string clientHello("\x16\x03\x01\x02\x00\x01", 6);
+
+    RequestFrame frame = HttpParser::frame(clientHello);
+
+    EXPECT_TRUE(frame.headersComplete);
+    EXPECT_EQ(frame.totalBytes(), clientHello.size());
+}
@@ -0,0 +1,72 @@
+#include <gtest/gtest.h>
+
+#include <httpserver/listener_handoff.h>
+#include <httpserver/unix_socket.h>
+
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cstdlib>
+#include <string>
+
+using namespace HTTPServer;
+
+namespace {
+
+int listenOnLoopback(int& port) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address));
+    listen(fd, 4);
+    socklen_t length = sizeof(address);
+    getsockname(fd, reinterpret_cast<sockaddr*>(&address), &length);
+    port = ntohs(address.sin_port);
+    return fd;
+}
+
+} // namespace
+
+// Inherited sockets are read from the environment once per process, so the
+// whole handoff is covered by a single test.
+TEST(ListenerHandoffTests, TakesSocketsByPortAndClosesTheRest) {
+    // GIVEN: three inherited listening sockets, one of them a Unix domain
+    // socket, and a descriptor that is not one.
+    int mainPort = 0, otherPort = 0;
+    const int mainFd = listenOnLoopback(mainPort);
+    const int otherFd = listenOnLoopback(otherPort);
+    const std::string unixPath = "@httpserver-handoff-" + std::to_string(getpid());
+    const int unixFd = UnixSocket::listen(unixPath, 0600);
+    const int notListening = socket(AF_INET, SOCK_STREAM, 0);
+    const std::string fds = std::to_string(mainFd) + "," + std::to_string(notListening) + "," +
+                            std::to_string(otherFd) + "," + std::to_string(unixFd);
+    setenv(ListenerHandoff::kFdsEnv, fds.c_str(), 1);
+    setenv(ListenerHandoff::kParentEnv, std::to_string(getpid()).c_str(), 1);
+
+    // WHEN:
+    const int taken = ListenerHandoff::take(Port(mainPort));
+    const int takenAgain = ListenerHandoff::take(Port(mainPort));
+    const int takenUnix = ListenerHandoff::take(unixPath);
+    ListenerHandoff::complete();
+
+    // THEN: the socket for the port is handed out once and is not inherited
+    // by anything this process execs.
+    EXPECT_EQ(taken, mainFd);
+    EXPECT_EQ(takenAgain, -1);
+    EXPECT_EQ(fcntl(taken, F_GETFD) & FD_CLOEXEC, FD_CLOEXEC);
+    EXPECT_EQ(takenUnix, unixFd);
+
+    // THEN: the socket nobody took is closed, the stranger left alone, and
+    // the environment cleared without signalling a process we did not
+    // start.
+    EXPECT_EQ(fcntl(otherFd, F_GETFD), -1);
+    EXPECT_NE(fcntl(notListening, F_GETFD), -1);
+    EXPECT_EQ(std::getenv(ListenerHandoff::kFdsEnv), nullptr);
+    EXPECT_EQ(std::getenv(ListenerHandoff::kParentEnv), nullptr);
+    close(taken);
+    close(takenUnix);
+    close(notListening);
+}
@@ -0,0 +1,90 @@
+#include <gtest/gtest.h>
+
+#include <httpserver/load_shedder.h>
+
+#include <atomic>
+#include <optional>
+#include <thread>
+#include <vector>
+
+using namespace HTTPServer;
+using namespace std::chrono_literals;
+
+TEST(LoadShedderTests, DisabledAlwaysAdmits) {
+    // GIVEN:
+    LoadShedder shedder;
+
+    // WHEN:
+    LoadShedder::Permit first = shedder.admit();
+    LoadShedder::Permit second = shedder.admit();
+
+    // THEN:
+    EXPECT_FALSE(shedder.enabled());
+    EXPECT_TRUE(first);
+    EXPECT_TRUE(second);
+    EXPECT_EQ(shedder.active(), 0u);
+}
+
+TEST(LoadShedderTests, WaiterTakesReleasedSlot) {
+    // GIVEN: a single handler slot that is taken.
+    LoadShedder shedder;
+    LoadSheddingOptions options;
+    options.maxConcurrentHandlers = 1;
+    shedder.configure(options);
+    std::optional<LoadShedder::Permit> holder(shedder.admit());
+    ASSERT_TRUE(*holder);
+
+    // WHEN: another request queues and the slot is then released.
+    std::atomic<bool> admitted{false};
+    std::thread waiter([&shedder, &admitted]() { admitted = static_cast<bool>(shedder.admit()); });
+    while (shedder.queued() == 0) std::this_thread::yield();
+    EXPECT_FALSE(admitted);
+    holder.reset();
+    waiter.join();
+
+    // THEN:
+    EXPECT_TRUE(admitted);
+    EXPECT_EQ(shedder.active(), 0u);
+    EXPECT_EQ(shedder.queued(), 0u);
+}
+
+TEST(LoadShedderTests, ShedsUnderSustainedOverloadAndRecovers) {
+    // GIVEN: one slot, a 1ms target and four clients each holding the slot
+    // for 5ms, so every queued request waits well beyond the target.
+    LoadShedder shedder;
+    LoadSheddingOptions options;
+    options.maxConcurrentHandlers = 1;
+    options.target = 1ms;
+    options.interval = 10ms;
+    shedder.configure(options);
+
+    // WHEN:
+    std::atomic<int> served{0}, shed{0};
+    std::atomic<bool> sawOverload{false};
+    const auto until = std::chrono::steady_clock::now() + 300ms;
+    std::vector<std::thread> clients;
+    for (int i = 0; i < 4; i++) {
+        clients.emplace_back([&]() {
+            while (std::chrono::steady_clock::now() < until) {
+                LoadShedder::Permit permit = shedder.admit();
+                if (shedder.overloaded()) sawOverload = true;
+                if (!permit) {
+                    shed++;
+                    continue;
+                }
+                served++;
+                std::this_thread::sleep_for(5ms);
+            }
+        });
+    }
+    for (auto& client : clients) client.join();
+
+    // THEN: the standing queue was detected and trimmed, not just served.
+    EXPECT_TRUE(sawOverload);
+    EXPECT_GT(shed.load(), 0);
+    EXPECT_GT(served.load(), 0);
+
+    // THEN: with the load gone a request is admitted straight away.
+    EXPECT_EQ(shedder.queued(), 0u);
+    EXPECT_TRUE(shedder.admit());
+}
@@ -0,0 +1,145 @@
+#include <gtest/gtest.h>
+
+#include <httpserver/http_object.h>
+#include <httpserver/metrics.h>
+#include <httpserver/router.h>
+#include <httpserver/http_response_builder.h>
+
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+using namespace HTTPServer;
+
+static uint64_t requestCount(const MetricsSnapshot& snap, const std::string& route, int status) {
+    auto it = snap.requests.find(std::make_tuple(std::string("GET"), route, status));
+    return it == snap.requests.end() ? 0 : it->second.latency.count;
+}
+
+TEST(HistogramTests, BucketsContainTheirValues) {
+    for (uint64_t value : {0ull, 1ull, 15ull, 16ull, 17ull, 1000ull, 123456ull, 987654321ull}) {
+        size_t index = HistogramBuckets::indexFor(value);
+        EXPECT_LE(HistogramBuckets::lowerBound(index), value);
+        EXPECT_GE(HistogramBuckets::upperBound(index), value);
+    }
+}
+
+TEST(HistogramTests, BucketsAreContiguous) {
+    for (size_t i = 1; i < HistogramBuckets::kBucketCount; i++) {
+        EXPECT_EQ(HistogramBuckets::upperBound(i - 1) + 1, HistogramBuckets::lowerBound(i));
+    }
+}
+
+TEST(HistogramTests, PercentilesWithinRelativeError) {
+    // GIVEN:
+    HistogramSnapshot histogram;
+
+    // WHEN:
+    for (uint64_t v = 1; v <= 10000; v++) {
+        histogram.record(v * 1000);
+    }
+
+    // THEN:
+    EXPECT_EQ(histogram.count, 10000u);
+    EXPECT_NEAR(static_cast<double>(histogram.percentile(50)), 5000000.0, 5000000.0 / 16);
+    EXPECT_NEAR(static_cast<double>(histogram.percentile(99)), 9900000.0, 9900000.0 / 16);
+    EXPECT_EQ(histogram.countAtOrBelow(HistogramBuckets::upperBound(HistogramBuckets::indexFor(10000000))), 10000u);
+}
+
+TEST(MetricsTests, RecordsFromExitedThreadsAreKept) {
+    // GIVEN:
+    const std::string route = "/metrics-test/threads";
+    uint64_t before = requestCount(Metrics::instance().snapshot(), route, 200);
+
+    // WHEN:
+    std::vector<std::thread> workers;
+    for (int t = 0; t < 4; t++) {
+        workers.emplace_back([&route]() {
+            for (int i = 0; i < 100; i++) {
+                Metrics::instance().recordRequest("GET", route, 200, 1000, 10);
+            }
+        });
+    }
+    for (auto& worker : workers) worker.join();
+
+    // THEN:
+    auto snap = Metrics::instance().snapshot();
+    EXPECT_EQ(requestCount(snap, route, 200) - before, 400u);
+}
+
+TEST(MetricsTests, DisabledMetricsRecordNothing) {
+    // GIVEN:
+    const std::string route = "/metrics-test/disabled";
+    Metrics::instance().setEnabled(false);
+
+    // WHEN:
+    Metrics::instance().recordRequest("GET", route, 200, 1000, 10);
+    Metrics::instance().setEnabled(true);
+
+    // THEN:
+    EXPECT_EQ(requestCount(Metrics::instance().snapshot(), route, 200), 0u);
+}
+
+TEST(MetricsTests, UnknownMethodsShareOneSeries) {
+    // GIVEN:
+    const std::string route = "/metrics-test/methods";
+    const size_t before = Metrics::instance().snapshot().requests.size();
+
+    // WHEN: a client invents a thousand methods.
+    for (int i = 0; i < 1000; i++) {
+        Metrics::instance().recordRequest("X" + std::to_string(i), route, 200, 1000, 10);
+    }
+    Metrics::instance().recordRequest("PATCH", route, 200, 1000, 10);
+
+    // THEN: they add one series between them, alongside the standard method.
+    auto snap = Metrics::instance().snapshot();
+    EXPECT_EQ(snap.requests.size() - before, 2u);
+    auto other = snap.requests.find(std::make_tuple(std::string(Metrics::kOtherMethod), route, 200));
+    ASSERT_NE(other, snap.requests.end());
+    EXPECT_EQ(other->second.latency.count, 1000u);
+    EXPECT_EQ(snap.requests.count(std::make_tuple(std::string("PATCH"), route, 200)), 1u);
+}
+
+TEST(MetricsTests, PrometheusOutputContainsSeries) {
+    // GIVEN:
+    Metrics::instance().recordRequest("GET", "/metrics-test/render", 404, 2000000, 42);
+
+    // WHEN:
+    std::string text = Metrics::instance().renderPrometheus();
+
+    // THEN:
+    const std::string labels = "method=\"GET\",route=\"/metrics-test/render\",status=\"404\"";
+    EXPECT_NE(text.find("# TYPE httpserver_request_duration_seconds histogram"), std::string::npos);
+    EXPECT_NE(text.find("httpserver_requests_total{" + labels + "} 1"), std::string::npos);
+    EXPECT_NE(text.find("httpserver_request_duration_seconds_bucket{" + labels + ",le=\"0.0025\"} 1"),
+              std::string::npos);
+    EXPECT_NE(text.find("httpserver_request_duration_seconds_bucket{" + labels + ",le=\"0.001\"} 0"),
+              std::string::npos);
+}
+
+TEST(MetricsTests, RouterRecordsMatchedPatternAndServesMetrics) {
+    // GIVEN:
+    Router::instance().addRoute("GET", "/metrics-test/item/{id}", [](const HttpRequest& req) {
+        return Responses::ok(req, "item", "text/plain");
+    });
+    Router::instance().addMetricsRoute("/metrics-test/metrics");
+
+    HttpRequest itemReq;
+    itemReq.method = "GET";
+    itemReq.path = "/metrics-test/item/7";
+    itemReq.version = "HTTP/1.1";
+
+    HttpRequest metricsReq = itemReq;
+    metricsReq.path = "/metrics-test/metrics";
+
+    // WHEN:
+    Router::instance().route(itemReq);
+    HttpResponse res = Router::instance().route(metricsReq);
+
+    // THEN:
+    EXPECT_EQ(itemReq.route, "/metrics-test/item/{id}");
+    EXPECT_EQ(res.code, StatusCode::OK);
+    EXPECT_EQ(res.headers["Content-Type"], "text/plain; version=0.0.4");
+    EXPECT_NE(res.body.find("httpserver_connections_total"), std::string::npos);
+}
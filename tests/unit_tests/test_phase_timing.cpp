@@ -0,0 +1,87 @@
+#include <gtest/gtest.h>
+
+#include <httpserver/metrics.h>
+#include <httpserver/phase_timing.h>
+
+#include <chrono>
+#include <string>
+#include <thread>
+
+using namespace HTTPServer;
+
+TEST(PhaseTimingTests, InactiveRecorderRecordsNothing) {
+    // GIVEN:
+    PhaseRecorder phases(false);
+
+    // WHEN:
+    phases.start();
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    phases.mark(Phase::Parse);
+
+    // THEN:
+    EXPECT_EQ(phases.nanoseconds(Phase::Parse), 0u);
+}
+
+TEST(PhaseTimingTests, MarkAttributesElapsedTimeToPhase) {
+    // GIVEN:
+    PhaseTiming::instance().enable(TimingClock::Monotonic);
+    PhaseRecorder phases(true);
+
+    // WHEN:
+    phases.start();
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    phases.mark(Phase::Handler);
+    phases.mark(Phase::Send);
+
+    // THEN:
+    EXPECT_GE(phases.nanoseconds(Phase::Handler), 2000000u);
+    EXPECT_LT(phases.nanoseconds(Phase::Send), phases.nanoseconds(Phase::Handler));
+    EXPECT_EQ(phases.nanoseconds(Phase::Parse), 0u);
+
+    PhaseTiming::instance().disable();
+}
+
+TEST(PhaseTimingTests, TscClockIsCalibrated) {
+    // GIVEN:
+    PhaseTiming::instance().enable(TimingClock::Tsc);
+    PhaseRecorder phases(true);
+
+    // WHEN:
+    phases.start();
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    phases.mark(Phase::Handler);
+
+    // THEN:
+    EXPECT_GT(PhaseTiming::instance().nanosecondsPerTick(PhaseTiming::instance().clock()), 0.0);
+    EXPECT_NEAR(static_cast<double>(phases.nanoseconds(Phase::Handler)), 5e6, 4e6);
+
+    PhaseTiming::instance().disable();
+}
+
+TEST(PhaseTimingTests, ServerTimingHeaderSkipsSendAndUnsetAccept) {
+    // GIVEN:
+    PhaseTiming::instance().enable(TimingClock::Monotonic);
+    PhaseRecorder phases(true);
+
+    // WHEN:
+    phases.set(Phase::Parse, 1500000);
+    std::string header = phases.serverTimingHeader();
+
+    // THEN:
+    EXPECT_EQ(header, "recv;dur=0.000, parse;dur=1.500, route;dur=0.000, handler;dur=0.000");
+
+    PhaseTiming::instance().disable();
+}
+
+TEST(PhaseTimingTests, PhaseHistogramsAreRendered) {
+    // GIVEN:
+    std::array<uint64_t, kPhaseCount> phases{};
+    phases[static_cast<size_t>(Phase::Recv)] = 1000;
+
+    // WHEN:
+    Metrics::instance().recordPhases(phases, false);
+    std::string text = Metrics::instance().renderPrometheus();
+
+    // THEN:
+    EXPECT_NE(text.find("httpserver_request_phase_seconds_count{phase=\"recv\"}"), std::string::npos);
+}
@@ -0,0 +1,78 @@
+#include <gtest/gtest.h>
+
+#include <httpserver/metrics.h>
+#include <httpserver/prefork.h>
+
+#include <string>
+#include <tuple>
+
+using namespace HTTPServer;
+using namespace std::chrono_literals;
+
+static uint64_t requestCount(const MetricsSnapshot& snap, const std::string& route) {
+    auto it = snap.requests.find(std::make_tuple(std::string("GET"), route, 200));
+    return it == snap.requests.end() ? 0 : it->second.latency.count;
+}
+
+TEST(MetricsSnapshotTests, EncodeRoundTrips) {
+    // GIVEN:
+    MetricsSnapshot snapshot;
+    snapshot.connectionsOpened = 7;
+    snapshot.http2Connections = 2;
+    snapshot.connectionTimeouts[1] = 3;
+    snapshot.phases[2].record(1500);
+    auto& series = snapshot.requests[{"GET", "/encoded/{id}", 200}];
+    series.latency.record(123456);
+    series.latency.record(99);
+    series.bytesSent = 4096;
+
+    // WHEN:
+    MetricsSnapshot decoded;
+    const bool ok = MetricsSnapshot::decode(snapshot.encode(), decoded);
+
+    // THEN:
+    ASSERT_TRUE(ok);
+    EXPECT_EQ(decoded.connectionsOpened, 7u);
+    EXPECT_EQ(decoded.http2Connections, 2u);
+    EXPECT_EQ(decoded.connectionTimeouts[1], 3u);
+    EXPECT_EQ(decoded.phases[2].buckets, snapshot.phases[2].buckets);
+    EXPECT_EQ(requestCount(decoded, "/encoded/{id}"), 2u);
+    EXPECT_EQ(decoded.requests.begin()->second.latency.buckets, series.latency.buckets);
+    EXPECT_EQ(decoded.requests.begin()->second.bytesSent, 4096u);
+}
+
+TEST(MetricsSnapshotTests, DecodeRejectsTruncatedInput) {
+    // GIVEN:
+    MetricsSnapshot snapshot;
+    snapshot.requests[{"GET", "/truncated", 200}].latency.record(1);
+    const std::string encoded = snapshot.encode();
+
+    // WHEN / THEN:
+    MetricsSnapshot decoded;
+    EXPECT_FALSE(MetricsSnapshot::decode(std::string_view(encoded).substr(0, encoded.size() - 1), decoded));
+}
+
+TEST(SharedMetricsTests, WorkerMetricsOutliveTheWorker) {
+    // GIVEN: this process publishing as worker 0 of two.
+    SharedMetrics shared;
+    ASSERT_TRUE(shared.create(2));
+    EXPECT_EQ(requestCount(shared.collect(1), "/shared-metrics"), 0u);
+    shared.attach(0, 10ms);
+    Metrics::instance().connectionOpened();
+    Metrics::instance().recordRequest("GET", "/shared-metrics", 200, 1000, 10);
+
+    // WHEN: it stops publishing and the supervisor retires its slot.
+    shared.detach();
+    const MetricsSnapshot published = shared.collect(1);
+    shared.retire(0);
+    const MetricsSnapshot retired = shared.collect(1);
+
+    // THEN: the slot is empty, and its metrics live on in the retired
+    // total with every connection closed.
+    EXPECT_EQ(requestCount(published, "/shared-metrics"), 1u);
+    EXPECT_GE(published.activeConnections(), 1u);
+    EXPECT_EQ(requestCount(retired, "/shared-metrics"), 1u);
+    EXPECT_EQ(retired.activeConnections(), 0u);
+    EXPECT_EQ(requestCount(shared.collect(2), "/shared-metrics"), 0u);
+    Metrics::instance().connectionClosed();
+}
@@ -0,0 +1,158 @@
+#include <gtest/gtest.h>
+
+#include <httpserver/rate_limiter.h>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace HTTPServer;
+using namespace std::chrono_literals;
+
+namespace {
+
+ClientAddress address(const std::string& ip) {
+    sockaddr_storage storage{};
+    if (ip.find(':') != std::string::npos) {
+        auto* in6 = reinterpret_cast<sockaddr_in6*>(&storage);
+        in6->sin6_family = AF_INET6;
+        inet_pton(AF_INET6, ip.c_str(), &in6->sin6_addr);
+    } else {
+        auto* in4 = reinterpret_cast<sockaddr_in*>(&storage);
+        in4->sin_family = AF_INET;
+        inet_pton(AF_INET, ip.c_str(), &in4->sin_addr);
+    }
+    return ClientAddress::fromSockaddr(storage);
+}
+
+RateLimits requestLimits(double perSecond, double burst, size_t maxClients = 1024) {
+    RateLimits limits;
+    limits.requests.perSecond = perSecond;
+    limits.requests.burst = burst;
+    limits.maxClients = maxClients;
+    return limits;
+}
+
+} // namespace
+
+TEST(RateLimiterTests, UnlimitedByDefault) {
+    // GIVEN:
+    RateLimiter limiter;
+
+    // WHEN / THEN:
+    EXPECT_FALSE(limiter.enabled());
+    for (int i = 0; i < 1000; i++) {
+        ASSERT_TRUE(limiter.allowConnection(address("10.0.0.1")));
+        ASSERT_TRUE(limiter.allowRequest(address("10.0.0.1")));
+    }
+}
+
+TEST(RateLimiterTests, BurstThenRefusedPerClient) {
+    // GIVEN: three requests of burst, refilled at one a second.
+    RateLimiter limiter;
+    limiter.configure(requestLimits(1, 3));
+
+    // WHEN / THEN:
+    for (int i = 0; i < 3; i++) EXPECT_TRUE(limiter.allowRequest(address("10.0.0.1")));
+    EXPECT_FALSE(limiter.allowRequest(address("10.0.0.1")));
+
+    // THEN: other clients, and connections, have buckets of their own.
+    EXPECT_TRUE(limiter.allowRequest(address("10.0.0.2")));
+    EXPECT_TRUE(limiter.allowConnection(address("10.0.0.1")));
+}
+
+TEST(RateLimiterTests, TokensRefillOverTime) {
+    // GIVEN: one request every 10ms.
+    RateLimiter limiter;
+    limiter.configure(requestLimits(100, 1));
+    ASSERT_TRUE(limiter.allowRequest(address("10.0.0.1")));
+    ASSERT_FALSE(limiter.allowRequest(address("10.0.0.1")));
+
+    // WHEN:
+    std::this_thread::sleep_for(20ms);
+
+    // THEN:
+    EXPECT_TRUE(limiter.allowRequest(address("10.0.0.1")));
+    EXPECT_FALSE(limiter.allowRequest(address("10.0.0.1")));
+}
+
+TEST(RateLimiterTests, IPv6ClientsShareTheirSlash64) {
+    // GIVEN:
+    RateLimiter limiter;
+    limiter.configure(requestLimits(1, 1));
+
+    // WHEN:
+    ASSERT_TRUE(limiter.allowRequest(address("2001:db8:1:2::1")));
+
+    // THEN:
+    EXPECT_FALSE(limiter.allowRequest(address("2001:db8:1:2::ffff")));
+    EXPECT_TRUE(limiter.allowRequest(address("2001:db8:1:3::1")));
+}
+
+TEST(RateLimiterTests, TableIsFixedAndForgetsQuietestClients) {
+    // GIVEN: room for 16 clients, one of them out of tokens.
+    RateLimiter limiter;
+    limiter.configure(requestLimits(0.001, 1, 16));
+    ASSERT_TRUE(limiter.allowRequest(address("10.0.0.1")));
+    ASSERT_FALSE(limiter.allowRequest(address("10.0.0.1")));
+
+    // WHEN: a flood of new clients passes through.
+    for (int i = 0; i < 1000; i++) {
+        limiter.allowRequest(address("192.168." + std::to_string(i / 256) + "." + std::to_string(i % 256)));
+    }
+
+    // THEN: the table did not grow, and the quiet client was evicted.
+    EXPECT_EQ(limiter.capacity(), 16u);
+    EXPECT_TRUE(limiter.allowRequest(address("10.0.0.1")));
+}
+
+TEST(RateLimiterTests, ConcurrentChecksNeverExceedBurst) {
+    // GIVEN: 100 tokens and next to no refill.
+    RateLimiter limiter;
+    limiter.configure(requestLimits(0.001, 100));
+    std::atomic<int> allowed{0};
+
+    // WHEN: eight threads race for the same client's bucket.
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 8; t++) {
+        threads.emplace_back([&]() {
+            for (int i = 0; i < 1000; i++) {
+                if (limiter.allowRequest(address("10.0.0.1"))) allowed++;
+            }
+        });
+    }
+    for (auto& thread : threads) thread.join();
+
+    // THEN:
+    EXPECT_EQ(allowed.load(), 100);
+}
+
+TEST(RateLimiterTests, RejectionIsPreSerialized429) {
+    // GIVEN:
+    RateLimiter limiter;
+    RateLimits limits;
+    limits.connections.perSecond = 1;
+    limits.retryAfter = 5s;
+    limiter.configure(limits);
+    int fds[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+
+    // WHEN:
+    limiter.reject(fds[0], true);
+    std::string received(512, '\0');
+    received.resize(std::max<ssize_t>(recv(fds[1], received.data(), received.size(), 0), 0));
+
+    // THEN:
+    EXPECT_EQ(received, std::string(limiter.rejection()));
+    EXPECT_EQ(received.find("HTTP/1.1 429 Too Many Requests\r\n"), 0u);
+    EXPECT_NE(received.find("Retry-After: 5\r\n"), std::string::npos);
+    char byte;
+    EXPECT_EQ(recv(fds[1], &byte, 1, 0), 0);
+    close(fds[1]);
+}
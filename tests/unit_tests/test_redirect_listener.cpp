@@ -0,0 +1,163 @@
+#include <gtest/gtest.h>
+
+#include <httpserver/redirect_listener.h>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <string>
+#include <thread>
+
+using namespace HTTPServer;
+using namespace std::chrono_literals;
+
+namespace {
+
+class RedirectListenerTest : public ::testing::Test {
+  protected:
+    void SetUp() override {
+        const int fd = socket(AF_INET, SOCK_STREAM, 0);
+        ASSERT_GE(fd, 0);
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        ASSERT_EQ(bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)), 0);
+        ASSERT_EQ(listen(fd, 16), 0);
+        socklen_t length = sizeof(address);
+        getsockname(fd, reinterpret_cast<sockaddr*>(&address), &length);
+        port = ntohs(address.sin_port);
+
+        server = std::thread([this, fd]() { listener.run(fd); });
+    }
+
+    void TearDown() override {
+        listener.stop();
+        server.join();
+    }
+
+    int connectClient() {
+        const int fd = socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        address.sin_port = htons(port);
+        EXPECT_EQ(connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)), 0);
+        return fd;
+    }
+
+    static void sendAll(int fd, std::string_view data) {
+        ASSERT_EQ(send(fd, data.data(), data.size(), 0), static_cast<ssize_t>(data.size()));
+    }
+
+    // Reads until 'count' complete responses (all of them carry a body ending
+    // in "...") have arrived, the peer closes or the timeout expires.
+    static std::string readResponses(int fd, size_t count, std::chrono::milliseconds timeout = 2000ms) {
+        std::string data;
+        char buffer[4096];
+        while (count > 0) {
+            pollfd pfd{fd, POLLIN, 0};
+            if (poll(&pfd, 1, static_cast<int>(timeout.count())) <= 0) break;
+            ssize_t bytes = recv(fd, buffer, sizeof(buffer), 0);
+            if (bytes <= 0) break;
+            data.append(buffer, bytes);
+            size_t complete = 0;
+            for (size_t pos = 0; (pos = data.find("...", pos)) != std::string::npos; pos += 3) complete++;
+            if (complete >= count) break;
+        }
+        return data;
+    }
+
+    static bool peerClosed(int fd, std::chrono::milliseconds timeout) {
+        pollfd pfd{fd, POLLIN, 0};
+        if (poll(&pfd, 1, static_cast<int>(timeout.count())) <= 0) return false;
+        char byte;
+        return recv(fd, &byte, 1, 0) == 0;
+    }
+
+    RedirectListener listener{Port(8443), 1500ms};
+    std::thread server;
+    uint16_t port = 0;
+};
+
+} // namespace
+
+TEST_F(RedirectListenerTest, RedirectsKeepAliveRequests) {
+    // GIVEN:
+    const int client = connectClient();
+
+    // WHEN: two pipelined requests on one connection.
+    sendAll(client, "GET /a?b=1 HTTP/1.1\r\nHost: example.com:80\r\n\r\n"
+                    "GET /second HTTP/1.1\r\nHost: example.com\r\n\r\n");
+    const std::string responses = readResponses(client, 2);
+
+    // THEN:
+    EXPECT_EQ(responses.find("HTTP/1.1 301 Moved Permanently\r\n"), 0u);
+    EXPECT_NE(responses.find("Location: https://example.com:8443/a?b=1\r\n"), std::string::npos);
+    EXPECT_NE(responses.find("Location: https://example.com:8443/second\r\n"), std::string::npos);
+    EXPECT_NE(responses.find("Connection: keep-alive\r\n"), std::string::npos);
+    EXPECT_NE(responses.find("Content-Length: 23\r\n"), std::string::npos);
+    EXPECT_FALSE(peerClosed(client, 100ms));
+    close(client);
+}
+
+TEST_F(RedirectListenerTest, IdleClientDoesNotDelayOthers) {
+    // GIVEN: a client that connects and sends only half a request.
+    const int idle = connectClient();
+    sendAll(idle, "GET / HTTP/1.1\r\n");
+
+    // WHEN:
+    const int active = connectClient();
+    const auto start = std::chrono::steady_clock::now();
+    sendAll(active, "GET /now HTTP/1.1\r\nHost: localhost\r\n\r\n");
+    const std::string response = readResponses(active, 1);
+
+    // THEN:
+    EXPECT_NE(response.find("Location: https://localhost:8443/now\r\n"), std::string::npos);
+    EXPECT_LT(std::chrono::steady_clock::now() - start, 500ms);
+    close(active);
+    close(idle);
+}
+
+TEST_F(RedirectListenerTest, ClosesWhenAsked) {
+    // GIVEN:
+    const int client = connectClient();
+
+    // WHEN:
+    sendAll(client, "GET / HTTP/1.1\r\nHost: localhost\r\nConnection: close\r\n\r\n");
+    const std::string response = readResponses(client, 1);
+
+    // THEN:
+    EXPECT_NE(response.find("Connection: close\r\n"), std::string::npos);
+    EXPECT_TRUE(peerClosed(client, 1000ms));
+    close(client);
+}
+
+TEST_F(RedirectListenerTest, RejectsUnsafeHost) {
+    // GIVEN:
+    const int client = connectClient();
+
+    // WHEN:
+    sendAll(client, "GET / HTTP/1.1\r\nHost: evil.com/x\"y\r\n\r\n");
+    std::string response(64, '\0');
+    pollfd pfd{client, POLLIN, 0};
+    ASSERT_GT(poll(&pfd, 1, 1000), 0);
+    response.resize(std::max<ssize_t>(recv(client, response.data(), response.size(), 0), 0));
+
+    // THEN:
+    EXPECT_EQ(response.find("HTTP/1.1 400 Bad Request"), 0u);
+    close(client);
+}
+
+TEST_F(RedirectListenerTest, ClosesIdleConnections) {
+    // GIVEN:
+    const int client = connectClient();
+    EXPECT_FALSE(peerClosed(client, 200ms));
+
+    // WHEN / THEN: idle timeout plus at most one sweep interval.
+    EXPECT_TRUE(peerClosed(client, 3000ms));
+    EXPECT_EQ(listener.connectionCount(), 0u);
+    close(client);
+}
@@ -0,0 +1,241 @@
+#include <gtest/gtest.h>
+
+#include <httpserver/reverse_proxy.h>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace HTTPServer;
+using namespace std::chrono_literals;
+
+namespace {
+
+// Stand-in upstream: answers every request with its own request head as the
+// body, chunked when the target mentions "chunked", and only after a delay
+// when it mentions "slow". Connections are kept alive.
+class Backend {
+  public:
+    Backend() {
+        d_fd = socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        bind(d_fd, reinterpret_cast<sockaddr*>(&address), sizeof(address));
+        listen(d_fd, 16);
+        socklen_t length = sizeof(address);
+        getsockname(d_fd, reinterpret_cast<sockaddr*>(&address), &length);
+        d_port = ntohs(address.sin_port);
+        d_thread = std::thread([this]() { acceptLoop(); });
+    }
+
+    ~Backend() {
+        d_stopping = true;
+        d_thread.join();
+        for (std::thread& connection : d_connections) connection.join();
+        close(d_fd);
+    }
+
+    std::string address() const { return "127.0.0.1:" + std::to_string(d_port); }
+    int accepted() const { return d_accepted; }
+    int requests() const { return d_requests; }
+
+  private:
+    void acceptLoop() {
+        while (!d_stopping) {
+            pollfd pfd{d_fd, POLLIN, 0};
+            if (poll(&pfd, 1, 20) <= 0) continue;
+            const int fd = accept(d_fd, nullptr, nullptr);
+            if (fd < 0) continue;
+            d_accepted++;
+            d_connections.emplace_back([this, fd]() { serve(fd); });
+        }
+    }
+
+    void serve(int fd) {
+        std::string in;
+        char buffer[4096];
+        while (!d_stopping) {
+            size_t headEnd;
+            while ((headEnd = in.find("\r\n\r\n")) == std::string::npos) {
+                pollfd pfd{fd, POLLIN, 0};
+                if (d_stopping) break;
+                if (poll(&pfd, 1, 20) <= 0) continue;
+                const ssize_t n = recv(fd, buffer, sizeof(buffer), 0);
+                if (n <= 0) {
+                    close(fd);
+                    return;
+                }
+                in.append(buffer, n);
+            }
+            if (headEnd == std::string::npos) break;
+            const std::string head = in.substr(0, headEnd);
+            in.erase(0, headEnd + 4);
+            d_requests++;
+
+            const std::string target = head.substr(0, head.find("\r\n"));
+            if (target.find("slow") != std::string::npos) std::this_thread::sleep_for(300ms);
+            std::string response;
+            if (target.find("chunked") != std::string::npos) {
+                const std::string half = head.substr(0, head.size() / 2);
+                const std::string rest = head.substr(head.size() / 2);
+                char size[16];
+                response = "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\nX-Backend: " + std::to_string(d_port) +
+                           "\r\n\r\n";
+                snprintf(size, sizeof(size), "%zx", half.size());
+                response += std::string(size) + "\r\n" + half + "\r\n";
+                snprintf(size, sizeof(size), "%zx", rest.size());
+                response += std::string(size) + "\r\n" + rest + "\r\n0\r\n\r\n";
+            } else {
+                response = "HTTP/1.1 200 OK\r\nContent-Length: " + std::to_string(head.size()) +
+                           "\r\nX-Backend: " + std::to_string(d_port) + "\r\nKeep-Alive: timeout=5\r\n\r\n" + head;
+            }
+            send(fd, response.data(), response.size(), MSG_NOSIGNAL);
+        }
+        close(fd);
+    }
+
+    int d_fd;
+    int d_port;
+    std::atomic<bool> d_stopping{false};
+    std::atomic<int> d_accepted{0};
+    std::atomic<int> d_requests{0};
+    std::thread d_thread;
+    std::vector<std::thread> d_connections;
+};
+
+// A port nothing listens on.
+std::string deadAddress() {
+    const int fd = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address));
+    socklen_t length = sizeof(address);
+    getsockname(fd, reinterpret_cast<sockaddr*>(&address), &length);
+    close(fd);
+    return "127.0.0.1:" + std::to_string(ntohs(address.sin_port));
+}
+
+HttpRequest request(const char* path, const char* query = "") {
+    HttpRequest req;
+    req.method = "GET";
+    req.path = path;
+    req.query = query;
+    req.version = "HTTP/1.1";
+    req.headers.emplace("Host", "example.test");
+    return req;
+}
+
+HttpResponse forward(ReverseProxy& proxy, const HttpRequest& req) {
+    std::promise<HttpResponse> result;
+    detach(proxy.forward(req), [&result](HttpResponse res) { result.set_value(std::move(res)); });
+    return result.get_future().get();
+}
+
+} // namespace
+
+TEST(ReverseProxyTests, ForwardsRequestsOverOnePooledConnection) {
+    // GIVEN: one upstream, and a request carrying a query and hop-by-hop
+    // headers
+    Backend backend;
+    ProxyOptions options;
+    options.upstreams = {backend.address()};
+    ReverseProxy proxy(options);
+    HttpRequest req = request("/api/items", "page=2&sort=name");
+    req.headers.emplace("Connection", "keep-alive, X-Hop");
+    req.headers.emplace("X-Hop", "1");
+    req.headers.emplace("X-End-To-End", "1");
+
+    // WHEN: it is sent three times, the last answered chunked
+    HttpResponse first = forward(proxy, req);
+    HttpResponse second = forward(proxy, req);
+    HttpResponse chunked = forward(proxy, request("/api/chunked"));
+
+    // THEN: the upstream saw the target and end-to-end headers only, over
+    // a single connection that is back in the pool
+    ASSERT_EQ(first.code, StatusCode::OK);
+    const std::string seen(first.body);
+    EXPECT_EQ(seen.rfind("GET /api/items?page=2&sort=name HTTP/1.1\r\n", 0), 0u);
+    EXPECT_NE(seen.find("Host: example.test\r\n"), std::string::npos);
+    EXPECT_NE(seen.find("X-End-To-End: 1\r\n"), std::string::npos);
+    EXPECT_EQ(seen.find("X-Hop"), std::string::npos);
+    EXPECT_EQ(first.headers.count("Keep-Alive"), 0u);
+    EXPECT_EQ(second.body, first.body);
+    ASSERT_EQ(chunked.code, StatusCode::OK);
+    EXPECT_EQ(std::string(chunked.body).rfind("GET /api/chunked HTTP/1.1\r\n", 0), 0u);
+    EXPECT_EQ(chunked.headers.count("Transfer-Encoding"), 0u);
+    EXPECT_EQ(backend.accepted(), 1);
+    EXPECT_EQ(backend.requests(), 3);
+    EXPECT_EQ(proxy.idleConnections(), 1u);
+}
+
+TEST(ReverseProxyTests, RoundRobinSpreadsRequestsAcrossUpstreams) {
+    // GIVEN:
+    Backend a;
+    Backend b;
+    ProxyOptions options;
+    options.upstreams = {a.address(), b.address()};
+    ReverseProxy proxy(options);
+
+    // WHEN:
+    for (int i = 0; i < 6; i++) {
+        ASSERT_EQ(forward(proxy, request("/")).code, StatusCode::OK);
+    }
+
+    // THEN:
+    EXPECT_EQ(a.requests(), 3);
+    EXPECT_EQ(b.requests(), 3);
+}
+
+TEST(ReverseProxyTests, UnreachableUpstreamsAreSkippedThenEjected) {
+    // GIVEN: a healthy upstream and one refusing connections, ejected after
+    // two failures
+    Backend healthy;
+    ProxyOptions options;
+    options.upstreams = {deadAddress(), healthy.address()};
+    options.balancing = LoadBalancing::LeastConnections;
+    options.maxFails = 2;
+    ReverseProxy proxy(options);
+
+    // WHEN:
+    for (int i = 0; i < 8; i++) {
+        ASSERT_EQ(forward(proxy, request("/")).code, StatusCode::OK);
+    }
+
+    // THEN: every request was answered by the healthy one
+    EXPECT_EQ(healthy.requests(), 8);
+    EXPECT_EQ(healthy.accepted(), 1);
+}
+
+TEST(ReverseProxyTests, UpstreamFailuresAnswerBadGatewayOrGatewayTimeout) {
+    // GIVEN: a proxy with nowhere to go, and one with a slow upstream
+    ProxyOptions deadOptions;
+    deadOptions.upstreams = {deadAddress()};
+    ReverseProxy dead(deadOptions);
+
+    Backend slow;
+    ProxyOptions slowOptions;
+    slowOptions.upstreams = {slow.address()};
+    slowOptions.ioTimeout = 100ms;
+    ReverseProxy impatient(slowOptions);
+
+    ProxyOptions invalidOptions;
+    invalidOptions.upstreams = {"no-port-here"};
+    ReverseProxy invalid(invalidOptions);
+
+    // WHEN / THEN:
+    EXPECT_EQ(forward(dead, request("/")).code, StatusCode::BadGateway);
+    EXPECT_EQ(forward(impatient, request("/slow")).code, StatusCode::GatewayTimeout);
+    EXPECT_EQ(invalid.upstreams(), 0u);
+    EXPECT_EQ(forward(invalid, request("/")).code, StatusCode::BadGateway);
+}
@@ -6,7 +6,10 @@
 #include <httpserver/http_object.h>
 #include <httpserver/http_response_builder.h>
 
+#include <array>
+#include <cstddef>
 #include <filesystem>
+#include <memory_resource>
 #include <fstream>
 
 using namespace HTTPServer;
@@ -200,6 +203,27 @@ TEST(RouterTests, WildcardRouteBasicMatch) {
     fs::remove_all(tempDir);
 }
 
+TEST(RouterTests, WildcardRouteDirectoryTargetIsNotFound) {
+    namespace fs = std::filesystem;
+
+    // GIVEN: a static route whose target resolves to a directory.
+    fs::path tempDir = fs::temp_directory_path() / "httpserver_static_dir_test";
+    fs::create_directories(tempDir / "nested");
+
+    Router::instance().addStaticDirectoryRoute("/dir/", tempDir.string() + "/");
+
+    HttpRequest req = makeReq("/dir/nested");
+
+    // WHEN:
+    HttpResponse res = Router::instance().route(req);
+
+    // THEN: it is not served as an empty 200.
+    EXPECT_EQ(res.code, StatusCode::NotFound);
+
+    // CLEANUP
+    fs::remove_all(tempDir);
+}
+
 TEST(RouterTests, WildcardRouteLongestPrefixWins) {
     namespace fs = std::filesystem;
 
@@ -229,7 +253,7 @@ TEST(RouterTests, WildcardRouteLongestPrefixWins) {
     HttpResponse res = Router::instance().route(req);
 
     // THEN:
-    EXPECT_EQ(res.body, expectedContent) << res.body;
+    EXPECT_EQ(std::string_view(res.body), expectedContent) << res.body;
 
     // CLEANUP:
     fs::remove_all(tmp);
@@ -330,4 +354,62 @@ TEST(RouterTests, NoRoutesForMethodReturnsNotFound) {
 
     // THEN:
     EXPECT_EQ(res.code, StatusCode::NotFound);
-}
\ No newline at end of file
+}
+
+TEST(RouterTests, ResponseSharesRequestArena) {
+    // GIVEN:
+    Router::instance().addRoute("GET", "/arena/{id}", [](const HttpRequest& req) {
+        return Responses::ok(req, "item " + std::string(req.params.at("id")));
+    });
+
+    std::array<std::byte, 8192> buffer;
+    std::pmr::monotonic_buffer_resource arena(buffer.data(), buffer.size(), std::pmr::null_memory_resource());
+    HttpRequest req(&arena);
+    req.method = "GET";
+    req.path = "/arena/42";
+    req.version = "HTTP/1.1";
+
+    // WHEN:
+    HttpResponse res = Router::instance().route(req);
+    auto payload = res.serialize();
+
+    // THEN:
+    EXPECT_EQ(res.code, StatusCode::OK);
+    EXPECT_EQ(res.body, "item 42");
+    EXPECT_EQ(res.get_allocator().resource(), &arena);
+    EXPECT_EQ(payload.get_allocator().resource(), &arena);
+    EXPECT_NE(payload.find("\r\n\r\nitem 42"), std::string::npos);
+}
+
+TEST(RouterTests, LargeStaticFileIsStreamedFromDescriptor) {
+    namespace fs = std::filesystem;
+
+    // GIVEN:
+    fs::path dir = fs::temp_directory_path() / "httpserver_test_large_static";
+    fs::create_directories(dir);
+    const std::string content(Responses::kMaxInlineFileSize + 1, 'z');
+    {
+        std::ofstream ofs(dir / "big.txt", std::ios::binary);
+        ofs << content;
+    }
+    Router::instance().addStaticDirectoryRoute("/large/", dir.string() + "/");
+
+    HttpRequest req = makeReq("/large/big.txt");
+
+    // WHEN:
+    HttpResponse res = Router::instance().route(req);
+
+    // THEN:
+    EXPECT_EQ(res.code, StatusCode::OK);
+    EXPECT_TRUE(res.body.empty());
+    ASSERT_NE(res.file, nullptr);
+    EXPECT_EQ(res.file->size(), content.size());
+    EXPECT_EQ(std::string_view(res.headers.at("Content-Length")), std::to_string(content.size()));
+
+    auto payload = res.serialize();
+    EXPECT_EQ(payload.size(), res.headSize() + content.size());
+    EXPECT_EQ(std::string_view(payload).substr(res.headSize()), content);
+
+    // CLEANUP:
+    fs::remove_all(dir);
+}
@@ -0,0 +1,89 @@
+#include <gtest/gtest.h>
+
+#include <httpserver/socket_options.h>
+
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace HTTPServer;
+using namespace std::chrono_literals;
+
+namespace {
+
+int intOption(int fd, int level, int name) {
+    int value = -1;
+    socklen_t length = sizeof(value);
+    EXPECT_EQ(getsockopt(fd, level, name, &value, &length), 0);
+    return value;
+}
+
+} // namespace
+
+TEST(SocketOptionsTests, ListeningSocketGetsEveryConfiguredOption) {
+    // GIVEN:
+    SocketOptions options;
+    options.deferAccept = 5s;
+    options.fastOpenQueue = 64;
+    options.sendBuffer = 32 * 1024;
+    options.receiveBuffer = 48 * 1024;
+    const int fd = socket(AF_INET, SOCK_STREAM, 0);
+
+    // WHEN:
+    configureListeningSocket(fd, options, true);
+
+    // THEN: the kernel doubles buffer sizes for its own bookkeeping
+    EXPECT_EQ(intOption(fd, IPPROTO_TCP, TCP_NODELAY), 1);
+    EXPECT_GE(intOption(fd, IPPROTO_TCP, TCP_DEFER_ACCEPT), 5);
+    EXPECT_EQ(intOption(fd, IPPROTO_TCP, TCP_FASTOPEN), 64);
+    EXPECT_EQ(intOption(fd, SOL_SOCKET, SO_SNDBUF), 2 * options.sendBuffer);
+    EXPECT_EQ(intOption(fd, SOL_SOCKET, SO_RCVBUF), 2 * options.receiveBuffer);
+    close(fd);
+}
+
+TEST(SocketOptionsTests, DefaultsLeaveKernelSettingsAlone) {
+    // GIVEN:
+    SocketOptions options;
+    options.noDelay = false;
+    const int fd = socket(AF_INET, SOCK_STREAM, 0);
+    const int sendBuffer = intOption(fd, SOL_SOCKET, SO_SNDBUF);
+
+    // WHEN:
+    configureListeningSocket(fd, options, true);
+
+    // THEN:
+    EXPECT_EQ(intOption(fd, IPPROTO_TCP, TCP_NODELAY), 0);
+    EXPECT_EQ(intOption(fd, IPPROTO_TCP, TCP_DEFER_ACCEPT), 0);
+    EXPECT_EQ(intOption(fd, SOL_SOCKET, SO_SNDBUF), sendBuffer);
+    close(fd);
+}
+
+TEST(SocketOptionsTests, AcceptedConnectionsGetNoDelayAndBuffers) {
+    // GIVEN: a connection accepted on a listener without the options
+    const int listener = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    ASSERT_EQ(bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)), 0);
+    ASSERT_EQ(listen(listener, 1), 0);
+    socklen_t length = sizeof(address);
+    getsockname(listener, reinterpret_cast<sockaddr*>(&address), &length);
+    const int client = socket(AF_INET, SOCK_STREAM, 0);
+    ASSERT_EQ(connect(client, reinterpret_cast<sockaddr*>(&address), sizeof(address)), 0);
+    const int accepted = accept(listener, nullptr, nullptr);
+    ASSERT_GE(accepted, 0);
+    ASSERT_EQ(intOption(accepted, IPPROTO_TCP, TCP_NODELAY), 0);
+
+    // WHEN:
+    SocketOptions options;
+    options.sendBuffer = 64 * 1024;
+    configureAcceptedSocket(accepted, options, true);
+
+    // THEN:
+    EXPECT_EQ(intOption(accepted, IPPROTO_TCP, TCP_NODELAY), 1);
+    EXPECT_EQ(intOption(accepted, SOL_SOCKET, SO_SNDBUF), 2 * options.sendBuffer);
+    close(accepted);
+    close(client);
+    close(listener);
+}
@@ -0,0 +1,180 @@
+#include <gtest/gtest.h>
+
+#include <httpserver/http_response_builder.h>
+#include <httpserver/io_scheduler.h>
+#include <httpserver/router.h>
+#include <httpserver/task.h>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+using namespace HTTPServer;
+using namespace std::chrono_literals;
+
+namespace {
+
+Task<int> answer() { co_return 42; }
+
+Task<int> doubled() { co_return 2 * co_await answer(); }
+
+Task<int> failing() {
+    throw std::runtime_error("boom");
+    co_return 0;
+}
+
+Task<std::string> recovered() {
+    try {
+        co_await failing();
+    } catch (const std::runtime_error& e) {
+        co_return std::string("caught ") + e.what();
+    }
+    co_return "not thrown";
+}
+
+// Runs 'task' to completion from the test thread, however it suspends.
+template <typename T>
+T wait(Task<T> task) {
+    std::promise<T> result;
+    detach(std::move(task), [&result](T value) { result.set_value(std::move(value)); });
+    return result.get_future().get();
+}
+
+} // namespace
+
+TEST(TaskTests, AwaitedTasksRunInlineUntilTheyCompleteWithoutSuspending) {
+    // GIVEN: a task awaiting another that never suspends
+    std::optional<int> result;
+
+    // WHEN:
+    detach(doubled(), [&result](int value) { result = value; });
+
+    // THEN: the result is delivered before detach returns
+    ASSERT_TRUE(result.has_value());
+    EXPECT_EQ(*result, 84);
+}
+
+TEST(TaskTests, ExceptionsPropagateToTheAwaiter) {
+    // GIVEN / WHEN:
+    std::string result = wait(recovered());
+
+    // THEN:
+    EXPECT_EQ(result, "caught boom");
+}
+
+TEST(IoSchedulerTests, SleepResumesOnTheSchedulerThreadAfterTheDuration) {
+    // GIVEN:
+    auto sleeper = []() -> Task<std::thread::id> {
+        co_await IoScheduler::instance().sleepFor(50ms);
+        co_return std::this_thread::get_id();
+    };
+    const auto start = std::chrono::steady_clock::now();
+
+    // WHEN:
+    const std::thread::id resumedOn = wait(sleeper());
+
+    // THEN:
+    EXPECT_GE(std::chrono::steady_clock::now() - start, 50ms);
+    EXPECT_NE(resumedOn, std::this_thread::get_id());
+}
+
+TEST(IoSchedulerTests, ReadableTimesOutThenSeesData) {
+    // GIVEN: a socket with nothing to read yet
+    int fds[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds), 0);
+    auto reader = [](int fd) -> Task<std::string> {
+        std::string seen;
+        seen += co_await IoScheduler::instance().readable(fd, 30ms) ? "ready," : "timeout,";
+        seen += co_await IoScheduler::instance().readable(fd, 5s) ? "ready" : "timeout";
+        co_return seen;
+    };
+
+    // WHEN: data only arrives after the first wait has timed out
+    std::thread writer([fd = fds[1]]() {
+        std::this_thread::sleep_for(100ms);
+        ASSERT_EQ(write(fd, "x", 1), 1);
+    });
+    const std::string seen = wait(reader(fds[0]));
+    writer.join();
+
+    // THEN:
+    EXPECT_EQ(seen, "timeout,ready");
+    close(fds[0]);
+    close(fds[1]);
+}
+
+TEST(IoSchedulerTests, ReadFileReturnsContentsOrNothing) {
+    // GIVEN:
+    const std::filesystem::path path = std::filesystem::temp_directory_path() / "io_scheduler_test.txt";
+    std::ofstream(path) << "file contents";
+    auto reader = [](std::string file) -> Task<std::optional<std::string>> {
+        co_return co_await IoScheduler::instance().readFile(std::move(file));
+    };
+
+    // WHEN:
+    const std::optional<std::string> contents = wait(reader(path.string()));
+    const std::optional<std::string> missing = wait(reader(path.string() + ".missing"));
+
+    // THEN:
+    ASSERT_TRUE(contents.has_value());
+    EXPECT_EQ(*contents, "file contents");
+    EXPECT_FALSE(missing.has_value());
+    std::filesystem::remove(path);
+}
+
+TEST(IoSchedulerTests, ThousandsOfWaitersShareOneThread) {
+    // GIVEN: many more concurrent sleepers than there are threads
+    constexpr int kWaiters = 5000;
+    std::atomic<int> finished{0};
+    std::promise<void> allDone;
+    auto sleeper = []() -> Task<void> { co_await IoScheduler::instance().sleepFor(200ms); };
+    const auto start = std::chrono::steady_clock::now();
+
+    // WHEN:
+    for (int i = 0; i < kWaiters; i++) {
+        detach(sleeper(), [&]() {
+            if (++finished == kWaiters) allDone.set_value();
+        });
+    }
+
+    // THEN: they all wait at once, rather than one after the other
+    ASSERT_EQ(allDone.get_future().wait_for(5s), std::future_status::ready);
+    EXPECT_LT(std::chrono::steady_clock::now() - start, 2s);
+    EXPECT_EQ(IoScheduler::instance().pending(), 0u);
+}
+
+TEST(IoSchedulerTests, AsyncRoutesAnswerThroughTheRouter) {
+    // GIVEN: an asynchronous route and one that throws
+    Router::instance().addRoute("GET", "/async-test", [](const HttpRequest& req) -> Task<HttpResponse> {
+        co_await IoScheduler::instance().sleepFor(10ms);
+        co_return Responses::ok(req, "awaited");
+    });
+    Router::instance().addRoute("GET", "/async-throws", [](const HttpRequest&) -> Task<HttpResponse> {
+        co_await IoScheduler::instance().sleepFor(10ms);
+        throw std::runtime_error("handler failed");
+    });
+    HttpRequest ok;
+    ok.method = "GET";
+    ok.path = "/async-test";
+    HttpRequest throws;
+    throws.method = "GET";
+    throws.path = "/async-throws";
+
+    // WHEN:
+    HttpResponse okResponse = Router::instance().route(ok);
+    HttpResponse failedResponse = Router::instance().route(throws);
+
+    // THEN:
+    EXPECT_EQ(okResponse.code, StatusCode::OK);
+    EXPECT_EQ(okResponse.body, "awaited");
+    EXPECT_EQ(failedResponse.code, StatusCode::InternalServerError);
+}
@@ -0,0 +1,226 @@
+#include <gtest/gtest.h>
+
+#include <httpserver/timer_wheel.h>
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+using namespace HTTPServer;
+using namespace std::chrono_literals;
+
+namespace {
+
+struct TestTimer : TimerWheel::Timer {
+    int id = 0;
+};
+
+class TimerWheelTest : public ::testing::Test {
+  protected:
+    // Advances to 'offset' after the wheel's origin and returns the ids fired.
+    std::vector<int> advanceTo(std::chrono::milliseconds offset) {
+        std::vector<int> fired;
+        wheel.advance(origin + offset,
+                      [&fired](TimerWheel::Timer& timer) { fired.push_back(static_cast<TestTimer&>(timer).id); });
+        return fired;
+    }
+
+    const TimerWheel::Clock::time_point origin = TimerWheel::Clock::now();
+    TimerWheel wheel{10ms, origin};
+};
+
+} // namespace
+
+TEST_F(TimerWheelTest, FiresAtTheFirstTickAfterTheDeadline) {
+    // GIVEN:
+    TestTimer timer;
+    timer.id = 1;
+    wheel.schedule(timer, origin + 25ms);
+
+    // WHEN / THEN: 25ms rounds up to the tick at 30ms.
+    EXPECT_TRUE(advanceTo(29ms).empty());
+    EXPECT_TRUE(timer.scheduled());
+    EXPECT_EQ(advanceTo(30ms), std::vector<int>{1});
+    EXPECT_FALSE(timer.scheduled());
+    EXPECT_TRUE(wheel.empty());
+}
+
+TEST_F(TimerWheelTest, FiresEveryTimerInDeadlineOrder) {
+    // GIVEN: deadlines on every level of the wheel, in scrambled order.
+    const std::vector<std::chrono::milliseconds> deadlines = {
+        50ms, 700ms, 5s, 41s, 3min, 70min, 10ms, 640ms, 650ms,
+    };
+    std::vector<std::unique_ptr<TestTimer>> timers;
+    for (size_t i = 0; i < deadlines.size(); i++) {
+        timers.push_back(std::make_unique<TestTimer>());
+        timers.back()->id = static_cast<int>(deadlines[i].count());
+        wheel.schedule(*timers.back(), origin + deadlines[i]);
+    }
+    ASSERT_EQ(wheel.size(), deadlines.size());
+
+    // WHEN:
+    std::vector<int> fired;
+    for (auto now = 0ms; now <= 71min; now += 10ms) {
+        for (int id : advanceTo(now)) {
+            EXPECT_EQ(std::chrono::milliseconds(id), now);
+            fired.push_back(id);
+        }
+    }
+
+    // THEN:
+    EXPECT_EQ(fired, (std::vector<int>{10, 50, 640, 650, 700, 5000, 41000, 180000, 4200000}));
+    EXPECT_TRUE(wheel.empty());
+}
+
+TEST_F(TimerWheelTest, RescheduleAndCancel) {
+    // GIVEN:
+    TestTimer moved, cancelled;
+    moved.id = 1;
+    cancelled.id = 2;
+    wheel.schedule(moved, origin + 100ms);
+    wheel.schedule(cancelled, origin + 100ms);
+
+    // WHEN:
+    wheel.schedule(moved, origin + 2s);
+    wheel.cancel(cancelled);
+
+    // THEN:
+    EXPECT_EQ(wheel.size(), 1u);
+    EXPECT_TRUE(advanceTo(1990ms).empty());
+    EXPECT_EQ(advanceTo(2s), std::vector<int>{1});
+}
+
+TEST_F(TimerWheelTest, PastDeadlinesFireOnNextAdvance) {
+    // GIVEN:
+    advanceTo(1s);
+    TestTimer timer;
+    timer.id = 7;
+
+    // WHEN:
+    wheel.schedule(timer, origin + 100ms);
+
+    // THEN:
+    EXPECT_EQ(advanceTo(1010ms), std::vector<int>{7});
+}
+
+TEST_F(TimerWheelTest, CallbackMayReschedule) {
+    // GIVEN:
+    TestTimer timer;
+    timer.id = 3;
+    wheel.schedule(timer, origin + 10ms);
+    int fired = 0;
+
+    // WHEN: a periodic timer re-arms itself every time it fires.
+    for (auto now = 10ms; now <= 100ms; now += 10ms) {
+        wheel.advance(origin + now, [&](TimerWheel::Timer& t) {
+            fired++;
+            wheel.schedule(t, origin + now + 20ms);
+        });
+    }
+
+    // THEN:
+    EXPECT_EQ(fired, 5);
+    EXPECT_TRUE(timer.scheduled());
+    wheel.cancel(timer);
+}
+
+TEST_F(TimerWheelTest, DeadlinesBeyondTheWheelSpanStillFire) {
+    // GIVEN: 64^4 ticks of 10ms is a little under two days.
+    TestTimer timer;
+    timer.id = 9;
+    const auto deadline = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::hours(24 * 5));
+    wheel.schedule(timer, origin + deadline);
+
+    // WHEN:
+    std::vector<int> early = advanceTo(deadline - 10ms);
+
+    // THEN:
+    EXPECT_TRUE(early.empty());
+    EXPECT_EQ(advanceTo(deadline), std::vector<int>{9});
+}
+
+TEST(ConnectionDeadlineTest, ExpiredDeadlineShutsTheSocketDown) {
+    // GIVEN:
+    int fds[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+    DeadlineReaper reaper(10ms);
+    reaper.start();
+    ConnectionDeadline deadline(reaper, fds[0]);
+
+    // WHEN: a blocking read with nothing to read.
+    deadline.arm(TimeoutKind::Header, 50ms);
+    char byte;
+    const auto start = std::chrono::steady_clock::now();
+    const ssize_t bytes = recv(fds[0], &byte, 1, 0);
+
+    // THEN: the reaper woke it by shutting the socket down.
+    EXPECT_EQ(bytes, 0);
+    EXPECT_GE(std::chrono::steady_clock::now() - start, 50ms);
+    EXPECT_TRUE(deadline.expired());
+    EXPECT_EQ(deadline.expiredKind(), TimeoutKind::Header);
+    EXPECT_EQ(reaper.pending(), 0u);
+
+    reaper.stop();
+    close(fds[0]);
+    close(fds[1]);
+}
+
+TEST(ConnectionDeadlineTest, RearmingAndDisarmingKeepTheSocketOpen) {
+    // GIVEN:
+    int fds[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+    DeadlineReaper reaper(10ms);
+    reaper.start();
+    ConnectionDeadline deadline(reaper, fds[0]);
+
+    // WHEN: each phase replaces the previous deadline before it expires.
+    deadline.arm(TimeoutKind::Idle, 60ms);
+    std::this_thread::sleep_for(30ms);
+    deadline.arm(TimeoutKind::Header, 60ms);
+    std::this_thread::sleep_for(30ms);
+    deadline.extend();
+    std::this_thread::sleep_for(30ms);
+    deadline.disarm();
+    std::this_thread::sleep_for(100ms);
+
+    // THEN:
+    EXPECT_FALSE(deadline.expired());
+    EXPECT_EQ(reaper.pending(), 0u);
+    pollfd pfd{fds[0], POLLIN, 0};
+    EXPECT_EQ(poll(&pfd, 1, 0), 0);
+
+    reaper.stop();
+    close(fds[0]);
+    close(fds[1]);
+}
+
+TEST(ConnectionDeadlineTest, ExpireAllClosesArmedAndLaterDeadlines) {
+    // GIVEN: one connection with a distant deadline armed.
+    int first[2], second[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, first), 0);
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, second), 0);
+    DeadlineReaper reaper(10ms);
+    reaper.start();
+    ConnectionDeadline armed(reaper, first[0]);
+    ConnectionDeadline later(reaper, second[0]);
+    armed.arm(TimeoutKind::Header, 10s);
+
+    // WHEN: everything is expired, and the other connection arms afterwards.
+    EXPECT_EQ(reaper.expireAll(), 1u);
+    later.arm(TimeoutKind::Write, 10s);
+
+    // THEN: both sockets were shut down at once.
+    char byte;
+    EXPECT_TRUE(armed.expired());
+    EXPECT_TRUE(later.expired());
+    EXPECT_EQ(recv(first[0], &byte, 1, 0), 0);
+    EXPECT_EQ(recv(second[0], &byte, 1, 0), 0);
+    EXPECT_EQ(reaper.pending(), 0u);
+
+    reaper.stop();
+    for (int fd : {first[0], first[1], second[0], second[1]}) close(fd);
+}
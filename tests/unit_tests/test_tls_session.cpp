@@ -0,0 +1,69 @@
+#include <gtest/gtest.h>
+
+#include <httpserver/tls_session.h>
+
+#include <chrono>
+
+using namespace HTTPServer;
+using namespace std::chrono_literals;
+
+TEST(TicketKeyRingTests, RetiredKeysKeptForSessionLifetime) {
+    // GIVEN:
+    TicketKeyRing ring(3600s, 300s);
+    EXPECT_EQ(ring.keyCount(), 1u);
+
+    // WHEN:
+    ring.rotate();
+    ring.rotate();
+
+    // THEN:
+    EXPECT_EQ(ring.keyCount(), 3u);
+}
+
+TEST(TicketKeyRingTests, ExpiredKeysAreDropped) {
+    // GIVEN:
+    TicketKeyRing ring(3600s, 0s);
+
+    // WHEN:
+    ring.rotate();
+    ring.rotate();
+
+    // THEN:
+    EXPECT_EQ(ring.keyCount(), 1u);
+}
+
+TEST(TicketKeyRingTests, InstallsOnContext) {
+    // GIVEN:
+    SSL_CTX* ctx = SSL_CTX_new(TLS_server_method());
+    ASSERT_NE(ctx, nullptr);
+    TicketKeyRing ring(3600s, 300s);
+
+    // WHEN:
+    TlsSessionOptions options;
+    configureTlsSessions(ctx, options, &ring);
+
+    // THEN:
+    EXPECT_EQ(SSL_CTX_get_options(ctx) & SSL_OP_NO_TICKET, 0u);
+    EXPECT_EQ(SSL_CTX_get_session_cache_mode(ctx), SSL_SESS_CACHE_SERVER);
+    EXPECT_EQ(SSL_CTX_get_timeout(ctx), 300);
+
+    SSL_CTX_free(ctx);
+}
+
+TEST(TicketKeyRingTests, TicketsDisabledWithoutRing) {
+    // GIVEN:
+    SSL_CTX* ctx = SSL_CTX_new(TLS_server_method());
+    ASSERT_NE(ctx, nullptr);
+
+    // WHEN:
+    TlsSessionOptions options;
+    options.sessionTickets = false;
+    options.sessionCache = false;
+    configureTlsSessions(ctx, options, nullptr);
+
+    // THEN:
+    EXPECT_NE(SSL_CTX_get_options(ctx) & SSL_OP_NO_TICKET, 0u);
+    EXPECT_EQ(SSL_CTX_get_session_cache_mode(ctx), SSL_SESS_CACHE_OFF);
+
+    SSL_CTX_free(ctx);
+}
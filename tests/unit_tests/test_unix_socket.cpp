@@ -0,0 +1,81 @@
+#include <gtest/gtest.h>
+
+#include <httpserver/client_address.h>
+#include <httpserver/unix_socket.h>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstdlib>
+#include <string>
+
+using namespace HTTPServer;
+
+namespace {
+
+std::string tempSocketPath() {
+    return "/tmp/httpserver-test-" + std::to_string(getpid()) + "-" + std::to_string(std::rand()) + ".sock";
+}
+
+} // namespace
+
+TEST(UnixSocketTests, AddressesRoundTripThroughBoundPath) {
+    for (const std::string& path : {tempSocketPath(), "@httpserver-test-" + std::to_string(getpid())}) {
+        // GIVEN:
+        const int fd = UnixSocket::listen(path, 0600);
+        ASSERT_GE(fd, 0) << path;
+
+        // WHEN:
+        const std::string bound = UnixSocket::boundPath(fd);
+
+        // THEN:
+        EXPECT_EQ(bound, path);
+        close(fd);
+        if (path.front() != UnixSocket::kAbstractPrefix) unlink(path.c_str());
+    }
+}
+
+TEST(UnixSocketTests, RejectsPathsThatDoNotFit) {
+    sockaddr_un address;
+    socklen_t length;
+    EXPECT_FALSE(UnixSocket::makeAddress("", address, length));
+    EXPECT_FALSE(UnixSocket::makeAddress("@", address, length));
+    EXPECT_FALSE(UnixSocket::makeAddress(std::string(sizeof(address.sun_path), 'x'), address, length));
+    // Abstract names are not NUL terminated, so one more byte fits.
+    EXPECT_TRUE(UnixSocket::makeAddress("@" + std::string(sizeof(address.sun_path) - 1, 'x'), address, length));
+}
+
+TEST(UnixSocketTests, ReplacesStaleSocketFileButNotLiveOne) {
+    // GIVEN: a socket file left behind by a listener that has gone
+    const std::string path = tempSocketPath();
+    close(UnixSocket::listen(path, 0600));
+    ASSERT_EQ(access(path.c_str(), F_OK), 0);
+
+    // WHEN:
+    const int fd = UnixSocket::listen(path, 0640);
+
+    // THEN: it is replaced, with the requested permissions
+    ASSERT_GE(fd, 0);
+    struct stat info{};
+    ASSERT_EQ(stat(path.c_str(), &info), 0);
+    EXPECT_EQ(info.st_mode & 0777, 0640u);
+
+    // THEN: while it is listened on, nobody else may take it
+    EXPECT_EQ(UnixSocket::listen(path, 0600), -1);
+    close(fd);
+    unlink(path.c_str());
+}
+
+TEST(UnixSocketTests, PeersHaveNoAddress) {
+    // GIVEN:
+    sockaddr_storage storage{};
+    storage.ss_family = AF_UNIX;
+
+    // WHEN:
+    const ClientAddress client = ClientAddress::fromSockaddr(storage);
+
+    // THEN:
+    EXPECT_TRUE(client.unixSocket);
+    EXPECT_FALSE(client.isIPv4());
+    EXPECT_EQ(client.toString(), "unix");
+}
@@ -0,0 +1,285 @@
+#include <gtest/gtest.h>
+
+#include <httpserver/websocket.h>
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace HTTPServer;
+using namespace std::chrono_literals;
+using WebSocket::CloseCode;
+using WebSocket::Opcode;
+
+namespace {
+
+constexpr unsigned char kMask[4] = {0x37, 0xfa, 0x21, 0x3d};
+
+// A frame as a client sends it, masked.
+std::string clientFrame(Opcode opcode, std::string_view payload, bool fin = true) {
+    std::string frame;
+    WebSocket::writeFrame(frame, opcode, payload, fin);
+    const size_t headerSize = frame.size() - payload.size();
+    frame[1] = static_cast<char>(frame[1] | 0x80);
+    frame.insert(headerSize, reinterpret_cast<const char*>(kMask), 4);
+    for (size_t i = 0; i < payload.size(); i++) frame[headerSize + 4 + i] ^= kMask[i % 4];
+    return frame;
+}
+
+struct Frame {
+    Opcode opcode;
+    std::string payload;
+};
+
+// Reads one server frame from 'fd', or nothing within the timeout.
+std::optional<Frame> readFrame(int fd, std::string& buffer, std::chrono::milliseconds timeout = 2s) {
+    while (true) {
+        WebSocket::FrameHeader header;
+        if (WebSocket::readFrameHeader(buffer, header) && buffer.size() - header.size >= header.length) {
+            Frame frame{header.opcode, buffer.substr(header.size, header.length)};
+            buffer.erase(0, header.size + header.length);
+            return frame;
+        }
+        pollfd pfd{fd, POLLIN, 0};
+        if (poll(&pfd, 1, static_cast<int>(timeout.count())) <= 0) return std::nullopt;
+        char chunk[4096];
+        const ssize_t n = recv(fd, chunk, sizeof(chunk), 0);
+        if (n <= 0) return std::nullopt;
+        buffer.append(chunk, n);
+    }
+}
+
+void sendAll(int fd, std::string_view data) { ASSERT_EQ(send(fd, data.data(), data.size(), 0), ssize_t(data.size())); }
+
+// One server connection over a socketpair, run on its own thread.
+class Session {
+  public:
+    Session(WebSocketHandler handler, WebSocketOptions options = {}) {
+        EXPECT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, d_fds), 0);
+        const int fd = d_fds[0];
+        WebSocketTransport transport{
+            [fd](char* buf, size_t size) -> ssize_t { return recv(fd, buf, size, 0); },
+            [fd](const char* data, size_t size) -> ssize_t { return send(fd, data, size, MSG_NOSIGNAL); },
+            [fd](std::chrono::milliseconds timeout, int wakeFd) {
+                pollfd pfds[2] = {{fd, POLLIN, 0}, {wakeFd, POLLIN, 0}};
+                return poll(pfds, 2, static_cast<int>(timeout.count())) > 0 && pfds[0].revents != 0;
+            }};
+        d_connection = std::make_shared<WebSocketConnection>(std::move(transport), std::move(handler), options);
+        d_thread = std::thread([this]() {
+            HttpRequest upgrade;
+            upgrade.path = "/ws";
+            d_connection->run(upgrade);
+            d_finished = true;
+        });
+    }
+
+    ~Session() {
+        shutdown(d_fds[1], SHUT_RDWR);
+        d_thread.join();
+        close(d_fds[0]);
+        close(d_fds[1]);
+    }
+
+    int client() const { return d_fds[1]; }
+    const WebSocketPtr& connection() const { return d_connection; }
+    bool finished() const { return d_finished; }
+
+  private:
+    int d_fds[2];
+    WebSocketPtr d_connection;
+    std::atomic<bool> d_finished{false};
+    std::thread d_thread;
+};
+
+} // namespace
+
+TEST(WebSocketTests, AcceptKeyMatchesTheRfcExample) {
+    EXPECT_EQ(WebSocket::acceptKey("dGhlIHNhbXBsZSBub25jZQ=="), "s3pPLMBiTxaQ9kYGzzhZRbK+xOo=");
+}
+
+TEST(WebSocketTests, UnmaskMatchesBytewiseXorAtEverySizeAndAlignment) {
+    // GIVEN:
+    uint32_t key;
+    std::memcpy(&key, kMask, 4);
+    std::string source(300, '\0');
+    for (size_t i = 0; i < source.size(); i++) source[i] = static_cast<char>(i * 7 + 3);
+
+    for (size_t offset = 0; offset < 4; offset++) {
+        for (size_t size = 0; size + offset <= source.size(); size += 13) {
+            // WHEN:
+            std::string data = source;
+            WebSocket::unmask(data.data() + offset, size, key);
+
+            // THEN:
+            for (size_t i = 0; i < source.size(); i++) {
+                const bool inside = i >= offset && i < offset + size;
+                const char expected = inside ? static_cast<char>(source[i] ^ kMask[(i - offset) % 4]) : source[i];
+                ASSERT_EQ(data[i], expected) << "offset " << offset << " size " << size << " byte " << i;
+            }
+        }
+    }
+}
+
+TEST(WebSocketTests, FrameHeadersRoundTripAtEveryLengthEncoding) {
+    for (size_t length : {size_t(0), size_t(125), size_t(126), size_t(65535), size_t(65536)}) {
+        // GIVEN:
+        std::string frame;
+        WebSocket::writeFrame(frame, Opcode::Binary, std::string(length, 'x'), false);
+
+        // WHEN:
+        WebSocket::FrameHeader header;
+        ASSERT_TRUE(WebSocket::readFrameHeader(frame, header));
+
+        // THEN:
+        EXPECT_FALSE(header.fin);
+        EXPECT_EQ(header.opcode, Opcode::Binary);
+        EXPECT_FALSE(header.masked);
+        EXPECT_EQ(header.length, length);
+        EXPECT_EQ(header.size + length, frame.size());
+        EXPECT_FALSE(WebSocket::readFrameHeader(std::string_view(frame).substr(0, header.size - 1), header));
+    }
+}
+
+TEST(WebSocketTests, Utf8ValidationRejectsMalformedSequences) {
+    EXPECT_TRUE(WebSocket::isValidUtf8("plain ascii that is longer than eight bytes"));
+    EXPECT_TRUE(WebSocket::isValidUtf8("h\xc3\xa9llo \xe2\x82\xac \xf0\x9d\x84\x9e"));
+    EXPECT_FALSE(WebSocket::isValidUtf8("\xc0\xaf"));         // overlong '/'
+    EXPECT_FALSE(WebSocket::isValidUtf8("\xed\xa0\x80"));     // surrogate
+    EXPECT_FALSE(WebSocket::isValidUtf8("\xf4\x90\x80\x80")); // past U+10FFFF
+    EXPECT_FALSE(WebSocket::isValidUtf8("euro \xe2\x82"));    // truncated
+}
+
+TEST(WebSocketTests, HandshakeAcceptsOnlyVersion13Upgrades) {
+    // GIVEN:
+    HttpRequest req;
+    req.method = "GET";
+    req.path = "/ws";
+    req.version = "HTTP/1.1";
+    req.headers.emplace("upgrade", "WebSocket");
+    req.headers.emplace("Connection", "keep-alive, Upgrade");
+    req.headers.emplace("Sec-WebSocket-Key", "dGhlIHNhbXBsZSBub25jZQ==");
+    req.headers.emplace("Sec-WebSocket-Version", "13");
+    HttpRequest oldVersion = req;
+    oldVersion.headers.insert_or_assign("Sec-WebSocket-Version", "8");
+    HttpRequest plain = req;
+    plain.headers.erase("upgrade");
+
+    // WHEN:
+    HttpResponse accepted = WebSocket::handshake(req);
+    HttpResponse refused = WebSocket::handshake(oldVersion);
+    HttpResponse notUpgrade = WebSocket::handshake(plain);
+
+    // THEN:
+    EXPECT_EQ(accepted.code, StatusCode::SwitchingProtocols);
+    EXPECT_EQ(std::string(accepted.headers.at("Sec-WebSocket-Accept")), "s3pPLMBiTxaQ9kYGzzhZRbK+xOo=");
+    EXPECT_EQ(std::string(accepted.headers.at("Upgrade")), "websocket");
+    EXPECT_EQ(refused.code, StatusCode::BadRequest);
+    EXPECT_EQ(std::string(refused.headers.at("Sec-WebSocket-Version")), "13");
+    EXPECT_EQ(notUpgrade.code, StatusCode::BadRequest);
+}
+
+TEST(WebSocketTests, FragmentsAreReassembledAndPingsAnsweredInBetween) {
+    // GIVEN: a connection echoing every message
+    std::atomic<int> closeCode{0};
+    WebSocketHandler handler;
+    handler.onMessage = [](const WebSocketPtr& ws, std::string_view message, bool binary) {
+        if (binary) {
+            ws->sendBinary(message);
+        } else {
+            ws->send(message);
+        }
+    };
+    handler.onClose = [&closeCode](const WebSocketPtr&, CloseCode code) { closeCode = static_cast<int>(code); };
+    Session session(handler);
+    std::string buffer;
+
+    // WHEN: a text message arrives in two fragments with a ping between them
+    sendAll(session.client(), clientFrame(Opcode::Text, "Hel", false) + clientFrame(Opcode::Ping, "are you there") +
+                                  clientFrame(Opcode::Continuation, "lo"));
+
+    // THEN: the pong comes back, then the whole message
+    std::optional<Frame> pong = readFrame(session.client(), buffer);
+    ASSERT_TRUE(pong.has_value());
+    EXPECT_EQ(pong->opcode, Opcode::Pong);
+    EXPECT_EQ(pong->payload, "are you there");
+    std::optional<Frame> echo = readFrame(session.client(), buffer);
+    ASSERT_TRUE(echo.has_value());
+    EXPECT_EQ(echo->opcode, Opcode::Text);
+    EXPECT_EQ(echo->payload, "Hello");
+
+    // WHEN: the client closes
+    sendAll(session.client(), clientFrame(Opcode::Close, std::string("\x03\xe8", 2)));
+
+    // THEN: the close is echoed and the session ends
+    std::optional<Frame> closeFrame = readFrame(session.client(), buffer);
+    ASSERT_TRUE(closeFrame.has_value());
+    EXPECT_EQ(closeFrame->opcode, Opcode::Close);
+    EXPECT_EQ(closeFrame->payload, std::string("\x03\xe8", 2));
+    for (int i = 0; i < 200 && !session.finished(); i++) std::this_thread::sleep_for(5ms);
+    EXPECT_TRUE(session.finished());
+    EXPECT_EQ(closeCode, 1000);
+}
+
+TEST(WebSocketTests, ProtocolViolationsCloseTheConnection) {
+    // GIVEN: a small message limit
+    WebSocketOptions options;
+    options.maxMessageSize = 16;
+    Session tooBig({}, options);
+    Session unmasked({}, options);
+    std::string buffer;
+
+    // WHEN: a message over the limit, and an unmasked frame
+    sendAll(tooBig.client(), clientFrame(Opcode::Binary, std::string(17, 'x')));
+    std::string frame;
+    WebSocket::writeFrame(frame, Opcode::Text, "hi");
+    sendAll(unmasked.client(), frame);
+
+    // THEN:
+    std::optional<Frame> first = readFrame(tooBig.client(), buffer);
+    ASSERT_TRUE(first.has_value());
+    EXPECT_EQ(first->opcode, Opcode::Close);
+    EXPECT_EQ(first->payload, std::string("\x03\xf1", 2)); // 1009
+    buffer.clear();
+    std::optional<Frame> second = readFrame(unmasked.client(), buffer);
+    ASSERT_TRUE(second.has_value());
+    EXPECT_EQ(second->payload, std::string("\x03\xea", 2)); // 1002
+}
+
+TEST(WebSocketTests, HubBroadcastsOneEncodedFrameToEveryConnection) {
+    // GIVEN: two connections joined to a hub as they open
+    WebSocketHub hub;
+    WebSocketHandler handler;
+    handler.onOpen = [&hub](const WebSocketPtr& ws, const HttpRequest&) { hub.add(ws); };
+    handler.onClose = [&hub](const WebSocketPtr& ws, CloseCode) { hub.remove(ws.get()); };
+    Session a(handler);
+    Session b(handler);
+    while (hub.size() < 2) std::this_thread::sleep_for(1ms);
+
+    // WHEN: a message is broadcast from this thread, then one connection
+    // is closed from it
+    EXPECT_EQ(hub.broadcast("to everyone"), 2u);
+    a.connection()->close(CloseCode::GoingAway, "bye");
+
+    // THEN: both receive it, and the closed one then gets its Close frame
+    std::string bufferA;
+    std::string bufferB;
+    std::optional<Frame> atA = readFrame(a.client(), bufferA);
+    std::optional<Frame> atB = readFrame(b.client(), bufferB);
+    ASSERT_TRUE(atA.has_value() && atB.has_value());
+    EXPECT_EQ(atA->payload, "to everyone");
+    EXPECT_EQ(atB->payload, "to everyone");
+    std::optional<Frame> closing = readFrame(a.client(), bufferA);
+    ASSERT_TRUE(closing.has_value());
+    EXPECT_EQ(closing->opcode, Opcode::Close);
+    EXPECT_EQ(closing->payload, std::string("\x03\xe9") + "bye");
+    EXPECT_FALSE(a.connection()->send("too late"));
+    EXPECT_EQ(hub.broadcast("again"), 1u);
+}
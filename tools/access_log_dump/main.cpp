@@ -0,0 +1,106 @@
+#include <httpserver/access_log.h>
+#include <httpserver/client_address.h>
+#include <httpserver/phase_timing.h>
+
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+#include <string>
+
+using namespace HTTPServer;
+
+static std::string formatTimestamp(uint64_t timestampNs) {
+    std::time_t seconds = static_cast<std::time_t>(timestampNs / 1000000000ULL);
+    unsigned long micros = static_cast<unsigned long>((timestampNs % 1000000000ULL) / 1000ULL);
+
+    std::tm utc{};
+    gmtime_r(&seconds, &utc);
+
+    char buf[64];
+    size_t len = std::strftime(buf, sizeof(buf), "%Y-%m-%dT%H:%M:%S", &utc);
+    std::snprintf(buf + len, sizeof(buf) - len, ".%06luZ", micros);
+    return buf;
+}
+
+static std::string csvQuote(const std::string& value) {
+    std::string out = "\"";
+    for (char c : value) {
+        if (c == '"') out.push_back('"');
+        out.push_back(c);
+    }
+    out.push_back('"');
+    return out;
+}
+
+static void usage(const char* argv0) {
+    std::cerr << "Usage: " << argv0 << " [--csv] <access-log-file>\n";
+}
+
+int main(int argc, char** argv) {
+    bool csv = false;
+    std::string path;
+
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--csv") == 0) {
+            csv = true;
+        } else if (path.empty()) {
+            path = argv[i];
+        } else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+
+    if (path.empty()) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    if (csv) {
+        std::cout << "timestamp,client_ip,client_port,method,path,status,bytes,latency_us,tls";
+        for (size_t i = 0; i < kPhaseCount; i++) {
+            std::cout << ',' << phaseName(static_cast<Phase>(i)) << "_us";
+        }
+        std::cout << '\n';
+    }
+
+    bool ok = AccessLog::forEachRecord(path, [csv](const AccessLogRecord& record) {
+        ClientAddress client;
+        std::memcpy(client.bytes.data(), record.clientAddr, client.bytes.size());
+        client.port = record.clientPort;
+        client.unixSocket = (record.flags & AccessLogRecord::kFlagUnixSocket) != 0;
+
+        std::string method(record.method, strnlen(record.method, sizeof(record.method)));
+        std::string requestPath(record.path, record.pathLength);
+        bool tls = (record.flags & AccessLogRecord::kFlagTLS) != 0;
+        bool phases = (record.flags & AccessLogRecord::kFlagPhases) != 0;
+
+        if (csv) {
+            std::cout << formatTimestamp(record.timestampNs) << ',' << client.ip() << ',' << client.port << ','
+                      << method << ',' << csvQuote(requestPath) << ',' << record.status << ',' << record.bytesSent
+                      << ',' << record.latencyUs << ',' << (tls ? 1 : 0);
+            for (size_t i = 0; i < kPhaseCount; i++) {
+                std::cout << ',';
+                if (phases) std::cout << record.phaseUs[i];
+            }
+            std::cout << '\n';
+        } else {
+            std::cout << formatTimestamp(record.timestampNs) << ' ' << client.toString() << ' ' << method << ' '
+                      << requestPath << ' ' << record.status << ' ' << record.bytesSent << "B "
+                      << record.latencyUs << "us" << (tls ? " TLS" : "");
+            if (phases) {
+                for (size_t i = 0; i < kPhaseCount; i++) {
+                    std::cout << ' ' << phaseName(static_cast<Phase>(i)) << '=' << record.phaseUs[i] << "us";
+                }
+            }
+            std::cout << '\n';
+        }
+    });
+
+    if (!ok) {
+        std::cerr << "Failed to read access log: " << path << "\n";
+        return 1;
+    }
+    return 0;
+}